@@ -0,0 +1,29 @@
+#ifndef G4DataCollect_StepFilterExpr_hh
+#define G4DataCollect_StepFilterExpr_hh
+
+#include "G4Interfaces/StepFilterBase.hh"
+#include "G4ExprParser/G4SteppingASTBuilder.hh"
+
+//Step filter accepting steps for which a boolean G4ExprParser expression (the
+//same language as used for filters of heatmaps and MCPL files) evaluates to
+//true. For instance: "step.volname == \"Detector\" && step.edep > 0.1 keV".
+//
+//The expression is compiled once, when the filter is initialised. Note that
+//G4Launcher::Launcher::setFilter(const char*) creates and validates such a
+//filter directly from an expression.
+
+class StepFilterExpr : public G4Interfaces::StepFilterBase {
+public:
+  StepFilterExpr();
+  virtual ~StepFilterExpr(){}
+  virtual void initFilter();
+  virtual bool filterStep(const G4Step*) const;
+private:
+  virtual bool validateParameters();
+  mutable G4ExprParser::G4SteppingASTBuilder m_builder;
+  ExprParser::Evaluator<bool> m_eval;
+  std::string m_expr;//currently compiled expression
+  int m_constval;//-1 if not constant
+};
+
+#endif
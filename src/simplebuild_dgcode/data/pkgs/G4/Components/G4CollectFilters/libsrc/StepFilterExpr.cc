@@ -0,0 +1,50 @@
+#include "G4CollectFilters/StepFilterExpr.hh"
+#include "G4Step.hh"
+#include <cstdio>
+
+StepFilterExpr::StepFilterExpr()
+  : G4Interfaces::StepFilterBase("G4CollectFilters/StepFilterExpr"),
+    m_constval(-1)
+{
+  addParameterString("expression","");
+}
+
+bool StepFilterExpr::validateParameters()
+{
+  if (getParameterString("expression").empty()) {
+    printf("StepFilterExpr ERROR: Please specify an expression!\n");
+    return false;
+  }
+  return true;
+}
+
+void StepFilterExpr::initFilter()
+{
+  //Might be called both when validating a filter created from a string and
+  //again by the data collection, so only compile if the expression changed:
+  std::string expr = getParameterString("expression");
+  if (m_eval.arg() && expr == m_expr)
+    return;
+  try {
+    m_eval = m_builder.createEvaluator<bool>(expr);
+  } catch (ExprParser::InputError& e) {
+    printf("\nStepFilterExpr ERROR: Invalid filter expression \"%s\"\n",expr.c_str());
+    printf("StepFilterExpr ERROR: %s : %s\n\n",e.epType(),e.epWhat());
+    throw;
+  }
+  m_expr = expr;
+  m_constval = -1;
+  if (m_eval.isConstant()) {
+    m_constval = m_eval() ? 1 : 0;
+    if (!m_constval)
+      printf("StepFilterExpr WARNING: Specified filter \"%s\" always evaluates to false\n",expr.c_str());
+  }
+}
+
+bool StepFilterExpr::filterStep(const G4Step*step) const
+{
+  if (m_constval!=-1)
+    return m_constval;
+  m_builder.setCurrentStep(step);
+  return m_eval();
+}
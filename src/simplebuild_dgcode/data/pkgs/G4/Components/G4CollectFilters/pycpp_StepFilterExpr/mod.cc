@@ -0,0 +1,7 @@
+#include "G4Interfaces/StepFilterPyExport.hh"
+#include "G4CollectFilters/StepFilterExpr.hh"
+
+PYTHON_MODULE( mod )
+{
+  StepFilterPyExport::exportFilter<StepFilterExpr>(mod, "StepFilterExpr");
+}
@@ -2,6 +2,7 @@
 #define G4ExprParser_G4SteppingASTBuilder_hh
 
 #include "ExprParser/ASTBuilder.hh"
+#include "ExprParser/SharedExprSet.hh"
 
 class G4Step;
 
@@ -19,8 +20,23 @@ namespace G4ExprParser {
     virtual ~G4SteppingASTBuilder(){}
 
     //Must always set current step here before attempting to evaluate expression
-    //trees built with this class:
-    void setCurrentStep(const G4Step* step) { m_currentStep = step; }
+    //trees built with this class (also when G4 reuses the same G4Step object
+    //for the next step):
+    void setCurrentStep(const G4Step* step) { m_currentStep = step; m_shared.nextGeneration(); }
+
+    //Like createEvaluator, but all evaluators created by this method share
+    //their common subexpressions (see ExprParser/SharedExprSet.hh). Thus, when
+    //several expressions are evaluated on the same step (like filter and
+    //quantity expressions of several heatmaps), data extracted from the step
+    //like step.pre.ekin, and anything calculated from it, is only computed once
+    //per step:
+    template<class TValue>
+    ExprParser::Evaluator<TValue> createSharedEvaluator(const str_type& expr)
+    {
+      auto evaluator = createEvaluator<TValue>(expr);
+      evaluator.setArg(m_shared.add(evaluator.arg()));
+      return evaluator;
+    }
 
     //Better disallow copy/move/assign, because after copying previously created
     //expressions will still refer to m_currentStep in the original builder,
@@ -33,6 +49,8 @@ namespace G4ExprParser {
   protected:
     virtual ExprEntityPtr createValue(const str_type& name) const;
     const G4Step * m_currentStep;
+  private:
+    ExprParser::SharedExprSet m_shared;
   };
 
 }
@@ -4,19 +4,166 @@
 #include "G4TransportationManager.hh"
 #include "G4Navigator.hh"
 #include "G4Material.hh"
+#include "G4VSolid.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Version.hh"
+#if defined(G4MULTITHREADED) && G4VERSION_NUMBER >= 1070
+#  include "G4GeometryWorkspace.hh"
+#  include "G4SolidsWorkspace.hh"
+#  define G4HEATMAP_THREAD_WORKSPACES
+#endif
+#include <thread>
+#include <exception>
+#include <algorithm>
+#include <set>
+#include <cmath>
 
 #include "RandUtils/Rand.hh"//Use dedicated random stream, don't disturb G4 random stream
 
+// Density maps are built by tracing rays parallel to the z-axis through the
+// geometry, one column of cells (ix,iy) at a time, at nsample_per_cell random
+// (x,y) positions within the column. Along each ray, the navigator moves from
+// boundary to boundary, so the cost is proportional to the number of volumes
+// crossed rather than to nz*nsample_per_cell point locations, and the density
+// in each cell is the exact length-weighted average along the ray.
+//
+// Columns are distributed over threads in interleaved slabs of constant x,
+// each thread using its own navigator. Random numbers are seeded per column,
+// so results only depend on the seed and not on the number of threads.
+//
+// In multi-threaded Geant4 builds, the solids and materials of logical volumes
+// (and the positions of replicated volumes) are kept in per-thread data, which
+// Geant4 only sets up in its own worker threads. Our threads therefore set up
+// their own copy of this data from that of the master thread, in geometry and
+// solids workspaces (as done by G4WorkerThread). This requires Geant4 10.7 or
+// later, so older multi-threaded builds use a single thread. In sequential
+// builds, all threads share the geometry, so a single thread is used when
+// navigation would modify it (replicated or parameterised volumes).
+
+namespace G4HeatMap_DensityMap {
+
+  class RayTracer {
+  public:
+    RayTracer(G4VPhysicalVolume* world, double zmin, double zmax, long nz)
+      : m_world(world->GetLogicalVolume()->GetSolid()),
+        m_zmin(zmin), m_zmax(zmax), m_dz((zmax-zmin)/nz), m_nz(nz)
+    {
+      m_nav.SetWorldVolume(world);
+    }
+
+    //Add integral of density along ray at (x,y) to cells (in units of
+    //density*length):
+    void trace(double x, double y, double * cells)
+    {
+      const G4ThreeVector dir(0.0,0.0,1.0);
+      const double minstep = 1e-9*CLHEP::mm;
+      G4ThreeVector p(x,y,m_zmin);
+      double z = m_zmin;
+      bool relative = false;
+      while ( z < m_zmax ) {
+        if ( m_world->Inside(p) == kOutside ) {
+          //Gap in non-box world, contributes no density:
+          double d = m_world->DistanceToIn(p,dir);
+          if ( d == kInfinity )
+            return;
+          z += std::max(d,minstep);
+          p.setZ(z);
+          relative = false;
+          continue;
+        }
+        G4VPhysicalVolume* pv = m_nav.LocateGlobalPointAndSetup(p,&dir,relative,false);
+        relative = true;
+        double safety;
+        double step = pv ? m_nav.ComputeStep(p,dir,m_zmax-z,safety) : minstep;
+        if ( step == kInfinity || step > m_zmax - z )
+          step = m_zmax - z;
+        step = std::max(step,minstep);
+        if ( pv )
+          deposit(z,z+step,pv->GetLogicalVolume()->GetMaterial()->GetDensity(),cells);
+        z += step;
+        p.setZ(z);
+        m_nav.SetGeometricallyLimitedStep();
+      }
+    }
+
+  private:
+    void deposit(double z0, double z1, double density, double * cells) const
+    {
+      z1 = std::min(z1,m_zmax);
+      long i0 = std::max<long>(0,long(std::floor((z0-m_zmin)/m_dz)));
+      long i1 = std::min<long>(m_nz-1,long(std::floor((z1-m_zmin)/m_dz)));
+      for ( long i = i0; i <= i1; ++i ) {
+        double l = std::min(z1,m_zmin+(i+1)*m_dz) - std::max(z0,m_zmin+i*m_dz);
+        if ( l > 0.0 )
+          cells[i] += density * l;
+      }
+    }
+    G4Navigator m_nav;
+    G4VSolid * m_world;
+    double m_zmin, m_zmax, m_dz;
+    long m_nz;
+  };
+
+  bool hasReplicas(G4LogicalVolume* lv, std::set<G4LogicalVolume*>& visited)
+  {
+    if ( !visited.insert(lv).second )
+      return false;
+    for ( std::size_t i = 0; i < std::size_t(lv->GetNoDaughters()); ++i ) {
+      G4VPhysicalVolume* d = lv->GetDaughter(i);
+      if ( d->IsReplicated() || hasReplicas(d->GetLogicalVolume(),visited) )
+        return true;
+    }
+    return false;
+  }
+
+  //Per-thread geometry data for the lifetime of the object (nothing needed in
+  //sequential builds):
+  class ThreadGeometry {
+  public:
+#ifdef G4HEATMAP_THREAD_WORKSPACES
+    ThreadGeometry()
+    {
+      G4GeometryWorkspace::GetPool()->CreateAndUseWorkspace();
+      G4SolidsWorkspace::GetPool()->CreateAndUseWorkspace();
+    }
+    ~ThreadGeometry()
+    {
+      G4SolidsWorkspace::GetPool()->ReleaseAndDestroyWorkspace();
+      G4GeometryWorkspace::GetPool()->ReleaseAndDestroyWorkspace();
+    }
+  private:
+    ThreadGeometry( const ThreadGeometry & );
+    ThreadGeometry & operator= ( const ThreadGeometry & );
+#else
+    ThreadGeometry() {}
+#endif
+  };
+
+  std::uint64_t columnSeed(std::uint64_t seed, long ix, long iy)
+  {
+    //splitmix64 finaliser of (seed,ix,iy):
+    std::uint64_t z = seed + 0x9E3779B97F4A7C15ULL * (1 + std::uint64_t(ix) + (std::uint64_t(iy)<<32));
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+}
+
 void py_createDensityMap(const std::string& outfile,
                          const std::string& comments,
                          long nsample_per_cell,
-                         long nx, long ny, long nz)
+                         long nx, long ny, long nz,
+                         long nthreads,
+                         std::uint64_t seed)
 {
+  namespace DM = G4HeatMap_DensityMap;
+  if ( nsample_per_cell < 1 || nx < 1 || ny < 1 || nz < 1 )
+    throw std::runtime_error("create_density_map: number of samples and cells must be positive");
   auto tm = G4TransportationManager::GetTransportationManager();
   assert(tm);
-  G4Navigator* nav = tm->GetNavigatorForTracking();
-  assert(nav);
+  G4VPhysicalVolume* world = tm->GetNavigatorForTracking()->GetWorldVolume();
+  assert(world);
   long n[3] = {nx, ny, nz};
   double lw[3];
   double up[3];
@@ -27,36 +174,75 @@ void py_createDensityMap(const std::string& outfile,
   Mesh::Mesh<3> mesh(n,lw,up,"Density map [g/cm3]",comments.c_str());
   mesh.setCellUnits("mm");
 
-  RandUtils::Rand rand;
-  G4ThreeVector p;
-  long idx[3];
-  G4VPhysicalVolume* last_pv(0);
-  double last_density(0.0);
-  for (idx[0] = 0; idx[0] < nx; ++idx[0])
-    for (idx[1] = 0; idx[1] < ny; ++idx[1])
-      for (idx[2] = 0; idx[2] < nz; ++idx[2]) {
-        long cellid = mesh.filler().cellIdCollapse(idx);
-        double density = 0.0;
-        for(long i=0; i<nsample_per_cell;++i) {
-          p.set(lw[0]+(idx[0]+rand.shoot())*dx,
-                lw[1]+(idx[1]+rand.shoot())*dy,
-                lw[2]+(idx[2]+rand.shoot())*dz);
-          G4VPhysicalVolume* pv = nav->LocateGlobalPointAndSetup(p);
-          assert(pv);
-          if (pv!=last_pv) {
-            last_density = pv->GetLogicalVolume()->GetMaterial()->GetDensity();
-            last_pv = pv;
-          }
-          density += last_density;
-        }
-        if (density)
-          mesh.filler().data()[cellid] = density/(nsample_per_cell*CLHEP::gram/CLHEP::cm3);
+  if ( nthreads <= 0 )
+    nthreads = std::max<long>(1,std::thread::hardware_concurrency());
+  nthreads = std::min(nthreads,nx);
+#if defined(G4MULTITHREADED) && !defined(G4HEATMAP_THREAD_WORKSPACES)
+  //Can not set up per-thread geometry data (see above):
+  if ( nthreads > 1 ) {
+    printf("DensityMap: Threads need Geant4 10.7 or later in multi-threaded builds, using a single thread\n");
+    nthreads = 1;
+  }
+#elif !defined(G4MULTITHREADED)
+  //Navigation in replicated or parameterised volumes modifies the shared
+  //physical volumes:
+  std::set<G4LogicalVolume*> visited;
+  if ( nthreads > 1 && DM::hasReplicas(world->GetLogicalVolume(),visited) ) {
+    printf("DensityMap: Geometry has replicated or parameterised volumes, using a single thread\n");
+    nthreads = 1;
+  }
+#endif
+
+  auto& data = mesh.filler().data();
+  const double norm = 1.0/(nsample_per_cell*dz*(CLHEP::gram/CLHEP::cm3));
+  auto work = [&](long ithread)
+  {
+    DM::RayTracer tracer(world,lw[2],up[2],nz);
+    std::vector<double> column(nz);
+    long idx[3];
+    for (idx[0] = ithread; idx[0] < nx; idx[0] += nthreads)
+      for (idx[1] = 0; idx[1] < ny; ++idx[1]) {
+        RandUtils::Rand rand(DM::columnSeed(seed,idx[0],idx[1]));
+        std::fill(column.begin(),column.end(),0.0);
+        for (long i = 0; i < nsample_per_cell; ++i)
+          tracer.trace(lw[0]+(idx[0]+rand.shoot())*dx,
+                       lw[1]+(idx[1]+rand.shoot())*dy,
+                       column.data());
+        for (idx[2] = 0; idx[2] < nz; ++idx[2])
+          if (column[idx[2]])
+            data[mesh.filler().cellIdCollapse(idx)] = column[idx[2]]*norm;
       }
+  };
+
+  if ( nthreads == 1 ) {
+    work(0);
+  } else {
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(nthreads);
+    for (long t = 0; t < nthreads; ++t)
+      threads.emplace_back([&work,&errors,t]()
+      {
+        try {
+          DM::ThreadGeometry geometry;
+          work(t);
+        } catch (...) {
+          errors[t] = std::current_exception();
+        }
+      });
+    for (auto& th : threads)
+      th.join();
+    for (auto& e : errors)
+      if (e)
+        std::rethrow_exception(e);
+  }
   mesh.enableStat("samples_per_cell") = nsample_per_cell;
   mesh.saveToFile(outfile);
 }
 
 PYTHON_MODULE( mod )
 {
-  mod.def("create_density_map",&py_createDensityMap);
+  mod.def("create_density_map",&py_createDensityMap,
+          py::arg("outfile"),py::arg("comments"),py::arg("nsample_per_cell"),
+          py::arg("nx"),py::arg("ny"),py::arg("nz"),
+          py::arg("nthreads")=0,py::arg("seed")=123456789);
 }
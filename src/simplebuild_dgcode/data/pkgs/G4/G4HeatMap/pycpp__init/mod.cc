@@ -24,6 +24,21 @@ namespace DMWriter {
   class HeatMapWriter;
 
   using HeatMapWriterPtr = std::shared_ptr<HeatMapWriter>;
+  using BuilderPtr = std::shared_ptr<G4ExprParser::G4SteppingASTBuilder>;
+
+  BuilderPtr sharedExprBuilder()
+  {
+    //All HeatMapWriters share a single builder, which the stepping action
+    //points at each step once, and filter and quantity expressions of all
+    //writers share common subexpressions:
+    static std::weak_ptr<G4ExprParser::G4SteppingASTBuilder> s_builder;
+    BuilderPtr b = s_builder.lock();
+    if (!b) {
+      b = std::make_shared<G4ExprParser::G4SteppingASTBuilder>();
+      s_builder = b;
+    }
+    return b;
+  }
 
   class HeatMapSteppingAction : public G4UserSteppingAction
   {
@@ -39,6 +54,7 @@ namespace DMWriter {
       : m_meshstat_nevts(0), m_meshstat_nsteps(0), m_meshstat_wsteps(0) {}
     virtual ~HeatMapSteppingAction();
     std::vector<HeatMapWriterPtr> m_heatmapwriters;
+    BuilderPtr m_expr_builder = sharedExprBuilder();
     static HeatMapSteppingAction * m_theInstance;
     double m_meshstat_nevts;
     double m_meshstat_nsteps;
@@ -92,7 +108,7 @@ namespace DMWriter {
     bool m_wrotefile;
     std::string m_comments;
 
-    G4ExprParser::G4SteppingASTBuilder m_expr_builder;
+    BuilderPtr m_expr_builder = sharedExprBuilder();
     ExprParser::Evaluator<bool> m_eval_filter;
     ExprParser::Evaluator<ExprParser::float_type> m_eval_quantity;
     std::string m_expr_filter;
@@ -142,6 +158,7 @@ namespace DMWriter {
     ++m_meshstat_nsteps;
     m_meshstat_wsteps += w;
     if (w) {
+      m_expr_builder->setCurrentStep(step);
       for ( auto& e : m_theInstance->m_heatmapwriters )
         e->processG4Step(step,w);
     }
@@ -215,13 +232,11 @@ namespace DMWriter {
   }
 
   void HeatMapWriter::processG4Step(const G4Step* step, double weight) {
-    //TODO: We could achieve less levels of indirection by having the stepping
-    //action own m_expr_builder and copy m_eval_filter onto our stepping action
-    //object as well (in an array with large max size, not a vector).
+    //NB: The stepping action already pointed the shared expression builder at
+    //the step.
     //
-    //Furthermore we could recognise constant factors in m_eval_quantity and
-    //only apply them once per cell at the end (for cheaper custom units).
-    m_expr_builder.setCurrentStep(step);
+    //TODO: We could recognise constant factors in m_eval_quantity and only
+    //apply them once per cell at the end (for cheaper custom units).
     if (!m_eval_filter())
       return;
     double val = m_eval_quantity();
@@ -269,7 +284,7 @@ namespace DMWriter {
   {
     m_expr_filter = expr;
     try {
-      m_eval_filter = m_expr_builder.createEvaluator<bool>(m_expr_filter);
+      m_eval_filter = m_expr_builder->createSharedEvaluator<bool>(m_expr_filter);
     } catch (ExprParser::InputError& e) {
       printf("\nHeatMapWriter ERROR: Invalid filter expression \"%s\"\n",m_expr_filter.c_str());
       printf("HeatMapWriter ERROR: %s : %s\n\n",e.epType(),e.epWhat());
@@ -285,7 +300,7 @@ namespace DMWriter {
   {
     m_expr_quantity = expr;
     try {
-      m_eval_quantity = m_expr_builder.createEvaluator<ExprParser::float_type>(m_expr_quantity);
+      m_eval_quantity = m_expr_builder->createSharedEvaluator<ExprParser::float_type>(m_expr_quantity);
     } catch (ExprParser::InputError& e) {
       printf("\nHeatMapWriter ERROR: Invalid quantity expression \"%s\"\n",m_expr_filter.c_str());
       printf("HeatMapWriter ERROR: %s : %s\n\n",e.epType(),e.epWhat());
@@ -0,0 +1,88 @@
+#ifndef G4Interfaces_ActionProfiler_hh
+#define G4Interfaces_ActionProfiler_hh
+
+#include "Core/Types.hh"
+#include <string>
+#include <chrono>
+#include <typeinfo>
+
+// Low-overhead profiling of the actions invoked during the event loop of a
+// Geant4 job (user stepping and event actions, step filters, generators, Griff
+// output, sensitive detectors, ...). It is off by default, in which case an
+// instrumented call costs nothing more than the test of a global flag.
+//
+// When enabled, all calls are counted but only every Nth call of each action is
+// timed (using std::chrono::steady_clock), and total times are estimated by
+// scaling the sampled times with the number of calls. Actions are instrumented
+// by registering them once and then placing a Scope object around each call:
+//
+//   static ActionProfiler::Entry * s_prof = ActionProfiler::registerAction("MyAction");
+//   ...
+//   ActionProfiler::Scope prof(s_prof);
+//
+// Registering the same name twice returns the same entry, and entries remain
+// valid for the lifetime of the process. Note that time spent in instrumented
+// actions called from within other instrumented actions is included in both.
+
+namespace ActionProfiler {
+
+  struct Entry {
+    std::string name;
+    std::uint64_t ncalls = 0;
+    std::uint64_t nsampled = 0;
+    std::chrono::steady_clock::duration tsampled = std::chrono::steady_clock::duration::zero();
+    unsigned countdown = 1;//calls until next sampled call
+  };
+
+  //Enable profiling, timing every sample_every'th call of each action (1 means
+  //timing all calls):
+  void enable(unsigned sample_every = 100);
+  bool enabled();
+  unsigned sampleEvery();
+
+  Entry * registerAction(const std::string& name);
+  //Demangled name of a class, for naming entries after the instrumented class:
+  std::string className(const std::type_info&);
+
+  //Table of all entries with calls, most expensive first (each line starting
+  //with prefix):
+  std::string table(const char * prefix = "");
+  void printTable(const char * prefix = "");
+
+  namespace detail {
+    extern bool s_enabled;
+    extern unsigned s_sampleEvery;
+  }
+
+  class Scope {
+  public:
+    explicit Scope(Entry * e)
+    {
+      if (detail::s_enabled)
+        start(e);
+    }
+    ~Scope()
+    {
+      if (m_entry)
+        m_entry->tsampled += std::chrono::steady_clock::now() - m_t0;
+    }
+    Scope( const Scope& ) = delete;
+    Scope& operator=( const Scope& ) = delete;
+  private:
+    Entry * m_entry = nullptr;
+    std::chrono::steady_clock::time_point m_t0;
+    void start(Entry * e)
+    {
+      ++e->ncalls;
+      if (--e->countdown)
+        return;
+      e->countdown = detail::s_sampleEvery;
+      ++e->nsampled;
+      m_entry = e;
+      m_t0 = std::chrono::steady_clock::now();
+    }
+  };
+
+}
+
+#endif
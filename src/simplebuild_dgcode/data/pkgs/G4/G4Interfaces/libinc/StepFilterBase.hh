@@ -27,14 +27,10 @@ namespace G4Interfaces {
     //reimplement if you need initialisation:
     virtual void initFilter() {};
 
-    bool negated() const {
-      if (m_negated==-1)
-        m_negated = getParameterBoolean("filter_negated") ? 1 : 0;
-      return m_negated;
-    }
+    bool negated() const { return m_negated.get(); }
   private:
     std::string m_name;
-    mutable int m_negated;
+    Utils::ParamHandle<bool> m_negated;
   };
 
 }
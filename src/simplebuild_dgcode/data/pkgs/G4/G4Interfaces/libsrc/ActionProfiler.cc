@@ -0,0 +1,93 @@
+#include "G4Interfaces/ActionProfiler.hh"
+#include "Utils/Format.hh"
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdlib>
+#include <cxxabi.h>
+
+namespace ActionProfiler {
+
+  namespace detail {
+    bool s_enabled = false;
+    unsigned s_sampleEvery = 100;
+  }
+
+  //deque, since entries must never move:
+  static std::deque<Entry> s_entries;
+
+  void enable(unsigned sample_every)
+  {
+    if (!sample_every)
+      throw std::runtime_error("ActionProfiler::enable: sample_every must be positive");
+    detail::s_sampleEvery = sample_every;
+    detail::s_enabled = true;
+  }
+
+  bool enabled() { return detail::s_enabled; }
+  unsigned sampleEvery() { return detail::s_sampleEvery; }
+
+  Entry * registerAction(const std::string& name)
+  {
+    for (auto& e : s_entries)
+      if (e.name == name)
+        return &e;
+    s_entries.emplace_back();
+    s_entries.back().name = name;
+    return &s_entries.back();
+  }
+
+  std::string className(const std::type_info& ti)
+  {
+    int status(0);
+    char * dm = abi::__cxa_demangle(ti.name(),nullptr,nullptr,&status);
+    std::string res( (status==0&&dm) ? dm : ti.name() );
+    std::free(dm);
+    return res;
+  }
+
+  std::string table(const char * prefix)
+  {
+    struct Row { const Entry * e; double total; };
+    std::vector<Row> rows;
+    double sumtotal(0.0);
+    for (auto& e : s_entries) {
+      if (!e.ncalls)
+        continue;
+      const double tsampled = std::chrono::duration<double>(e.tsampled).count();
+      const double total = e.nsampled ? tsampled * double(e.ncalls) / e.nsampled : 0.0;
+      rows.push_back({&e,total});
+      sumtotal += total;
+    }
+    std::stable_sort(rows.begin(),rows.end(),[](const Row& a, const Row& b) { return a.total > b.total; });
+    std::string res, tmp;
+    Utils::string_format(tmp,"%sAction profile (timing 1 in every %u calls of each action, totals are estimates):\n",
+                         prefix,detail::s_sampleEvery);
+    res += tmp;
+    Utils::string_format(tmp,"%s  %-50s %12s %10s %12s %11s %6s\n",prefix,"Action","Calls","Timed","Mean [ns]","Total [s]","Frac");
+    res += tmp;
+    for (auto& r : rows) {
+      const double mean = r.e->nsampled ? 1e9*std::chrono::duration<double>(r.e->tsampled).count()/r.e->nsampled : 0.0;
+      Utils::string_format(tmp,"%s  %-50s %12llu %10llu %12.1f %11.4g %5.1f%%\n",
+                           prefix,r.e->name.c_str(),(unsigned long long)r.e->ncalls,
+                           (unsigned long long)r.e->nsampled,mean,r.total,
+                           sumtotal ? 100.0*r.total/sumtotal : 0.0);
+      res += tmp;
+    }
+    if (rows.empty()) {
+      Utils::string_format(tmp,"%s  (no calls of instrumented actions)\n",prefix);
+      res += tmp;
+    }
+    return res;
+  }
+
+  void printTable(const char * prefix)
+  {
+    std::string t = table(prefix);
+    std::fputs(t.c_str(),stdout);
+    std::fflush(stdout);
+  }
+
+}
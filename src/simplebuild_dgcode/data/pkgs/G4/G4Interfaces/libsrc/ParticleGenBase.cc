@@ -1,5 +1,6 @@
 #include "G4Interfaces/ParticleGenBase.hh"
 #include "G4Interfaces/FrameworkGlobals.hh"
+#include "G4Interfaces/ActionProfiler.hh"
 #include "G4VUserPrimaryGeneratorAction.hh"
 #include "Randomize.hh"
 #include "CLHEP/Random/RandPoisson.h"
@@ -10,7 +11,7 @@
 class ParticleGenBaseAction : public G4VUserPrimaryGeneratorAction
 {
 public:
-  ParticleGenBaseAction(G4Interfaces::ParticleGenBase * g) : m_gen(g), m_first(true) {}
+  ParticleGenBaseAction(G4Interfaces::ParticleGenBase * g) : m_gen(g), m_first(true), m_prof(nullptr) {}
   virtual ~ParticleGenBaseAction(){}
   virtual void GeneratePrimaries(G4Event* evt)
   {
@@ -19,6 +20,7 @@ public:
     if (m_first) {
       m_gen->init();
       m_first=false;
+      m_prof = ActionProfiler::registerAction("ParticleGenerator["+m_gen->getNameStr()+"]::gen");
     }
 
     //Fire pre-generation callbacks:
@@ -30,7 +32,10 @@ public:
     }
 
     //Actual event generation:
-    m_gen->gen(evt);
+    {
+      ActionProfiler::Scope prof(m_prof);
+      m_gen->gen(evt);
+    }
 
     //Fire post-generation callbacks:
     {
@@ -43,6 +48,7 @@ public:
 private:
   G4Interfaces::ParticleGenBase * m_gen;
   bool m_first;
+  ActionProfiler::Entry * m_prof;
 };
 
 G4VUserPrimaryGeneratorAction * G4Interfaces::ParticleGenBase::getAction()
@@ -2,10 +2,9 @@
 
 G4Interfaces::StepFilterBase::StepFilterBase(const char*name)
   : Utils::ParametersBase(),
-    m_name(name),
-    m_negated(-1)
+    m_name(name)
 {
-  addParameterBoolean("filter_negated",false);
+  m_negated = addParameterBoolean("filter_negated",false);
 }
 
 const char* G4Interfaces::StepFilterBase::getName() const
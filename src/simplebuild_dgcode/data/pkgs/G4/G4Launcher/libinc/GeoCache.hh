@@ -0,0 +1,60 @@
+#ifndef G4Launcher_GeoCache_hh
+#define G4Launcher_GeoCache_hh
+
+#include "G4Interfaces/GeoConstructBase.hh"
+#include "G4VUserDetectorConstruction.hh"
+#include <string>
+
+//Detector construction wrapping a GeoConstructBase, which keeps a binary
+//description of the constructed volume tree in a cache directory. On a cache
+//hit, the volumes are rebuilt directly from the description, without calling
+//Construct() on the geometry (and without checking for overlaps, since that was
+//already done when the entry was created).
+//
+//Entries are keyed on the geometry name and parameters and the Geant4 version,
+//as well as on the size and modification time of:
+//
+//  * The library (or executable) containing the geometry class.
+//  * All loaded package libraries (libPKG__*), since the geometry might use
+//    code from other packages (base classes, materials, helpers, ...).
+//  * All files below $SBLD_DATA_DIR.
+//  * Any files named by string parameters of the geometry.
+//
+//Changes to other files read in Construct() are NOT detected, so the cache
+//must be cleared by hand after changing such files.
+//
+//Only geometries consisting of G4PVPlacements of common CSG solids
+//(boxes, tubes, cones, spheres, orbs and trapezoids, possibly combined in
+//boolean solids) made of materials from the NamedMaterialProvider or the NIST
+//database are cached. For anything else (replicas, parameterised volumes,
+//sensitive detectors, fields, user limits, regions or optical surfaces
+//created in Construct(), ...) the geometry is simply constructed as usual.
+//
+//ConstructSDandField() is forwarded to the wrapped geometry, which must
+//therefore not depend on state set up in its Construct() method.
+
+namespace G4Launcher {
+
+  class CachedGeoConstruction : public G4VUserDetectorConstruction {
+  public:
+    //Takes ownership of geo:
+    CachedGeoConstruction(G4Interfaces::GeoConstructBase* geo, const std::string& cachedir);
+    virtual ~CachedGeoConstruction();
+
+    G4VPhysicalVolume* Construct() override;
+    void ConstructSDandField() override;
+
+    G4Interfaces::GeoConstructBase* geo() const { return m_geo; }
+
+    //Human readable key of the cache entry for the geometry in its current
+    //state (empty if the library of the geometry can not be determined):
+    std::string cacheKey() const;
+
+  private:
+    G4Interfaces::GeoConstructBase* m_geo;
+    std::string m_dir;
+  };
+
+}
+
+#endif
@@ -78,8 +78,14 @@ namespace G4Launcher {
     //Optionally set the filter for which steps are written to Griff files:
     void setFilter(G4Interfaces::StepFilterBase*);
 
+    //Or set it as a G4ExprParser expression like "step.volname==\"Detector\"
+    //&& step.edep>0" (compiled once, invalid expressions raise exceptions
+    //immediately):
+    void setFilter(const char * expression);
+
     //A different stronger filter which actually also kills steps to prevent further simulations:
     void setKillFilter(G4Interfaces::StepFilterBase*);
+    void setKillFilter(const char * expression);
 
     //Optionally pick a physics list. Default is "QGSP_BIC_HP_EMZ" (except "QGSP_BIC_HP" is default for Geant4 versions older than v10.3)
     void setPhysicsList(const char *);//For picking a G4 reference list
@@ -118,6 +124,53 @@ namespace G4Launcher {
     void setRndEvtMsgMode(const char * mode);
     const std::string& rndEvtMsgMode() const;//mode or empty if setRndEvtMsgMode never called
 
+    //How event seeds are derived from the seed (see G4Random/RandomManager.hh
+    //for details). Mode must be "CHAINED" (default) or "INDEXED". In INDEXED
+    //mode, each event seed is a function of the seed and the global event index
+    //only, so results do not depend on the number of processes, and any event
+    //can be rerun alone by setting the index of the first event:
+    void setSeedMode(const char * mode);
+    const std::string& seedMode() const;//mode or empty if setSeedMode never called
+    void setFirstEventIndex(std::uint64_t);//only allowed in INDEXED mode
+    std::uint64_t firstEventIndex() const;
+
+    //Opt-in cache of physics tables, using the Geant4 store/retrieve physics
+    //table mechanism. Entries are keyed on Geant4 version, physics list,
+    //geometry parameters, materials, default cut value and all commands
+    //applied during initialisation. On a cache miss, tables are stored after
+    //the simulation, and on a hit they are retrieved rather than built at the
+    //start of the simulation (processes not supporting this, like many
+    //hadronic ones, will still build their data as usual). An empty dir means
+    //$G4LAUNCHER_PHYSCACHEDIR or /tmp/$USER/dgcode_g4physcache:
+    void setPhysicsTableCache(const char * dir = "");
+    const std::string& physicsTableCache() const;//empty if not enabled
+
+    //Opt-in cache of the constructed geometry (see G4Launcher/GeoCache.hh). On
+    //a hit, the volumes are rebuilt from a binary description rather than by
+    //calling Construct() on the geometry. Entries are keyed on the geometry
+    //name and parameters, the Geant4 version, all loaded package libraries and
+    //the package data files. Geometries with volumes or materials which can
+    //not be described (e.g. replicas or materials not from the
+    //NamedMaterialProvider) are simply constructed as usual. An empty dir means $G4LAUNCHER_GEOCACHEDIR or the
+    //directory /tmp/$USER/dgcode_geocache:
+    void setGeometryCache(const char * dir = "");
+    const std::string& geometryCache() const;//empty if not enabled
+
+    //Print the wall-clock time spent in each phase of the initialisation (and
+    //in creating each named material), once the first event is about to be
+    //generated:
+    void setReportInitTimings(bool b = true);
+    bool reportInitTimings() const;
+
+    //Built-in low-overhead profiling of the actions invoked during the event
+    //loop (see G4Interfaces/ActionProfiler.hh). All calls of the generator,
+    //step filters, Griff output and user actions registered below are counted,
+    //and every sample_every'th call of each is timed. A table with estimated
+    //time spent in each is printed after the simulation and embedded in the
+    //Griff metadata (key "ActionProfile"). Must be called before init():
+    void setProfileActions(unsigned sample_every = 100);
+    unsigned profileActions() const;//0 if not enabled
+
     //To avoid conflicts with the GRIFF file hooks, register custom stepping and
     //event actions here rather than with the run-manager. Note that you should
     //only construct your action class instances *after* calling init() on the
@@ -0,0 +1,772 @@
+#include "G4Launcher/GeoCache.hh"
+#include "G4Interfaces/FrameworkGlobals.hh"
+#include "G4Materials/NamedMaterialProvider.hh"
+#include "Utils/ByteStream.hh"
+#include "G4Utils/Flush.hh"
+#include "G4PVPlacement.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VisAttributes.hh"
+#include "G4Material.hh"
+#include "G4Box.hh"
+#include "G4Tubs.hh"
+#include "G4Cons.hh"
+#include "G4Sphere.hh"
+#include "G4Orb.hh"
+#include "G4Trd.hh"
+#include "G4UnionSolid.hh"
+#include "G4SubtractionSolid.hh"
+#include "G4IntersectionSolid.hh"
+#include "G4DisplacedSolid.hh"
+#include "G4LogicalBorderSurface.hh"
+#include "G4LogicalSkinSurface.hh"
+#include "G4Version.hh"
+#include <map>
+#include <array>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <link.h>
+#include <unistd.h>
+
+namespace G4Launcher_impl_geocache {
+
+  static const std::uint32_t s_magic = 0x43474744;//"DGGC"
+  static const std::uint32_t s_formatVersion = 2;
+
+  enum SolidType : std::uint8_t { BOX, TUBS, CONS, SPHERE, ORB, TRD,
+                                  UNION, SUBTRACTION, INTERSECTION, DISPLACED };
+  enum VisMode : std::uint8_t { VIS_NONE, VIS_ATTRIBUTES };
+  enum VisFlags : std::uint8_t { VISF_VISIBLE = 1, VISF_DAUGHTERSINVISIBLE = 2, VISF_FORCESTYLE = 4,
+                                 VISF_FORCEAUXEDGE = 8, VISF_AUXEDGEVISIBLE = 16, VISF_FORCELINESEGMENTS = 32 };
+
+  //The visualisation attributes of a logical volume (all of G4VisAttributes
+  //except attribute definitions and values for picking):
+  struct VisRec {
+    std::uint8_t flags = 0;
+    std::uint8_t linestyle = 0;
+    std::uint8_t style = 0;//forced drawing style
+    std::array<double,4> rgba = {{1.0,1.0,1.0,1.0}};
+    double linewidth = 1.0;
+    std::int32_t linesegments = 0;
+    std::int32_t cloudpoints = 0;
+    double starttime = 0.0;
+    double endtime = 0.0;
+    bool operator<(const VisRec& o) const
+    {
+      return std::tie(flags,linestyle,style,rgba,linewidth,linesegments,cloudpoints,starttime,endtime)
+        < std::tie(o.flags,o.linestyle,o.style,o.rgba,o.linewidth,o.linesegments,o.cloudpoints,o.starttime,o.endtime);
+    }
+  };
+
+  VisRec visRec(const G4VisAttributes& vis)
+  {
+    VisRec v;
+    v.flags = std::uint8_t( ( vis.IsVisible() ? VISF_VISIBLE : 0 )
+                            | ( vis.IsDaughtersInvisible() ? VISF_DAUGHTERSINVISIBLE : 0 )
+                            | ( vis.IsForceDrawingStyle() ? VISF_FORCESTYLE : 0 )
+                            | ( vis.IsForceAuxEdgeVisible() ? VISF_FORCEAUXEDGE : 0 )
+#if G4VERSION_NUMBER >= 1040
+                            | ( vis.IsForcedAuxEdgeVisible() ? VISF_AUXEDGEVISIBLE : 0 )
+#else
+                            | VISF_AUXEDGEVISIBLE
+#endif
+                            | ( vis.IsForceLineSegmentsPerCircle() ? VISF_FORCELINESEGMENTS : 0 ) );
+    const G4Colour& c = vis.GetColour();
+    v.rgba = {{ c.GetRed(), c.GetGreen(), c.GetBlue(), c.GetAlpha() }};
+    v.linestyle = std::uint8_t(vis.GetLineStyle());
+    v.linewidth = vis.GetLineWidth();
+    v.style = std::uint8_t(vis.GetForcedDrawingStyle());
+    v.linesegments = vis.GetForcedLineSegmentsPerCircle();
+#if G4VERSION_NUMBER >= 1060
+    v.cloudpoints = vis.GetForcedNumberOfCloudPoints();
+#endif
+    v.starttime = vis.GetStartTime();
+    v.endtime = vis.GetEndTime();
+    return v;
+  }
+
+  G4VisAttributes * createVisAttributes(const VisRec& v)
+  {
+    auto vis = new G4VisAttributes(G4Colour(v.rgba[0],v.rgba[1],v.rgba[2],v.rgba[3]));
+    vis->SetVisibility((v.flags&VISF_VISIBLE)!=0);
+    vis->SetDaughtersInvisible((v.flags&VISF_DAUGHTERSINVISIBLE)!=0);
+    vis->SetLineStyle(G4VisAttributes::LineStyle(v.linestyle));
+    vis->SetLineWidth(v.linewidth);
+    if (v.flags&VISF_FORCESTYLE) {
+      if (v.style==G4VisAttributes::wireframe)
+        vis->SetForceWireframe(true);
+      else if (v.style==G4VisAttributes::solid)
+        vis->SetForceSolid(true);
+#if G4VERSION_NUMBER >= 1060
+      else if (v.style==G4VisAttributes::cloud)
+        vis->SetForceCloud(true);
+#endif
+    }
+#if G4VERSION_NUMBER >= 1060
+    if (v.cloudpoints>0)
+      vis->SetForceNumberOfCloudPoints(v.cloudpoints);
+#endif
+    if (v.flags&VISF_FORCEAUXEDGE)
+      vis->SetForceAuxEdgeVisible((v.flags&VISF_AUXEDGEVISIBLE)!=0);
+    if (v.flags&VISF_FORCELINESEGMENTS)
+      vis->SetForceLineSegmentsPerCircle(v.linesegments);
+    vis->SetStartTime(v.starttime);
+    vis->SetEndTime(v.endtime);
+    return vis;
+  }
+
+  std::uint64_t hash(const std::string& s)
+  {
+    //64bit FNV-1a:
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : s) {
+      h ^= c;
+      h *= 0x100000001b3ULL;
+    }
+    return h;
+  }
+
+  class Writer {
+  public:
+    template<class T>
+    void put(const T& t)
+    {
+      const std::size_t n = m_buf.size();
+      m_buf.resize(n+ByteStream::nbytesToWrite(t));
+      char * data = &m_buf[n];
+      ByteStream::write(data,t);
+    }
+    void putTransform(const G4RotationMatrix& rot, const G4ThreeVector& trans)
+    {
+      auto r = rot.rep3x3();
+      for (double v : { r.xx_, r.xy_, r.xz_, r.yx_, r.yy_, r.yz_, r.zx_, r.zy_, r.zz_,
+                        trans.x(), trans.y(), trans.z() })
+        put(v);
+    }
+    void append(const Writer& o) { m_buf += o.m_buf; }
+    const std::string& data() const { return m_buf; }
+  private:
+    std::string m_buf;
+  };
+
+  class Reader {
+  public:
+    Reader(const char * begin, const char * end) : m_data(begin), m_end(end) {}
+    template<class T>
+    void get(T& t)
+    {
+      need(sizeof(T));
+      ByteStream::read(m_data,t);
+    }
+    void get(std::string& s)
+    {
+      std::uint16_t n;
+      get(n);
+      need(n);
+      s.assign(m_data,n);
+      m_data += n;
+    }
+    template<class T>
+    T get() { T t; get(t); return t; }
+    G4Transform3D getTransform()
+    {
+      double v[12];
+      for (auto& e : v)
+        get(e);
+      CLHEP::HepRep3x3 r(v[0],v[1],v[2],v[3],v[4],v[5],v[6],v[7],v[8]);
+      return G4Transform3D(G4RotationMatrix(r),G4ThreeVector(v[9],v[10],v[11]));
+    }
+    std::size_t getCount()
+    {
+      //Each item takes at least one byte, so larger counts are from corrupt data:
+      auto n = get<std::uint32_t>();
+      need(n);
+      return n;
+    }
+    bool atEnd() const { return m_data == m_end; }
+  private:
+    const char * m_data;
+    const char * m_end;
+    void need(std::size_t n)
+    {
+      if (std::size_t(m_end-m_data) < n)
+        throw std::runtime_error("truncated geometry cache entry");
+    }
+  };
+
+  //Records the volume tree below the world volume, or the reason why it can
+  //not be recorded:
+  class Encoder {
+  public:
+    bool encode(const G4VPhysicalVolume * world)
+    {
+      if (G4LogicalBorderSurface::GetNumberOfBorderSurfaces() || G4LogicalSkinSurface::GetNumberOfSkinSurfaces())
+        return fail("optical surfaces are defined");
+      return addPV(world,-1);
+    }
+    const std::string& failReason() const { return m_failReason; }
+    std::string data() const
+    {
+      Writer w;
+      w.put(std::uint32_t(m_mats.size()));
+      for (auto& m : m_mats)
+        w.put(m);
+      w.put(std::uint32_t(m_solidIdx.size()));
+      w.append(m_solids);
+      w.put(std::uint32_t(m_lvIdx.size()));
+      w.append(m_lvs);
+      w.put(m_npvs);
+      w.append(m_pvs);
+      return w.data();
+    }
+
+  private:
+    std::string m_failReason;
+    std::map<const G4Material*,std::uint32_t> m_matIdx;
+    std::vector<std::string> m_mats;
+    std::map<const G4VSolid*,std::uint32_t> m_solidIdx;
+    Writer m_solids;
+    std::map<const G4LogicalVolume*,std::uint32_t> m_lvIdx;
+    Writer m_lvs;
+    std::uint32_t m_npvs = 0;
+    Writer m_pvs;
+
+    bool fail(const std::string& reason)
+    {
+      m_failReason = reason;
+      return false;
+    }
+
+    bool checkName(const std::string& name)
+    {
+      return name.size() < std::numeric_limits<std::uint16_t>::max() || fail("name too long: "+name.substr(0,50));
+    }
+
+    bool addMaterial(const G4Material * mat, std::uint32_t& idx)
+    {
+      auto it = m_matIdx.find(mat);
+      if (it != m_matIdx.end()) {
+        idx = it->second;
+        return true;
+      }
+      std::string s = NamedMaterialProvider::materialString(mat);
+      if (s.empty() && mat->GetName().rfind("G4_",0)==0)
+        s = mat->GetName();//from the NIST database
+      if (s.empty())
+        return fail("material "+mat->GetName()+" was not created by the NamedMaterialProvider");
+      if (!checkName(s))
+        return false;
+      idx = std::uint32_t(m_mats.size());
+      m_matIdx[mat] = idx;
+      m_mats.push_back(s);
+      return true;
+    }
+
+    bool addSolid(const G4VSolid * solid, std::uint32_t& idx)
+    {
+      auto it = m_solidIdx.find(solid);
+      if (it != m_solidIdx.end()) {
+        idx = it->second;
+        return true;
+      }
+      //Use the entity type rather than dynamic_cast, since derived classes
+      //might not be described by the parameters of their base class:
+      const std::string type = solid->GetEntityType();
+      Writer w;
+      if (type=="G4Box") {
+        auto s = static_cast<const G4Box*>(solid);
+        w.put(std::uint8_t(BOX));
+        for (double v : { s->GetXHalfLength(), s->GetYHalfLength(), s->GetZHalfLength() })
+          w.put(v);
+      } else if (type=="G4Tubs") {
+        auto s = static_cast<const G4Tubs*>(solid);
+        w.put(std::uint8_t(TUBS));
+        for (double v : { s->GetInnerRadius(), s->GetOuterRadius(), s->GetZHalfLength(),
+                          s->GetStartPhiAngle(), s->GetDeltaPhiAngle() })
+          w.put(v);
+      } else if (type=="G4Cons") {
+        auto s = static_cast<const G4Cons*>(solid);
+        w.put(std::uint8_t(CONS));
+        for (double v : { s->GetInnerRadiusMinusZ(), s->GetOuterRadiusMinusZ(),
+                          s->GetInnerRadiusPlusZ(), s->GetOuterRadiusPlusZ(),
+                          s->GetZHalfLength(), s->GetStartPhiAngle(), s->GetDeltaPhiAngle() })
+          w.put(v);
+      } else if (type=="G4Sphere") {
+        auto s = static_cast<const G4Sphere*>(solid);
+        w.put(std::uint8_t(SPHERE));
+        for (double v : { s->GetInnerRadius(), s->GetOuterRadius(), s->GetStartPhiAngle(),
+                          s->GetDeltaPhiAngle(), s->GetStartThetaAngle(), s->GetDeltaThetaAngle() })
+          w.put(v);
+      } else if (type=="G4Orb") {
+        w.put(std::uint8_t(ORB));
+        w.put(double(static_cast<const G4Orb*>(solid)->GetRadius()));
+      } else if (type=="G4Trd") {
+        auto s = static_cast<const G4Trd*>(solid);
+        w.put(std::uint8_t(TRD));
+        for (double v : { s->GetXHalfLength1(), s->GetXHalfLength2(), s->GetYHalfLength1(),
+                          s->GetYHalfLength2(), s->GetZHalfLength() })
+          w.put(v);
+      } else if (type=="G4UnionSolid"||type=="G4SubtractionSolid"||type=="G4IntersectionSolid") {
+        std::uint32_t idxA, idxB;
+        if (!addSolid(solid->GetConstituentSolid(0),idxA) || !addSolid(solid->GetConstituentSolid(1),idxB))
+          return false;
+        w.put(std::uint8_t(type=="G4UnionSolid" ? UNION : (type=="G4SubtractionSolid" ? SUBTRACTION : INTERSECTION)));
+        w.put(idxA);
+        w.put(idxB);
+      } else if (type=="G4DisplacedSolid") {
+        auto s = static_cast<const G4DisplacedSolid*>(solid);
+        std::uint32_t idxMoved;
+        if (!addSolid(s->GetConstituentMovedSolid(),idxMoved))
+          return false;
+        w.put(std::uint8_t(DISPLACED));
+        w.put(idxMoved);
+        G4Transform3D t = s->GetDirectTransform3D();
+        w.putTransform(t.getRotation(),t.getTranslation());
+      } else {
+        return fail("solid type "+type+" is not supported");
+      }
+      if (!checkName(solid->GetName()))
+        return false;
+      m_solids.put(std::string(solid->GetName()));
+      m_solids.append(w);
+      idx = std::uint32_t(m_solidIdx.size());
+      m_solidIdx[solid] = idx;
+      return true;
+    }
+
+    bool addLV(const G4LogicalVolume * lv, std::uint32_t& idx)
+    {
+      auto it = m_lvIdx.find(lv);
+      if (it != m_lvIdx.end()) {
+        idx = it->second;
+        return true;
+      }
+      if (lv->GetSensitiveDetector() || lv->GetFieldManager() || lv->GetUserLimits() || lv->GetRegion())
+        return fail("logical volume "+lv->GetName()+" has a sensitive detector, field, user limits or region");
+      std::uint32_t idxSolid, idxMat;
+      if (!addSolid(lv->GetSolid(),idxSolid) || !addMaterial(lv->GetMaterial(),idxMat) || !checkName(lv->GetName()))
+        return false;
+      m_lvs.put(std::string(lv->GetName()));
+      m_lvs.put(idxSolid);
+      m_lvs.put(idxMat);
+      auto vis = lv->GetVisAttributes();
+      if (!vis) {
+        m_lvs.put(std::uint8_t(VIS_NONE));
+      } else {
+        m_lvs.put(std::uint8_t(VIS_ATTRIBUTES));
+        const VisRec v = visRec(*vis);
+        m_lvs.put(v.flags);
+        m_lvs.put(v.linestyle);
+        m_lvs.put(v.style);
+        for (double c : v.rgba)
+          m_lvs.put(c);
+        m_lvs.put(v.linewidth);
+        m_lvs.put(v.linesegments);
+        m_lvs.put(v.cloudpoints);
+        m_lvs.put(v.starttime);
+        m_lvs.put(v.endtime);
+      }
+      idx = std::uint32_t(m_lvIdx.size());
+      m_lvIdx[lv] = idx;
+      //Daughters (each logical volume is only visited once, even if placed
+      //several times):
+      const int ndaughters = int(lv->GetNoDaughters());
+      for (int i = 0; i < ndaughters; ++i)
+        if (!addPV(lv->GetDaughter(i),std::int32_t(idx)))
+          return false;
+      return true;
+    }
+
+    bool addPV(const G4VPhysicalVolume * pv, std::int32_t idxMother)
+    {
+      if (!dynamic_cast<const G4PVPlacement*>(pv) || pv->IsReplicated() || pv->IsParameterised())
+        return fail("physical volume "+pv->GetName()+" is not a simple placement");
+      std::uint32_t idxLV;
+      if (!addLV(pv->GetLogicalVolume(),idxLV) || !checkName(pv->GetName()))
+        return false;
+      m_pvs.put(std::string(pv->GetName()));
+      m_pvs.put(idxLV);
+      m_pvs.put(idxMother);
+      m_pvs.put(std::int32_t(pv->GetCopyNo()));
+      m_pvs.put(std::uint8_t(pv->IsMany()?1:0));
+      m_pvs.putTransform(pv->GetObjectRotationValue(),pv->GetObjectTranslation());
+      ++m_npvs;
+      return true;
+    }
+  };
+
+  //Decoded entry. Everything is read and validated before any Geant4 objects
+  //are created, so a corrupt entry leaves no stray volumes behind:
+  struct SolidRec { std::string name; std::uint8_t type; std::vector<double> pars; std::uint32_t idx[2]; G4Transform3D trf; };
+  struct LVRec { std::string name; std::uint32_t solid, mat; std::uint8_t vis; VisRec visrec; };
+  struct PVRec { std::string name; std::uint32_t lv; std::int32_t mother, copyNo; std::uint8_t many; G4Transform3D trf; };
+  struct Entry {
+    std::vector<std::string> mats;
+    std::vector<SolidRec> solids;
+    std::vector<LVRec> lvs;
+    std::vector<PVRec> pvs;
+  };
+
+  void decode(Reader& r, Entry& e)
+  {
+    auto checkIdx = [](std::uint32_t idx, std::size_t n)
+    {
+      if (idx >= n)
+        throw std::runtime_error("invalid index in geometry cache entry");
+    };
+    e.mats.resize(r.getCount());
+    for (auto& m : e.mats)
+      r.get(m);
+    e.solids.resize(r.getCount());
+    for (std::size_t i = 0; i < e.solids.size(); ++i) {
+      auto& s = e.solids[i];
+      r.get(s.name);
+      r.get(s.type);
+      unsigned npars(0), nidx(0);
+      switch (s.type) {
+      case BOX: npars = 3; break;
+      case TUBS: npars = 5; break;
+      case CONS: npars = 7; break;
+      case SPHERE: npars = 6; break;
+      case ORB: npars = 1; break;
+      case TRD: npars = 5; break;
+      case UNION: case SUBTRACTION: case INTERSECTION: nidx = 2; break;
+      case DISPLACED: nidx = 1; break;
+      default:
+        throw std::runtime_error("unknown solid type in geometry cache entry");
+      }
+      s.pars.resize(npars);
+      for (auto& p : s.pars)
+        r.get(p);
+      for (unsigned j = 0; j < nidx; ++j) {
+        r.get(s.idx[j]);
+        checkIdx(s.idx[j],i);//constituents always come first
+      }
+      if (s.type==DISPLACED)
+        s.trf = r.getTransform();
+    }
+    e.lvs.resize(r.getCount());
+    for (auto& lv : e.lvs) {
+      r.get(lv.name);
+      r.get(lv.solid);
+      r.get(lv.mat);
+      r.get(lv.vis);
+      checkIdx(lv.solid,e.solids.size());
+      checkIdx(lv.mat,e.mats.size());
+      if (lv.vis==VIS_ATTRIBUTES) {
+        auto& v = lv.visrec;
+        r.get(v.flags);
+        r.get(v.linestyle);
+        r.get(v.style);
+        for (auto& c : v.rgba)
+          r.get(c);
+        r.get(v.linewidth);
+        r.get(v.linesegments);
+        r.get(v.cloudpoints);
+        r.get(v.starttime);
+        r.get(v.endtime);
+        if (v.linestyle>2 || v.style>2)
+          throw std::runtime_error("invalid visualisation attributes in geometry cache entry");
+      } else if (lv.vis!=VIS_NONE) {
+        throw std::runtime_error("invalid visualisation mode in geometry cache entry");
+      }
+    }
+    e.pvs.resize(r.getCount());
+    unsigned nworld(0);
+    for (auto& pv : e.pvs) {
+      r.get(pv.name);
+      r.get(pv.lv);
+      r.get(pv.mother);
+      r.get(pv.copyNo);
+      r.get(pv.many);
+      pv.trf = r.getTransform();
+      checkIdx(pv.lv,e.lvs.size());
+      if (pv.mother<0)
+        ++nworld;
+      else
+        checkIdx(std::uint32_t(pv.mother),e.lvs.size());
+    }
+    if (nworld!=1 || !r.atEnd())
+      throw std::runtime_error("inconsistent geometry cache entry");
+  }
+
+  G4VPhysicalVolume * build(const Entry& e)
+  {
+    std::vector<G4Material*> mats;
+    for (auto& m : e.mats)
+      mats.push_back(NamedMaterialProvider::getMaterial(m));
+
+    std::vector<G4VSolid*> solids;
+    for (auto& s : e.solids) {
+      const double * p = s.pars.data();
+      G4VSolid * solid(nullptr);
+      switch (s.type) {
+      case BOX: solid = new G4Box(s.name,p[0],p[1],p[2]); break;
+      case TUBS: solid = new G4Tubs(s.name,p[0],p[1],p[2],p[3],p[4]); break;
+      case CONS: solid = new G4Cons(s.name,p[0],p[1],p[2],p[3],p[4],p[5],p[6]); break;
+      case SPHERE: solid = new G4Sphere(s.name,p[0],p[1],p[2],p[3],p[4],p[5]); break;
+      case ORB: solid = new G4Orb(s.name,p[0]); break;
+      case TRD: solid = new G4Trd(s.name,p[0],p[1],p[2],p[3],p[4]); break;
+      case UNION: solid = new G4UnionSolid(s.name,solids.at(s.idx[0]),solids.at(s.idx[1])); break;
+      case SUBTRACTION: solid = new G4SubtractionSolid(s.name,solids.at(s.idx[0]),solids.at(s.idx[1])); break;
+      case INTERSECTION: solid = new G4IntersectionSolid(s.name,solids.at(s.idx[0]),solids.at(s.idx[1])); break;
+      case DISPLACED: solid = new G4DisplacedSolid(s.name,solids.at(s.idx[0]),s.trf); break;
+      }
+      solids.push_back(solid);
+    }
+
+    std::vector<G4LogicalVolume*> lvs;
+    std::map<VisRec,G4VisAttributes*> viscache;
+    for (auto& r : e.lvs) {
+      auto lv = new G4LogicalVolume(solids.at(r.solid),mats.at(r.mat),r.name);
+      if (r.vis==VIS_ATTRIBUTES) {
+        auto& vis = viscache[r.visrec];
+        if (!vis)
+          vis = createVisAttributes(r.visrec);
+        lv->SetVisAttributes(vis);
+      }
+      lvs.push_back(lv);
+    }
+
+    G4VPhysicalVolume * world(nullptr);
+    for (auto& r : e.pvs) {
+      G4LogicalVolume * mother = r.mother < 0 ? nullptr : lvs.at(r.mother);
+      auto pv = new G4PVPlacement(r.trf,lvs.at(r.lv),r.name,mother,r.many!=0,r.copyNo,false);
+      if (!mother)
+        world = pv;
+    }
+    return world;
+  }
+
+  std::string canonicalPath(const std::string& path)
+  {
+    std::error_code ec;
+    auto p = std::filesystem::canonical(path,ec);
+    return ec ? path : p.string();
+  }
+
+  std::string libraryOf(const void * addr)
+  {
+    Dl_info info;
+    if (!dladdr(addr,&info) || !info.dli_fname || !*info.dli_fname)
+      return std::string();
+    return canonicalPath(info.dli_fname);
+  }
+
+  //Size and modification time of a file (empty if not available):
+  std::string fileStamp(const std::string& path)
+  {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const auto size = fs::file_size(path,ec);
+    if (ec)
+      return std::string();
+    const auto mtime = fs::last_write_time(path,ec);
+    if (ec)
+      return std::string();
+    std::ostringstream ss;
+    ss << "size=" << size << " mtime=" << mtime.time_since_epoch().count();
+    return ss.str();
+  }
+
+  //All loaded package libraries:
+  std::vector<std::string> packageLibraries()
+  {
+    std::vector<std::string> libs;
+    dl_iterate_phdr([](dl_phdr_info * info, std::size_t, void * data)
+                    {
+                      const char * name = info->dlpi_name;
+                      const char * base = name ? std::strrchr(name,'/') : nullptr;
+                      base = base ? base + 1 : name;
+                      if (base && std::strncmp(base,"libPKG__",8)==0)
+                        static_cast<std::vector<std::string>*>(data)->push_back(canonicalPath(name));
+                      return 0;
+                    },&libs);
+    std::sort(libs.begin(),libs.end());
+    libs.erase(std::unique(libs.begin(),libs.end()),libs.end());
+    return libs;
+  }
+
+  //Hash of the names, sizes and modification times of all files below a
+  //directory (following symlinks, as the data directory of an installation
+  //mostly consists of symlinks to the data directories of the packages):
+  std::string directoryStamp(const std::string& dir)
+  {
+    namespace fs = std::filesystem;
+    std::vector<std::string> entries;
+    std::error_code ec;
+    fs::recursive_directory_iterator it(dir,fs::directory_options::follow_directory_symlink,ec), itE;
+    for (; !ec && it != itE; it.increment(ec)) {
+      std::error_code ec2;
+      if (it->is_regular_file(ec2))
+        entries.push_back(it->path().lexically_relative(dir).string()+" "+fileStamp(it->path().string()));
+    }
+    if (ec)
+      return std::string();
+    std::sort(entries.begin(),entries.end());
+    std::string all;
+    for (auto& e : entries)
+      all += e + "\n";
+    std::ostringstream ss;
+    ss << "nfiles=" << entries.size() << " hash=" << std::hex << hash(all);
+    return ss.str();
+  }
+}
+
+G4Launcher::CachedGeoConstruction::CachedGeoConstruction(G4Interfaces::GeoConstructBase* geo, const std::string& cachedir)
+  : G4VUserDetectorConstruction(),
+    m_geo(geo),
+    m_dir(cachedir)
+{
+}
+
+G4Launcher::CachedGeoConstruction::~CachedGeoConstruction()
+{
+  delete m_geo;
+}
+
+void G4Launcher::CachedGeoConstruction::ConstructSDandField()
+{
+  m_geo->ConstructSDandField();
+}
+
+std::string G4Launcher::CachedGeoConstruction::cacheKey() const
+{
+  namespace gc = G4Launcher_impl_geocache;
+  //The virtual table of the geometry class lives in the library (or
+  //executable) implementing it:
+  const std::string lib = gc::libraryOf(*reinterpret_cast<void* const*>(m_geo));
+  const std::string libstamp = lib.empty() ? std::string() : gc::fileStamp(lib);
+  if (libstamp.empty())
+    return std::string();
+
+  std::ostringstream ss;
+  ss << "format=" << gc::s_formatVersion << "\n";
+  ss << "g4version=" << G4VERSION_NUMBER << "\n";
+  ss << "geo=" << m_geo->getName() << "\n";
+  ss << "geolib=" << lib << " " << libstamp << "\n";
+  char * dataS;
+  unsigned lengthS;
+  m_geo->serialiseParameters(dataS,lengthS);
+  ss << "pars=" << std::hex << std::setfill('0');
+  for (unsigned i = 0; i < lengthS; ++i)
+    ss << std::setw(2) << unsigned((unsigned char)dataS[i]);
+  ss << std::dec << "\n";
+  delete[] dataS;
+
+  //The geometry might depend on code in any other package (base classes,
+  //materials, helpers, ...), so all of them are included:
+  for (auto& pkglib : gc::packageLibraries())
+    ss << "lib=" << pkglib << " " << gc::fileStamp(pkglib) << "\n";
+
+  //Data files which might be read in Construct():
+  const char * datadir = std::getenv("SBLD_DATA_DIR");
+  if (datadir && *datadir)
+    ss << "datadir=" << datadir << " " << gc::directoryStamp(datadir) << "\n";
+  G4Interfaces::GeoConstructBase::ParameterList parnames;
+  m_geo->getParameterListString(parnames);
+  for (auto& n : parnames) {
+    const std::string& v = m_geo->getParameterString(n);
+    std::error_code ec;
+    if (!v.empty() && std::filesystem::is_regular_file(v,ec))
+      ss << "file[" << n << "]=" << gc::canonicalPath(v) << " " << gc::fileStamp(v) << "\n";
+  }
+  return ss.str();
+}
+
+G4VPhysicalVolume* G4Launcher::CachedGeoConstruction::Construct()
+{
+  namespace fs = std::filesystem;
+  namespace gc = G4Launcher_impl_geocache;
+  const char * prefix = FrameworkGlobals::printPrefix();
+  G4Utils::flush();
+
+  const std::string key = cacheKey();
+  if (key.empty()) {
+    printf("%sWARNING: Could not determine the library of the geometry (not using geometry cache)\n",prefix);
+    std::cout.flush();
+    return m_geo->Construct();
+  }
+  std::ostringstream ssentry;
+  ssentry << m_dir << "/geo_" << std::hex << gc::hash(key) << ".bin";
+  const std::string entry = ssentry.str();
+
+  std::error_code ec;
+  if (fs::exists(entry,ec)) {
+    std::ifstream fh(entry,std::ios::binary);
+    std::ostringstream ss;
+    ss << fh.rdbuf();
+    const std::string data = ss.str();
+    gc::Entry e;
+    bool ok(false);
+    try {
+      gc::Reader r(data.data(),data.data()+data.size());
+      std::uint32_t keylen(0);
+      if (r.get<std::uint32_t>()==gc::s_magic && r.get<std::uint32_t>()==gc::s_formatVersion) {
+        r.get(keylen);
+        if (keylen==key.size() && data.size()-12 >= keylen && data.compare(12,keylen,key)==0) {
+          gc::Reader rpayload(data.data()+12+keylen,data.data()+data.size());
+          gc::decode(rpayload,e);
+          ok = true;
+        }
+      }
+    } catch (std::runtime_error& err) {
+      printf("%sWARNING: Ignoring invalid geometry cache entry %s (%s)\n",prefix,entry.c_str(),err.what());
+    }
+    if (ok) {
+      printf("%sBuilding geometry from cache: %s\n",prefix,entry.c_str());
+      std::cout.flush();
+      return gc::build(e);
+    }
+  }
+
+  printf("%sGeometry not found in cache (will be added after construction): %s\n",prefix,entry.c_str());
+  std::cout.flush();
+  G4VPhysicalVolume * world = m_geo->Construct();
+  G4Utils::flush();
+
+  gc::Encoder enc;
+  if (!world || !enc.encode(world)) {
+    printf("%sGeometry can not be cached: %s\n",prefix,world?enc.failReason().c_str():"no world volume");
+    std::cout.flush();
+    return world;
+  }
+  gc::Writer w;
+  w.put(gc::s_magic);
+  w.put(gc::s_formatVersion);
+  w.put(std::uint32_t(key.size()));
+  std::string data = w.data() + key + enc.data();
+
+  //Write under a temporary name and rename when complete, so concurrent jobs
+  //never see partial entries:
+  fs::create_directories(m_dir,ec);
+  const std::string tmpfile = entry + ".tmp" + std::to_string(getpid());
+  bool ok(false);
+  {
+    std::ofstream fh(tmpfile,std::ios::binary);
+    fh.write(data.data(),data.size());
+    ok = fh.good();
+  }
+  if (ok) {
+    fs::rename(tmpfile,entry,ec);
+    ok = !ec;
+  }
+  fs::remove(tmpfile,ec);
+  if (ok)
+    printf("%sStored geometry in cache: %s\n",prefix,entry.c_str());
+  else
+    printf("%sWARNING: Failed to store geometry in cache: %s\n",prefix,entry.c_str());
+  std::cout.flush();
+  return world;
+}
@@ -11,20 +11,26 @@
 #include "G4Interfaces/GeoConstructBase.hh"
 #include "G4Interfaces/ParticleGenBase.hh"
 #include "G4Interfaces/StepFilterBase.hh"
+#include "G4CollectFilters/StepFilterExpr.hh"
 #include "G4Interfaces/PhysListProviderBase.hh"
 #include "G4DataCollect/G4DataCollect.hh"
 #include "G4Random/RandomManager.hh"
 #include "G4Interfaces/FrameworkGlobals.hh"
+#include "G4Interfaces/ActionProfiler.hh"
+#include "G4Materials/NamedMaterialProvider.hh"
 #include "G4NCrystalRel/G4NCInstall.hh"
 #include "G4NCrystalRel/G4NCManager.hh"
 #include "Core/FPE.hh"
 #include "Units/Units.hh"
 #include "MultiProcessingMgr.hh"
+#include "G4Launcher/GeoCache.hh"
 #include "G4Utils/Flush.hh"
 #include "G4RunManager.hh"
 #include "G4UImanager.hh"
 #include "G4ParticleGun.hh"
 #include "G4VUserPrimaryGeneratorAction.hh"
+#include "G4UserSteppingAction.hh"
+#include "G4UserEventAction.hh"
 #include "G4VisExecutive.hh"
 #include "G4UIterminal.hh"
 #include "G4UItcsh.hh"
@@ -33,11 +39,21 @@
 #include "Utils/Format.hh"
 #include "Utils/ByteStream.hh"
 #include "G4VUserPhysicsList.hh"
+#include "G4Material.hh"
+#include "G4Version.hh"
 #if G4LAUNCHER_ENABLE_GDML_DUMP
 #include "G4GDMLParser.hh"
 #endif
 #include <limits>
 #include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <unistd.h>
 #include "launcher_impl_ts.hh"
 
 #include "NCrystal/ncapi.h"
@@ -69,11 +85,16 @@ struct G4Launcher::Launcher::Imp {
       m_postmphooks_alreadyfired(false),
       m_norandom(false),
       m_seed(0),
+      m_firstEvtIdx(0),
       m_nprocs(0),
       m_allowMultipleSettings(false),
       m_physicsListProvider(0),
       m_dofpe(true),
-      m_closedGriff(false)
+      m_closedGriff(false),
+      m_physcacheState(PHYSCACHE_DISABLED),
+      m_reportInitTimings(false),
+      m_profileActions(0),
+      m_tlast(std::chrono::steady_clock::now())
   {
     if (std::string(FrameworkGlobals::printPrefix()).empty())
       FrameworkGlobals::setPrintPrefix("G4Launcher:: ");
@@ -127,6 +148,8 @@ struct G4Launcher::Launcher::Imp {
   bool m_norandom;
   std::uint64_t m_seed;
   std::string m_rnd_evtmsg_mode;
+  std::string m_seedmode;
+  std::uint64_t m_firstEvtIdx;
 
   //mp:
   unsigned m_nprocs;
@@ -145,6 +168,32 @@ struct G4Launcher::Launcher::Imp {
   bool m_dofpe;
   bool m_closedGriff;
 
+  //physics table cache:
+  std::string m_physcacheDir;
+  std::string m_physcacheEntry;//directory of entry for current job
+  std::string m_physcacheKey;
+  enum { PHYSCACHE_DISABLED, PHYSCACHE_HIT, PHYSCACHE_MISS } m_physcacheState;
+  void setupPhysicsTableCache();//after run manager init
+  void storePhysicsTables();//after simulation
+
+  //geometry cache:
+  std::string m_geocacheDir;
+
+  //profiling of actions in event loop:
+  unsigned m_profileActions;
+
+  //timing of initialisation phases:
+  bool m_reportInitTimings;
+  std::chrono::steady_clock::time_point m_tlast;
+  std::vector<std::pair<std::string,double> > m_initTimings;
+  void markInitPhase(const char * phase)
+  {
+    auto t = std::chrono::steady_clock::now();
+    m_initTimings.emplace_back(phase,std::chrono::duration<double>(t-m_tlast).count());
+    m_tlast = t;
+  }
+  void printInitTimings();
+
   void closeGriff() { if (m_output!="none" && !m_closedGriff ) { G4DataCollect::finish(); m_closedGriff=true; } }
 
   const char * prefix() { return FrameworkGlobals::printPrefix(); }
@@ -271,6 +320,39 @@ void G4Launcher::Launcher::setKillFilter(G4Interfaces::StepFilterBase*f)
   m_imp->m_killfilter = f;
 }
 
+namespace G4Launcher {
+  static G4Interfaces::StepFilterBase * createExprFilter(const char * expression)
+  {
+    auto f = new StepFilterExpr;
+    try {
+      f->setParameterString("expression",expression?expression:"");
+      f->initFilter();//compile already now to catch errors early
+    } catch (...) {
+      delete f;
+      throw;
+    }
+    return f;
+  }
+}
+
+void G4Launcher::Launcher::setFilter(const char * expression)
+{
+  if (m_imp->m_isinit_pre)
+    m_imp->error("setFilter called too late");
+  if (m_imp->m_filter)
+    m_imp->error("attempt to call setFilter twice");
+  setFilter(createExprFilter(expression));
+}
+
+void G4Launcher::Launcher::setKillFilter(const char * expression)
+{
+  if (m_imp->m_isinit_pre)
+    m_imp->error("setKillFilter called too late");
+  if (m_imp->m_killfilter)
+    m_imp->error("attempt to call setKillFilter twice");
+  setKillFilter(createExprFilter(expression));
+}
+
 void G4Launcher::Launcher::setOutput(const char* filename,const char * mode)
 {
   if (m_imp->m_isinit_pre)
@@ -357,6 +439,7 @@ void G4Launcher::Launcher::Imp::preinit()
   if (m_isinit_pre)
     return;//silent return, might not be an error
   m_isinit_pre = true;
+  markInitPhase("Configuration");
 
   for ( auto& e : m_prepreinithooks )
     (*e)();
@@ -387,6 +470,8 @@ void G4Launcher::Launcher::Imp::preinit()
       error("Calling both noRandomSetup() and setSeed() is consistent");
     if (!m_rnd_evtmsg_mode.empty())
       error("Calling both noRandomSetup() and setRndEvtMsgMode() is consistent");
+    if (!m_seedmode.empty())
+      error("Calling both noRandomSetup() and setSeedMode() is consistent");
     print("Will not set up random engine");
   } else {
     if (!m_seed) {
@@ -400,7 +485,17 @@ void G4Launcher::Launcher::Imp::preinit()
     } else if (m_rnd_evtmsg_mode=="NEVER") {
       evtmsgmode = RandomManager::EVTMSG_NEVER;
     } else { assert(m_rnd_evtmsg_mode.empty()||m_rnd_evtmsg_mode=="ADAPTABLE"); }
-    RandomManager::init(m_seed, evtmsgmode );
+    auto seedmode = RandomManager::SEEDMODE_CHAINED;
+    if (m_seedmode=="INDEXED") {
+      seedmode = RandomManager::SEEDMODE_INDEXED;
+      printf("%sEvent seeds will be derived from seed and event index (first event index: %llu).\n",
+             prefix(),(long long unsigned)m_firstEvtIdx);
+    } else {
+      assert(m_seedmode.empty()||m_seedmode=="CHAINED");
+      if (m_firstEvtIdx)
+        error("setFirstEventIndex() requires setSeedMode(\"INDEXED\")");
+    }
+    RandomManager::init(m_seed, evtmsgmode, seedmode, m_firstEvtIdx );
   }
 
   ensureCreateRM();
@@ -472,7 +567,10 @@ void G4Launcher::Launcher::Imp::preinit()
     } else {
       print("Setting up geometry:");
       m_geo->dump((std::string(Imp::prefix())+"  --> ").c_str());
-      m_rm->SetUserInitialization(m_geo);
+      if (m_geocacheDir.empty())
+        m_rm->SetUserInitialization(m_geo);
+      else
+        m_rm->SetUserInitialization(new CachedGeoConstruction(m_geo,m_geocacheDir));
     }
   }
 
@@ -515,6 +613,7 @@ void G4Launcher::Launcher::Imp::preinit()
   }
 
   print("Pre-init done");
+  markInitPhase("Pre-init (physics list, geometry and output setup)");
 }
 
 //hack to access protected method StoreHistory:
@@ -661,6 +760,223 @@ void G4Launcher::Launcher::Imp::finalMetadata()
   }
 }
 
+namespace G4Launcher_impl_profiling {
+
+  //Wrappers timing user actions. They take over ownership of the wrapped
+  //action, as the run manager would otherwise have done:
+
+  class ProfiledSteppingAction : public G4UserSteppingAction {
+  public:
+    ProfiledSteppingAction(G4UserSteppingAction* a)
+      : m_action(a),
+        m_prof(ActionProfiler::registerAction(ActionProfiler::className(typeid(*a))+"::UserSteppingAction"))
+    {
+    }
+    virtual ~ProfiledSteppingAction() { delete m_action; }
+    virtual void SetSteppingManagerPointer(G4SteppingManager* p)
+    {
+      G4UserSteppingAction::SetSteppingManagerPointer(p);
+      m_action->SetSteppingManagerPointer(p);
+    }
+    virtual void UserSteppingAction(const G4Step* step)
+    {
+      ActionProfiler::Scope prof(m_prof);
+      m_action->UserSteppingAction(step);
+    }
+  private:
+    G4UserSteppingAction * m_action;
+    ActionProfiler::Entry * m_prof;
+  };
+
+  class ProfiledEventAction : public G4UserEventAction {
+  public:
+    ProfiledEventAction(G4UserEventAction* a)
+      : m_action(a),
+        m_profBegin(ActionProfiler::registerAction(ActionProfiler::className(typeid(*a))+"::BeginOfEventAction")),
+        m_profEnd(ActionProfiler::registerAction(ActionProfiler::className(typeid(*a))+"::EndOfEventAction"))
+    {
+    }
+    virtual ~ProfiledEventAction() { delete m_action; }
+    virtual void BeginOfEventAction(const G4Event* evt)
+    {
+      if (fpEventManager)
+        m_action->SetEventManager(fpEventManager);
+      ActionProfiler::Scope prof(m_profBegin);
+      m_action->BeginOfEventAction(evt);
+    }
+    virtual void EndOfEventAction(const G4Event* evt)
+    {
+      ActionProfiler::Scope prof(m_profEnd);
+      m_action->EndOfEventAction(evt);
+    }
+  private:
+    G4UserEventAction * m_action;
+    ActionProfiler::Entry * m_profBegin;
+    ActionProfiler::Entry * m_profEnd;
+  };
+}
+
+namespace G4Launcher_impl_physcache {
+  std::uint64_t hash(const std::string& s)
+  {
+    //64bit FNV-1a:
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : s) {
+      h ^= c;
+      h *= 0x100000001b3ULL;
+    }
+    return h;
+  }
+  std::string defaultDir(const char * envvar = "G4LAUNCHER_PHYSCACHEDIR", const char * name = "dgcode_g4physcache")
+  {
+    const char * envdir = std::getenv(envvar);
+    if (envdir && *envdir)
+      return envdir;
+    const char * user = std::getenv("USER");
+    return std::string("/tmp/") + (user&&*user?user:"unknown") + "/" + name;
+  }
+  std::string readFile(const std::string& fn)
+  {
+    std::ifstream fh(fn,std::ios::binary);
+    std::ostringstream ss;
+    ss << fh.rdbuf();
+    return ss.str();
+  }
+}
+
+void G4Launcher::Launcher::Imp::setupPhysicsTableCache()
+{
+  //Tables are built at the start of the first run, so the key can include
+  //materials and commands only available after G4RunManager::Initialize():
+  if (m_physcacheDir.empty())
+    return;
+  std::ostringstream ss;
+  ss.precision(17);
+  ss << "g4version=" << G4VERSION_NUMBER << "\n";
+  ss << "physlist=" << m_physicsListName << "\n";
+  if (m_geo) {
+    char * dataS;
+    unsigned lengthS;
+    m_geo->serialiseParameters(dataS,lengthS);
+    ss << "geo=" << m_geo->getName() << " pars=" << std::hex
+       << G4Launcher_impl_physcache::hash(std::string(dataS,lengthS)) << std::dec << "\n";
+    delete[] dataS;
+  }
+  if (m_rm->GetUserPhysicsList())
+    ss << "defaultcut=" << m_rm->GetUserPhysicsList()->GetDefaultCutValue() << "\n";
+  for (auto mat : *G4Material::GetMaterialTable()) {
+    ss << "material=" << mat->GetName() << " density=" << mat->GetDensity()
+       << " temp=" << mat->GetTemperature() << " pressure=" << mat->GetPressure()
+       << " state=" << int(mat->GetState());
+    const double * fractions = mat->GetFractionVector();
+    for (std::size_t i = 0; i < mat->GetNumberOfElements(); ++i) {
+      auto elem = mat->GetElement(i);
+      ss << " " << elem->GetName() << ":" << fractions[i];
+      const double * abundances = elem->GetRelativeAbundanceVector();
+      for (std::size_t j = 0; j < elem->GetNumberOfIsotopes(); ++j)
+        ss << " " << elem->GetIsotope(j)->GetName() << ":" << abundances[j];
+    }
+    ss << "\n";
+  }
+  for (auto& c : m_cmdlog)
+    ss << "cmd=" << c << "\n";
+  m_physcacheKey = ss.str();
+
+  std::ostringstream ssentry;
+  ssentry << m_physcacheDir << "/g4phys_" << std::hex << G4Launcher_impl_physcache::hash(m_physcacheKey);
+  m_physcacheEntry = ssentry.str();
+
+  std::error_code ec;
+  if ( std::filesystem::exists(m_physcacheEntry+"/key.txt",ec)
+       && G4Launcher_impl_physcache::readFile(m_physcacheEntry+"/key.txt") == m_physcacheKey ) {
+    printf("%sRetrieving physics tables from cache: %s\n",prefix(),m_physcacheEntry.c_str());
+    std::cout.flush();
+    std::string c("/run/particle/retrievePhysicsTable ");
+    c += m_physcacheEntry;
+    if (G4UImanager::GetUIpointer()->ApplyCommand(c)==fCommandSucceeded) {
+      m_physcacheState = PHYSCACHE_HIT;
+      return;
+    }
+    print("WARNING: Failed to request retrieval of physics tables. Will build them instead.");
+  } else {
+    printf("%sPhysics tables not found in cache (will be added after simulation): %s\n",
+           prefix(),m_physcacheEntry.c_str());
+  }
+  m_physcacheState = PHYSCACHE_MISS;
+}
+
+void G4Launcher::Launcher::Imp::storePhysicsTables()
+{
+  if (m_physcacheState!=PHYSCACHE_MISS)
+    return;
+  m_physcacheState = PHYSCACHE_DISABLED;//only try once
+  //Store under a temporary name and rename when complete, so concurrent jobs
+  //never see partial entries:
+  namespace fs = std::filesystem;
+  std::error_code ec;
+  const std::string tmpdir = m_physcacheEntry + ".tmp" + std::to_string(getpid());
+  fs::create_directories(tmpdir,ec);
+  if (ec) {
+    printf("%sWARNING: Could not create physics table cache directory %s\n",prefix(),tmpdir.c_str());
+    return;
+  }
+  std::string c("/run/particle/storePhysicsTable ");
+  c += tmpdir;
+  bool ok = G4UImanager::GetUIpointer()->ApplyCommand(c)==fCommandSucceeded;
+  if (ok) {
+    std::ofstream fh(tmpdir+"/key.txt",std::ios::binary);
+    fh << m_physcacheKey;
+    ok = fh.good();
+  }
+  if (ok) {
+    fs::rename(tmpdir,m_physcacheEntry,ec);
+    if (ec && !fs::exists(m_physcacheEntry))
+      ok = false;
+  }
+  fs::remove_all(tmpdir,ec);//no-op unless failed or other process stored same entry first
+  if (ok)
+    printf("%sStored physics tables in cache: %s\n",prefix(),m_physcacheEntry.c_str());
+  else
+    printf("%sWARNING: Failed to store physics tables in cache: %s\n",prefix(),m_physcacheEntry.c_str());
+  std::cout.flush();
+}
+
+void G4Launcher::Launcher::Imp::printInitTimings()
+{
+  G4Utils::flush();
+  std::cout.flush();
+  double total(0.0);
+  std::size_t w(0);
+  for (auto& e : m_initTimings)
+    w = std::max<std::size_t>(w,e.first.size());
+  printf("%sWall-clock time spent in initialisation phases:\n",prefix());
+  for (auto& e : m_initTimings) {
+    printf("%s  %-*s : %9.3f s\n",prefix(),int(w),e.first.c_str(),e.second);
+    total += e.second;
+  }
+  printf("%s  %-*s : %9.3f s\n",prefix(),int(w),"=> Time to first event",total);
+  NamedMaterialProvider::printStatistics(prefix());
+  std::cout.flush();
+}
+
+namespace G4Launcher_impl_physcache {
+  class InitTimingsCB : public G4Interfaces::PreGenCallBack {
+  public:
+    InitTimingsCB(std::function<void()> f) : m_f(f) {}
+    virtual ~InitTimingsCB(){}
+    void preGen() override {
+      if (m_f) {
+        //only report in the parent process:
+        if (!FrameworkGlobals::isChild())
+          m_f();
+        m_f = nullptr;
+      }
+    }
+  private:
+    std::function<void()> m_f;
+  };
+}
+
 void G4Launcher::Launcher::initVis()
 {
   m_imp->preinit_vis(this);
@@ -688,9 +1004,11 @@ void G4Launcher::Launcher::init()
       cmd(it->c_str());
     m_imp->m_cmds_preinit.clear();
   }
+  m_imp->markInitPhase("Pre-init hooks and commands");
   m_imp->print("Calling G4RunManager::Initialize()");
   m_imp->m_rm->Initialize();
   m_imp->print("G4RunManager::Initialize() done");
+  m_imp->markInitPhase("G4RunManager::Initialize() (geometry construction)");
 
   {
     auto itE = m_imp->m_cmds_postinit.end();
@@ -715,6 +1033,8 @@ void G4Launcher::Launcher::init()
   for (auto& e : m_imp->m_postinithooks )
     (*e)();
 
+  m_imp->setupPhysicsTableCache();
+  m_imp->markInitPhase("Post-init commands and hooks");
 }
 
 void G4Launcher::Launcher::startSimulation(unsigned nevents)
@@ -748,6 +1068,19 @@ void G4Launcher::Launcher::startSimulation(unsigned nevents)
     m_imp->m_gen->installPostGenCallBack(*it);
   m_imp->m_postgenhooks.clear();
 
+  if (m_imp->m_reportInitTimings) {
+    Imp * imp = m_imp;
+    m_imp->markInitPhase("Final setup");
+    auto cb = std::make_shared<G4Launcher_impl_physcache::InitTimingsCB>([imp]()
+    {
+      imp->markInitPhase(imp->m_physcacheState==Imp::PHYSCACHE_HIT
+                         ? "Start of run (physics tables retrieved from cache)"
+                         : "Start of run (physics tables built)");
+      imp->printInitTimings();
+    });
+    m_imp->m_gen->installPreGenCallBack(cb);
+  }
+
   m_imp->m_rm->BeamOn(nevents);
   if (m_imp->m_gen->reachedLimit()) {
     assert(!m_imp->m_gen->unlimited());
@@ -755,6 +1088,11 @@ void G4Launcher::Launcher::startSimulation(unsigned nevents)
   }
 
   m_imp->print("Simulation done");
+  if (ActionProfiler::enabled())
+    ActionProfiler::printTable(m_imp->prefix());
+
+  if (!FrameworkGlobals::isChild())
+    m_imp->storePhysicsTables();
 
   for ( auto& e : m_imp->m_postsimhooks )
     (*e)();
@@ -961,6 +1299,92 @@ void G4Launcher::Launcher::setRndEvtMsgMode(const char * mode)
 }
 
 
+const std::string& G4Launcher::Launcher::seedMode() const
+{
+  return m_imp->m_seedmode;
+}
+
+void G4Launcher::Launcher::setSeedMode(const char * mode)
+{
+  if (m_imp->m_isinit_pre)
+    m_imp->error("setSeedMode called too late");
+  if (!mode)
+    m_imp->error("setSeedMode called with null string");
+  std::string smode(mode);
+  if ( smode!="CHAINED" && smode!="INDEXED" )
+    m_imp->error("setSeedMode called with invalid mode. Must be CHAINED or INDEXED");
+  m_imp->m_seedmode = smode;
+}
+
+void G4Launcher::Launcher::setFirstEventIndex(std::uint64_t idx)
+{
+  if (m_imp->m_isinit_pre)
+    m_imp->error("setFirstEventIndex called too late");
+  m_imp->m_firstEvtIdx = idx;
+}
+
+std::uint64_t G4Launcher::Launcher::firstEventIndex() const
+{
+  return m_imp->m_firstEvtIdx;
+}
+
+void G4Launcher::Launcher::setPhysicsTableCache(const char * dir)
+{
+  if (m_imp->m_isinit_rm)
+    m_imp->error("setPhysicsTableCache called too late");
+  if (!dir)
+    m_imp->error("setPhysicsTableCache called with null string");
+  m_imp->m_physcacheDir = *dir ? std::string(dir) : G4Launcher_impl_physcache::defaultDir();
+  while (m_imp->m_physcacheDir.size()>1 && m_imp->m_physcacheDir.back()=='/')
+    m_imp->m_physcacheDir.pop_back();
+}
+
+const std::string& G4Launcher::Launcher::physicsTableCache() const
+{
+  return m_imp->m_physcacheDir;
+}
+
+void G4Launcher::Launcher::setGeometryCache(const char * dir)
+{
+  if (m_imp->m_isinit_pre)
+    m_imp->error("setGeometryCache called too late");
+  if (!dir)
+    m_imp->error("setGeometryCache called with null string");
+  m_imp->m_geocacheDir = *dir ? std::string(dir) : G4Launcher_impl_physcache::defaultDir("G4LAUNCHER_GEOCACHEDIR","dgcode_geocache");
+  while (m_imp->m_geocacheDir.size()>1 && m_imp->m_geocacheDir.back()=='/')
+    m_imp->m_geocacheDir.pop_back();
+}
+
+const std::string& G4Launcher::Launcher::geometryCache() const
+{
+  return m_imp->m_geocacheDir;
+}
+
+void G4Launcher::Launcher::setReportInitTimings(bool b)
+{
+  m_imp->m_reportInitTimings = b;
+}
+
+bool G4Launcher::Launcher::reportInitTimings() const
+{
+  return m_imp->m_reportInitTimings;
+}
+
+void G4Launcher::Launcher::setProfileActions(unsigned sample_every)
+{
+  if (m_imp->m_isinit_rm)
+    m_imp->error("setProfileActions called too late");
+  if (!sample_every)
+    m_imp->error("setProfileActions called with sample_every=0");
+  m_imp->m_profileActions = sample_every;
+  ActionProfiler::enable(sample_every);
+}
+
+unsigned G4Launcher::Launcher::profileActions() const
+{
+  return m_imp->m_profileActions;
+}
+
 void G4Launcher::Launcher::setSeed(std::uint64_t seed)
 {
   if (!seed)
@@ -974,6 +1398,8 @@ void G4Launcher::Launcher::setUserSteppingAction(G4UserSteppingAction*ua)
     m_imp->error("setUserSteppingAction must only be called after init()");
   if (!ua)
     m_imp->error("Only call setUserSteppingAction with non-zero argument.");
+  if (m_imp->m_profileActions)
+    ua = new G4Launcher_impl_profiling::ProfiledSteppingAction(ua);
   if (m_imp->m_output!="none")
     G4DataCollect::installUserSteppingAction(ua);//via Griff
   else
@@ -986,6 +1412,8 @@ void G4Launcher::Launcher::setUserEventAction(G4UserEventAction*ua)
     m_imp->error("setUserEventAction must only be called after init()");
   if (!ua)
     m_imp->error("Only call setUserEventAction with non-zero argument.");
+  if (m_imp->m_profileActions)
+    ua = new G4Launcher_impl_profiling::ProfiledEventAction(ua);
   if (m_imp->m_output!="none")
     G4DataCollect::installUserEventAction(ua);//via Griff
   else
@@ -30,6 +30,21 @@ namespace G4Launcher_py {
     return l.rndEvtMsgMode();
   }
 
+  std::string Launcher_seedMode(G4Launcher::Launcher& l)
+  {
+    return l.seedMode();
+  }
+
+  std::string Launcher_physicsTableCache(G4Launcher::Launcher& l)
+  {
+    return l.physicsTableCache();
+  }
+
+  std::string Launcher_geometryCache(G4Launcher::Launcher& l)
+  {
+    return l.geometryCache();
+  }
+
   G4ThreeVector pytuple2g4vect(const py::tuple&t)
   {
     if ( py::len(t) != 3 )
@@ -78,6 +93,11 @@ namespace G4Launcher_py {
 
   void Launcher_setFilter( G4Launcher::Launcher& launcher, py::object o )
   {
+    if ( py::isinstance<py::str>( o ) ) {
+      //G4ExprParser expression:
+      launcher.setFilter(py::cast<std::string>( o ).c_str());
+      return;
+    }
     if ( !py::isinstance<G4Interfaces::StepFilterBase>( o ) )
       throw std::runtime_error("Ojbect of invalid type passed to .setFilter(..)");
     launcher.setFilter(py::cast<G4Interfaces::StepFilterBase*>( o ));
@@ -87,6 +107,11 @@ namespace G4Launcher_py {
 
   void Launcher_setKillFilter( G4Launcher::Launcher& launcher, py::object o )
   {
+    if ( py::isinstance<py::str>( o ) ) {
+      //G4ExprParser expression:
+      launcher.setKillFilter(py::cast<std::string>( o ).c_str());
+      return;
+    }
     if ( !py::isinstance<G4Interfaces::StepFilterBase>( o ) )
       throw std::runtime_error("Ojbect of invalid type passed to .setKillFilter(..)");
     launcher.setKillFilter(py::cast<G4Interfaces::StepFilterBase*>( o ));
@@ -207,6 +232,18 @@ PYTHON_MODULE( mod )
     .def("startSimulation",&G4Launcher::Launcher::startSimulation)
     .def("setRndEvtMsgMode",&G4Launcher::Launcher::setRndEvtMsgMode)
     .def("rndEvtMsgMode",&G4Launcher_py::Launcher_rndEvtMsgMode)
+    .def("setSeedMode",&G4Launcher::Launcher::setSeedMode)
+    .def("seedMode",&G4Launcher_py::Launcher_seedMode)
+    .def("setFirstEventIndex",&G4Launcher::Launcher::setFirstEventIndex)
+    .def("firstEventIndex",&G4Launcher::Launcher::firstEventIndex)
+    .def("setPhysicsTableCache",&G4Launcher::Launcher::setPhysicsTableCache,py::arg("dir")="")
+    .def("physicsTableCache",&G4Launcher_py::Launcher_physicsTableCache)
+    .def("setGeometryCache",&G4Launcher::Launcher::setGeometryCache,py::arg("dir")="")
+    .def("geometryCache",&G4Launcher_py::Launcher_geometryCache)
+    .def("setReportInitTimings",&G4Launcher::Launcher::setReportInitTimings,py::arg("b")=true)
+    .def("reportInitTimings",&G4Launcher::Launcher::reportInitTimings)
+    .def("setProfileActions",&G4Launcher::Launcher::setProfileActions,py::arg("sample_every")=100)
+    .def("profileActions",&G4Launcher::Launcher::profileActions)
     .def("setPhysicsList",&G4Launcher::Launcher::setPhysicsList)
     .def("setPhysicsListProvider",&G4Launcher::Launcher::setPhysicsListProvider)
     .def("hasPhysicsListProvider",&G4Launcher::Launcher::hasPhysicsListProvider)
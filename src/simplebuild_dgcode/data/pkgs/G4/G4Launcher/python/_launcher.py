@@ -356,9 +356,27 @@ def _swallowCmdLineAndLaunch(self):
                         help="Show available physics lists")
     parser.add_argument("--allowfpe",action='store_true',default=False,dest="allowfpe",
                         help="Do not trap floating point errors")
+    parser.add_argument("--physcache",type=str,dest="physcache",nargs='?',const='',default=None,metavar='DIR',
+                        help=("Retrieve physics tables from (or store them in) a cache to speed up initialisation."
+                              +" Default DIR is $G4LAUNCHER_PHYSCACHEDIR or /tmp/$USER/dgcode_g4physcache"))
+    parser.add_argument("--geocache",type=str,dest="geocache",nargs='?',const='',default=None,metavar='DIR',
+                        help=("Rebuild the geometry from (or store it in) a cache rather than constructing it."
+                              +" Default DIR is $G4LAUNCHER_GEOCACHEDIR or /tmp/$USER/dgcode_geocache"))
+    parser.add_argument("--inittimings",action='store_true',default=False,dest="inittimings",
+                        help="Report time spent in each initialisation phase before the first event")
+    parser.add_argument("--profileactions",type=int,dest="profileactions",nargs='?',const=100,default=0,metavar='N',
+                        help=("Count calls of generator, filters, Griff output and user actions, time every Nth call"
+                              +" of each, and report the estimated time spent in each [default N is 100]"))
     if not norandom:
         parser.add_argument("-s", "--seed",type=int, dest="seed", default=default_seed,
                             help="Use S as seed for generation of random numbers [default %i]"%default_seed,metavar='S')
+        parser.add_argument("--seedmode",type=str,choices=['CHAINED','INDEXED'], dest="seedmode",
+                            default=(self.seedMode() or 'CHAINED'),metavar='MODE',
+                            help=('How to derive event seeds from the seed. With INDEXED, each event seed only depends on'
+                                  +' the seed and the event index, and not on the number of processes [default %(default)s]'))
+        parser.add_argument("--firstevt",type=int, dest="firstevtidx", default=self.firstEventIndex(),metavar='I',
+                            help='Index of first event, for instance to rerun event I alone (requires --seedmode=INDEXED)'
+                            +' [default %(default)s]')
     if default_dovis:
         parser.add_argument("-n", "--novisualise",action='store_false',default=True,dest="vis",
                             help='Do *not* drop to G4 interactive prompt and launch viewer')
@@ -412,11 +430,27 @@ def _swallowCmdLineAndLaunch(self):
 
     if opt.allowfpe:
         self.allowFPE()
+    if opt.physcache is not None:
+        self.setPhysicsTableCache(opt.physcache)
+    if opt.geocache is not None:
+        self.setGeometryCache(opt.geocache)
+    if opt.inittimings:
+        self.setReportInitTimings(True)
+    if opt.profileactions:
+        if opt.profileactions<0: parser.error('Argument of --profileactions must be positive')
+        self.setProfileActions(opt.profileactions)
 
     if not norandom:
         if opt.seed<0: parser.error('Seed must be a positive number')
         if opt.seed!=default_seed:
             self.setSeed(opt.seed)
+        if opt.firstevtidx<0: parser.error('Index of first event must not be negative')
+        if opt.firstevtidx and opt.seedmode!='INDEXED':
+            parser.error('--firstevt requires --seedmode=INDEXED')
+        if opt.seedmode!=(self.seedMode() or 'CHAINED'):
+            self.setSeedMode(opt.seedmode)
+        if opt.firstevtidx!=self.firstEventIndex():
+            self.setFirstEventIndex(opt.firstevtidx)
     if opt.njobs<1: parser.error('Number of parallel processes must be at least 1')
 
     if unlimited_src:
@@ -63,6 +63,18 @@ namespace NamedMaterialProvider {
   //Access materials:
   G4Material * getMaterial(const std::string&);
 
+  //The string with which a material was obtained from getMaterial (empty if the
+  //material did not come from here). Passing it to getMaterial in a later job
+  //gives an identical material:
+  std::string materialString(const G4Material*);
+
+  //Materials are cached, so each distinct string (after trimming whitespace,
+  //and for NCrystal cfg-strings after bringing them on a canonical form) is
+  //only turned into a material once per process, and repeated requests cost a
+  //hash lookup. This prints the time spent creating each material and the
+  //number of requests for it, most expensive first:
+  void printStatistics(const char * prefix = "");
+
   //Normally this will be called by the framework:
   void setPrintPrefix(const char*);
 }
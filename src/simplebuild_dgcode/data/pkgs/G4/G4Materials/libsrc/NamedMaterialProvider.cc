@@ -25,8 +25,14 @@
 #include "Core/FindData.hh"
 #include "Core/String.hh"
 #include "Core/File.hh"
+#include "G4Material.hh"
 #include <cstdlib>
+#include <cstdio>
 #include <map>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <chrono>
 #include <set>
 #include <sstream>
 #include <stdexcept>
@@ -200,8 +206,48 @@ NamedMaterialProvider::MatInfo::MatInfo(const std::string& ss)
   }
 }
 
+namespace NamedMaterialProvider {
+  static G4Material * getMaterialImpl(const std::string&);
+  static std::map<const G4Material*,std::string> s_matstrings;
+
+  //Caches of materials already created, keyed on the trimmed material strings
+  //and (to also catch different spellings) on the canonical form of NCrystal
+  //cfg-strings. The index in the G4 material table is kept, so materials
+  //deleted in the meantime are detected and created again:
+  struct CacheEntry {
+    G4Material * mat;
+    std::size_t index;
+  };
+  typedef std::unordered_map<std::string,CacheEntry> MatCache;
+  static MatCache s_cache;
+  static MatCache s_cache_ncrystal;
+
+  static G4Material * cacheLookup(MatCache& cache, const std::string& key)
+  {
+    auto it = cache.find(key);
+    if (it == cache.end())
+      return nullptr;
+    auto table = G4Material::GetMaterialTable();
+    if ( it->second.index < table->size() && (*table)[it->second.index] == it->second.mat )
+      return it->second.mat;
+    cache.erase(it);
+    return nullptr;
+  }
+
+  static void cacheInsert(MatCache& cache, const std::string& key, G4Material * mat)
+  {
+    cache[key] = CacheEntry{ mat, std::size_t(mat->GetIndex()) };
+  }
+
+  struct MatStats {
+    double seconds = 0.0;
+    std::uint64_t nrequests = 0;
+  };
+  static std::map<std::string,MatStats> s_stats;
+}
+
 //FIXME: return const materials
-G4Material * NamedMaterialProvider::getMaterial(const std::string& sss)
+G4Material * NamedMaterialProvider::getMaterialImpl(const std::string& sss)
 {
   constexpr double stp_temp = 273.15 * Units::kelvin;
   constexpr double stp_pressure = 1.0 * Units::atm;
@@ -286,18 +332,16 @@ G4Material * NamedMaterialProvider::getMaterial(const std::string& sss)
       }();
 
     if ( ncrystal_matcfg.has_value() ) {
-      //No caching, just rely on NCrystal:
-      return validate( G4NC::createMaterial( ncrystal_matcfg.value() ) );
+      std::string key = ncrystal_matcfg.value().toStrCfg();
+      G4Material * mat = cacheLookup( s_cache_ncrystal, key );
+      if ( !mat ) {
+        mat = validate( G4NC::createMaterial( ncrystal_matcfg.value() ) );
+        cacheInsert( s_cache_ncrystal, key, mat );
+      }
+      return mat;
     }
   }
 
-  //check cache:
-  static std::map<std::string,G4Material*> cache;
-  auto itCache = cache.find(ss);
-  if (itCache!=cache.end()) {
-    return itCache->second;
-  }
-
   //Decode:
   MatInfo matinfo(ss);
 
@@ -696,6 +740,44 @@ G4Material * NamedMaterialProvider::getMaterial(const std::string& sss)
     //assert(matinfo.fullname == mat->GetName());
   }
 
-  cache[ss] = mat;
   return validate( mat );
 }
+
+G4Material * NamedMaterialProvider::getMaterial(const std::string& s)
+{
+  std::string ss = NC::trim2( s );
+  G4Material * mat = cacheLookup( s_cache, ss );
+  if ( mat ) {
+    ++s_stats[ss].nrequests;
+    return mat;
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  mat = getMaterialImpl(ss);
+  auto& stats = s_stats[ss];
+  stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+  ++stats.nrequests;
+  cacheInsert( s_cache, ss, mat );
+  //Remember the first string giving each material:
+  s_matstrings.emplace(mat,ss);
+  return mat;
+}
+
+void NamedMaterialProvider::printStatistics(const char * prefix)
+{
+  std::vector<std::pair<std::string,MatStats>> v(s_stats.begin(),s_stats.end());
+  std::stable_sort(v.begin(),v.end(),[](const std::pair<std::string,MatStats>& a,
+                                        const std::pair<std::string,MatStats>& b)
+                   { return a.second.seconds > b.second.seconds; });
+  printf("%sTime spent creating named materials (including any component materials):\n",prefix);
+  for (auto& e : v)
+    printf("%s  %9.3f s %8llu request%s : \"%s\"\n",prefix,e.second.seconds,
+           (unsigned long long)e.second.nrequests,e.second.nrequests==1?" ":"s",e.first.c_str());
+  if (v.empty())
+    printf("%s  (no materials created)\n",prefix);
+}
+
+std::string NamedMaterialProvider::materialString(const G4Material* mat)
+{
+  auto it = s_matstrings.find(mat);
+  return it == s_matstrings.end() ? std::string() : it->second;
+}
@@ -11,7 +11,22 @@
 //
 //Note that it is too late to do step 2) in an G4UserEventAction::BeginEvent as
 //particle generation happens before.
-
+//
+//Two seeding modes are available:
+//
+// SEEDMODE_CHAINED (default): The first event uses the seed passed to init(),
+//   and each subsequent seed is taken from the random stream of the previous
+//   event. In forked child processes the first seed is offset by a large prime
+//   times the process ID, so results depend on the number of processes.
+//
+// SEEDMODE_INDEXED: The seed of the event with global index i is a hash of
+//   (seed,i), with i counting from first_event_index. Events are assigned to
+//   forked processes in an interleaved manner (process p simulates events
+//   p, p+nprocs, p+2*nprocs, ...), consistent with how generators reading
+//   input files distribute their events. Thus, the seed of each event is
+//   independent of the number of processes, and any single event (or range of
+//   events) can be reproduced by simulating it alone with first_event_index
+//   set accordingly.
 #include "Core/Types.hh"
 namespace G4Interfaces {
   class ParticleGenBase;
@@ -19,8 +34,13 @@ namespace G4Interfaces {
 
 struct RandomManager {
   enum EVTMSGLEVEL { EVTMSG_NEVER, EVTMSG_ADAPTABLE, EVTMSG_ALWAYS };
-  static void init(std::uint64_t seed_of_first_event, EVTMSGLEVEL lvl = EVTMSG_ADAPTABLE );
+  enum SEEDMODE { SEEDMODE_CHAINED, SEEDMODE_INDEXED };
+  static void init(std::uint64_t seed_of_first_event, EVTMSGLEVEL lvl = EVTMSG_ADAPTABLE,
+                   SEEDMODE mode = SEEDMODE_CHAINED, std::uint64_t first_event_index = 0 );
   static void attach(G4Interfaces::ParticleGenBase* the_particle_generator_of_the_job);
+
+  //The seed used for the event with global index evtidx in SEEDMODE_INDEXED:
+  static std::uint64_t indexedEventSeed(std::uint64_t seed, std::uint64_t evtidx);
 };
 
 #endif
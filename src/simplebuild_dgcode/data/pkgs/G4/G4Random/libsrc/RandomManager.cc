@@ -12,13 +12,19 @@ class RndmSeedCB : public G4Interfaces::PreGenCallBack {
 public:
 
   //Will set the seed at the beginning of each event and print it (occasionally)
-  //along with the event number. First event will start with the seed passed in
-  //through the variable "firstseed".
-  RndmSeedCB(std::uint64_t firstseed,RandomManager::EVTMSGLEVEL l)
+  //along with the event number. In chained mode, the first event will start
+  //with the seed passed in through the variable "firstseed", in indexed mode
+  //all seeds are derived from it and the global event index.
+  RndmSeedCB(std::uint64_t firstseed,RandomManager::EVTMSGLEVEL l,
+             RandomManager::SEEDMODE mode, std::uint64_t first_event_index)
     : PreGenCallBack(),
       m_nextseed(firstseed),
       m_evtcount(0),
-      m_evtMsgLvl(l)
+      m_evtMsgLvl(l),
+      m_seedMode(mode),
+      m_masterSeed(firstseed),
+      m_evtIdx(first_event_index),
+      m_evtIdxStride(0)
   {
     printf("%sInstalling xoroshiro128+ random generator (via NCrystal)\n",FrameworkGlobals::printPrefix());
     m_engine = new NCG4RngEngine;
@@ -32,7 +38,21 @@ public:
   virtual void preGen()
   {
     std::uint64_t seed_to_use;
-    if (m_nextseed) {
+    std::uint64_t evtidx(0);
+    if (m_seedMode==RandomManager::SEEDMODE_INDEXED) {
+      if (!m_evtIdxStride) {
+        //1st event. Forking (if any) has happened at this point, so we can
+        //find our place in the interleaved assignment of events to processes:
+        m_evtIdxStride = 1;
+        if (FrameworkGlobals::isForked()) {
+          m_evtIdx += FrameworkGlobals::mpID();
+          m_evtIdxStride = FrameworkGlobals::nProcs();
+        }
+      }
+      evtidx = m_evtIdx;
+      seed_to_use = RandomManager::indexedEventSeed(m_masterSeed,evtidx);
+      m_evtIdx += m_evtIdxStride;
+    } else if (m_nextseed) {
       //1st event...
       if (FrameworkGlobals::isForked()&&FrameworkGlobals::isChild()) {
         //...in a forked off child.
@@ -70,9 +90,11 @@ public:
           G4Utils::flush();
           //don't use printf for 64bit ints as it is less portable:
           std::cout << FrameworkGlobals::printPrefix()
-                    <<"Begin simulation of event "<<m_evtcount
-                    <<" [seed " << seed_to_use<<"]"
-                    <<std::endl;
+                    <<"Begin simulation of event "<<m_evtcount;
+          if (m_seedMode==RandomManager::SEEDMODE_INDEXED)
+            std::cout <<" [index " << evtidx << ", seed " << seed_to_use<<"]"<<std::endl;
+          else
+            std::cout <<" [seed " << seed_to_use<<"]"<<std::endl;
         }
     }
   }
@@ -86,12 +108,38 @@ private:
   NCG4RngEngine * m_engine = nullptr;
   unsigned m_evtcount;
   RandomManager::EVTMSGLEVEL m_evtMsgLvl;
+  RandomManager::SEEDMODE m_seedMode;
+  std::uint64_t m_masterSeed;
+  std::uint64_t m_evtIdx;//global index of next event (indexed mode)
+  std::uint64_t m_evtIdxStride;//0 until first event (indexed mode)
 };
 
-void RandomManager::init(std::uint64_t seed_of_first_event,EVTMSGLEVEL lvl)
+void RandomManager::init(std::uint64_t seed_of_first_event,EVTMSGLEVEL lvl,
+                         SEEDMODE mode, std::uint64_t first_event_index)
 {
   assert(!s_theRndmSeedCB);
-  s_theRndmSeedCB = std::make_shared<RndmSeedCB>(seed_of_first_event,lvl);
+  s_theRndmSeedCB = std::make_shared<RndmSeedCB>(seed_of_first_event,lvl,mode,first_event_index);
+}
+
+namespace {
+  inline std::uint64_t splitmix64_mix(std::uint64_t z)
+  {
+    //Finalizer of the SplitMix64 generator (a bijection with good avalanche
+    //properties):
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return z ^ (z >> 31);
+  }
+}
+
+std::uint64_t RandomManager::indexedEventSeed(std::uint64_t seed, std::uint64_t evtidx)
+{
+  //Keyed counter-based hash. The event index is mixed on its own before being
+  //combined with the seed, so nearby seeds and nearby indices both give
+  //unrelated event seeds:
+  const std::uint64_t golden_gamma = UINT64_C(0x9e3779b97f4a7c15);
+  std::uint64_t s = splitmix64_mix( seed + golden_gamma * splitmix64_mix( evtidx + golden_gamma ) );
+  return s ? s : golden_gamma;//never return 0 (means "no seed" in places)
 }
 
 void RandomManager::attach(G4Interfaces::ParticleGenBase* pg)
@@ -12,6 +12,11 @@ namespace EvtFile {
 
   typedef std::string str_type;
 
+  //Algorithms for the event checksums. The id is stored in each event header
+  //since file format version 3 (older files always use MurmurHash3):
+  enum class CheckSumAlgo : std::uint32_t { MurmurHash3 = 0, CRC32C = 1 };
+  static const CheckSumAlgo CHECKSUMALGO_DEFAULT = CheckSumAlgo::CRC32C;
+
 }
 
 #endif
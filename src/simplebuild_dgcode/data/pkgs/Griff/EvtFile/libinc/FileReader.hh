@@ -9,6 +9,7 @@
 
 #include "Core/Types.hh"
 #include "EvtFile/IFormat.hh"
+#include "EvtFile/Defs.hh"
 #include "EvtFile/IDBSubSectionReader.hh"
 #include <vector>
 #include <fstream>
@@ -16,6 +17,7 @@
 #include <map>
 #include <cassert>
 #include "Utils/DynBuffer.hh"
+#include "ZLibUtils/Compress.hh"
 
 namespace EvtFile {
 
@@ -75,6 +77,18 @@ namespace EvtFile {
 
     int32_t version() const { return m_version; }
 
+    //Dictionary used for compression of the full data sections (empty unless
+    //the file format version is 4 or later):
+    const std::string& compressionDictionary() const { return m_dict; }
+
+    //Declare that only the brief data of events will be needed. The full data
+    //sections are then never read or decompressed, but simply skipped on disk,
+    //and the brief data is read in the same sequential pass as the event
+    //header. Any attempt to access the full data (including via
+    //verifyEventDataIntegrity) will result in an exception:
+    void setBriefDataOnly(bool b = true) { m_briefDataOnly = b; }
+    bool briefDataOnly() const { return m_briefDataOnly; }
+
     ////////////////////////
     //  Event navigation  //
     ////////////////////////
@@ -84,6 +98,9 @@ namespace EvtFile {
     bool goToPreviousEvent() { return skipEvents(-1); }
     bool goToFirstEvent() { return seekEventByIndex(0); };
     bool skipEvents(int n);//n<0 to go backwards
+    //Number of events indexed so far. After navigation past the last event
+    //failed (without bad()), this is the number of events in the file:
+    unsigned nEventsIndexed() const { return m_evts.size(); }
     bool seekEventByIndex(unsigned idx);//event idx in the file [0=first evt in file, 1=second, etc.]
     bool goToEvent(std::uint32_t run_number,std::uint32_t evt_number);
 
@@ -101,20 +118,34 @@ namespace EvtFile {
     unsigned eventNumber() const { return m_currentEventInfo->evtNumber; }
     unsigned eventIndex() const { return m_currentEventInfo->evtIndex; }
     unsigned nBytesBriefData() const { return m_currentEventInfo->sectionSize_briefdata; }
-    unsigned nBytesFullData() { if (!m_fulldata_isloaded) getFullData(); return m_fulldata_size; }
+    unsigned nBytesFullData() { if (!m_fulldata_isloaded&&!m_fulldata_partial) getFullData(); return m_fulldata_size; }
     unsigned nBytesFullDataOnDisk() const { return m_currentEventInfo->sectionSize_fulldata; }
     const char* getBriefData();//on demand loading => not const (we could consider mutable, but...)
     const char* getFullData();//on demand loading => not const (we could consider mutable, but...)
 
+    //Like getFullData(), but only guarantees that the first nbytes of the full
+    //data are available, decompressing no more than needed (when compressed).
+    //The returned pointer remains valid for the event, also after subsequent
+    //calls requesting more data:
+    const char* getFullDataPrefix(unsigned nbytes);
+
     //Special methods for data hashing / integrity
     std::uint32_t eventCheckSum() const;//Checksum stored in file
+    CheckSumAlgo eventCheckSumAlgo() const;//Algorithm used for the checksum
     bool verifyEventDataIntegrity();//Recalculate checksum and verify
-                                    //(Semi-expensive, will re-read the DB
-                                    //section each time called)
+                                    //(Semi-expensive, reads all data of the
+                                    //event in a single pass if not already
+                                    //loaded, including the DB section)
 
     //Special methods for specialised low-level access:
     unsigned nBytesSharedDataInEvent() const { return m_currentEventInfo->sectionSize_database; }
     void getSharedDataInEvent(std::vector<char>&);//Will reload data and place in vector (will be resized)
+    //The full data section as stored on disk (i.e. compressed, if the format
+    //uses compression), with nBytesFullDataOnDisk() bytes. It is only
+    //decompressed if getFullData() is subsequently called:
+    const char* getFullDataOnDisk();
+    //Size of event headers on disk (depends on file format version):
+    unsigned eventHeaderBytes() const { return m_evtHeaderBytes; }
 
   private:
 
@@ -128,10 +159,12 @@ namespace EvtFile {
     unsigned m_bufferLength;
     std::ifstream m_is;
     int32_t m_version;
+    unsigned m_evtHeaderBytes;
     //bool m_eventActive;
     bool m_bad;
     EvtFileDB * m_db_listener;
     std::string m_reason;
+    std::string m_dict;
 
     void read(char*data,unsigned nbytes);
     template<class T>
@@ -145,8 +178,15 @@ namespace EvtFile {
     Utils::DynBuffer<char> m_section_fulldata_compressed;
     bool m_briefdata_isloaded;
     bool m_fulldata_isloaded;
-
-    void initEventAtIndex(unsigned idx);
+    bool m_fulldata_partial;//compressed data read and being decompressed on demand
+    ZLibUtils::PartialDecompressor m_fulldata_decompressor;
+    ZLibUtils::Decompressor m_decompressor;
+    Utils::DynBuffer<char> m_section_database;//only used when verifying
+    bool readFullDataFromDisk(bool seek = true);
+    bool m_briefDataOnly;
+    void checkFullDataAccess() const;
+
+    void initEventAtIndex(unsigned idx, bool passing = false);//passing: only skipping over the event
     struct EventInfo {
       std::uint32_t checkSum;
       std::uint32_t runNumber;
@@ -154,9 +194,9 @@ namespace EvtFile {
       std::uint32_t sectionSize_database;
       std::uint32_t sectionSize_briefdata;
       std::uint32_t sectionSize_fulldata;//on-disk, not uncompressed
-      std::streampos evtPosInFile;
+      std::uint32_t checkSumAlgo;//not on disk before format version 3
       std::uint32_t evtIndex;
-      std::uint32_t dummy;//Here to have sizeof(EventInfo)==8*sizeof(std::uint32_t)+sizeof(streampos) even on 64bit.
+      std::streampos evtPosInFile;
     };
     static_assert( sizeof(EventInfo)==8*sizeof(std::uint32_t)+sizeof(std::streampos), "" );
     EventInfo * m_currentEventInfo = nullptr;
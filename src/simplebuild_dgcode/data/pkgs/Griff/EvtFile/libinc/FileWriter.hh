@@ -5,12 +5,16 @@
 //not have a need to use this file.
 
 #include "EvtFile/IFormat.hh"
+#include "EvtFile/Defs.hh"
 #include "Core/Types.hh"
 #include <cassert>
 #include <vector>
+#include <deque>
 #include <fstream>
 #include <cstring>
+#include <string>
 #include "Utils/DynBuffer.hh"
+#include "ZLibUtils/Compress.hh"
 
 //TODO: Add method which will ignore current event.
 //TODO: Make sure (#evt,#run) is unique in file (merger scripts must honour this)
@@ -30,9 +34,10 @@ namespace EvtFile {
     //  Methods for opening/closing the file  //
     ////////////////////////////////////////////
 
-    //The constructor opens the file and writes the first few words identifying
-    //the filetype. It will append the appropriate file extension of the format
-    //to the filename if it doesn't have that ending already.
+    //The constructor opens the file (the first few words identifying the
+    //filetype are written along with the first event). It will append the
+    //appropriate file extension of the format to the filename if it doesn't
+    //have that ending already.
     FileWriter( const IFormat*,
                 const char* filename,
                 int buffer_len=8192 );
@@ -81,6 +86,43 @@ namespace EvtFile {
 
     void flushEventToDisk(int32_t runnumber, int32_t eventnumber);//Call at end of each event
 
+    //Algorithm used for checksums of events written by flushEventToDisk
+    //(default is CRC32C):
+    void setCheckSumAlgo(CheckSumAlgo a) { m_checksumalgo = a; }
+    CheckSumAlgo checkSumAlgo() const { return m_checksumalgo; }
+
+    //Compress the full data sections of all events with a preset dictionary
+    //(see ZLibUtils::Compressor), which is stored once in the file header. This
+    //greatly improves compression of small events, whose full data sections
+    //otherwise have too little internal redundancy. The dictionary can either be
+    //given explicitly (e.g. when copying compressed events from a file using
+    //that dictionary), or be trained on the full data of the first ntrain events,
+    //which are then kept in memory until the dictionary is ready. Must be
+    //called before the first event is written, and only for formats with
+    //compressed full data. Files with a dictionary use file format version 4:
+    void setCompressionDictionary(const std::string& dict);
+    void trainCompressionDictionary(unsigned ntrain = 100, unsigned dictsize = 16384);
+    const std::string& compressionDictionary() const { return m_dict; }
+
+    //Low-level method for tools copying events between files: Write out a
+    //complete event whose full data section is already in its on-disk
+    //(i.e. compressed) form, along with a precalculated checksum. The header
+    //words are checksum, run number, event number and the on-disk sizes of the
+    //three sections, and algo is the one used for the checksum. No data must
+    //have been added to the current event, and pre-flush callbacks are not
+    //triggered:
+    void writeRawEvent(const std::uint32_t (&eventheader)[6], CheckSumAlgo algo,
+                       const char* dbdata, const char* briefdata, const char* fulldata_ondisk);
+    //(the full data must be compressed with compressionDictionary(), and
+    //writeRawEvent can not be used while a dictionary is being trained)
+
+    //The checksum stored in event headers, given the header words (except the
+    //checksum itself) and the contents of the three sections. The full data
+    //must be passed in uncompressed form:
+    static std::uint32_t eventCheckSum(CheckSumAlgo algo, const std::uint32_t (&eventheader)[6],
+                                       const char* dbdata, const char* briefdata,
+                                       const char* fulldata, unsigned fulldata_size);
+
   private:
 
     // FileWriter( const FileWriter & );
@@ -93,8 +135,25 @@ namespace EvtFile {
     Utils::DynBuffer<char> m_section_briefdata;
     Utils::DynBuffer<char> m_section_fulldata;
     Utils::DynBuffer<char> m_section_fulldata_compressed;
+    ZLibUtils::Compressor m_compressor;
     std::vector<IFWPreFlushCB*> m_preFlushCBs;
     std::string m_filename;
+    CheckSumAlgo m_checksumalgo;
+    //File header (written before the first event, once any dictionary is known):
+    bool m_headerWritten;
+    std::string m_dict;
+    void writeFileHeader();
+    //Events kept while training a dictionary:
+    struct PendingEvent {
+      int32_t runnumber, eventnumber;
+      Utils::DynBuffer<char> database, briefdata, fulldata;
+    };
+    std::deque<PendingEvent> m_pendingEvents;//deque, so entries are never moved
+    unsigned m_ntrain;
+    unsigned m_dictsize;
+    void finishTraining();
+    void writeCurrentEvent(int32_t runnumber, int32_t eventnumber);
+    void writeEventHeader(const std::uint32_t (&eventheader)[6], CheckSumAlgo);
     void write( const char*data, unsigned nbytes ) { m_os.write( data, nbytes); }
     void write( const Utils::DynBuffer<char>& buf )
     { if (!buf.empty())
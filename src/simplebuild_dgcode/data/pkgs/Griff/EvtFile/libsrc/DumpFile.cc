@@ -1,6 +1,6 @@
 #include "EvtFile/DumpFile.hh"
-#include "EvtFileDefs.hh"
 #include "EvtFile/FileReader.hh"
+#include "ZLibUtils/Compress.hh"
 #include <cassert>
 #include "Core/Types.hh"
 #include <cstdio>
@@ -60,6 +60,11 @@ namespace EvtFile {
         return false;
       }
     printf("  File format version: %i\n",f.version());
+    if (!f.compressionDictionary().empty()) {
+      const std::string& dict = f.compressionDictionary();
+      printf("  Compression dictionary: %u bytes (id 0x%08x)\n",(unsigned)dict.size(),
+             (unsigned)ZLibUtils::dictionaryID(dict.data(),dict.size()));
+    }
     if (!f.eventActive()) {
       printf("  No events in file.\n");
       return true;//not an error!
@@ -80,11 +85,11 @@ namespace EvtFile {
       bool integrity(f.verifyEventDataIntegrity());
       unsigned fulldatasize = uncompressed_sizes ? f.nBytesFullData() : f.nBytesFullDataOnDisk();
       if (!brief||!integrity) {
-        std::ostringstream stmp;stmp<<std::uint64_t(EVTFILE_EVENT_HEADER_BYTES+db.nBytesReceived()+f.nBytesBriefData()+fulldatasize);
+        std::ostringstream stmp;stmp<<std::uint64_t(f.eventHeaderBytes()+db.nBytesReceived()+f.nBytesBriefData()+fulldatasize);
 
         printf("  %8i %6i %6i %9i %9i %12i %11i %8s %s\n",
                f.eventIndex(),f.runNumber(),f.eventNumber(),
-               int(EVTFILE_EVENT_HEADER_BYTES), db.nBytesReceived(),f.nBytesBriefData(),fulldatasize,
+               int(f.eventHeaderBytes()), db.nBytesReceived(),f.nBytesBriefData(),fulldatasize,
                stmp.str().c_str(),
                integrity ? "[success]" : "[failure]" );
       }
@@ -100,11 +105,11 @@ namespace EvtFile {
 
     std::ostringstream s;
     s<<"Total [nevts="<<nevts<<"]:";
-    std::ostringstream stmp1;stmp1<<std::uint64_t(nevts*EVTFILE_EVENT_HEADER_BYTES);
+    std::ostringstream stmp1;stmp1<<std::uint64_t(nevts*f.eventHeaderBytes());
     std::ostringstream stmp2;stmp2<<totdb;
     std::ostringstream stmp3;stmp3<<totbrief;
     std::ostringstream stmp4;stmp4<<totfull;
-    std::ostringstream stmp5;stmp5<<std::uint64_t(nevts*EVTFILE_EVENT_HEADER_BYTES)+totdb+totbrief+totfull;
+    std::ostringstream stmp5;stmp5<<std::uint64_t(nevts*f.eventHeaderBytes())+totdb+totbrief+totfull;
 
     printf("  %-22s %9s %9s %12s %11s %8s %s\n",
            s.str().c_str(),
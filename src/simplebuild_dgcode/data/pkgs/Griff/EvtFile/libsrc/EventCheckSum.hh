@@ -0,0 +1,37 @@
+#ifndef EvtFile_EventCheckSum_hh
+#define EvtFile_EventCheckSum_hh
+
+//Progressive calculation of event checksums with any of the supported
+//algorithms (internal to the EvtFile package).
+
+#include "EvtFile/Defs.hh"
+#include "Utils/ProgressiveHash.hh"
+#include "Utils/ProgressiveCRC32C.hh"
+
+namespace EvtFile {
+
+  inline bool checkSumAlgoIsKnown(std::uint32_t algo)
+  {
+    return algo == (std::uint32_t)CheckSumAlgo::MurmurHash3 || algo == (std::uint32_t)CheckSumAlgo::CRC32C;
+  }
+
+  class EventCheckSum {
+  public:
+    EventCheckSum(CheckSumAlgo algo) : m_crc(algo == CheckSumAlgo::CRC32C) {}
+    void addData(const char* data, unsigned len)
+    {
+      if (m_crc)
+        m_crc32c.addData(data,len);
+      else
+        m_murmur.addData(data,len);
+    }
+    std::uint32_t getHash() const { return m_crc ? m_crc32c.getHash() : m_murmur.getHash(); }
+  private:
+    bool m_crc;
+    ProgressiveCRC32C m_crc32c;
+    ProgressiveHash m_murmur;
+  };
+
+}
+
+#endif
@@ -1,12 +1,22 @@
 #ifndef EvtFile_EvtFileDefs_hh
 #define EvtFile_EvtFileDefs_hh
 
-//The file format version we are currently writing (the container version, not
-//the version of the contained data):
-#define EVTFILE_VERSION ((int32_t)2)
+//The newest file format version (the container version, not the version of the
+//contained data). Since version 4, the file header contains a dictionary used
+//for compression of the full data sections. Files without a dictionary are
+//still written as version 3, so they stay readable by older releases:
+#define EVTFILE_VERSION ((int32_t)4)
+#define EVTFILE_VERSION_NODICT ((int32_t)3)
 
-//Sizes in EVTFILE__VERSION 0,1,2:
+//Sizes in EVTFILE__VERSION 0,1,2,3 (version 4 adds the size of the dictionary
+//as a 32 bit word, followed by the dictionary itself):
 #define EVTFILE_FILE_HEADER_BYTES (2*sizeof(int32_t))
-#define EVTFILE_EVENT_HEADER_BYTES (6*sizeof(std::uint32_t))
+#define EVTFILE_MAX_DICT_BYTES (1u<<20)
+
+//Event headers contain checksum, run number, event number and the sizes of the
+//three data sections. Since version 3, a word with the checksum algorithm id
+//follows:
+#define EVTFILE_EVENT_HEADER_BYTES_V2 (6*sizeof(std::uint32_t))
+#define EVTFILE_EVENT_HEADER_BYTES (7*sizeof(std::uint32_t))
 
 #endif
@@ -2,10 +2,12 @@
 #include "EvtFile/FileReader.hh"
 #include "EvtFile/FileWriter.hh"
 #include "EvtFileDefs.hh"
-#include "Utils/ProgressiveHash.hh"
+#include "EventCheckSum.hh"
 #include "ZLibUtils/Compress.hh"
 #include <limits>
 #include <cassert>
+#include <cstddef>
+#include <stdexcept>
 
 namespace EvtFile {
 
@@ -18,12 +20,15 @@ namespace EvtFile {
       m_buf(0),
       m_bufferLength(buffer_len),
       m_version(-1),
+      m_evtHeaderBytes(EVTFILE_EVENT_HEADER_BYTES),
       m_bad(false),
       m_db_listener(db_listener),
       m_fulldata_size(0),
       m_fulldata_compressed(format->compressFullData()),
       m_briefdata_isloaded(false),
       m_fulldata_isloaded(false),
+      m_fulldata_partial(false),
+      m_briefDataOnly(false),
       m_currentEventInfo(nullptr),
       m_fileName(filename)
   {
@@ -81,8 +86,26 @@ namespace EvtFile {
       close();
       return false;
     }
+    if (fileversion>=4) {
+      //Dictionary for compression of the full data sections:
+      std::uint32_t dictsize;
+      read(dictsize);
+      if (!m_is.fail()&&dictsize<=EVTFILE_MAX_DICT_BYTES) {
+        m_dict.resize(dictsize);
+        read(&m_dict[0],dictsize);
+      }
+      if (m_is.fail()||dictsize>EVTFILE_MAX_DICT_BYTES) {
+        m_bad=true;
+        m_reason="File not in right format";
+        close();
+        return false;
+      }
+      m_decompressor.setDictionary(m_dict.data(),m_dict.size());
+      m_fulldata_decompressor.setDictionary(m_dict.data(),m_dict.size());
+    }
     //All ok!
     m_version=fileversion;
+    m_evtHeaderBytes = ( fileversion < 3 ? EVTFILE_EVENT_HEADER_BYTES_V2 : EVTFILE_EVENT_HEADER_BYTES );
     m_section_briefdata.reserve(4096);
     m_section_fulldata.reserve(4096);
     m_section_fulldata_compressed.reserve(4096);
@@ -132,9 +155,10 @@ namespace EvtFile {
 
     //Ok, targetidx lies beyond the events already read. Jump to the first
     //unread event and step forward from there.
-    initEventAtIndex(m_evts.size());
+    //Events passed on the way are only indexed (header and database section).
+    initEventAtIndex(m_evts.size(),m_evts.size()<targetidx);
     while(m_currentEventInfo && targetidx>m_currentEventInfo->evtIndex)
-      initEventAtIndex(m_evts.size());
+      initEventAtIndex(m_evts.size(),m_evts.size()<targetidx);
 
     return m_currentEventInfo!=nullptr;
   }
@@ -153,6 +177,7 @@ namespace EvtFile {
       m_currentEventInfo=&(m_evts[idx]);
       m_briefdata_isloaded = false;
       m_fulldata_isloaded = false;
+      m_fulldata_partial = false;
       return true;//we previously read the event so can jump right to it
     }
 
@@ -166,7 +191,7 @@ namespace EvtFile {
     return false;
   }
 
-  void FileReader::initEventAtIndex(unsigned idx)
+  void FileReader::initEventAtIndex(unsigned idx, bool passing)
   {
     assert(isInit());
 
@@ -179,6 +204,7 @@ namespace EvtFile {
     m_currentEventInfo=nullptr;
     m_briefdata_isloaded = false;
     m_fulldata_isloaded = false;
+    m_fulldata_partial = false;
 
     assert(idx<=m_evts.size());
     if (idx==m_evts.size()) {
@@ -189,8 +215,7 @@ namespace EvtFile {
         //Seek to end of last read event in file:
         EventInfo& lastEvt = m_evts.back();
         newEvtPos = lastEvt.evtPosInFile;
-        newEvtPos +=EVTFILE_EVENT_HEADER_BYTES;
-        static_assert(EVTFILE_EVENT_HEADER_BYTES==6*sizeof(std::uint32_t));
+        newEvtPos += m_evtHeaderBytes;
         newEvtPos+=lastEvt.sectionSize_database;
         newEvtPos+=lastEvt.sectionSize_briefdata;
         newEvtPos+=lastEvt.sectionSize_fulldata;
@@ -216,9 +241,12 @@ namespace EvtFile {
       EventInfo& newEvt = m_evts.back();
       newEvt.evtPosInFile = newEvtPos;
       newEvt.evtIndex = m_evts.size()-1;
-      read(reinterpret_cast<char*>(&newEvt.checkSum),sizeof(std::uint32_t)*6);//Trick to read all 6 variables with one call
-      static_assert(sizeof(EventInfo)==sizeof(std::uint32_t)*8+sizeof(std::streampos));//make sure there is no padding => our trick would fail
-      static_assert(EVTFILE_EVENT_HEADER_BYTES==sizeof(std::uint32_t)*6);//make sure we are consistent with EvtFileDefs.hh
+      read(reinterpret_cast<char*>(&newEvt.checkSum),m_evtHeaderBytes);//Trick to read all 6 or 7 variables with one call
+      static_assert(offsetof(EventInfo,checkSumAlgo)==sizeof(std::uint32_t)*6);//make sure there is no padding => our trick would fail
+      static_assert(EVTFILE_EVENT_HEADER_BYTES==sizeof(std::uint32_t)*7);//make sure we are consistent with EvtFileDefs.hh
+      static_assert(EVTFILE_EVENT_HEADER_BYTES_V2==sizeof(std::uint32_t)*6);
+      if (m_evtHeaderBytes==EVTFILE_EVENT_HEADER_BYTES_V2)
+        newEvt.checkSumAlgo = (std::uint32_t)CheckSumAlgo::MurmurHash3;
       if (m_is.fail()) {
         m_bad=true;
         m_evts.resize(m_evts.size()-1);
@@ -239,6 +267,22 @@ namespace EvtFile {
           return;
         }
         m_db_listener->newInfoAvailable(m_section_briefdata.data(),newEvt.sectionSize_database);
+      } else if (m_briefDataOnly && newEvt.sectionSize_database) {
+        m_is.seekg(newEvt.sectionSize_database,std::ios::cur);
+      }
+      if (m_briefDataOnly && !passing && newEvt.sectionSize_briefdata) {
+        //Brief data follows right after, so read it now rather than seeking
+        //back to it later:
+        m_section_briefdata.resize_without_init(newEvt.sectionSize_briefdata);
+        read(m_section_briefdata.data(),newEvt.sectionSize_briefdata);
+        if (m_is.fail()) {
+          m_bad=true;
+          m_evts.resize(m_evts.size()-1);
+          m_currentEventInfo=nullptr;
+          m_reason="Errors encountered while reading brief data section of event";
+          return;
+        }
+        m_briefdata_isloaded = true;
       }
       //All ok it seems:
       m_currentEventInfo=&newEvt;
@@ -259,6 +303,7 @@ namespace EvtFile {
 
     m_briefdata_isloaded = false;
     m_fulldata_isloaded = false;
+    m_fulldata_partial = false;
 
     if (m_evtMap.size()<m_evts.size()) {
       //update m_evtMap
@@ -283,8 +328,8 @@ namespace EvtFile {
     if (!m_currentEventInfo->sectionSize_database)
       return;
 
-    m_is.seekg(m_currentEventInfo->evtPosInFile+std::streampos(EVTFILE_EVENT_HEADER_BYTES));
-    assert(m_is.tellg()==m_currentEventInfo->evtPosInFile+std::streampos(EVTFILE_EVENT_HEADER_BYTES));
+    m_is.seekg(m_currentEventInfo->evtPosInFile+std::streampos(m_evtHeaderBytes));
+    assert(m_is.tellg()==m_currentEventInfo->evtPosInFile+std::streampos(m_evtHeaderBytes));
     char * tmp = data.data();
     assert(tmp);
     read(tmp,m_currentEventInfo->sectionSize_database);
@@ -301,7 +346,7 @@ namespace EvtFile {
       m_section_briefdata.resize_without_init(nBytesBriefData());
       assert(m_currentEventInfo!=nullptr);
       std::streampos pos = m_currentEventInfo->evtPosInFile;
-      pos+=EVTFILE_EVENT_HEADER_BYTES;
+      pos+=m_evtHeaderBytes;
       pos+=m_currentEventInfo->sectionSize_database;
       m_is.seekg(pos);
       if (m_is.fail()) {
@@ -318,12 +363,26 @@ namespace EvtFile {
     return m_section_briefdata.data();
   }
 
+  void FileReader::checkFullDataAccess() const
+  {
+    if (m_briefDataOnly)
+      throw std::runtime_error("EvtFile::FileReader: Full data of event requested while reading in brief-data-only mode");
+  }
+
   const char* FileReader::getFullData() {
     assert(isInit());
+    checkFullDataAccess();
 
     if (m_fulldata_isloaded)
       return m_section_fulldata.data();
 
+    if (m_fulldata_partial) {
+      //finish decompression started by getFullDataPrefix:
+      m_fulldata_decompressor.ensureAvailable(m_fulldata_size);
+      m_fulldata_isloaded=true;
+      return m_section_fulldata.data();
+    }
+
     assert(eventActive() && "getFullData() called when not eventActive()");
 
     unsigned n(nBytesFullDataOnDisk());
@@ -336,7 +395,7 @@ namespace EvtFile {
         m_section_fulldata.resize_without_init(n);
       assert(m_currentEventInfo!=nullptr);
       std::streampos pos = m_currentEventInfo->evtPosInFile;
-      pos+=EVTFILE_EVENT_HEADER_BYTES;
+      pos+=m_evtHeaderBytes;
       pos+=m_currentEventInfo->sectionSize_database;
       pos+=m_currentEventInfo->sectionSize_briefdata;
       m_is.seekg(pos);
@@ -355,7 +414,7 @@ namespace EvtFile {
       if (m_fulldata_compressed) {
         //uncompress:
         assert(n>sizeof(std::uint32_t));
-        ZLibUtils::decompressToBufferNew(m_section_fulldata_compressed.data(), n, m_section_fulldata);
+        m_decompressor.decompress(m_section_fulldata_compressed.data(), n, m_section_fulldata);
         if ( m_section_fulldata.size() >= std::numeric_limits<unsigned>::max() )
           throw std::runtime_error("full data section size exceeds unsigned integer limits");
         m_fulldata_size = static_cast<unsigned>(m_section_fulldata.size());
@@ -365,35 +424,157 @@ namespace EvtFile {
     return m_section_fulldata.data();
   }
 
+  bool FileReader::readFullDataFromDisk(bool seek)
+  {
+    //Reads the (compressed) full data section from disk without decompressing
+    //it, and prepares on-demand decompression. If seek is false, the stream
+    //must already be positioned at the start of the full data section:
+    assert(m_fulldata_compressed);
+    assert(!m_fulldata_isloaded&&!m_fulldata_partial);
+    assert(eventActive() && "getFullDataPrefix() called when not eventActive()");
+    const unsigned n(nBytesFullDataOnDisk());
+    m_section_fulldata_compressed.resize_without_init(n);
+    if (seek) {
+      std::streampos pos = m_currentEventInfo->evtPosInFile;
+      pos+=m_evtHeaderBytes;
+      pos+=m_currentEventInfo->sectionSize_database;
+      pos+=m_currentEventInfo->sectionSize_briefdata;
+      m_is.seekg(pos);
+      if (m_is.fail()) {
+        m_bad=true;
+        m_reason="Error while seeking to full data section of event";
+        return false;
+      }
+    }
+    if (n)
+      read(m_section_fulldata_compressed.data(),n);
+    if (m_is.fail()) {
+      m_bad=true;
+      m_reason="Errors encountered while reading full data section of event";
+      return false;
+    }
+    m_fulldata_decompressor.reset(m_section_fulldata_compressed.data(), n, m_section_fulldata);
+    m_fulldata_size = m_fulldata_decompressor.originalSize();
+    m_fulldata_partial = true;
+    return true;
+  }
+
+  const char* FileReader::getFullDataPrefix(unsigned nbytes) {
+    assert(isInit());
+    checkFullDataAccess();
+    if (m_fulldata_isloaded)
+      return m_section_fulldata.data();
+    if (!m_fulldata_compressed)
+      return getFullData();//nothing to gain
+    if (!m_fulldata_partial && !readFullDataFromDisk())
+      return 0;
+    if (m_fulldata_decompressor.ensureAvailable(nbytes)==m_fulldata_size)
+      m_fulldata_isloaded = true;
+    return m_section_fulldata.data();
+  }
+
+  const char* FileReader::getFullDataOnDisk() {
+    assert(isInit());
+    checkFullDataAccess();
+    if (!m_fulldata_compressed||!nBytesFullDataOnDisk())
+      return getFullData();
+    //The compressed buffer is kept intact by both getFullData() and
+    //getFullDataPrefix(), so only read it if neither was called already:
+    if (!m_fulldata_isloaded && !m_fulldata_partial && !readFullDataFromDisk())
+      return 0;
+    return m_section_fulldata_compressed.data();
+  }
+
   bool FileReader::verifyEventDataIntegrity()
   {
     assert(isInit());
+    checkFullDataAccess();
 
     if (!ok()||!eventActive())
       return false;
     assert(m_currentEventInfo);
 
-    ProgressiveHash hash;
-    hash.addData(reinterpret_cast<char*>(&(m_currentEventInfo->runNumber)),5*sizeof(std::uint32_t));
-
-    if (m_currentEventInfo->sectionSize_database>0) {
-      m_is.seekg(m_currentEventInfo->evtPosInFile+std::streampos(EVTFILE_EVENT_HEADER_BYTES));
-      assert(m_is.tellg()==m_currentEventInfo->evtPosInFile+std::streampos(EVTFILE_EVENT_HEADER_BYTES));
-      char * tmp = new char[m_currentEventInfo->sectionSize_database];//we could cache this, but normally we don't verify integrity...
-      assert(tmp);
-      read(tmp,m_currentEventInfo->sectionSize_database);
-      hash.addData(tmp,m_currentEventInfo->sectionSize_database);
-      delete[] tmp;
+    const EventInfo& evt = *m_currentEventInfo;
+    if (!checkSumAlgoIsKnown(evt.checkSumAlgo))
+      return false;
+
+    EventCheckSum hash(static_cast<CheckSumAlgo>(evt.checkSumAlgo));
+    hash.addData(reinterpret_cast<const char*>(&(evt.runNumber)),5*sizeof(std::uint32_t));
+
+    //Read all sections not already in memory with a single sequential pass over
+    //the event on disk (skipping only the brief data, if already loaded):
+    const unsigned nfull(evt.sectionSize_fulldata);
+    const bool readfull = nfull && !m_fulldata_isloaded && !m_fulldata_partial;
+    if (evt.sectionSize_database || !m_briefdata_isloaded || readfull) {
+      m_is.seekg(evt.evtPosInFile+std::streampos(m_evtHeaderBytes));
+      if (m_is.fail()) {
+        m_bad=true;
+        return false;
+      }
     }
 
-    if (m_currentEventInfo->sectionSize_briefdata)
-      hash.addData(getBriefData(),m_currentEventInfo->sectionSize_briefdata);
+    if (evt.sectionSize_database) {
+      m_section_database.resize_without_init(evt.sectionSize_database);
+      read(m_section_database.data(),evt.sectionSize_database);
+      if (m_is.fail()) {
+        m_bad=true;
+        return false;
+      }
+      hash.addData(m_section_database.data(),evt.sectionSize_database);
+    }
 
-    if (m_currentEventInfo->sectionSize_fulldata) {
-      hash.addData(getFullData(),nBytesFullData());
+    if (evt.sectionSize_briefdata) {
+      if (!m_briefdata_isloaded) {
+        m_section_briefdata.resize_without_init(evt.sectionSize_briefdata);
+        read(m_section_briefdata.data(),evt.sectionSize_briefdata);
+        if (m_is.fail()) {
+          m_bad=true;
+          return false;
+        }
+        m_briefdata_isloaded = true;
+      } else if (readfull) {
+        m_is.seekg(evt.sectionSize_briefdata,std::ios::cur);
+      }
+      hash.addData(m_section_briefdata.data(),evt.sectionSize_briefdata);
+    }
+    m_briefdata_isloaded = true;
+
+    if (!nfull)
+      return evt.checkSum == hash.getHash();
+
+    if (readfull) {
+      if (m_fulldata_compressed) {
+        if (!readFullDataFromDisk(false))
+          return false;
+      } else {
+        m_section_fulldata.resize_without_init(nfull);
+        read(m_section_fulldata.data(),nfull);
+        if (m_is.fail()) {
+          m_bad=true;
+          return false;
+        }
+        m_fulldata_size = nfull;
+        m_fulldata_isloaded = true;
+      }
+    }
+
+    if (m_fulldata_isloaded) {
+      hash.addData(m_section_fulldata.data(),m_fulldata_size);
+    } else {
+      //Hash while decompressing, in chunks small enough to still be in the CPU
+      //caches:
+      assert(m_fulldata_partial);
+      const unsigned chunk = 65536;
+      unsigned nhashed = 0;
+      while (nhashed<m_fulldata_size) {
+        const unsigned navail = m_fulldata_decompressor.ensureAvailable(std::min(nhashed+chunk,m_fulldata_size));
+        hash.addData(m_section_fulldata.data()+nhashed,navail-nhashed);
+        nhashed = navail;
+      }
+      m_fulldata_isloaded = true;
     }
 
-    return m_currentEventInfo->checkSum == hash.getHash();
+    return evt.checkSum == hash.getHash();
   }
 
 }
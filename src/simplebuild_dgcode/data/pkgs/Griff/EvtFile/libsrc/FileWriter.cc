@@ -1,7 +1,7 @@
 #include "EvtFile/FileWriter.hh"
 #include "Core/String.hh"
 #include "EvtFileDefs.hh"
-#include "Utils/ProgressiveHash.hh"
+#include "EventCheckSum.hh"
 #include "ZLibUtils/Compress.hh"
 #include <stdexcept>
 
@@ -12,7 +12,11 @@ namespace EvtFile {
                           int buffer_len )
     : m_format(format),
       m_buf(buffer_len ? new char[buffer_len] : nullptr),
-      m_filename(filename)
+      m_filename(filename),
+      m_checksumalgo(CHECKSUMALGO_DEFAULT),
+      m_headerWritten(false),
+      m_ntrain(0),
+      m_dictsize(0)
   {
     if ( buffer_len > 0 )
       m_os.rdbuf()->pubsetbuf(m_buf, buffer_len );
@@ -22,8 +26,6 @@ namespace EvtFile {
     else
       m_os.open((std::string(filename)+format->fileExtension()).c_str(), std::ios::out | std::ios::binary);
 
-    write(format->magicWord());
-    write(EVTFILE_VERSION);
 
     m_section_database.reserve(4096);
     m_section_briefdata.reserve(4096);
@@ -39,6 +41,10 @@ namespace EvtFile {
 
   void FileWriter::close()
   {
+    if (m_ntrain)
+      finishTraining();
+    if (!m_headerWritten && m_os.is_open())
+      writeFileHeader();
     m_os.close();
     delete[] m_buf;
   }
@@ -52,18 +58,39 @@ namespace EvtFile {
     for( auto it=m_preFlushCBs.begin(), itE=m_preFlushCBs.end(); it!=itE; ++it )
       (*it)->aboutToFlushEventToDisk(*this);
 
+    if (m_ntrain) {
+      //Keep the event until the dictionary has been trained:
+      m_pendingEvents.emplace_back();
+      PendingEvent& pe = m_pendingEvents.back();
+      pe.runnumber = runnumber;
+      pe.eventnumber = eventnumber;
+      pe.database.swap(m_section_database);
+      pe.briefdata.swap(m_section_briefdata);
+      pe.fulldata.swap(m_section_fulldata);
+      if (m_pendingEvents.size()>=m_ntrain)
+        finishTraining();
+      return;
+    }
+    writeCurrentEvent(runnumber,eventnumber);
+  }
+
+  void FileWriter::writeCurrentEvent(int32_t runnumber, int32_t eventnumber)
+  {
+    if (!m_headerWritten)
+      writeFileHeader();
+
     bool compress_full_data(m_format->compressFullData());
 
     //Compress the full data section:
     unsigned fulldata_compressed_size(0);
     if (compress_full_data&&!m_section_fulldata.empty()) {
-      ZLibUtils::compressToBuffer(m_section_fulldata.data(), m_section_fulldata.size(),
-                                  m_section_fulldata_compressed, fulldata_compressed_size);
+      m_compressor.compress(m_section_fulldata.data(), m_section_fulldata.size(),
+                            m_section_fulldata_compressed);
+      fulldata_compressed_size = m_section_fulldata_compressed.size();
     }
 
     //For efficient hash calculation and file i/o, put the event header in an array:
     std::uint32_t eventheader[6];
-    static_assert(EVTFILE_EVENT_HEADER_BYTES==6*sizeof(std::uint32_t));
 
     //The first field in the header is reserved for the hash:
     eventheader[1] = runnumber;
@@ -76,15 +103,12 @@ namespace EvtFile {
       eventheader[5] = (std::uint32_t)m_section_fulldata.size();
 
     //Calculate the hash (from uncompressed data!):
-    ProgressiveHash hash;
-    hash.addData((char*)&(eventheader[1]),5*sizeof(std::uint32_t));
-    if (!m_section_database.empty()) hash.addData(m_section_database.data(),m_section_database.size());
-    if (!m_section_briefdata.empty()) hash.addData(m_section_briefdata.data(),m_section_briefdata.size());
-    if (!m_section_fulldata.empty()) hash.addData(m_section_fulldata.data(),m_section_fulldata.size());
-    eventheader[0] = hash.getHash();
+    eventheader[0] = eventCheckSum(m_checksumalgo,eventheader,m_section_database.data(),
+                                   m_section_briefdata.data(),m_section_fulldata.data(),
+                                   m_section_fulldata.size());
 
     //Write out the header:
-    write((char*)&(eventheader[0]),6*sizeof(std::uint32_t));
+    writeEventHeader(eventheader,m_checksumalgo);
 
     //Write out the three data blobs:
     if (!m_section_database.empty()) write(m_section_database);
@@ -107,6 +131,107 @@ namespace EvtFile {
     m_section_fulldata_compressed.clear();
   }
 
+  void FileWriter::setCompressionDictionary(const std::string& dict)
+  {
+    if (m_headerWritten||m_ntrain)
+      throw std::logic_error("FileWriter::setCompressionDictionary must be called before events are written");
+    if (!dict.empty()&&!m_format->compressFullData())
+      throw std::logic_error("FileWriter::setCompressionDictionary called for format without compression");
+    if (dict.size()>EVTFILE_MAX_DICT_BYTES)
+      throw std::runtime_error("FileWriter::setCompressionDictionary: Dictionary too large");
+    m_dict = dict;
+    m_compressor.setDictionary(m_dict.data(),m_dict.size());
+  }
+
+  void FileWriter::trainCompressionDictionary(unsigned ntrain, unsigned dictsize)
+  {
+    if (m_headerWritten||m_ntrain)
+      throw std::logic_error("FileWriter::trainCompressionDictionary must be called before events are written");
+    if (!m_format->compressFullData())
+      throw std::logic_error("FileWriter::trainCompressionDictionary called for format without compression");
+    if (!ntrain||!dictsize||dictsize>EVTFILE_MAX_DICT_BYTES)
+      throw std::runtime_error("FileWriter::trainCompressionDictionary: Invalid parameters");
+    m_ntrain = ntrain;
+    m_dictsize = dictsize;
+  }
+
+  void FileWriter::finishTraining()
+  {
+    assert(m_ntrain&&!m_headerWritten);
+    std::vector<std::pair<const char*,unsigned>> samples;
+    samples.reserve(m_pendingEvents.size());
+    for (auto& pe : m_pendingEvents)
+      samples.emplace_back(pe.fulldata.data(),(unsigned)pe.fulldata.size());
+    m_ntrain = 0;
+    setCompressionDictionary(ZLibUtils::trainDictionary(samples,m_dictsize));
+    //Write out the pending events:
+    for (auto& pe : m_pendingEvents) {
+      assert(m_section_database.empty()&&m_section_briefdata.empty()&&m_section_fulldata.empty());
+      m_section_database.swap(pe.database);
+      m_section_briefdata.swap(pe.briefdata);
+      m_section_fulldata.swap(pe.fulldata);
+      writeCurrentEvent(pe.runnumber,pe.eventnumber);
+    }
+    m_pendingEvents.clear();
+  }
+
+  void FileWriter::writeFileHeader()
+  {
+    assert(!m_headerWritten);
+    m_headerWritten = true;
+    write(m_format->magicWord());
+    if (m_dict.empty()) {
+      write(EVTFILE_VERSION_NODICT);
+    } else {
+      write(EVTFILE_VERSION);
+      write((std::uint32_t)m_dict.size());
+      write(m_dict.data(),m_dict.size());
+    }
+  }
+
+  void FileWriter::writeEventHeader(const std::uint32_t (&eventheader)[6], CheckSumAlgo algo)
+  {
+    static_assert(EVTFILE_EVENT_HEADER_BYTES==7*sizeof(std::uint32_t));
+    const std::uint32_t h[7] = { eventheader[0], eventheader[1], eventheader[2], eventheader[3],
+                                 eventheader[4], eventheader[5], (std::uint32_t)algo };
+    write((const char*)&(h[0]),7*sizeof(std::uint32_t));
+  }
+
+  std::uint32_t FileWriter::eventCheckSum(CheckSumAlgo algo, const std::uint32_t (&eventheader)[6],
+                                          const char* dbdata, const char* briefdata,
+                                          const char* fulldata, unsigned fulldata_size)
+  {
+    //NB: The algorithm id is not itself included in the checksum, so events
+    //can be copied between files without changing it.
+    EventCheckSum hash(algo);
+    hash.addData((const char*)&(eventheader[1]),5*sizeof(std::uint32_t));
+    if (eventheader[3]) hash.addData(dbdata,eventheader[3]);
+    if (eventheader[4]) hash.addData(briefdata,eventheader[4]);
+    if (fulldata_size) hash.addData(fulldata,fulldata_size);
+    return hash.getHash();
+  }
+
+  void FileWriter::writeRawEvent(const std::uint32_t (&eventheader)[6], CheckSumAlgo algo,
+                                 const char* dbdata, const char* briefdata, const char* fulldata_ondisk)
+  {
+    assert(is_open() && "Attempt to write to a file which is not open");
+    assert(!bad() && "Attempt to write to a file with bad status");
+    assert(m_section_database.empty()&&m_section_briefdata.empty()&&m_section_fulldata.empty());
+    if (m_ntrain)
+      throw std::logic_error("FileWriter::writeRawEvent can not be used while training a compression dictionary");
+    if (!m_headerWritten)
+      writeFileHeader();
+    writeEventHeader(eventheader,algo);
+    if (eventheader[3]) write(dbdata,eventheader[3]);
+    if (eventheader[4]) write(briefdata,eventheader[4]);
+    if (eventheader[5]) write(fulldata_ondisk,eventheader[5]);
+    if (!m_os.good()) {
+      printf("EvtFile ERROR: Troubles encountered while writing to file %s\n",m_filename.c_str());
+      printf("               => File might be corrupted!\n");
+      throw std::runtime_error("Data file write failed");
+    }
+  }
+
 }
 
 
@@ -56,6 +56,27 @@ public:
   //... and/or a kill filter [G4DataCollect takes ownership]:
   static void setStepKillFilter(G4Interfaces::StepFilterBase*);
 
+  //Compress the full data of events with a dictionary trained on the first
+  //nevents events (see EvtFile::FileWriter::trainCompressionDictionary), which
+  //makes files with many small events considerably smaller. The first nevents
+  //events are kept in memory until the dictionary is ready. Must be called
+  //before the first event:
+  static void setCompressionDictionaryTraining(unsigned nevents, unsigned dictsize = 16384);
+
+  //When several processes write separate files (e.g. with multi-processing, or
+  //jobs on a cluster), each trains its own dictionary. Merging such files (see
+  //GriffFormat/Merge.hh) keeps the dictionary of the first input file, so the
+  //full data of all events in the other files must be decompressed and
+  //recompressed, which makes merging much slower. To avoid this, all processes
+  //can instead be given the same dictionary, for instance the one of a file
+  //from an earlier (shorter) job with training or the output of
+  //sb_griffformat_dictcompress. Must be called before the first event, and
+  //replaces any training requested:
+  static void setCompressionDictionary(const std::string& dict);
+  //Use the dictionary stored in an existing Griff file (throws if the file can
+  //not be read or has no dictionary):
+  static void setCompressionDictionaryFromFile(const std::string& griffFile);
+
 private:
   struct Imp;
 };
@@ -22,9 +22,13 @@ namespace G4DataCollectInternals {
   DCSteppingAction::DCSteppingAction(const char* outputFile, GriffFormat::Format::MODE mode, G4UserSteppingAction * otherAct)
     : G4UserSteppingAction(), m_mode(mode), m_otherAction(otherAct),
       m_stepFilter(0), m_stepKillFilter(0), m_doFilter(false),
+      m_prof_filter(0), m_prof_killfilter(0),
+      m_prof_record(ActionProfiler::registerAction("Griff step recording")),
+      m_prof_writer(ActionProfiler::registerAction("Griff end-of-event writer")),
       m_prevTrkId(INT_MAX), m_prevStepNbr(INT_MAX-1), m_prevVol(0),
       m_currentMetaDataIdx(EvtFile::INDEX_MAX),
-      m_mgr(0), m_outputFile(outputFile)
+      m_mgr(0), m_outputFile(outputFile),
+      m_dictTrainEvents(0), m_dictSize(0)
   {
     //Todo: user should be able to change mode on the fly, and even be able to skip writing of event entirely.
   }
@@ -62,6 +66,10 @@ namespace G4DataCollectInternals {
         m_outputFile += extension;
     }
     m_mgr = new DCMgr(m_outputFile.c_str());
+    if (!m_dict.empty())
+      m_mgr->fileWriter.setCompressionDictionary(m_dict);
+    else if (m_dictTrainEvents)
+      m_mgr->fileWriter.trainCompressionDictionary(m_dictTrainEvents,m_dictSize);
     if (m_stepFilter)
       m_stepFilter->initFilter();
     if (m_stepKillFilter)
@@ -160,14 +168,29 @@ namespace G4DataCollectInternals {
     m_prevVol=vol; m_prevTrkId=trkid; m_prevStepNbr=stepNbr;
 
     if (m_doFilter) {
-      if (m_stepKillFilter && m_stepKillFilter->filterStep(step) == m_stepKillFilter->negated() ) {
-        track->SetTrackStatus(fStopAndKill);
-        return;
+      if (m_stepKillFilter) {
+        bool pass;
+        {
+          ActionProfiler::Scope prof(m_prof_killfilter);
+          pass = m_stepKillFilter->filterStep(step);
+        }
+        if ( pass == m_stepKillFilter->negated() ) {
+          track->SetTrackStatus(fStopAndKill);
+          return;
+        }
+      }
+      if (m_stepFilter) {
+        bool pass;
+        {
+          ActionProfiler::Scope prof(m_prof_filter);
+          pass = m_stepFilter->filterStep(step);
+        }
+        if ( pass == m_stepFilter->negated() )
+          return;
       }
-      if (m_stepFilter && m_stepFilter->filterStep(step) == m_stepFilter->negated() )
-        return;
     }
     //passed any filters so record:
+    ActionProfiler::Scope prof(m_prof_record);
     unsigned nstepsprev = m_steps.size();
     DCStepData * newstep = mempoolGetStepObject();
     m_steps.push_back(newstep);
@@ -216,11 +239,28 @@ namespace G4DataCollectInternals {
     return lhs->trkId==rhs->trkId ? lhs->stepNbr<rhs->stepNbr : lhs->trkId<rhs->trkId;
   }
 
-  void DCSteppingAction::EndOfEventAction(const G4Event*)
+  void DCSteppingAction::updateProfileMetaData(const G4Event* evt)
+  {
+    //Embed the action profile in the metadata on the last event of the run,
+    //and at exponentially increasing intervals (to keep the number of distinct
+    //metadata entries low, while leaving a reasonably recent profile in files
+    //from runs which are aborted):
+    if (!ActionProfiler::enabled())
+      return;
+    const G4Run * run = G4RunManager::GetRunManager()->GetCurrentRun();
+    const std::uint64_t ievt = evt->GetEventID();
+    const bool last = run && ievt+1 >= std::uint64_t(run->GetNumberOfEventToBeProcessed());
+    if ( last || ( ievt >= 1 && !(ievt & (ievt+1)) ) )
+      setMetaData("ActionProfile",ActionProfiler::table());
+  }
+
+  void DCSteppingAction::EndOfEventAction(const G4Event*evt)
   {
     if (!m_mgr)//check here as well, in case 1st event had no tracks.
       initMgr();
 
+    ActionProfiler::Scope prof(m_prof_writer);
+
     //Prepare steps:
     std::sort(m_steps.begin(),m_steps.end(),compareSteps);//cheap, just swapping order of pointers
 
@@ -348,6 +388,7 @@ namespace G4DataCollectInternals {
       //add G4 version, name of random gen, etc. to metadata.
       setBasicMetaData();
     }
+    updateProfileMetaData(evt);
     if (!m_pendingMetaData.empty()) {
       auto itE = m_pendingMetaData.end();
       for (auto it = m_pendingMetaData.begin();it!=itE;++it)
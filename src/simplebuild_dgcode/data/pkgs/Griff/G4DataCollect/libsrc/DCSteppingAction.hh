@@ -3,11 +3,13 @@
 
 #include "GriffFormat/Format.hh"
 #include "G4Interfaces/StepFilterBase.hh"
+#include "G4Interfaces/ActionProfiler.hh"
 #include "G4UserSteppingAction.hh"
 #include "DCStepData.hh"
 #include "Utils/StringSort.hh"
 #include <vector>
 #include <deque>
+#include <string>
 class G4Event;
 class G4VPhysicalVolume;
 
@@ -21,15 +23,46 @@ namespace G4DataCollectInternals {
     void EndOfEventAction(const G4Event*);//This non-standard method will be invoked by our helpful event action.
     G4UserSteppingAction * otherAction() const { return m_otherAction; }
     void setOtherAction(G4UserSteppingAction *ua) { assert(ua&&!m_otherAction); m_otherAction = ua; }
-    void setStepFilter(G4Interfaces::StepFilterBase *sf) { assert(sf&&!m_stepFilter); m_stepFilter = sf; m_doFilter=true; }
-    void setStepKillFilter(G4Interfaces::StepFilterBase *sf) { assert(sf&&!m_stepKillFilter); m_stepKillFilter = sf; m_doFilter=true; }
+    void setStepFilter(G4Interfaces::StepFilterBase *sf)
+    {
+      assert(sf&&!m_stepFilter);
+      m_stepFilter = sf;
+      m_doFilter=true;
+      m_prof_filter = ActionProfiler::registerAction(std::string("StepFilter[")+sf->getName()+"]::filterStep");
+    }
+    void setStepKillFilter(G4Interfaces::StepFilterBase *sf)
+    {
+      assert(sf&&!m_stepKillFilter);
+      m_stepKillFilter = sf;
+      m_doFilter=true;
+      m_prof_killfilter = ActionProfiler::registerAction(std::string("KillFilter[")+sf->getName()+"]::filterStep");
+    }
     void setMetaData(const std::string& ckey,const std::string& cvalue);
+    void setCompressionDictionaryTraining(unsigned nevents, unsigned dictsize)
+    {
+      assert(!m_mgr&&"Output file already opened");
+      m_dictTrainEvents = nevents;
+      m_dictSize = dictsize;
+      m_dict.clear();
+    }
+    void setCompressionDictionary(const std::string& dict)
+    {
+      assert(!m_mgr&&"Output file already opened");
+      m_dictTrainEvents = 0;
+      m_dict = dict;
+    }
   private:
     GriffFormat::Format::MODE m_mode;
     G4UserSteppingAction * m_otherAction;
     G4Interfaces::StepFilterBase * m_stepFilter;
     G4Interfaces::StepFilterBase * m_stepKillFilter;
     bool m_doFilter;
+    //Profiling (see G4Interfaces/ActionProfiler.hh):
+    ActionProfiler::Entry * m_prof_filter;
+    ActionProfiler::Entry * m_prof_killfilter;
+    ActionProfiler::Entry * m_prof_record;
+    ActionProfiler::Entry * m_prof_writer;
+    void updateProfileMetaData(const G4Event*);
     int m_prevTrkId;
     int m_prevStepNbr;
     G4VPhysicalVolume* m_prevVol;
@@ -43,6 +76,9 @@ namespace G4DataCollectInternals {
     void initMgr();
     DCMgr * m_mgr;
     std::string m_outputFile;
+    unsigned m_dictTrainEvents;
+    unsigned m_dictSize;
+    std::string m_dict;
     struct Track_;
 
     std::vector<DCStepData*> m_steps;
@@ -2,6 +2,8 @@
 #include "G4DataCollect/G4DataCollect.hh"
 #include "DCSteppingAction.hh"
 #include "DCEventAction.hh"
+#include "GriffFormat/Format.hh"
+#include "EvtFile/FileReader.hh"
 
 #include "G4RunManager.hh"
 #include <stdexcept>
@@ -72,6 +74,28 @@ void G4DataCollect::setStepKillFilter(G4Interfaces::StepFilterBase*sf)
   G4DataCollectInternals::s_stepact->setStepKillFilter(sf);
 }
 
+void G4DataCollect::setCompressionDictionaryTraining(unsigned nevents, unsigned dictsize)
+{
+  assert(G4DataCollectInternals::s_stepact&&"installHooks not called before setCompressionDictionaryTraining");
+  G4DataCollectInternals::s_stepact->setCompressionDictionaryTraining(nevents,dictsize);
+}
+
+void G4DataCollect::setCompressionDictionary(const std::string& dict)
+{
+  assert(G4DataCollectInternals::s_stepact&&"installHooks not called before setCompressionDictionary");
+  G4DataCollectInternals::s_stepact->setCompressionDictionary(dict);
+}
+
+void G4DataCollect::setCompressionDictionaryFromFile(const std::string& griffFile)
+{
+  EvtFile::FileReader fr(GriffFormat::Format::getFormat(),griffFile.c_str());
+  if (!fr.init())
+    throw std::runtime_error("G4DataCollect: Problems reading dictionary from "+griffFile+" ("+fr.bad_reason()+")");
+  if (fr.compressionDictionary().empty())
+    throw std::runtime_error("G4DataCollect: No compression dictionary in "+griffFile);
+  setCompressionDictionary(fr.compressionDictionary());
+}
+
 void G4DataCollect::finish()
 {
   G4RunManager * rm = G4RunManager::GetRunManager();
@@ -10,4 +10,10 @@ PYTHON_MODULE( mod )
   mod.def("finish",&G4DataCollect::finish,"Uninstall hooks and close output file.");
   mod.def("setMetaData",&G4DataCollect::setMetaData);
   mod.def("setUserData",&G4DataCollect::setUserData);
+  mod.def("setCompressionDictionaryTraining",&G4DataCollect::setCompressionDictionaryTraining,
+          "Compress the step data with a dictionary trained on the first events.",
+          py::arg("nevents"), py::arg("dictsize")=16384
+          );
+  mod.def("setCompressionDictionaryFromFile",&G4DataCollect::setCompressionDictionaryFromFile,
+          "Compress the step data with the dictionary stored in an existing Griff file.");
 }
@@ -0,0 +1,96 @@
+#include "GriffAnaRunner/ExprHists.hh"
+#include "ExprParser/Exception.hh"
+#include "Core/String.hh"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+  int usage(const char * progname, const char * errmsg)
+  {
+    if (errmsg) {
+      printf("ERROR: %s\n\nRun with -h or --help for usage information\n",errmsg);
+      return 1;
+    }
+    const char * p = std::strrchr(progname,'/');
+    progname = p ? p + 1 : progname;
+    printf("\nUsage:\n\n  %s [options] HISTSPEC1 [HISTSPEC2 ...] GRIFFFILE1 [GRIFFFILE2 ...]\n\n"
+           "Fills histograms from the Griff files (arguments ending in .griff) on several\n"
+           "threads and saves them in a SimpleHists file. Each histogram is specified as:\n\n"
+           "  key(nbins,xmin,xmax): [sum] expr [if cond]\n\n"
+           "where expr and cond are expressions in trk.xxx, seg.xxx and step.xxx\n"
+           "variables (see sb_griffexprparser_skim). The histogram is filled with the\n"
+           "value of expr for each track, segment or step (depending on the variables\n"
+           "used) for which cond is true. With \"sum\", the values are instead added up\n"
+           "over each event, and the sum is filled once per event.\n"
+           "\nOptions:\n\n"
+           "  -h, --help       : Show this usage information.\n"
+           "  -jN, --threads=N : Number of threads (default: one per core).\n"
+           "  -oFILE           : Output file (default: griffhists.shist).\n"
+           "\nExamples:\n\n"
+           "  %s 'ekin(100,0,5): trk.ekin/MeV if trk.name==\"alpha\" && trk.is_secondary' sim.griff\n"
+           "  %s -j8 'edep(100,0,3): sum seg.edep/MeV if seg.volname==\"Detector\"' sim_*.griff\n\n"
+           "The histograms are filled with the same values regardless of the number of\n"
+           "threads, but the order in which they are added up depends on it. Hence\n"
+           "weighted contents and statistics like mean and RMS can differ by rounding\n"
+           "errors between runs with different numbers of threads.\n\n",
+           progname,progname,progname);
+    return 0;
+  }
+
+}
+
+int main(int argc,char** argv) {
+  std::vector<std::string> specs, inputs;
+  std::string output = "griffhists";
+  unsigned nthreads = 0;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    if (a=="-h"||a=="--help")
+      return usage(argv[0],0);
+    if (a.compare(0,2,"-j")==0||a.compare(0,10,"--threads=")==0) {
+      const std::string n = a.substr(a[1]=='j'?2:10);
+      if (n.empty()||!Core::contains_only(n, "0123456789")||n.size()>4)
+        return usage(argv[0],"Invalid number of threads");
+      nthreads = std::stoul(n);
+    } else if (a.compare(0,2,"-o")==0) {
+      output = a.substr(2);
+      if (Core::ends_with(output,".shist"))
+        output.resize(output.size()-6);
+      if (output.empty())
+        return usage(argv[0],"Missing output file name");
+    } else if (a.size()>1&&a[0]=='-') {
+      return usage(argv[0],("Unknown option: "+a).c_str());
+    } else if (Core::ends_with(a,".griff")) {
+      inputs.push_back(a);
+    } else {
+      specs.push_back(a);
+    }
+  }
+  if (specs.empty())
+    return usage(argv[0],"No histograms specified");
+  if (inputs.empty())
+    return usage(argv[0],"No input files specified");
+
+  std::unique_ptr<GriffAnaRunner::ExprHists> eh;
+  try {
+    eh.reset(new GriffAnaRunner::ExprHists(specs));
+  } catch (ExprParser::InputError& e) {
+    printf("ERROR: %s : %s\n",e.epType(),e.epWhat());
+    return 1;
+  }
+
+  GriffAnaRunner::Runner runner(inputs);
+  runner.setNThreads(nthreads);
+  runner.setSummaryOnly(eh->summaryOnly());
+  SimpleHists::HistCollection hc;
+  runner.run(hc,eh->kernel()).print();
+  hc.saveToFile(output,true);
+  printf("Wrote %u histogram%s to %s.shist\n",(unsigned)specs.size(),(specs.size()==1?"":"s"),output.c_str());
+  return 0;
+}
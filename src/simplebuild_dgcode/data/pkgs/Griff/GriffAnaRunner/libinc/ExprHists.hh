@@ -0,0 +1,63 @@
+#ifndef GriffAnaRunner_ExprHists_hh
+#define GriffAnaRunner_ExprHists_hh
+
+#include "GriffAnaRunner/Runner.hh"
+
+//Kernel for the Runner, filling 1D histograms which are declared with strings
+//of the form:
+//
+//   key(nbins,xmin,xmax): expr
+//   key(nbins,xmin,xmax): expr if cond
+//
+//For example:
+//
+//   alpha_ekin(100,0,2): seg.ekin_start/MeV if trk.name=="alpha" && seg.iseg==0
+//   edep(100,0,3): sum seg.edep/MeV if seg.volname=="Detector"
+//
+//Here expr and cond are expressions in the trk.xxx, seg.xxx and step.xxx
+//variables of GriffExprParser::GriffASTBuilder. Depending on the variables
+//used, the histogram is filled with the value of expr for each track, segment
+//or step for which cond is true. If expr is prefixed with "sum", the values are
+//instead added up over the event, and the sum is filled once for each event
+//with at least one track, segment or step for which cond is true (this is for
+//instance how the total energy deposition in a volume is histogrammed). The
+//bin range can be given as constant expressions (e.g. "0.5*pi").
+
+namespace GriffAnaRunner {
+
+  class ExprHists {
+  public:
+    //Throws ExprParser::InputError (or derived) if a specification is invalid:
+    ExprHists(const std::vector<std::string>& specs);
+    ~ExprHists();
+
+    //Kernel to pass to Runner::run:
+    Kernel kernel() const;
+
+    //Whether only the brief data of events is needed (i.e. no step.xxx
+    //variables are used), so Runner::setSummaryOnly can be used:
+    bool summaryOnly() const;
+
+    struct Spec {
+      enum Level { TRACK, SEGMENT, STEP };
+      std::string key;
+      unsigned nbins;
+      double xmin;
+      double xmax;
+      std::string expr;
+      std::string cond;//empty if none
+      bool sum;
+      Level level;
+    };
+    const std::vector<Spec>& specs() const { return m_specs; }
+
+    //Parse a single specification:
+    static Spec parseSpec(const std::string&);
+
+  private:
+    std::vector<Spec> m_specs;
+  };
+
+}
+
+#endif
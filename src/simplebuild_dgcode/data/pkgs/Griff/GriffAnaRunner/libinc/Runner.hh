@@ -0,0 +1,114 @@
+#ifndef GriffAnaRunner_Runner_hh
+#define GriffAnaRunner_Runner_hh
+
+#include "GriffDataRead/GriffDataReader.hh"
+#include "SimpleHists/HistCollection.hh"
+#include <functional>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+//Runs a per-event analysis kernel over Griff files on several threads. Rather
+//than writing the usual loop:
+//
+//   GriffDataReader dr(argc,argv);
+//   SimpleHists::HistCollection hc;
+//   auto h = hc.book1D(...);
+//   while (dr.loopEvents()) {
+//     ...fill h...
+//   }
+//   hc.saveToFile("myana");
+//
+//one provides the booking and the body of the loop to the runner as a kernel:
+//
+//   GriffAnaRunner::Runner runner(argc,argv);
+//   SimpleHists::HistCollection hc;
+//   runner.run(hc,[](GriffDataReader& dr, SimpleHists::HistCollection& hc) {
+//       auto h = hc.book1D(...);
+//       auto si = std::make_shared<GriffAnaUtils::SegmentIterator>(&dr);
+//       return [h,si](GriffDataReader& dr) { ...fill h... };
+//     }).print();
+//   hc.saveToFile("myana");
+//
+//The kernel is invoked once for each thread, with the thread's own data reader
+//and an empty thread-private HistCollection in which to book histograms. It
+//returns the function to be called for each event handled by the thread. All
+//invocations of the kernel happen in the calling thread, one after the other,
+//so kernels do not need to worry about thread-safety while booking.
+//
+//Events are assigned to threads in chunks of consecutive events, round-robin
+//by their position in the input. Each thread reads the input files with its
+//own GriffDataReader, skipping over the chunks of other threads without loading
+//anything but their event headers (and database sections). Afterwards, the
+//thread-private collections are merged into the one passed to run(..), in the
+//order of the threads. Thus results do not depend on the scheduling of the
+//threads, and with a single thread they are identical to those of the usual
+//loop. With a different number of threads (or chunk size), the histograms are
+//filled with the same values, but the sums of weights and the statistics
+//(mean, RMS, ...) are accumulated in a different order and can therefore
+//differ by rounding errors (integral counts with unit weights are exact).
+
+namespace GriffAnaRunner {
+
+  typedef std::function<void(GriffDataReader&)> EventFunction;
+  typedef std::function<EventFunction(GriffDataReader&, SimpleHists::HistCollection&)> Kernel;
+
+  struct RunStats {
+    unsigned nthreads = 0;
+    std::uint64_t nevents = 0;//events processed
+    std::uint64_t nbytes = 0;//on-disk size of events processed
+    double seconds = 0.0;
+    void print(const char * prefix = "") const;//throughput report
+  };
+
+  class Runner {
+  public:
+    Runner(const std::string& inputFile);
+    Runner(const std::vector<std::string>& inputFiles);
+    //Input files are all arguments not starting with '-', as for
+    //GriffDataReader(argc,argv). Additionally, -jN or --threads=N can be used
+    //to set the number of threads:
+    Runner(int argc, char** argv);
+    ~Runner(){}
+
+    //Number of threads (0 means one per available core) [default 0]:
+    void setNThreads(unsigned n) { m_nthreads = n; }
+    unsigned nThreads() const { return m_nthreads; }
+
+    //Number of consecutive events assigned to a thread at a time [default 100]:
+    void setChunkSize(unsigned n);
+    unsigned chunkSize() const { return m_chunkSize; }
+
+    //Limit processing to a range of events in the input (nmax=0 means all
+    //events after the first ones skipped):
+    void setEventRange(std::uint64_t nskip, std::uint64_t nmax = 0) { m_nskip = nskip; m_nmax = nmax; }
+
+    //Whether the kernel only needs the brief data of events (in which case the
+    //readers are put in summary-only mode, see GriffDataReader::setSummaryOnly):
+    void setSummaryOnly(bool b = true) { m_summaryOnly = b; }
+    bool summaryOnly() const { return m_summaryOnly; }
+
+    //See GriffDataReader::allowSetupChange:
+    void allowSetupChange() { m_allowSetupChange = true; }
+
+    //Run the kernel over the input and merge the resulting histograms into hc
+    //(histograms with keys already present in hc are merged onto those). Any
+    //exception thrown by the kernel in a thread is rethrown here:
+    RunStats run(SimpleHists::HistCollection& hc, const Kernel&);
+
+    //Input files:
+    const std::vector<std::string>& inputFiles() const { return m_inputFiles; }
+
+  private:
+    std::vector<std::string> m_inputFiles;
+    unsigned m_nthreads;
+    unsigned m_chunkSize;
+    std::uint64_t m_nskip;
+    std::uint64_t m_nmax;
+    bool m_summaryOnly;
+    bool m_allowSetupChange;
+  };
+
+}
+
+#endif
@@ -0,0 +1,214 @@
+#include "GriffAnaRunner/ExprHists.hh"
+#include "GriffExprParser/GriffASTBuilder.hh"
+#include "ExprParser/Exception.hh"
+#include "Core/String.hh"
+#include <memory>
+#include <set>
+
+namespace GriffAnaRunner {
+
+  namespace {
+
+    std::string trimmed(const std::string& s)
+    {
+      const char * ws = " \t\n";
+      auto b = s.find_first_not_of(ws);
+      if (b==std::string::npos)
+        return std::string();
+      return s.substr(b,s.find_last_not_of(ws)+1-b);
+    }
+
+    void badSpec(const std::string& spec, const char * what)
+    {
+      EXPRPARSER_THROW2(ParseError,"invalid histogram specification \""<<spec<<"\" ("<<what<<")");
+    }
+
+    //Position of word (surrounded by whitespace) in s, ignoring string
+    //literals. Returns npos if not found:
+    std::size_t findWord(const std::string& s, const char * word)
+    {
+      const std::string w(word);
+      char quote = 0;
+      for (std::size_t i = 0; i < s.size(); ++i) {
+        if (quote) {
+          if (s[i]==quote)
+            quote = 0;
+          continue;
+        }
+        if (s[i]=='"'||s[i]=='\'') {
+          quote = s[i];
+          continue;
+        }
+        if ( s.compare(i,w.size(),w)==0
+             && ( i==0 || std::isspace((unsigned char)s[i-1]) )
+             && ( i+w.size()==s.size() || std::isspace((unsigned char)s[i+w.size()]) ) )
+          return i;
+      }
+      return std::string::npos;
+    }
+
+    //Expressions of a histogram specification compiled with a given builder:
+    struct CompiledHist {
+      CompiledHist(const ExprHists::Spec& s, GriffExprParser::GriffASTBuilder& b)
+        : spec(s),
+          val(b.createEvaluator<ExprParser::float_type>(s.expr)),
+          cond(s.cond.empty() ? ExprParser::Evaluator<bool>() : b.createEvaluator<bool>(s.cond)),
+          hist(0), sum(0.0), nsum(0) {}
+      ExprHists::Spec spec;
+      ExprParser::Evaluator<ExprParser::float_type> val;
+      ExprParser::Evaluator<bool> cond;
+      SimpleHists::Hist1D * hist;
+      double sum;
+      unsigned nsum;
+      void process()
+      {
+        if ( cond.arg() && !cond() )
+          return;
+        if (spec.sum) {
+          sum += val();
+          ++nsum;
+        } else {
+          hist->fill(val());
+        }
+      }
+      void endEvent()
+      {
+        if (nsum)
+          hist->fill(sum);
+        sum = 0.0;
+        nsum = 0;
+      }
+    };
+
+    //Per-thread state of the kernel:
+    struct ThreadState {
+      GriffExprParser::GriffASTBuilder builder;
+      std::vector<std::unique_ptr<CompiledHist>> hists[3];//by level
+      std::vector<CompiledHist*> sumhists;
+      void processEvent(const GriffDataReader& dr)
+      {
+        auto& trkhists = hists[ExprHists::Spec::TRACK];
+        auto& seghists = hists[ExprHists::Spec::SEGMENT];
+        auto& stephists = hists[ExprHists::Spec::STEP];
+        const bool needsegs = !seghists.empty() || !stephists.empty();
+        for (auto trk = dr.trackBegin(); trk!=dr.trackEnd(); ++trk) {
+          builder.setCurrentTrack(trk);
+          for (auto& h : trkhists)
+            h->process();
+          if (!needsegs)
+            continue;
+          for (auto seg = trk->segmentBegin(); seg!=trk->segmentEnd(); ++seg) {
+            builder.setCurrentSegment(seg);
+            for (auto& h : seghists)
+              h->process();
+            if (stephists.empty())
+              continue;
+            for (auto step = seg->stepBegin(); step!=seg->stepEnd(); ++step) {
+              builder.setCurrentStep(step);
+              for (auto& h : stephists)
+                h->process();
+            }
+          }
+        }
+        for (auto h : sumhists)
+          h->endEvent();
+      }
+    };
+
+  }
+
+}
+
+GriffAnaRunner::ExprHists::Spec GriffAnaRunner::ExprHists::parseSpec(const std::string& spec)
+{
+  Spec s;
+
+  //key(nbins,xmin,xmax):
+  auto lpar = spec.find('(');
+  auto rpar = spec.find(')');
+  auto colon = spec.find(':',rpar==std::string::npos?0:rpar);
+  if ( lpar==std::string::npos || rpar==std::string::npos || colon==std::string::npos || rpar < lpar )
+    badSpec(spec,"must be of the form \"key(nbins,xmin,xmax): expr [if cond]\"");
+  s.key = trimmed(spec.substr(0,lpar));
+  if ( s.key.empty() || !trimmed(spec.substr(rpar+1,colon-rpar-1)).empty() )
+    badSpec(spec,"must be of the form \"key(nbins,xmin,xmax): expr [if cond]\"");
+  std::vector<std::string> binning;
+  Core::split(binning,spec.substr(lpar+1,rpar-lpar-1),",");
+  if (binning.size()!=3)
+    badSpec(spec,"binning must be specified as (nbins,xmin,xmax)");
+  const std::string nbins = trimmed(binning.at(0));
+  if ( nbins.empty() || nbins.size()>7 || !Core::contains_only(nbins,"0123456789") || !(s.nbins = std::stoul(nbins)) )
+    badSpec(spec,"invalid number of bins");
+  GriffExprParser::GriffASTBuilder builder;
+  double * range[2] = { &s.xmin, &s.xmax };
+  for (unsigned i = 0; i < 2; ++i) {
+    auto e = builder.createEvaluator<ExprParser::float_type>(binning.at(i+1));
+    if (!e.isConstant())
+      badSpec(spec,"bin range must be constant");
+    *range[i] = e();
+  }
+  if (!(s.xmin < s.xmax))
+    badSpec(spec,"xmin must be less than xmax");
+
+  //expr [if cond]:
+  std::string rest = trimmed(spec.substr(colon+1));
+  s.sum = ( findWord(rest,"sum")==0 );
+  if (s.sum)
+    rest = trimmed(rest.substr(3));
+  auto ifpos = findWord(rest,"if");
+  s.expr = trimmed(rest.substr(0,ifpos));
+  s.cond = ifpos==std::string::npos ? std::string() : trimmed(rest.substr(ifpos+2));
+  if (s.expr.empty())
+    badSpec(spec,"missing expression");
+  if ( ifpos!=std::string::npos && s.cond.empty() )
+    badSpec(spec,"missing condition after \"if\"");
+
+  //Compile once, to catch errors early and to see which variables are used:
+  CompiledHist test(s,builder);
+  if ( test.val.isConstant() && ( s.cond.empty() || test.cond.isConstant() ) )
+    badSpec(spec,"must refer to at least one trk.xxx, seg.xxx or step.xxx variable");
+  s.level = builder.usesStepData() ? Spec::STEP : ( builder.usesSegmentData() ? Spec::SEGMENT : Spec::TRACK );
+  return s;
+}
+
+GriffAnaRunner::ExprHists::ExprHists(const std::vector<std::string>& specs)
+{
+  std::set<std::string> keys;
+  for (auto& spec : specs) {
+    m_specs.push_back(parseSpec(spec));
+    if (!keys.insert(m_specs.back().key).second)
+      badSpec(spec,"key already used");
+  }
+  if (m_specs.empty())
+    EXPRPARSER_THROW(ParseError,"no histograms specified");
+}
+
+GriffAnaRunner::ExprHists::~ExprHists()
+{
+}
+
+bool GriffAnaRunner::ExprHists::summaryOnly() const
+{
+  for (auto& s : m_specs)
+    if (s.level==Spec::STEP)
+      return false;
+  return true;
+}
+
+GriffAnaRunner::Kernel GriffAnaRunner::ExprHists::kernel() const
+{
+  std::vector<Spec> specs = m_specs;
+  return [specs](GriffDataReader&, SimpleHists::HistCollection& hc)
+  {
+    auto state = std::make_shared<ThreadState>();
+    for (auto& s : specs) {
+      state->hists[s.level].emplace_back(new CompiledHist(s,state->builder));
+      CompiledHist * h = state->hists[s.level].back().get();
+      std::string title = (s.sum?"sum ":"") + s.expr + (s.cond.empty() ? "" : " if "+s.cond);
+      h->hist = hc.book1D(title,s.nbins,s.xmin,s.xmax,s.key);
+      if (s.sum)
+        state->sumhists.push_back(h);
+    }
+    return [state](GriffDataReader& dr) { state->processEvent(dr); };
+  };
+}
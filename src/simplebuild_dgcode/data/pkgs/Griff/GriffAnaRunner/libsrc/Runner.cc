@@ -0,0 +1,195 @@
+#include "GriffAnaRunner/Runner.hh"
+#include "EvtFile/FileReader.hh"
+#include "Core/String.hh"
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <set>
+#include <algorithm>
+#include <cstdio>
+#include <climits>
+
+namespace GriffAnaRunner {
+
+  namespace {
+
+    struct Worker {
+      std::unique_ptr<GriffDataReader> dr;
+      std::unique_ptr<SimpleHists::HistCollection> hc;
+      EventFunction fct;
+      std::uint64_t nevents = 0;
+      std::uint64_t nbytes = 0;
+      std::exception_ptr error;
+    };
+
+    struct OpenMsgGuard {
+      OpenMsgGuard() : m_orig(GriffDataReader::openMsg()) {}
+      ~OpenMsgGuard() { GriffDataReader::setOpenMsg(m_orig); }
+      const bool m_orig;
+    };
+
+    void runWorker( Worker& w, unsigned ithread, unsigned nthreads, unsigned chunksize,
+                    std::uint64_t nskip, std::uint64_t nmax )
+    {
+      try {
+        //Each thread visits only the chunks of events it owns, skipping over
+        //the others with GriffDataReader::skipEvents (which merely reads their
+        //headers and database sections):
+        GriffDataReader& dr = *w.dr;
+        std::uint64_t idx = 0;//index of the current event of dr
+        auto skipTo = [&dr,&idx](std::uint64_t target)
+        {
+          while (idx < target) {
+            const unsigned n = static_cast<unsigned>(std::min<std::uint64_t>(target-idx,UINT_MAX));
+            if (!dr.skipEvents(n))
+              return false;
+            idx += n;
+          }
+          return true;
+        };
+        if (!dr.eventActive())
+          return;
+        for (std::uint64_t ichunk = ithread; ; ichunk += nthreads) {
+          std::uint64_t first = nskip + ichunk * chunksize;
+          std::uint64_t end = first + chunksize;
+          if (nmax) {
+            if (first - nskip >= nmax)
+              break;
+            end = std::min<std::uint64_t>(end,nskip + nmax);
+          }
+          if (!skipTo(first))
+            break;
+          while (true) {
+            auto fr = dr.getRawFileReader();
+            w.nbytes += fr->eventHeaderBytes() + fr->nBytesSharedDataInEvent()
+              + fr->nBytesBriefData() + fr->nBytesFullDataOnDisk();
+            ++w.nevents;
+            w.fct(dr);
+            if (idx + 1 == end)
+              break;
+            if (!dr.goToNextEvent())
+              return;
+            ++idx;
+          }
+        }
+      } catch (...) {
+        w.error = std::current_exception();
+      }
+    }
+
+  }
+
+}
+
+void GriffAnaRunner::RunStats::print(const char * prefix) const
+{
+  const double s = seconds > 0.0 ? seconds : 1e-9;
+  printf("%sProcessed %llu events (%.1f MB) in %.2f s with %u thread%s : %.0f events/s, %.1f MB/s\n",
+         prefix,(unsigned long long)nevents,nbytes*1e-6,seconds,nthreads,(nthreads==1?"":"s"),
+         nevents/s,nbytes*1e-6/s);
+}
+
+GriffAnaRunner::Runner::Runner(const std::string& inputFile)
+  : Runner(std::vector<std::string>(1,inputFile))
+{
+}
+
+GriffAnaRunner::Runner::Runner(const std::vector<std::string>& inputFiles)
+  : m_inputFiles(inputFiles),
+    m_nthreads(0),
+    m_chunkSize(100),
+    m_nskip(0),
+    m_nmax(0),
+    m_summaryOnly(false),
+    m_allowSetupChange(false)
+{
+}
+
+GriffAnaRunner::Runner::Runner(int argc, char** argv)
+  : Runner(std::vector<std::string>())
+{
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    if (a.compare(0,2,"-j")==0||a.compare(0,10,"--threads=")==0) {
+      const std::string n = a.substr(a[1]=='j'?2:10);
+      if (n.empty()||!Core::contains_only(n, "0123456789")||n.size()>4)
+        throw std::runtime_error("GriffAnaRunner: invalid number of threads specified");
+      m_nthreads = std::stoul(n);
+    } else if (!a.empty() && a[0]!='-') {
+      m_inputFiles.push_back(a);
+    }
+  }
+}
+
+void GriffAnaRunner::Runner::setChunkSize(unsigned n)
+{
+  if (!n)
+    throw std::runtime_error("GriffAnaRunner: chunk size must be positive");
+  m_chunkSize = n;
+}
+
+GriffAnaRunner::RunStats GriffAnaRunner::Runner::run(SimpleHists::HistCollection& hc, const Kernel& kernel)
+{
+  if (m_inputFiles.empty())
+    throw std::runtime_error("GriffAnaRunner: no input files specified");
+
+  RunStats stats;
+  stats.nthreads = m_nthreads ? m_nthreads : std::max<unsigned>(1,std::thread::hardware_concurrency());
+
+  const auto t0 = std::chrono::steady_clock::now();
+
+  //Readers are opened and kernels invoked in this thread, in the order of the
+  //threads. Only the first reader announces the files it opens:
+  OpenMsgGuard openmsg;
+  std::vector<Worker> workers(stats.nthreads);
+  for (unsigned i = 0; i < stats.nthreads; ++i) {
+    Worker& w = workers[i];
+    GriffDataReader::setOpenMsg(openmsg.m_orig && i==0);
+    w.dr.reset(new GriffDataReader(m_inputFiles));
+    w.dr->setSummaryOnly(m_summaryOnly);
+    if (m_allowSetupChange)
+      w.dr->allowSetupChange();
+    w.hc.reset(new SimpleHists::HistCollection);
+    w.fct = kernel(*w.dr,*w.hc);
+  }
+  //Files opened later are only announced when running in this thread:
+  GriffDataReader::setOpenMsg(openmsg.m_orig && stats.nthreads==1);
+
+  if (stats.nthreads==1) {
+    runWorker(workers.front(),0,1,m_chunkSize,m_nskip,m_nmax);
+  } else {
+    std::vector<std::thread> threads;
+    threads.reserve(stats.nthreads);
+    for (unsigned i = 0; i < stats.nthreads; ++i)
+      threads.emplace_back(runWorker,std::ref(workers[i]),i,stats.nthreads,m_chunkSize,m_nskip,m_nmax);
+    for (auto& t : threads)
+      t.join();
+  }
+
+  for (auto& w : workers)
+    if (w.error)
+      std::rethrow_exception(w.error);
+
+  //Merge in a fixed order, taking over the histograms of the first thread:
+  for (auto& w : workers) {
+    stats.nevents += w.nevents;
+    stats.nbytes += w.nbytes;
+    w.fct = nullptr;//kernel state (e.g. iterators) might refer to the reader
+    std::set<std::string> keys;
+    w.hc->getKeys(keys);
+    for (auto& key : keys) {
+      if (hc.hasKey(key)) {
+        hc.hist(key)->merge(w.hc->hist(key));
+      } else {
+        hc.add(w.hc->remove(key),key);
+      }
+    }
+    w.hc.reset();
+    w.dr.reset();
+  }
+
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+  return stats;
+}
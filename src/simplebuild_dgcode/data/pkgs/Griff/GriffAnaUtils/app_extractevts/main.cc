@@ -65,6 +65,8 @@ int main(int argc,char** argv) {
     if (nseen%10000==0&&nseen)
       printf("Processed %llu events\n",(unsigned long long)nseen);
     auto fr = dr.getRawFileReader();
+    if (nseen==1)//full data is copied compressed, so keep the dictionary
+      fw.setCompressionDictionary(fr->compressionDictionary());
     if (fr->nBytesSharedDataInEvent()) {
       fr->getSharedDataInEvent(tmp);
       if (!tmp.empty()) {
@@ -76,13 +78,21 @@ int main(int argc,char** argv) {
     if (selected_evts.count(evtid)) {
       ++ntaken;
       selected_evts.erase(evtid);
-      if (!pending_shared_data.empty())
-        fw.writeDataDBSection(&pending_shared_data[0], pending_shared_data.size());
-      if (fr->nBytesBriefData())
-        fw.writeDataBriefSection(fr->getBriefData(), fr->nBytesBriefData());
-      if (fr->nBytesFullData())
-        fw.writeDataFullSection(fr->getFullData(), fr->nBytesFullData());
-      fw.flushEventToDisk(fr->runNumber(),fr->eventNumber());//Call at end of each event
+      //Copy the event without decompressing and recompressing the full data
+      //section. Only when the shared data of skipped events must be added does
+      //the checksum need to be recalculated:
+      std::uint32_t header[6] = { fr->eventCheckSum(), fr->runNumber(), fr->eventNumber(),
+                                  (std::uint32_t)pending_shared_data.size(),
+                                  fr->nBytesBriefData(), fr->nBytesFullDataOnDisk() };
+      auto checksumalgo = fr->eventCheckSumAlgo();
+      if (header[3]!=fr->nBytesSharedDataInEvent()) {
+        checksumalgo = fw.checkSumAlgo();
+        header[0] = EvtFile::FileWriter::eventCheckSum(checksumalgo,header,pending_shared_data.data(),
+                                                       fr->getBriefData(),fr->getFullData(),
+                                                       fr->nBytesFullData());
+      }
+      fw.writeRawEvent(header,checksumalgo,pending_shared_data.data(),fr->getBriefData(),
+                       fr->getFullDataOnDisk());
       pending_shared_data.clear();
 
       printf("Copied event #%llu to output file\n",(unsigned long long)evtid);
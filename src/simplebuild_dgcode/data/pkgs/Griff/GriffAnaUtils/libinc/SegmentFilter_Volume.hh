@@ -2,6 +2,7 @@
 #define GriffAnaUtils_SegmentFilter_Volume_hh
 
 #include "GriffAnaUtils/ISegmentFilter.hh"
+#include "GriffAnaUtils/TouchableCache.hh"
 #include <string>
 
 //A simply volume filter which requires an exact match of the
@@ -10,6 +11,10 @@
 //
 //By default, LOGICAL volume names are considered. If instead you wish to select
 //based on PHYSICAL volume names, use the "setPhysical() method.
+//
+//Since the outcome only depends on the touchable of the segment, it is cached
+//per touchable index, so string comparisons are only done once per volume in
+//the file and filtering of subsequent segments is a simple lookup.
 
 namespace GriffAnaUtils {
 
@@ -28,6 +33,8 @@ namespace GriffAnaUtils {
 
   private:
     virtual ~SegmentFilter_Volume(){}
+    bool filterNoCache(const GriffDataRead::Segment*segment) const;
+    TouchableCache m_cache;
     unsigned m_depth;
     std::string m_volname[3];
     bool m_logical;
@@ -0,0 +1,41 @@
+#ifndef GriffAnaUtils_TouchableCache_hh
+#define GriffAnaUtils_TouchableCache_hh
+
+#include "GriffDataRead/Segment.hh"
+#include <vector>
+
+//Caches the outcome of a decision which depends only on the volume
+//(i.e. touchable) of a segment, such as a match on volume names. The decision
+//is evaluated once for each new touchable encountered and afterwards looked up
+//by touchable index, so per-segment cost is a vector lookup rather than string
+//comparisons. The cache is automatically reset when the GriffDataReader opens a
+//new file (and thus starts a new touchable DB).
+
+namespace GriffAnaUtils {
+
+  class TouchableCache {
+  public:
+    TouchableCache() : m_dr(0), m_dbGeneration(0) {}
+    ~TouchableCache(){}
+
+    //Returns the cached decision for the volume of the segment, invoking
+    //resolve(segment) only when the volume was not seen before:
+    template<class TResolve>
+    bool lookup(const GriffDataRead::Segment*, TResolve resolve) const;
+
+    void clear() const { m_state.clear(); m_dr = 0; }
+
+  private:
+    enum { UNRESOLVED = 0, RESOLVED_FALSE = 1, RESOLVED_TRUE = 2 };
+    mutable std::vector<unsigned char> m_state;
+    mutable const GriffDataReader * m_dr;
+    mutable std::uint64_t m_dbGeneration;
+    template<class TResolve>
+    bool resolveAndCache(const GriffDataRead::Segment*, TResolve&) const;
+  };
+
+}
+
+#include "GriffAnaUtils/TouchableCache.icc"
+
+#endif
@@ -5,6 +5,7 @@
 #include "Utils/FastLookupSet.hh"
 #include "Core/Types.hh"
 #include <set>
+#include <bitset>
 
 namespace GriffAnaUtils {
 
@@ -44,6 +45,13 @@ namespace GriffAnaUtils {
     TrackFilter_PDGCode & operator= ( const TrackFilter_PDGCode & );
     virtual ~TrackFilter_PDGCode(){}
     bool m_unsigned;
+    //Codes with absolute values below nbits (leptons, gammas and the most
+    //common hadrons) are resolved once when added, into bitmaps indexed by the
+    //code, so filtering tracks of such particles is a single bit test. Other
+    //codes (e.g. ions) are looked up in the sets below:
+    enum { nbits = 4096 };
+    std::bitset<2*nbits> m_bitsSigned;//bit c+nbits
+    std::bitset<nbits> m_bitsAbs;//bit |c|
 #if 1//fixme, once we trust these sets we should use Utils::FastLookupSet always
     Utils::FastLookupSet<int32_t> m_allAbsCodes;
     Utils::FastLookupSet<int32_t> m_positiveCodes;//includes "0"
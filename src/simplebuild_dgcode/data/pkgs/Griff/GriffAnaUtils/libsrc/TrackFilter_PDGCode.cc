@@ -44,6 +44,10 @@ GriffAnaUtils::TrackFilter_PDGCode * GriffAnaUtils::TrackFilter_PDGCode::addCode
     m_positiveCodes.insert(c);
     m_allAbsCodes.insert(c);
   }
+  if (c>-nbits&&c<nbits) {
+    m_bitsSigned.set(c+nbits);
+    m_bitsAbs.set(c<0?-c:c);
+  }
   return this;
 }
 
@@ -115,7 +115,10 @@ public:
   bool goToNextFile();//try to skip to first event in next file
   bool goToNextEvent();//will automatically skip to next file when needed
   bool goToFirstEvent();//meaning first event of the first file with n>0 events in it
-  bool skipEvents(unsigned n);//Will automatically skip to next file when needed.
+  bool skipEvents(unsigned n);//Will automatically skip to next file when needed. Only
+                              //the headers and database sections of the events
+                              //skipped over are read, and no callbacks are fired
+                              //for them.
 
   //If all you want to do is loop through all events, it is simplest to use the
   //following method which combines eventActive() checks with goToNextEvent():
@@ -138,6 +141,21 @@ public:
   std::uint32_t eventCheckSum() const;//Checksum stored in file
   bool verifyEventDataIntegrity();//Recalculate checksum and verify
 
+  //Counter which changes whenever the database of volumes, materials, etc. is
+  //reset (i.e. when a new file is opened). Code caching information per DB
+  //index (e.g. per Segment::touchableIndex()) must discard it when this
+  //changes. Within a file the DB only grows, so cached entries stay valid:
+  std::uint64_t dbGeneration() const { return m_dbGeneration; }
+
+  //Analyses which only need the brief (track and segment level) information
+  //can declare so up front. The full data sections holding the steps are then
+  //skipped on disk without ever being read or decompressed, making it much
+  //faster to scan through files with FULL or REDUCED storage. Accessing step
+  //information (or calling verifyEventDataIntegrity) in this mode results in
+  //an exception:
+  void setSummaryOnly(bool b = true);
+  bool summaryOnly() const { return m_summaryOnly; }
+
 private:
   //multiple files:
   std::vector<std::string> m_inputFiles;
@@ -147,6 +165,8 @@ private:
   bool m_eventLoopStart;
   //current file:
   unsigned m_fileIdx;
+  std::uint64_t m_dbGeneration;
+  bool m_summaryOnly;
   EvtFile::FileReader * m_fr;
   alignas(EvtFile::FileReader) char m_mempool_filereader[sizeof(EvtFile::FileReader)];
   //event data:
@@ -197,6 +217,7 @@ private:
 
   void init();
   void initFile(unsigned);
+  bool openNextFile();
   void loadTracks() const;
   void actualLoadTracks() const;
   void clearEvent();
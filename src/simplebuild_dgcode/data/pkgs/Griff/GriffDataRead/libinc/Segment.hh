@@ -23,7 +23,11 @@ namespace GriffDataRead {
     const Segment * getPreviousSegment() const;//returns 0 if this is the first segment.
     bool nextWasFiltered() const;//returns true if first step coming after this segment was filtered out.
 
-    //WARNING: Calling any of the next methods will usually trigger loading of all step data in the event!
+    //NB: Calling any of the next methods will trigger reading of step data from
+    //the file. Step data is only decompressed up to and including the steps of
+    //this segment, so it is cheapest for the first tracks in the event (like
+    //the primary tracks), but can approach the cost of decompressing all step
+    //data of the event for the last tracks.
     unsigned nStepsOriginal() const;//number of steps comprising the segment
     unsigned nStepsStored() const;//number of steps actually available in the inputfile (in FULL mode nStepsOriginal() == nStepsStored())
 
@@ -60,6 +64,11 @@ namespace GriffDataRead {
 
     bool inSameVolume(const Segment*) const;//see if two segments are in the same volume
 
+    //Index of the volume (touchable) in the file DB. Segments with the same
+    //index are in the same volume, and all volume properties above only depend
+    //on it. Only valid as long as GriffDataReader::dbGeneration() is unchanged:
+    EvtFile::index_type touchableIndex() const;
+
     //////////////////////////////////////////////////////
     //  The rest of this file is implementation details //
     //////////////////////////////////////////////////////
@@ -80,7 +89,6 @@ namespace GriffDataRead {
     friend class Step;
     mutable const Step* m_stepsBegin;
     mutable const Step* m_stepsEnd;//0 means steps are not setup, 0x1 means the mode is minimal.
-    EvtFile::index_type touchableIndex() const;
   };
 }
 
@@ -4,6 +4,8 @@
 #include "Core/String.hh"
 #include <sstream>
 #include <stdexcept>
+#include <algorithm>
+#include <limits>
 
 bool GriffDataReader::sm_openMsg = true;
 
@@ -179,6 +181,8 @@ void GriffDataReader::init()
   m_dbmgr.addSubSection(m_dbMetaDataStrings);
 
   m_fileIdx = UINT_MAX;
+  m_dbGeneration = 0;
+  m_summaryOnly = false;
   m_fr = 0;
   goToFirstEvent();
 }
@@ -196,7 +200,7 @@ void GriffDataReader::initFile(unsigned i)
       bool ok = m_fr->goToFirstEvent();
       assert(m_fr->nBytesBriefData()>=2*sizeof(std::uint32_t));
       assert(ok&&m_fr->ok()&&!m_fr->bad());
-      assert(m_fr->verifyEventDataIntegrity());
+      assert(m_summaryOnly||m_fr->verifyEventDataIntegrity());
 #endif
       m_fileIdx = i;
       return;
@@ -204,7 +208,9 @@ void GriffDataReader::initFile(unsigned i)
     m_fr->EvtFile::FileReader::~FileReader();//fixme std::optional would be better!
     m_fr = nullptr;
   }
+  ++m_dbGeneration;//DB was cleared
   m_fr = new(&(m_mempool_filereader[0])) EvtFile::FileReader(GriffFormat::Format::getFormat(),m_inputFiles[i].c_str(),&m_dbmgr);
+  m_fr->setBriefDataOnly(m_summaryOnly);
   bool ok = m_fr->init();
   if (!ok || m_fr->bad()) {
     printf("GriffDataReader::ERROR Trouble while opening file %s : %s\n",m_inputFiles[i].c_str(),m_fr->bad_reason());
@@ -219,7 +225,55 @@ void GriffDataReader::initFile(unsigned i)
   m_fileIdx = i;
 }
 
+void GriffDataReader::setSummaryOnly(bool b)
+{
+  m_summaryOnly = b;
+  if (m_fr)
+    m_fr->setBriefDataOnly(b);
+}
+
 bool GriffDataReader::goToNextFile()
+{
+  if (!openNextFile())
+    return false;
+  beginEventActions();
+  return true;
+}
+
+bool GriffDataReader::skipEvents(unsigned n)
+{
+  if (!eventActive())
+    return false;//we are no-where to begin with...
+  if (!n)
+    return true;
+  clearEvent();
+  //Skip at the level of the file reader, so the events skipped over are merely
+  //indexed (their database sections must still be read, since they are
+  //cumulative). File transitions are handled like in goToNextFile():
+  while (true) {
+    const unsigned idx = m_fr->eventIndex();
+    const unsigned nstep = std::min<unsigned>(n,std::numeric_limits<int>::max());
+    if (m_fr->skipEvents(static_cast<int>(nstep))) {
+      n -= nstep;
+      if (!n)
+        break;
+      continue;
+    }
+    if (m_fr->bad())
+      return false;//something went wrong
+    //Reached the end of the file, the first event of the next file counts as one more:
+    assert(m_fr->nEventsIndexed()>idx);
+    n -= std::min<unsigned>(n,m_fr->nEventsIndexed()-idx);
+    if (!openNextFile())
+      return false;
+    if (!n)
+      break;
+  }
+  beginEventActions();
+  return true;
+}
+
+bool GriffDataReader::openNextFile()
 {
   if (m_fileIdx==m_inputFiles.size())
     return false;//we already determined that there is no next file to try.
@@ -241,8 +295,6 @@ bool GriffDataReader::goToNextFile()
   if (m_fileIdx==m_inputFiles.size())
     return false;//there is no next file to try
   initFile(m_fileIdx);
-  if (eventActive())
-    beginEventActions();
   return eventActive();
 }
 
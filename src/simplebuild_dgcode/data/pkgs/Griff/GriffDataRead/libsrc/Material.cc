@@ -52,15 +52,8 @@ const GriffDataRead::Element* GriffDataRead::Material::getElement(unsigned ielem
 
 const std::string& GriffDataRead::Material::stateStr() const
 {
-  static std::string state_strings[4];
-  static bool needs_init = true;
-  if (needs_init) {
-    needs_init = false;
-    state_strings[0] = "Undefined";
-    state_strings[1] = "Solid";
-    state_strings[2] = "Liquid";
-    state_strings[3] = "Gas";
-  }
+  //NB: Initialised in the declaration, since analyses can run in several threads:
+  static const std::string state_strings[4] = { "Undefined", "Solid", "Liquid", "Gas" };
   assert(m_state>=0&&m_state<=3);
   return state_strings[m_state];
 }
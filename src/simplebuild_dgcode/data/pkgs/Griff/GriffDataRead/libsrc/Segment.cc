@@ -1,4 +1,6 @@
 #include <cassert>
+#include <stdexcept>
+#include <string>
 #include "GriffDataRead/Segment.hh"
 #include "GriffDataRead/Track.hh"
 #include "GriffDataRead/GriffDataReader.hh"
@@ -21,6 +23,14 @@ double GriffDataRead::Segment::segmentLength() const
   return sl;
 }
 
+namespace {
+  [[noreturn]] void stepDataError(EvtFile::FileReader * fr)
+  {
+    throw std::runtime_error(std::string("GriffDataReader: Problems reading step data in ")
+                             +fr->fileName()+" ("+fr->bad_reason()+")");
+  }
+}
+
 void GriffDataRead::Segment::actualSetupSteps() const
 {
   assert(!m_stepsBegin);
@@ -31,9 +41,21 @@ void GriffDataRead::Segment::actualSetupSteps() const
     return;
   }
   GriffDataReader * dr = m_trk->m_dr;
-  const char * stepdata = dr->m_fr->getFullData() + rawstep;
+  if (dr->m_summaryOnly)
+    throw std::runtime_error("GriffDataReader: Step information is not available when reading in summary-only mode");
+  //Only decompress the full data section up to the steps of this segment
+  //(tracks are stored in order, so analyses only looking at the steps of the
+  //first (primary) tracks need not inflate the steps of the whole event):
+  EvtFile::FileReader * fr = dr->m_fr;
+  const unsigned stepsize = GriffFormat::Format::SIZE_STEPPREPOSTPART+GriffFormat::Format::SIZE_STEPOTHERPART;
+  const char * fulldata = fr->getFullDataPrefix(rawstep+GriffFormat::Format::SIZE_STEPHEADER);
+  if (!fulldata)
+    stepDataError(fr);
+  const char * stepdata = fulldata + rawstep;
   unsigned nsteps_stored = ByteStream::interpret<std::uint32_t>(stepdata + 4);
   assert(nsteps_stored>=1);
+  if (!fr->getFullDataPrefix(rawstep+GriffFormat::Format::SIZE_STEPHEADER+nsteps_stored*stepsize))
+    stepDataError(fr);
   stepdata+=GriffFormat::Format::SIZE_STEPHEADER;
   static_assert(GriffFormat::Format::SIZE_STEPHEADER==8);
   //Get memory big enough to store nsteps_stored Step objects:
@@ -50,7 +72,7 @@ void GriffDataRead::Segment::actualSetupSteps() const
     assert(stepdata);
     const_cast<Step*>(step)->set(this,stepdata);
     assert(step->m_data);
-    stepdata+=(GriffFormat::Format::SIZE_STEPPREPOSTPART+GriffFormat::Format::SIZE_STEPOTHERPART);
+    stepdata+=stepsize;
     static_assert(GriffFormat::Format::SIZE_STEPPREPOSTPART==68);
     static_assert(GriffFormat::Format::SIZE_STEPOTHERPART==16);
   }
@@ -158,6 +158,8 @@ PYTHON_MODULE( mod )
     .def("eventIndexInCurrentFile",&GriffDataReader::eventIndexInCurrentFile)
     .def("eventCheckSum",&GriffDataReader::eventCheckSum)
     .def("verifyEventDataIntegrity",&GriffDataReader::verifyEventDataIntegrity)
+    .def("setSummaryOnly",&GriffDataReader::setSummaryOnly)
+    .def("summaryOnly",&GriffDataReader::summaryOnly)
     ;
 
 }
@@ -0,0 +1,165 @@
+#include "GriffExprParser/EventPredicate.hh"
+#include "GriffDataRead/GriffDataReader.hh"
+#include "GriffFormat/Format.hh"
+#include "EvtFile/FileReader.hh"
+#include "EvtFile/FileWriter.hh"
+#include "ExprParser/ASTDebug.hh"
+
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+  int usage(const char * progname, const char * errmsg)
+  {
+    if (errmsg) {
+      printf("ERROR: %s\n\nRun with -h or --help for usage information\n",errmsg);
+      return 1;
+    }
+    const char * p = std::strrchr(progname,'/');
+    progname = p ? p + 1 : progname;
+    printf("\nUsage:\n\n  %s [options] EXPR GRIFFINPUT GRIFFOUTPUT\n\n"
+           "Copies the events of GRIFFINPUT for which EXPR is true for at least one\n"
+           "segment (or, if EXPR only involves trk.xxx variables, one track) into the\n"
+           "new file GRIFFOUTPUT. EXPR is evaluated using just the brief data of the\n"
+           "events, so the step data of rejected events is never read, and that of\n"
+           "selected events is copied as it is.\n"
+           "\nOptions:\n\n"
+           "  -h, --help       : Show this usage information.\n"
+           "  --noverify       : Do not verify checksums of selected events (faster).\n"
+           "  --show           : Show the compiled expression and exit.\n"
+           "\nExamples:\n\n"
+           "  %s 'seg.volname==\"Detector\" && seg.edep>10keV' sim.griff skim.griff\n"
+           "  %s 'trk.is_neutron && trk.is_primary && trk.ekin<25meV' sim.griff skim.griff\n\n"
+           "To skim several files, either skim them one by one and merge the outputs\n"
+           "afterwards, or merge them first (with sb_griffformat_merge).\n\n",
+           progname,progname,progname);
+    return 0;
+  }
+
+}
+
+int main(int argc,char** argv) {
+  std::vector<std::string> args;
+  bool opt_verify = true;
+  bool opt_show = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    if (a=="-h"||a=="--help")
+      return usage(argv[0],0);
+    else if (a=="--noverify")
+      opt_verify = false;
+    else if (a=="--show")
+      opt_show = true;
+    else if (a.size()>1&&a[0]=='-')
+      return usage(argv[0],("Unknown option: "+a).c_str());
+    else
+      args.push_back(a);
+  }
+  if (args.size() != (opt_show ? 1 : 3))
+    return usage(argv[0],"Wrong number of arguments");
+
+  std::unique_ptr<GriffExprParser::EventPredicate> pred;
+  try {
+    pred.reset(new GriffExprParser::EventPredicate(args[0]));
+  } catch (ExprParser::InputError& e) {
+    printf("ERROR: %s in expression : %s\n",e.epType(),e.epWhat());
+    return 1;
+  }
+  if (opt_show) {
+    printf("\nexpression: \"%s\"\n\nis evaluated per %s and compiles into the following"
+           " abstract syntax tree representation:\n\n",pred->expression().c_str(),
+           pred->segmentLevel() ? "segment" : "track");
+    ExprParser::printTree(pred->tree(),"                   |",false);
+    printf("\n");
+    return 0;
+  }
+
+  const auto t0 = std::chrono::steady_clock::now();
+  GriffDataReader dr(args[1]);
+  dr.setSummaryOnly();
+  EvtFile::FileWriter fw(GriffFormat::Format::getFormat(),args[2].c_str());
+  if (!fw.ok()) {
+    printf("ERROR: Problems opening requested output file\n");
+    return 1;
+  }
+  std::vector<char> pending_shared_data;
+  std::vector<char> tmp;
+  std::uint64_t ntaken(0), nseen(0);
+  std::uint64_t nbytes_input(0), nbytes_read(0);
+
+  while (dr.loopEvents()) {
+    if ( dr.eventIndexInCurrentFile()==0 && nseen ) {
+      printf("ERROR: Skimming multiple input files is currently not supported!\n");
+      return 1;
+    }
+    ++nseen;
+    auto fr = dr.getRawFileReader();
+    if (nseen==1)//full data is copied compressed, so keep the dictionary
+      fw.setCompressionDictionary(fr->compressionDictionary());
+    const std::uint64_t nbytes_brief = fr->eventHeaderBytes()+fr->nBytesSharedDataInEvent()+fr->nBytesBriefData();
+    nbytes_input += nbytes_brief + fr->nBytesFullDataOnDisk();
+    nbytes_read += nbytes_brief;
+    if (fr->nBytesSharedDataInEvent()) {
+      fr->getSharedDataInEvent(tmp);
+      pending_shared_data.insert(pending_shared_data.end(),tmp.begin(),tmp.end());
+    }
+
+    if (!(*pred)(dr))
+      continue;
+
+    //Selected, so access to the step data is needed after all:
+    ++ntaken;
+    nbytes_read += fr->nBytesFullDataOnDisk();
+    dr.setSummaryOnly(false);
+    if (opt_verify && !dr.verifyEventDataIntegrity()) {
+      printf("ERROR: Data integrity check failed in input data on event #%llu\n",
+             (unsigned long long)dr.loopCount());
+      return 1;
+    }
+    //Copy the event without decompressing and recompressing the full data
+    //section. Only when the shared data of skipped events must be added does
+    //the checksum need to be recalculated:
+    std::uint32_t header[6] = { fr->eventCheckSum(), fr->runNumber(), fr->eventNumber(),
+                                (std::uint32_t)pending_shared_data.size(),
+                                fr->nBytesBriefData(), fr->nBytesFullDataOnDisk() };
+    auto checksumalgo = fr->eventCheckSumAlgo();
+    if (header[3]!=fr->nBytesSharedDataInEvent()) {
+      checksumalgo = fw.checkSumAlgo();
+      header[0] = EvtFile::FileWriter::eventCheckSum(checksumalgo,header,pending_shared_data.data(),
+                                                     fr->getBriefData(),fr->getFullData(),
+                                                     fr->nBytesFullData());
+    }
+    fw.writeRawEvent(header,checksumalgo,pending_shared_data.data(),fr->getBriefData(),
+                     fr->getFullDataOnDisk());
+    pending_shared_data.clear();
+    dr.setSummaryOnly(true);
+  }
+
+  fw.close();
+  const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+
+  if (!ntaken) {
+    //Best to threat this as an error, since the file doesn't even contain any
+    //metadata like geometry parameters etc.
+    printf("ERROR: No events selected from file (file has %llu events).\n",
+           (unsigned long long)nseen);
+    return 1;
+  }
+
+  printf("Selected %llu of %llu events (%g %%) into new file %s\n",
+         (unsigned long long)ntaken,(unsigned long long)nseen,
+         ntaken*100.0/nseen,args[2].c_str());
+  printf("Read %.3g MB of %.3g MB input data (%g %%)\n",nbytes_read*1e-6,nbytes_input*1e-6,
+         nbytes_read*100.0/std::max<std::uint64_t>(nbytes_input,1));
+  printf("Processed %llu events in %.2f s (%.0f events/s, %.1f MB/s of input data).\n",
+         (unsigned long long)nseen,secs,nseen/(secs>0.0?secs:1e-9),nbytes_input*1e-6/(secs>0.0?secs:1e-9));
+
+  return 0;
+}
@@ -0,0 +1,49 @@
+#ifndef GriffExprParser_EventPredicate_hh
+#define GriffExprParser_EventPredicate_hh
+
+//Selection of events in Griff files, by an expression like:
+//
+//   seg.volname=="Detector" && seg.edep > 10keV
+//
+//An event is selected if the expression is true for at least one segment in
+//the event, or, for expressions only referring to trk.xxx variables, for at
+//least one track. Only the brief data of events is needed to evaluate the
+//predicate, so readers used purely for event selection can (and should) be put
+//in summary-only mode (see GriffDataReader::setSummaryOnly), in which case
+//the step data of rejected events is never read or decompressed.
+
+#include "GriffExprParser/GriffASTBuilder.hh"
+#include "GriffDataRead/GriffDataReader.hh"
+
+namespace GriffExprParser {
+
+  class EventPredicate {
+  public:
+    //Throws ExprParser::InputError (or derived) if the expression is invalid or
+    //refers to step.xxx variables:
+    EventPredicate(const str_type& expression);
+    ~EventPredicate(){}
+
+    const str_type& expression() const { return m_expr; }
+
+    //Whether the expression is evaluated per segment (otherwise per track):
+    bool segmentLevel() const { return m_builder.usesSegmentData(); }
+
+    //Whether the current event of the reader is selected:
+    bool operator()(const GriffDataReader&);
+
+    //The compiled expression (e.g. for printing with ExprParser::printTree):
+    ExprEntityPtr tree() { return m_eval.arg(); }
+
+    EventPredicate & operator= ( const EventPredicate & ) = delete;
+    EventPredicate( const EventPredicate& ) = delete;
+
+  private:
+    str_type m_expr;
+    GriffASTBuilder m_builder;
+    ExprParser::Evaluator<bool> m_eval;
+  };
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef GriffExprParser_GriffASTBuilder_hh
+#define GriffExprParser_GriffASTBuilder_hh
+
+#include "ExprParser/ASTBuilder.hh"
+#include "GriffDataRead/Track.hh"
+#include "GriffDataRead/Segment.hh"
+#include "GriffDataRead/Step.hh"
+
+namespace GriffExprParser {
+
+  using ExprParser::ASTBuilder;
+  using ExprParser::ExprEntityPtr;
+  using ExprParser::float_type;
+  using ExprParser::int_type;
+  using ExprParser::str_type;
+
+  //Builds expressions from variables named trk.xxx, seg.xxx, step.xxx,
+  //step.pre.xxx and step.post.xxx, referring to properties of
+  //GriffDataRead::Track, GriffDataRead::Segment and GriffDataRead::Step objects
+  //(see GriffDataExtractors.hh for the available properties). The trk.xxx and
+  //seg.xxx variables are available from the brief data of events, while the
+  //step variables of course require the full data.
+  //
+  //Comparisons of volume, material or particle names with constant strings
+  //(like seg.volname=="Detector" or trk.name!="gamma") are folded into nodes
+  //which compare the strings only once per touchable index or PDG code in the
+  //file, and otherwise just look up the cached result. Thus such selections
+  //are as fast as those of the compiled filters in GriffAnaUtils.
+
+  class GriffASTBuilder : public ASTBuilder {
+  public:
+    GriffASTBuilder() : ASTBuilder(), m_currentTrack(0), m_currentSegment(0), m_currentStep(0),
+                        m_usesSegmentData(false), m_usesStepData(false) {};
+    virtual ~GriffASTBuilder(){}
+
+    //Must always set current step (which also sets the current segment and
+    //track), segment (which also sets the current track to the track of the
+    //segment) or track here before attempting to evaluate expression trees
+    //built with this class. Expressions referring to step.xxx variables can not
+    //be evaluated with just a segment, and expressions referring to seg.xxx
+    //variables can not be evaluated with just a track:
+    void setCurrentStep(const GriffDataRead::Step* step) { m_currentStep = step; m_currentSegment = step->getSegment(); m_currentTrack = step->getTrack(); }
+    void setCurrentSegment(const GriffDataRead::Segment* seg) { m_currentStep = 0; m_currentSegment = seg; m_currentTrack = seg->getTrack(); }
+    void setCurrentTrack(const GriffDataRead::Track* trk) { m_currentStep = 0; m_currentSegment = 0; m_currentTrack = trk; }
+
+    //Whether any expression created so far refers to seg.xxx (or step.xxx) variables:
+    bool usesSegmentData() const { return m_usesSegmentData; }
+    //Whether any expression created so far refers to step.xxx variables:
+    bool usesStepData() const { return m_usesStepData; }
+
+    //Better disallow copy/move/assign, because after copying previously created
+    //expressions will still refer to m_currentTrack and m_currentSegment in the
+    //original builder, which might lead to surprises:
+    GriffASTBuilder & operator= ( const GriffASTBuilder & ) = delete;
+    GriffASTBuilder & operator= ( GriffASTBuilder && ) = delete;
+    GriffASTBuilder( const GriffASTBuilder& ) = delete;
+    GriffASTBuilder( GriffASTBuilder&& ) = delete;
+
+  protected:
+    virtual ExprEntityPtr createValue(const str_type& name) const;
+    virtual ExprEntityPtr createBinaryOperator(const str_type& identifier, ExprEntityPtr arg1, ExprEntityPtr arg2) const;
+    const GriffDataRead::Track * m_currentTrack;
+    const GriffDataRead::Segment * m_currentSegment;
+    const GriffDataRead::Step * m_currentStep;
+  private:
+    mutable bool m_usesSegmentData;
+    mutable bool m_usesStepData;
+  };
+
+}
+
+#endif
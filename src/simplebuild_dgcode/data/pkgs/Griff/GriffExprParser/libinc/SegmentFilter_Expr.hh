@@ -0,0 +1,41 @@
+#ifndef GriffExprParser_SegmentFilter_Expr_hh
+#define GriffExprParser_SegmentFilter_Expr_hh
+
+#include "GriffAnaUtils/ISegmentFilter.hh"
+#include "GriffExprParser/GriffASTBuilder.hh"
+
+//Selects segments for which an expression in seg.xxx and trk.xxx variables is
+//true, for instance:
+//
+//   seg.volname=="Detector" && trk.name=="alpha" && seg.edep > 10keV
+//
+//Name comparisons like the ones above are resolved once per volume or particle
+//type in the file, so the filter is about as fast as the equivalent
+//combination of compiled filters (SegmentFilter_Volume, TrackFilter_PDGCode and
+//SegmentFilter_EnergyDeposition).
+
+namespace GriffExprParser {
+
+  class SegmentFilter_Expr : public GriffAnaUtils::ISegmentFilter {
+  public:
+
+    //Throws ExprParser::InputError (or derived) if the expression is invalid or
+    //refers to step.xxx variables:
+    SegmentFilter_Expr(const str_type& expression);
+
+    bool filter(const GriffDataRead::Segment*segment) const;
+
+    const str_type& expression() const { return m_expr; }
+    const ExprEntityPtr tree() const { return m_eval.arg(); }
+
+  private:
+    virtual ~SegmentFilter_Expr(){}
+    str_type m_expr;
+    mutable GriffASTBuilder m_builder;
+    ExprParser::Evaluator<bool> m_eval;
+  };
+}
+
+#include "GriffExprParser/SegmentFilter_Expr.icc"
+
+#endif
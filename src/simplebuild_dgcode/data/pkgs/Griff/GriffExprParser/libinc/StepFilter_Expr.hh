@@ -0,0 +1,39 @@
+#ifndef GriffExprParser_StepFilter_Expr_hh
+#define GriffExprParser_StepFilter_Expr_hh
+
+#include "GriffAnaUtils/IStepFilter.hh"
+#include "GriffExprParser/GriffASTBuilder.hh"
+
+//Selects steps for which an expression in step.xxx, step.pre.xxx,
+//step.post.xxx, seg.xxx and trk.xxx variables is true, for instance:
+//
+//   step.post.process_defined_step=="NeutronInelastic" && step.pre.ekin < 0.1eV
+//
+//Note that a step filter can not skip entire segments by itself. When iterating
+//with a StepIterator it is therefore usually more efficient to put cuts which
+//only involve seg.xxx and trk.xxx variables into a separate SegmentFilter_Expr.
+
+namespace GriffExprParser {
+
+  class StepFilter_Expr : public GriffAnaUtils::IStepFilter {
+  public:
+
+    //Throws ExprParser::InputError (or derived) if the expression is invalid:
+    StepFilter_Expr(const str_type& expression);
+
+    bool filter(const GriffDataRead::Step*step) const;
+
+    const str_type& expression() const { return m_expr; }
+    const ExprEntityPtr tree() const { return m_eval.arg(); }
+
+  private:
+    virtual ~StepFilter_Expr(){}
+    str_type m_expr;
+    mutable GriffASTBuilder m_builder;
+    ExprParser::Evaluator<bool> m_eval;
+  };
+}
+
+#include "GriffExprParser/StepFilter_Expr.icc"
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef GriffExprParser_TrackFilter_Expr_hh
+#define GriffExprParser_TrackFilter_Expr_hh
+
+#include "GriffAnaUtils/ITrackFilter.hh"
+#include "GriffExprParser/GriffASTBuilder.hh"
+
+//Selects tracks for which an expression in trk.xxx variables is true, for
+//instance:
+//
+//   trk.name=="alpha" && trk.ekin > 1MeV
+//
+//The expression is usually given at runtime (e.g. from the command line), so
+//selections can be changed without recompiling the analysis.
+
+namespace GriffExprParser {
+
+  class TrackFilter_Expr : public GriffAnaUtils::ITrackFilter {
+  public:
+
+    //Throws ExprParser::InputError (or derived) if the expression is invalid or
+    //refers to seg.xxx or step.xxx variables:
+    TrackFilter_Expr(const str_type& expression);
+
+    bool filter(const GriffDataRead::Track*trk) const;
+
+    const str_type& expression() const { return m_expr; }
+    const ExprEntityPtr tree() const { return m_eval.arg(); }
+
+  private:
+    virtual ~TrackFilter_Expr(){}
+    str_type m_expr;
+    mutable GriffASTBuilder m_builder;
+    ExprParser::Evaluator<bool> m_eval;
+  };
+}
+
+#include "GriffExprParser/TrackFilter_Expr.icc"
+
+#endif
@@ -0,0 +1,31 @@
+#include "GriffExprParser/EventPredicate.hh"
+
+GriffExprParser::EventPredicate::EventPredicate(const str_type& expression)
+  : m_expr(expression),
+    m_eval(m_builder.createEvaluator<bool>(expression))
+{
+  if (m_builder.usesStepData())
+    EXPRPARSER_THROW(ParseError,"event selection expressions can not refer to step.xxx variables (only the brief data of events is used)");
+}
+
+bool GriffExprParser::EventPredicate::operator()(const GriffDataReader& dr)
+{
+  auto trkE = dr.trackEnd();
+  if (!segmentLevel()) {
+    for (auto trk = dr.trackBegin(); trk!=trkE; ++trk) {
+      m_builder.setCurrentTrack(trk);
+      if (m_eval())
+        return true;
+    }
+    return false;
+  }
+  for (auto trk = dr.trackBegin(); trk!=trkE; ++trk) {
+    auto segE = trk->segmentEnd();
+    for (auto seg = trk->segmentBegin(); seg!=segE; ++seg) {
+      m_builder.setCurrentSegment(seg);
+      if (m_eval())
+        return true;
+    }
+  }
+  return false;
+}
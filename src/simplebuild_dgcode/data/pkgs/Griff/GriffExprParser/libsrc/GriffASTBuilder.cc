@@ -0,0 +1,352 @@
+#include "GriffExprParser/GriffASTBuilder.hh"
+#include "GriffDataExtractors.hh"
+#include "GriffAnaUtils/TouchableCache.hh"
+#include "GriffDataRead/GriffDataReader.hh"
+#include "ExprParser/ASTStdPhys.hh"
+#include "Core/String.hh"
+#include <utility>
+#include <cassert>
+
+namespace GriffExprParser {
+
+  using GriffDataRead::Track;
+  using GriffDataRead::Segment;
+  using GriffDataRead::Step;
+
+  template<class TObj, class TValue, TValue eval_func(const TObj*)>
+  class GriffEEVal : public ExprParser::ExprEntity<TValue> {
+  public:
+    GriffEEVal(const str_type name_, const TObj *& obj)
+      : ExprParser::ExprEntity<TValue>(), m_obj(obj), m_name(name_) {}
+    virtual bool isConstant() const { return false; }
+    virtual str_type name() const { return m_name; }
+    virtual TValue evaluate() const
+    {
+      assert(m_obj&&"did you remember to call GriffASTBuilder::setCurrentStep (or setCurrentSegment or setCurrentTrack) before evaluating the expression?");
+      return eval_func(m_obj);
+    }
+  protected:
+    const TObj *& m_obj;
+    str_type m_name;
+  };
+
+  //Names of volumes and materials only depend on the touchable of a segment,
+  //and names of particles only on the PDG code of a track. Comparisons of such
+  //names with constant strings are therefore folded into nodes which resolve
+  //the comparison once per touchable index (or PDG code) in the file, and
+  //afterwards simply look up the cached result.
+
+  class PDGCodeCache {
+  public:
+    //Same interface as GriffAnaUtils::TouchableCache. There are usually just a
+    //handful of different particle types in a file, so a linear search is fine:
+    PDGCodeCache() : m_dr(0), m_dbGeneration(0) {}
+    template<class TResolve>
+    bool lookup(const Track* trk, TResolve resolve) const
+    {
+      const std::int32_t code = trk->pdgCode();
+      const GriffDataReader * dr = trk->getDataReader();
+      if (dr!=m_dr || dr->dbGeneration()!=m_dbGeneration) {
+        m_state.clear();
+        m_dr = dr;
+        m_dbGeneration = dr->dbGeneration();
+      } else {
+        for (auto& e : m_state)
+          if (e.first==code)
+            return e.second;
+      }
+      const bool res = resolve(trk);
+      m_state.emplace_back(code,res);
+      return res;
+    }
+  private:
+    mutable std::vector<std::pair<std::int32_t,bool>> m_state;
+    mutable const GriffDataReader * m_dr;
+    mutable std::uint64_t m_dbGeneration;
+  };
+
+  template<class TObj> struct NameCache;
+  template<> struct NameCache<Segment> { typedef GriffAnaUtils::TouchableCache type; };
+  template<> struct NameCache<Track> { typedef PDGCodeCache type; };
+
+  template<class TObj, str_type eval_func(const TObj*)>
+  class GriffEENameCmp final : public ExprParser::ExprEntity<int_type> {
+  public:
+    GriffEENameCmp(const str_type name_, const TObj *& obj, const str_type& value, bool negate)
+      : ExprParser::ExprEntity<int_type>(), m_obj(obj), m_name(name_), m_value(value), m_negate(negate) {}
+    virtual bool isConstant() const { return false; }
+    virtual str_type name() const { return m_name; }
+    virtual int_type evaluate() const
+    {
+      assert(m_obj&&"did you remember to call GriffASTBuilder::setCurrentStep (or setCurrentSegment or setCurrentTrack) before evaluating the expression?");
+      return m_cache.lookup(m_obj,[this](const TObj* o) { return (eval_func(o)==m_value) != m_negate; });
+    }
+  private:
+    const TObj *& m_obj;
+    str_type m_name;
+    str_type m_value;
+    bool m_negate;
+    typename NameCache<TObj>::type m_cache;
+  };
+
+  class IFoldableName {
+  public:
+    virtual ~IFoldableName(){}
+    virtual ExprEntityPtr createComparison(const str_type& value, bool negate) const = 0;
+  };
+
+  template<class TObj, str_type eval_func(const TObj*)>
+  class GriffEENameVal final : public GriffEEVal<TObj,str_type,eval_func>, public IFoldableName {
+  public:
+    using GriffEEVal<TObj,str_type,eval_func>::GriffEEVal;
+    virtual ExprEntityPtr createComparison(const str_type& value, bool negate) const
+    {
+      return ExprParser::makeobj<GriffEENameCmp<TObj,eval_func>>(this->m_name+(negate?"!=\"":"==\"")+value+"\"",
+                                                                 this->m_obj,value,negate);
+    }
+  };
+
+  //Deduce object and value types from the signature of the extractor functions:
+  template<class TFunc> struct ExtractorInfo;
+  template<class TValue, class TObj> struct ExtractorInfo<TValue(*)(const TObj*)> {
+    typedef TValue value_type;
+    typedef TObj object_type;
+  };
+
+  template <auto thefunc>
+  ExprEntityPtr wrap_extractor(const str_type& name, const typename ExtractorInfo<decltype(thefunc)>::object_type *& objref)
+  {
+    typedef ExtractorInfo<decltype(thefunc)> Info;
+    return ExprParser::makeobj<GriffEEVal<typename Info::object_type,typename Info::value_type,thefunc>>(name,objref);
+  }
+
+  template <auto thefunc>
+  ExprEntityPtr wrap_name_extractor(const str_type& name, const typename ExtractorInfo<decltype(thefunc)>::object_type *& objref)
+  {
+    typedef ExtractorInfo<decltype(thefunc)> Info;
+    return ExprParser::makeobj<GriffEENameVal<typename Info::object_type,thefunc>>(name,objref);
+  }
+
+  ExprEntityPtr GriffASTBuilder::createValue(const str_type& name) const
+  {
+    using ExprParser::create_constant;
+
+    //standard math/physics constants:
+
+    auto p = ASTBuilder::createValue(name);
+    p = p ? p : ExprParser::create_standard_unit_or_constant(name);
+    if (p)
+      return p;
+
+    //constants needed to compare with step.status (same names as in Geant4):
+
+    if (!name.empty()&&name[0]=='f') {
+      if (name=="fWorldBoundary") return create_constant((int_type)Step::STATUS_WorldBoundary);
+      if (name=="fGeomBoundary") return create_constant((int_type)Step::STATUS_GeomBoundary);
+      if (name=="fAtRestDoItProc") return create_constant((int_type)Step::STATUS_AtRestDoItProc);
+      if (name=="fAlongStepDoItProc") return create_constant((int_type)Step::STATUS_AlongStepDoItProc);
+      if (name=="fPostStepDoItProc") return create_constant((int_type)Step::STATUS_PostStepDoItProc);
+      if (name=="fUserDefinedLimit") return create_constant((int_type)Step::STATUS_UserDefinedLimit);
+      if (name=="fExclusivelyForcedProc") return create_constant((int_type)Step::STATUS_ExclusivelyForcedProc);
+      if (name=="fUndefined") return create_constant((int_type)Step::STATUS_Undefined);
+    }
+
+    //Volatile value wrappers for data extracted from the current track, segment
+    //or step. Look for variables named trk.xxx, seg.xxx, step.xxx, step.pre.xxx
+    //or step.post.xxx and look for the correspondingly named xxx function in
+    //GriffDataExtractors.hh:
+
+    std::vector<std::string> parts;
+    Core::split_noempty(parts,name,".");
+
+    GriffASTBuilder * self = const_cast<GriffASTBuilder*>(this);
+
+    //Evil but convenient macro (can't stringify with pure C++):
+#   ifdef TESTRETURN
+#     undef TESTRETURN
+#   endif
+#   define TESTRETURN(x) if (p2==#x) { return wrap_extractor<extract_space::x>(name,objref); }
+#   ifdef TESTRETURN_NAME
+#     undef TESTRETURN_NAME
+#   endif
+#   define TESTRETURN_NAME(x) if (p2==#x) { return wrap_name_extractor<extract_space::x>(name,objref); }
+#   ifdef TESTRETURN_SP
+#     undef TESTRETURN_SP
+#   endif
+#   define TESTRETURN_SP(x) if (p2==#x) { return ( ispre ? wrap_extractor<extract_space::x<true>>(name,objref) \
+                                                         : wrap_extractor<extract_space::x<false>>(name,objref) ); }
+
+    if (parts.size()==2&&parts[0]=="seg") {
+      namespace extract_space = DataExtractors::seg;
+      const GriffDataRead::Segment * & objref = self->m_currentSegment;
+      m_usesSegmentData = true;
+      auto& p2 = parts[1];
+      switch(p2.empty()?'@':p2[0]) {
+      case 'd':
+        TESTRETURN(delta_e);
+        TESTRETURN(delta_time); break;
+      case 'e':
+        TESTRETURN(edep);
+        TESTRETURN(edep_ion);
+        TESTRETURN(edep_nonion);
+        TESTRETURN(ekin_end);
+        TESTRETURN(ekin_start);
+        TESTRETURN(end_at_voledge); break;
+      case 'i':
+        TESTRETURN(is_in_world);
+        TESTRETURN(iseg); break;
+      case 'm':
+        TESTRETURN_NAME(mat_name);
+        TESTRETURN(mat_density);
+        TESTRETURN(mat_temperature);
+        TESTRETURN(mat_pressure); break;
+      case 'p':
+        TESTRETURN_NAME(physvolname);
+        TESTRETURN_NAME(physvolname_1);
+        TESTRETURN_NAME(physvolname_2); break;
+      case 's':
+        TESTRETURN(start_at_voledge); break;
+      case 't':
+        TESTRETURN(time_end);
+        TESTRETURN(time_start); break;
+      case 'v':
+        TESTRETURN(volcopyno);
+        TESTRETURN(volcopyno_1);
+        TESTRETURN(volcopyno_2);
+        TESTRETURN(voldepth);
+        TESTRETURN_NAME(volname);
+        TESTRETURN_NAME(volname_1);
+        TESTRETURN_NAME(volname_2); break;
+      }
+      EXPRPARSER_THROW2(ParseError,"unknown seg property : \""<<p2<<"\"");
+    }
+
+    if (parts.size()==2&&parts[0]=="trk") {
+      namespace extract_space = DataExtractors::trk;
+      const GriffDataRead::Track * & objref = self->m_currentTrack;
+      auto& p2 = parts[1];
+      switch(p2.empty()?'@':p2[0]) {
+      case 'a':
+        TESTRETURN(atomicmass);
+        TESTRETURN(atomicnumber); break;
+      case 'c':
+        TESTRETURN(charge);
+        TESTRETURN(creatorprocess); break;
+      case 'e':
+        TESTRETURN(ekin); break;
+      case 'i':
+        TESTRETURN(is_gamma);
+        TESTRETURN(is_ion);
+        TESTRETURN(is_neutrino);
+        TESTRETURN(is_neutron);
+        TESTRETURN(is_photon);
+        TESTRETURN(is_primary);
+        TESTRETURN(is_secondary);
+        TESTRETURN(is_shortlived);
+        TESTRETURN(is_stable); break;
+      case 'l':
+        TESTRETURN(lifetime); break;
+      case 'm':
+        TESTRETURN(magneticmoment);
+        TESTRETURN(mass); break;
+      case 'n':
+        TESTRETURN_NAME(name);
+        TESTRETURN(ndaughters);
+        TESTRETURN(nsegments); break;
+      case 'p':
+        TESTRETURN(parentid);
+        TESTRETURN(pdgcode); break;
+      case 's':
+        TESTRETURN(spin);
+        TESTRETURN_NAME(subtype); break;
+      case 't':
+        TESTRETURN(time);
+        TESTRETURN(trkid);
+        TESTRETURN_NAME(type); break;
+      case 'w':
+        TESTRETURN(weight);
+        TESTRETURN(width); break;
+      }
+      EXPRPARSER_THROW2(ParseError,"unknown trk property : \""<<p2<<"\"");
+    }
+
+    if (parts.size()==2&&parts[0]=="step") {
+      namespace extract_space = DataExtractors::step;
+      const GriffDataRead::Step * & objref = self->m_currentStep;
+      m_usesSegmentData = m_usesStepData = true;
+      auto& p2 = parts[1];
+      switch(p2.empty()?'@':p2[0]) {
+      case 'd':
+        TESTRETURN(delta_e);
+        TESTRETURN(delta_pos);
+        TESTRETURN(delta_time); break;
+      case 'e':
+        TESTRETURN(edep);
+        TESTRETURN(edep_ion);
+        TESTRETURN(edep_nonion); break;
+      case 'i':
+        TESTRETURN(istep); break;
+      case 's':
+        TESTRETURN(status);
+        TESTRETURN(steplength); break;
+      }
+      if ( p2=="pre" || p2=="post" )
+        EXPRPARSER_THROW2(ParseError,"missing property of \""<<name<<"\". specify like \""<<name<<".xxx\")");
+      EXPRPARSER_THROW2(ParseError,"unknown step property : \""<<p2<<"\"");
+    }
+
+    if (parts.size()==3&&parts[0]=="step"&&(parts[1]=="pre"||parts[1]=="post")) {
+      namespace extract_space = DataExtractors::steppoint;
+      const GriffDataRead::Step * & objref = self->m_currentStep;
+      m_usesSegmentData = m_usesStepData = true;
+      const bool ispre = parts[1]=="pre";
+      auto& p2 = parts[2];
+      switch(p2.empty()?'@':p2[0]) {
+      case 'a':
+        TESTRETURN_SP(at_voledge); break;
+      case 'e':
+        TESTRETURN_SP(ekin); break;
+      case 'l':
+        TESTRETURN_SP(local_x);
+        TESTRETURN_SP(local_y);
+        TESTRETURN_SP(local_z); break;
+      case 'm':
+        TESTRETURN_SP(mom); break;
+      case 'p':
+        TESTRETURN_SP(process_defined_step);
+        TESTRETURN_SP(px);
+        TESTRETURN_SP(py);
+        TESTRETURN_SP(pz); break;
+      case 't':
+        TESTRETURN_SP(time); break;
+      case 'x':
+        TESTRETURN_SP(x); break;
+      case 'y':
+        TESTRETURN_SP(y); break;
+      case 'z':
+        TESTRETURN_SP(z); break;
+      }
+      EXPRPARSER_THROW2(ParseError,"unknown step."<<parts[1]<<" property : \""<<p2<<"\"");
+    }
+
+    if ( parts.size()==1 && (parts[0]=="seg" || parts[0]=="trk" || parts[0]=="step") )
+      EXPRPARSER_THROW2(ParseError,"missing property of \""<<parts[0]<<"\". specify like \""<<parts[0]<<".xxx\")");
+
+    return 0;
+  }
+
+  ExprEntityPtr GriffASTBuilder::createBinaryOperator(const str_type& identifier, ExprEntityPtr arg1, ExprEntityPtr arg2) const
+  {
+    //Fold comparisons of volume, material and particle names with constant
+    //strings (in either order) into cached comparisons:
+    if ( identifier=="==" || identifier=="!=" ) {
+      for (int i = 0; i < 2; ++i, std::swap(arg1,arg2)) {
+        auto foldable = dynamic_cast<const IFoldableName*>(arg1.get());
+        if ( foldable && arg2->isConstant() && arg2->returnType()==ExprParser::ET_STRING )
+          return foldable->createComparison(ExprParser::_eval<str_type>(arg2),identifier=="!=");
+      }
+    }
+    return ASTBuilder::createBinaryOperator(identifier,arg1,arg2);
+  }
+
+}
@@ -0,0 +1,156 @@
+#ifndef GriffExprParser_GriffDataExtractors_hh
+#define GriffExprParser_GriffDataExtractors_hh
+
+#include "ExprParser/Types.hh"
+#include "GriffDataRead/Track.hh"
+#include "GriffDataRead/Segment.hh"
+#include "GriffDataRead/Step.hh"
+#include "GriffDataRead/Material.hh"
+#include <cstdlib>
+#include <cmath>
+
+namespace GriffExprParser {
+
+  namespace DataExtractors {
+    using ExprParser::int_type;
+    using ExprParser::float_type;
+    using ExprParser::str_type;
+    using GriffDataRead::Track;
+    using GriffDataRead::Segment;
+    using GriffDataRead::Step;
+
+    namespace trk {
+
+      //The following functions can be embedded in expressions via the notation
+      //"trk.xxx" where xxx is the name of the function below:
+
+      inline int_type trkid(const Track* trk) { return trk->trackID(); }
+      inline int_type parentid(const Track* trk) { return trk->parentID(); }
+      inline int_type is_primary(const Track* trk) { return trk->isPrimary(); }
+      inline int_type is_secondary(const Track* trk) { return trk->isSecondary(); }
+      inline int_type ndaughters(const Track* trk) { return trk->nDaughters(); }
+      inline int_type nsegments(const Track* trk) { return trk->nSegments(); }
+      inline str_type creatorprocess(const Track* trk) { return trk->creatorProcess(); }
+      inline float_type weight(const Track* trk) { return trk->weight(); }
+      inline float_type ekin(const Track* trk) { return trk->startEKin(); }
+      inline float_type time(const Track* trk) { return trk->startTime(); }
+      inline float_type mass(const Track* trk) { return trk->mass(); }
+      inline float_type width(const Track* trk) { return trk->width(); }
+      inline float_type charge(const Track* trk) { return trk->charge(); }
+      inline float_type lifetime(const Track* trk) { return trk->lifeTime(); }
+      inline str_type name(const Track* trk) { return trk->pdgName(); }
+      inline str_type type(const Track* trk) { return trk->pdgType(); }
+      inline str_type subtype(const Track* trk) { return trk->pdgSubType(); }
+      inline int_type atomicnumber(const Track* trk) { return trk->atomicNumber(); }
+      inline int_type atomicmass(const Track* trk) { return trk->atomicMass(); }
+      inline float_type magneticmoment(const Track* trk) { return trk->magneticMoment(); }
+      inline float_type spin(const Track* trk) { return trk->spin(); }
+      inline int_type is_stable(const Track* trk) { return trk->stable(); }
+      inline int_type is_shortlived(const Track* trk) { return trk->shortLived(); }
+      inline int_type pdgcode(const Track* trk) { return trk->pdgCode(); }
+      inline int_type is_neutron(const Track* trk) { return trk->pdgCode()==2112; }
+      inline int_type is_gamma(const Track* trk) { return trk->pdgCode()==22; }
+      inline int_type is_photon(const Track* trk) { return trk->pdgCode()==22; }
+      inline int_type is_neutrino(const Track* trk)
+      {
+        auto pp = std::abs(trk->pdgCode());
+        return pp==12||pp==14||pp==16;
+      }
+      inline int_type is_ion(const Track* trk)
+      {
+        auto pp = std::abs(trk->pdgCode());
+        return pp/100000000 == 10;
+      }
+
+    }
+
+    namespace seg {
+
+      //The following functions can be embedded in expressions via the notation
+      //"seg.xxx" where xxx is the name of the function below:
+
+      inline int_type iseg(const Segment* seg) { return seg->iSegment(); }
+      inline float_type edep(const Segment* seg) { return seg->eDep(); }
+      inline float_type edep_nonion(const Segment* seg) { return seg->eDepNonIonising(); }
+      inline float_type edep_ion(const Segment* seg) { return seg->eDep()-seg->eDepNonIonising(); }
+      inline float_type ekin_start(const Segment* seg) { return seg->startEKin(); }
+      inline float_type ekin_end(const Segment* seg) { return seg->endEKin(); }
+      inline float_type delta_e(const Segment* seg) { return seg->endEKin()-seg->startEKin(); }
+      inline float_type time_start(const Segment* seg) { return seg->startTime(); }
+      inline float_type time_end(const Segment* seg) { return seg->endTime(); }
+      inline float_type delta_time(const Segment* seg) { return seg->endTime()-seg->startTime(); }
+      inline int_type start_at_voledge(const Segment* seg) { return seg->startAtVolumeBoundary(); }
+      inline int_type end_at_voledge(const Segment* seg) { return seg->endAtVolumeBoundary(); }
+      inline int_type is_in_world(const Segment* seg) { return seg->isInWorldVolume(); }
+      inline int_type voldepth(const Segment* seg) { return seg->volumeDepthStored(); }
+      inline str_type volname(const Segment* seg) { return seg->volumeName(0); }
+      inline str_type volname_1(const Segment* seg) { return seg->volumeDepthStored()>1 ? seg->volumeName(1) : str_type(); }
+      inline str_type volname_2(const Segment* seg) { return seg->volumeDepthStored()>2 ? seg->volumeName(2) : str_type(); }
+      inline str_type physvolname(const Segment* seg) { return seg->physicalVolumeName(0); }
+      inline str_type physvolname_1(const Segment* seg) { return seg->volumeDepthStored()>1 ? seg->physicalVolumeName(1) : str_type(); }
+      inline str_type physvolname_2(const Segment* seg) { return seg->volumeDepthStored()>2 ? seg->physicalVolumeName(2) : str_type(); }
+      inline int_type volcopyno(const Segment* seg) { return seg->volumeCopyNumber(0); }
+      inline int_type volcopyno_1(const Segment* seg) { return seg->volumeDepthStored()>1 ? seg->volumeCopyNumber(1) : 0; }
+      inline int_type volcopyno_2(const Segment* seg) { return seg->volumeDepthStored()>2 ? seg->volumeCopyNumber(2) : 0; }
+      inline str_type mat_name(const Segment* seg) { return seg->material()->getName(); }
+      inline float_type mat_density(const Segment* seg) { return seg->material()->density(); }
+      inline float_type mat_temperature(const Segment* seg) { return seg->material()->temperature(); }
+      inline float_type mat_pressure(const Segment* seg) { return seg->material()->pressure(); }
+
+    }
+
+    namespace step {
+
+      //The following functions can be embedded in expressions via the notation
+      //"step.xxx" where xxx is the name of the function below:
+
+      inline int_type istep(const Step* step) { return step->iStep(); }
+      inline float_type edep(const Step* step) { return step->eDep(); }
+      inline float_type edep_nonion(const Step* step) { return step->eDepNonIonising(); }
+      inline float_type edep_ion(const Step* step) { return step->eDep()-step->eDepNonIonising(); }
+      inline float_type steplength(const Step* step) { return step->stepLength(); }
+      inline float_type delta_e(const Step* step) { return step->postEKin()-step->preEKin(); }
+      inline float_type delta_time(const Step* step) { return step->postTime()-step->preTime(); }
+      inline float_type delta_pos(const Step* step)
+      {
+        const double * a = step->preGlobalArray();
+        const double * b = step->postGlobalArray();
+        return std::sqrt((b[0]-a[0])*(b[0]-a[0])+(b[1]-a[1])*(b[1]-a[1])+(b[2]-a[2])*(b[2]-a[2]));
+      }
+      inline int_type status(const Step* step) { return step->stepStatus(); }//NB: can compare with constants like "fGeomBoundary" in expressions
+
+    }
+
+    namespace steppoint {
+
+      //The following functions can be reached in expressions via either of the
+      //notations "step.pre.xxx" or "step.post.xxx" where xxx is the name of the
+      //function below, and where "pre" or "post" is used depending on whether
+      //the function is to be evaluated at the start or the end of the step:
+
+      template<bool pre> inline float_type ekin(const Step* s) { return pre ? s->preEKin() : s->postEKin(); }
+      template<bool pre> inline float_type time(const Step* s) { return pre ? s->preTime() : s->postTime(); }
+      template<bool pre> inline float_type x(const Step* s) { return pre ? s->preGlobalX() : s->postGlobalX(); }
+      template<bool pre> inline float_type y(const Step* s) { return pre ? s->preGlobalY() : s->postGlobalY(); }
+      template<bool pre> inline float_type z(const Step* s) { return pre ? s->preGlobalZ() : s->postGlobalZ(); }
+      template<bool pre> inline float_type local_x(const Step* s) { return pre ? s->preLocalX() : s->postLocalX(); }
+      template<bool pre> inline float_type local_y(const Step* s) { return pre ? s->preLocalY() : s->postLocalY(); }
+      template<bool pre> inline float_type local_z(const Step* s) { return pre ? s->preLocalZ() : s->postLocalZ(); }
+      template<bool pre> inline float_type px(const Step* s) { return pre ? s->preMomentumX() : s->postMomentumX(); }
+      template<bool pre> inline float_type py(const Step* s) { return pre ? s->preMomentumY() : s->postMomentumY(); }
+      template<bool pre> inline float_type pz(const Step* s) { return pre ? s->preMomentumZ() : s->postMomentumZ(); }
+      template<bool pre> inline float_type mom(const Step* s)
+      {
+        const float * p = pre ? s->preMomentumArray() : s->postMomentumArray();
+        return std::sqrt(double(p[0])*p[0]+double(p[1])*p[1]+double(p[2])*p[2]);
+      }
+      template<bool pre> inline int_type at_voledge(const Step* s) { return pre ? s->preAtVolEdge() : s->postAtVolEdge(); }
+      template<bool pre> inline str_type process_defined_step(const Step* s) { return pre ? s->preProcessDefinedStep() : s->postProcessDefinedStep(); }
+
+    }
+
+  }
+
+}
+
+#endif
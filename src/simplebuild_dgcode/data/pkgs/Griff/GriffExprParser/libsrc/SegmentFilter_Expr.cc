@@ -0,0 +1,9 @@
+#include "GriffExprParser/SegmentFilter_Expr.hh"
+
+GriffExprParser::SegmentFilter_Expr::SegmentFilter_Expr(const str_type& expression)
+  : m_expr(expression),
+    m_eval(m_builder.createEvaluator<bool>(expression))
+{
+  if (m_builder.usesStepData())
+    EXPRPARSER_THROW(ParseError,"segment filter expressions can not refer to step.xxx variables");
+}
@@ -0,0 +1,7 @@
+#include "GriffExprParser/StepFilter_Expr.hh"
+
+GriffExprParser::StepFilter_Expr::StepFilter_Expr(const str_type& expression)
+  : m_expr(expression),
+    m_eval(m_builder.createEvaluator<bool>(expression))
+{
+}
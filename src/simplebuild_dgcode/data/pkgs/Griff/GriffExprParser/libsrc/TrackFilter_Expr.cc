@@ -0,0 +1,9 @@
+#include "GriffExprParser/TrackFilter_Expr.hh"
+
+GriffExprParser::TrackFilter_Expr::TrackFilter_Expr(const str_type& expression)
+  : m_expr(expression),
+    m_eval(m_builder.createEvaluator<bool>(expression))
+{
+  if (m_builder.usesSegmentData())
+    EXPRPARSER_THROW(ParseError,"track filter expressions can only refer to trk.xxx variables");
+}
@@ -0,0 +1,225 @@
+#include "GriffFormat/Format.hh"
+#include "EvtFile/FileReader.hh"
+#include "EvtFile/FileWriter.hh"
+#include "ZLibUtils/Compress.hh"
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+  int usage(const char * progname, const char * errmsg)
+  {
+    if (errmsg) {
+      printf("ERROR: %s\n\nRun with -h or --help for usage information\n",errmsg);
+      return 1;
+    }
+    const char * p = std::strrchr(progname,'/');
+    progname = p ? p + 1 : progname;
+    printf("\nUsage:\n\n  %s [options] GRIFFOUTPUT GRIFFINPUT\n\n"
+           "Rewrites the events of GRIFFINPUT into a new file GRIFFOUTPUT, compressing\n"
+           "their full (step) data with a dictionary trained on the first events. This\n"
+           "typically makes files with many small events considerably smaller, at no\n"
+           "cost when reading them. The sizes of the full data in the two files are\n"
+           "reported.\n"
+           "\nOptions:\n\n"
+           "  -h, --help     : Show this usage information.\n"
+           "  --train=N      : Train the dictionary on the first N events (default 100).\n"
+           "  --dictsize=B   : Maximal size of the dictionary in bytes (default 16384).\n"
+           "  --dict=FILE    : Instead of training a dictionary, use the one stored in\n"
+           "                   the Griff file FILE. Rewriting several files with the same\n"
+           "                   dictionary allows sb_griffformat_merge to copy their\n"
+           "                   events without recompressing them.\n"
+           "  --nodict       : Do not use a dictionary (e.g. to convert files back to a\n"
+           "                   format readable by older releases).\n"
+           "  --timing       : Also report the time needed to decompress the full data\n"
+           "                   in the two files.\n"
+           "\nExamples:\n\n"
+           "  %s small.griff sim.griff\n"
+           "  %s small.griff sim.griff --train=1000 --dictsize=32768\n"
+           "  %s small2.griff sim2.griff --dict=small.griff\n\n",
+           progname,progname,progname,progname);
+    return 0;
+  }
+
+  bool parseUInt(const std::string& s, std::uint64_t& val)
+  {
+    if (s.empty()||s.size()>9||s.find_first_not_of("0123456789")!=std::string::npos)
+      return false;
+    val = std::stoull(s);
+    return true;
+  }
+
+  struct FullDataStats {
+    std::uint64_t nevents = 0;
+    std::uint64_t nbytes = 0;
+    std::uint64_t nbytes_ondisk = 0;
+    double seconds = 0.0;
+  };
+
+  //Read (and decompress) the full data sections of all events in a file:
+  bool readFullData(const std::string& filename, FullDataStats& st)
+  {
+    EvtFile::FileReader fr(GriffFormat::Format::getFormat(),filename.c_str());
+    if (!fr.init())
+      return false;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (;fr.eventActive();fr.goToNextEvent()) {
+      ++st.nevents;
+      st.nbytes_ondisk += fr.nBytesFullDataOnDisk();
+      if (fr.nBytesFullDataOnDisk()&&!fr.getFullData())
+        return false;
+      st.nbytes += fr.nBytesFullData();
+    }
+    st.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+    return !fr.bad();
+  }
+
+  void printStats(const char * label, const std::string& filename, const FullDataStats& st, bool timing)
+  {
+    printf("  %-6s: %llu events, full data %llu bytes compressed to %llu bytes (%.1f%%)\n",
+           label,(unsigned long long)st.nevents,(unsigned long long)st.nbytes,
+           (unsigned long long)st.nbytes_ondisk,st.nbytes?100.0*st.nbytes_ondisk/st.nbytes:0.0);
+    if (timing)
+      printf("          decompression of full data in %s: %.3f s (%.1f MB/s)\n",filename.c_str(),
+             st.seconds,st.nbytes*1e-6/(st.seconds>0.0?st.seconds:1e-9));
+  }
+
+}
+
+int main(int argc,char** argv) {
+  std::uint64_t ntrain = 100;
+  std::uint64_t dictsize = 16384;
+  bool nodict = false;
+  std::string dictfile;
+  bool timing = false;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a(argv[i]);
+    if (a=="-h"||a=="--help") {
+      return usage(argv[0],nullptr);
+    } else if (a=="--nodict") {
+      nodict = true;
+    } else if (a=="--timing") {
+      timing = true;
+    } else if (a.compare(0,8,"--train=")==0) {
+      if (!parseUInt(a.substr(8),ntrain)||!ntrain)
+        return usage(argv[0],"Invalid number of training events");
+    } else if (a.compare(0,7,"--dict=")==0) {
+      dictfile = a.substr(7);
+      if (dictfile.empty())
+        return usage(argv[0],"Missing file name for --dict");
+    } else if (a.compare(0,11,"--dictsize=")==0) {
+      if (!parseUInt(a.substr(11),dictsize)||dictsize<256||dictsize>32768)
+        return usage(argv[0],"Invalid dictionary size (must be from 256 to 32768 bytes)");
+    } else if (!a.empty()&&a[0]=='-') {
+      return usage(argv[0],"Unrecognised option");
+    } else if (!a.empty()) {
+      files.push_back(a);
+    }
+  }
+  if (files.size()!=2)
+    return usage(argv[0],"Must specify output and input files");
+  std::string output = files.at(0);
+  const std::string input = files.at(1);
+  const std::string ext = GriffFormat::Format::getFormat()->fileExtension();
+  if (output.size()<ext.size()||output.compare(output.size()-ext.size(),ext.size(),ext)!=0)
+    output += ext;
+  if (output==input)
+    return usage(argv[0],"Output file is also given as input");
+  if (nodict&&!dictfile.empty())
+    return usage(argv[0],"Options --nodict and --dict can not be combined");
+
+  std::string dict;
+  if (!dictfile.empty()) {
+    EvtFile::FileReader frdict(GriffFormat::Format::getFormat(),dictfile.c_str());
+    if (!frdict.init()) {
+      printf("ERROR: Problems opening %s (%s)\n",dictfile.c_str(),frdict.bad_reason());
+      return 1;
+    }
+    dict = frdict.compressionDictionary();
+    if (dict.empty()) {
+      printf("ERROR: No compression dictionary in %s\n",dictfile.c_str());
+      return 1;
+    }
+  }
+
+  EvtFile::FileReader fr(GriffFormat::Format::getFormat(),input.c_str());
+  if (!fr.init()) {
+    printf("ERROR: Problems opening %s (%s)\n",input.c_str(),fr.bad_reason());
+    return 1;
+  }
+  if (!fr.eventActive()) {
+    printf("ERROR: No events in %s\n",input.c_str());
+    return 1;
+  }
+
+  std::uint64_t nevents = 0;
+  try {
+    EvtFile::FileWriter fw(GriffFormat::Format::getFormat(),output.c_str());
+    if (!fw.ok()) {
+      printf("ERROR: Problems opening output file %s\n",output.c_str());
+      return 1;
+    }
+    if (!dict.empty())
+      fw.setCompressionDictionary(dict);
+    else if (!nodict)
+      fw.trainCompressionDictionary(ntrain,dictsize);
+    std::vector<char> db;
+    for (;fr.eventActive();fr.goToNextEvent()) {
+      if (!fr.verifyEventDataIntegrity()) {
+        printf("ERROR: Data integrity check failed in input data on event #%llu\n",
+               (unsigned long long)nevents);
+        return 1;
+      }
+      if (fr.nBytesSharedDataInEvent()) {
+        fr.getSharedDataInEvent(db);
+        fw.writeDataDBSection(db.data(),db.size());
+      }
+      if (fr.nBytesBriefData())
+        fw.writeDataBriefSection(fr.getBriefData(),fr.nBytesBriefData());
+      if (fr.nBytesFullData())
+        fw.writeDataFullSection(fr.getFullData(),fr.nBytesFullData());
+      fw.flushEventToDisk(fr.runNumber(),fr.eventNumber());
+      ++nevents;
+    }
+    if (fr.bad()) {
+      printf("ERROR: Problems reading %s (%s)\n",input.c_str(),fr.bad_reason());
+      return 1;
+    }
+    fw.close();
+    if (!dict.empty()) {
+      printf("Used compression dictionary of %u bytes (id 0x%08x) from %s\n",
+             (unsigned)dict.size(),(unsigned)ZLibUtils::dictionaryID(dict.data(),dict.size()),
+             dictfile.c_str());
+    } else if (!nodict) {
+      const std::string& trained = fw.compressionDictionary();
+      if (trained.empty())
+        printf("Warning: No dictionary used, since the events have too little full data in common\n");
+      else
+        printf("Trained compression dictionary of %u bytes (id 0x%08x) on the first %llu events\n",
+               (unsigned)trained.size(),(unsigned)ZLibUtils::dictionaryID(trained.data(),trained.size()),
+               (unsigned long long)std::min(ntrain,nevents));
+    }
+  } catch (std::exception& e) {
+    printf("ERROR: %s\n",e.what());
+    return 1;
+  }
+  fr.close();
+
+  FullDataStats st_in, st_out;
+  if (!readFullData(input,st_in)||!readFullData(output,st_out)||st_out.nevents!=nevents) {
+    printf("ERROR: Problems reading back the full data\n");
+    return 1;
+  }
+  printf("Wrote %llu events to %s\n",(unsigned long long)nevents,output.c_str());
+  printStats("Input",input,st_in,timing);
+  printStats("Output",output,st_out,timing);
+  return 0;
+}
@@ -0,0 +1,133 @@
+#include "GriffFormat/Merge.hh"
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+  int usage(const char * progname, const char * errmsg)
+  {
+    if (errmsg) {
+      printf("ERROR: %s\n\nRun with -h or --help for usage information\n",errmsg);
+      return 1;
+    }
+    const char * p = std::strrchr(progname,'/');
+    progname = p ? p + 1 : progname;
+    printf("\nUsage:\n\n  %s [options] GRIFFOUTPUT GRIFFINPUT1 [GRIFFINPUT2 ...]\n\n"
+           "Merges the events of the GRIFFINPUT files (e.g. the per-process files from\n"
+           "a job using multi-processing) into a single new file GRIFFOUTPUT. Event\n"
+           "data is copied as it is, and only the shared data (volumes, materials,\n"
+           "processes, particle types, metadata) is consolidated.\n"
+           "\nOptions:\n\n"
+           "  -h, --help       : Show this usage information.\n"
+           "  -jN, --threads=N : Use N threads for reading input files (default is one\n"
+           "                     per input file, up to the number of cores).\n"
+           "  --noverify       : Do not verify event checksums of input files (faster).\n"
+           "  --events=RANGES  : Only copy events with the given indices, counting all\n"
+           "                     events in all input files in order (starting from 0).\n"
+           "                     RANGES is a comma separated list of indices or ranges\n"
+           "                     like 100-199 (inclusive).\n"
+           "  -q, --quiet      : Less output.\n"
+           "\nExamples:\n\n"
+           "  %s merged.griff job_*.griff\n"
+           "  %s first_events.griff merged.griff --events=0-99\n\n",
+           progname,progname,progname);
+    return 0;
+  }
+
+  bool parseUInt(const std::string& s, std::uint64_t& val)
+  {
+    if (s.empty()||s.find_first_not_of("0123456789")!=std::string::npos)
+      return false;
+    try {
+      val = std::stoull(s);
+    } catch (std::exception&) {
+      return false;
+    }
+    return true;
+  }
+
+  bool parseRanges(const std::string& s, std::vector<std::pair<std::uint64_t,std::uint64_t>>& ranges)
+  {
+    std::size_t pos = 0;
+    while (pos<=s.size()) {
+      std::size_t end = s.find(',',pos);
+      if (end==std::string::npos)
+        end = s.size();
+      const std::string r = s.substr(pos,end-pos);
+      const std::size_t dash = r.find('-');
+      std::uint64_t a, b;
+      if (dash==std::string::npos) {
+        if (!parseUInt(r,a))
+          return false;
+        b = a;
+      } else if (!parseUInt(r.substr(0,dash),a)||!parseUInt(r.substr(dash+1),b)||b<a) {
+        return false;
+      }
+      ranges.emplace_back(a,b);
+      pos = end+1;
+    }
+    return !ranges.empty();
+  }
+
+}
+
+int main(int argc,char** argv) {
+  GriffFormat::MergeOptions opt;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a(argv[i]);
+    std::uint64_t n;
+    if (a=="-h"||a=="--help") {
+      return usage(argv[0],nullptr);
+    } else if (a=="-q"||a=="--quiet") {
+      opt.verbose = false;
+    } else if (a=="--noverify") {
+      opt.verify = false;
+    } else if (a.compare(0,2,"-j")==0||a.compare(0,10,"--threads=")==0) {
+      if (!parseUInt(a.substr(a[1]=='j'?2:10),n)||n>1024)
+        return usage(argv[0],"Invalid number of threads");
+      opt.nthreads = n;
+    } else if (a.compare(0,9,"--events=")==0) {
+      if (!parseRanges(a.substr(9),opt.selection))
+        return usage(argv[0],"Invalid event ranges");
+    } else if (!a.empty()&&a[0]=='-') {
+      return usage(argv[0],"Unrecognised option");
+    } else if (!a.empty()) {
+      files.push_back(a);
+    }
+  }
+  if (files.size()<2)
+    return usage(argv[0],"Missing output and input files");
+
+  const std::string output = files.front();
+  files.erase(files.begin());
+  for (auto& f : files) {
+    if (f==output||f==output+".griff")
+      return usage(argv[0],"Output file is also given as input");
+  }
+
+  GriffFormat::MergeStats stats;
+  try {
+    stats = GriffFormat::mergeFiles(files,output,opt);
+  } catch (std::runtime_error& e) {
+    printf("ERROR: %s\n",e.what());
+    return 1;
+  }
+
+  printf("Wrote %llu of %llu events from %i input file%s into %s (%.3g MB)\n",
+         (unsigned long long)stats.nevents_written,(unsigned long long)stats.nevents_read,
+         (int)files.size(),files.size()==1?"":"s",output.c_str(),stats.nbytes_written*1e-6);
+  if (opt.verbose)
+    printf("  Events copied unmodified: %llu, with updated indices: %llu, with updated and recompressed step data: %llu\n",
+           (unsigned long long)stats.nevents_raw,(unsigned long long)stats.nevents_rehashed,
+           (unsigned long long)stats.nevents_recompressed);
+  if (stats.npdgconflicts)
+    printf("WARNING: Input files have different particle properties for some PDG codes (e.g. from different"
+           " Geant4 versions). Those of the first definition are used in the output for all events.\n");
+  return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef GriffFormat_Merge_hh
+#define GriffFormat_Merge_hh
+
+//Merging of .griff files, like the per-process files produced by jobs using
+//multi-processing or by jobs running on a cluster, into a single file. Events
+//are copied from the input files in order, and can optionally be selected by
+//their index, so this can also be used for extracting events from a file.
+//
+//The brief and compressed full data sections of events are copied byte for
+//byte, and only the shared-data (DB) sections are rewritten so they fill a
+//single consolidated DB in the output file. Since the brief and full data
+//sections refer to volumes, processes and metadata by their index in the DB,
+//they must be updated if the consolidated DB ends up assigning different
+//indices than the DB of an input file (which is not the case for the first
+//file, nor for files from jobs with the same setup). Only if process indices
+//change is it necessary to decompress and recompress full data sections. The
+//same goes for input files whose full data sections were compressed with
+//another dictionary (see EvtFile::FileWriter::setCompressionDictionary) than
+//the first input file, whose dictionary is used for the output.
+//
+//Particle properties are stored once per PDG code in a Griff file. If input
+//files have different properties for the same code (e.g. when produced with
+//different Geant4 versions), those of the first input file are used for all
+//events, and the number of ignored definitions is reported in MergeStats.
+//
+//Input files are read (and by default verified against event checksums) in
+//parallel by a pool of threads, while the calling thread consolidates the
+//DB's and writes the output.
+
+#include "Core/Types.hh"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace GriffFormat {
+
+  struct MergeOptions {
+    //Threads reading input files (0: one per input file, up to the number of
+    //cores):
+    unsigned nthreads = 0;
+    //Recalculate and check the checksum of all input events (this requires
+    //decompression of full data sections):
+    bool verify = true;
+    //Only copy events whose index is in one of these inclusive ranges (counting
+    //all events in all input files, starting at 0). Empty means all events:
+    std::vector<std::pair<std::uint64_t,std::uint64_t>> selection;
+    //Print a line for each input file:
+    bool verbose = true;
+  };
+
+  struct MergeStats {
+    std::uint64_t nevents_read = 0;
+    std::uint64_t nevents_written = 0;
+    std::uint64_t nevents_raw = 0;//copied byte for byte, checksum included
+    std::uint64_t nevents_rehashed = 0;//DB or brief data changed, full data copied compressed
+    std::uint64_t nevents_recompressed = 0;//full data had to be decompressed and recompressed (remapped or other dictionary)
+    std::uint64_t nbytes_read = 0;
+    std::uint64_t nbytes_written = 0;
+    std::uint64_t npdgconflicts = 0;//ignored particle definitions differing from the kept one for the same PDG code
+  };
+
+  //Merge inputs into output (the .griff extension is appended if missing). As
+  //with other Griff files, it is an error to produce an output without events,
+  //since it would not even contain metadata. Throws std::runtime_error in case
+  //of problems (unreadable or corrupted input files, checksum errors, ...):
+  MergeStats mergeFiles( const std::vector<std::string>& inputs,
+                         const std::string& output,
+                         const MergeOptions& = MergeOptions() );
+
+}
+
+#endif
@@ -0,0 +1,750 @@
+#include "GriffFormat/Merge.hh"
+#include "GriffFormat/Format.hh"
+#include "GriffFormat/ParticleDefinition.hh"
+#include "EvtFile/FileReader.hh"
+#include "EvtFile/FileWriter.hh"
+#include "ZLibUtils/Compress.hh"
+#include "Utils/DynBuffer.hh"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
+#include <deque>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <cassert>
+
+namespace GriffFormat {
+
+  namespace {
+
+    using EvtFile::index_type;
+    typedef GriffFormat::Format F;
+
+    template<class T>
+    inline T peek(const char* data) { T t; std::memcpy(&t,data,sizeof(T)); return t; }
+    template<class T>
+    inline void poke(char* data, const T& t) { std::memcpy(data,&t,sizeof(T)); }
+
+    //The DB subsections, in an order where entries only refer to entries in
+    //earlier subsections:
+    enum Cat { C_VOLNAMES, C_MATNAMES, C_ELEMNAMES, C_ISONAMES, C_PROCNAMES,
+               C_PDGNAMES, C_PDGTYPES, C_PDGSUBTYPES, C_MDSTRINGS,
+               C_ISOTOPES, C_ELEMENTS, C_MATERIALS, C_TOUCHABLES, C_METADATA,
+               C_PDGCODES, NCAT };
+    const unsigned NCAT_STRINGS = C_MDSTRINGS + 1;
+    const EvtFile::subsectid_type cat_subsectid[NCAT] = {
+      F::subsectid_volnames, F::subsectid_materialnames, F::subsectid_elementnames,
+      F::subsectid_isotopenames, F::subsectid_procnames, F::subsectid_pdgnames,
+      F::subsectid_pdgtypes, F::subsectid_pdgsubtypes, F::subsectid_metadatastrings,
+      F::subsectid_isotopes, F::subsectid_elements, F::subsectid_materials,
+      F::subsectid_touchables, F::subsectid_metadata, F::subsectid_pdgcodes };
+
+    //Volume indices share their word in the brief data with three flags:
+    const index_type VOLIDX_MASK = 0x1FFFFFFF;
+
+    struct Event {
+      std::uint32_t header[6];//checksum, run, evt and section sizes
+      EvtFile::CheckSumAlgo checksumalgo;
+      std::vector<char> db;
+      std::vector<char> brief;
+      std::vector<char> full_ondisk;
+      Utils::DynBuffer<char> full;//decompressed full data (if full_available)
+      bool full_available = false;
+      bool recompress = false;//full data compressed with another dictionary than the output
+      std::size_t nbytes() const { return 7*sizeof(std::uint32_t)+db.size()+brief.size()+full_ondisk.size(); }
+    };
+    typedef std::unique_ptr<Event> EventPtr;
+
+    class EventQueue {
+      //Events read from one input file, waiting to be written out. To bound
+      //memory usage, the reading thread waits while too much data is queued:
+    public:
+      //Returns false if the merge was aborted:
+      bool push(EventPtr ev)
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock,[this]{ return m_aborted || m_events.empty() || m_nbytes < s_maxbytes; });
+        if (m_aborted)
+          return false;
+        m_nbytes += ev->nbytes();
+        m_events.push_back(std::move(ev));
+        m_cv.notify_all();
+        return true;
+      }
+
+      void finish(std::exception_ptr error)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finished = true;
+        m_error = error;
+        m_cv.notify_all();
+      }
+
+      void abort()
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_aborted = true;
+        m_cv.notify_all();
+      }
+
+      //Returns nullptr when all events in the file were consumed, and rethrows
+      //any exception from the reading thread:
+      EventPtr pop()
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock,[this]{ return m_finished || !m_events.empty(); });
+        if (m_events.empty()) {
+          if (m_error)
+            std::rethrow_exception(m_error);
+          return nullptr;
+        }
+        EventPtr ev = std::move(m_events.front());
+        m_events.pop_front();
+        m_nbytes -= ev->nbytes();
+        m_cv.notify_all();
+        return ev;
+      }
+
+    private:
+      static const std::size_t s_maxbytes = 32*1024*1024;
+      std::mutex m_mutex;
+      std::condition_variable m_cv;
+      std::deque<EventPtr> m_events;
+      std::size_t m_nbytes = 0;
+      bool m_finished = false;
+      bool m_aborted = false;
+      std::exception_ptr m_error;
+    };
+
+    [[noreturn]] void fileError(const std::string& filename, const std::string& what)
+    {
+      throw std::runtime_error("GriffFormat::mergeFiles: "+what+" in file "+filename);
+    }
+
+    void readFile(const std::string& filename, EventQueue& queue, bool verify, const std::string& outdict)
+    {
+      EvtFile::FileReader fr(F::getFormat(),filename.c_str());
+      if (!fr.init())
+        fileError(filename,std::string("Problems opening (")+fr.bad_reason()+")");
+      const bool samedict = fr.compressionDictionary()==outdict;
+      for (;fr.eventActive();fr.goToNextEvent()) {
+        EventPtr ev(new Event);
+        ev->header[0] = fr.eventCheckSum();
+        ev->header[1] = fr.runNumber();
+        ev->header[2] = fr.eventNumber();
+        ev->header[3] = fr.nBytesSharedDataInEvent();
+        ev->header[4] = fr.nBytesBriefData();
+        ev->header[5] = fr.nBytesFullDataOnDisk();
+        ev->checksumalgo = fr.eventCheckSumAlgo();
+        if (ev->header[3])
+          fr.getSharedDataInEvent(ev->db);
+        const char * brief = fr.getBriefData();
+        const char * full = fr.getFullDataOnDisk();
+        if (fr.bad()||(ev->header[4]&&!brief)||(ev->header[5]&&!full))
+          fileError(filename,"Problems reading event data");
+        ev->brief.assign(brief,brief+ev->header[4]);
+        ev->full_ondisk.assign(full,full+ev->header[5]);
+        if (verify) {
+          const char * fulldata = fr.getFullData();
+          const unsigned n = fr.nBytesFullData();
+          if (n&&!fulldata)
+            fileError(filename,"Problems reading event data");
+          if (EvtFile::FileWriter::eventCheckSum(ev->checksumalgo,ev->header,ev->db.data(),
+                                                 ev->brief.data(),fulldata,n)!=ev->header[0])
+            fileError(filename,"Checksum error in event #"+std::to_string(fr.eventIndex()));
+          ev->full.resize_without_init(n);
+          if (n)
+            std::memcpy(ev->full.data(),fulldata,n);
+          ev->full_available = true;
+        }
+        if (!samedict&&ev->header[5]) {
+          //Full data must be recompressed with the dictionary of the output:
+          if (!ev->full_available) {
+            const char * fulldata = fr.getFullData();
+            const unsigned n = fr.nBytesFullData();
+            if (n&&!fulldata)
+              fileError(filename,"Problems reading event data");
+            ev->full.resize_without_init(n);
+            if (n)
+              std::memcpy(ev->full.data(),fulldata,n);
+            ev->full_available = true;
+          }
+          ev->recompress = true;
+        }
+        if (!queue.push(std::move(ev)))
+          return;
+      }
+      if (fr.bad())
+        fileError(filename,std::string("Problems reading (")+fr.bad_reason()+")");
+    }
+
+    struct ConsolidatedDB {
+      //Entries (or strings) in one subsection of the output DB, and the ones
+      //still to be written:
+      std::unordered_map<std::string,index_type> index;
+      std::vector<std::string> pending;
+      std::vector<std::string> pdgdefs;//all particle definitions, by index
+      std::uint64_t npdgconflicts = 0;
+      index_type add(std::string&& entry, bool is_pdg, bool& added)
+      {
+        //PDG codes are not referred to by index, but must be unique. So only
+        //the first definition of each code is kept:
+        std::string key = is_pdg ? entry.substr(offsetof(ParticleDefinition,pdgcode),sizeof(std::int32_t)) : entry;
+        auto res = index.emplace(std::move(key),static_cast<index_type>(index.size()));
+        added = res.second;
+        if (added) {
+          if (index.size() >= EvtFile::INDEX_MAX)
+            throw std::runtime_error("GriffFormat::mergeFiles: Too many entries in output DB");
+          if (is_pdg)
+            pdgdefs.push_back(entry);
+          pending.push_back(std::move(entry));
+        } else if (is_pdg && pdgdefs.at(res.first->second)!=entry) {
+          ++npdgconflicts;
+        }
+        return res.first->second;
+      }
+    };
+
+    struct Ref {
+      std::size_t offset;
+      Cat cat;
+    };
+
+    class Merger {
+    public:
+      Merger(const std::vector<std::string>& inputs, const MergeOptions& opt)
+        : m_inputs(inputs), m_opt(opt)
+      {
+        for (auto& r : m_opt.selection) {
+          if (r.first>r.second)
+            throw std::runtime_error("GriffFormat::mergeFiles: Invalid event range");
+          m_selection_end = std::max(m_selection_end,r.second+1);
+        }
+      }
+
+      MergeStats run(const std::string& output);
+
+    private:
+      const std::vector<std::string>& m_inputs;
+      MergeOptions m_opt;
+      std::uint64_t m_selection_end = 0;
+      MergeStats m_stats;
+      EvtFile::FileWriter * m_fw = nullptr;
+      std::string m_filename;//current input file
+      //Output DB:
+      ConsolidatedDB m_db[NCAT];
+      //Mapping of indices in the DB of the current input file to the output DB:
+      std::vector<index_type> m_map[NCAT];
+      bool m_identity[NCAT];
+      //Buffers:
+      std::vector<std::string> m_items[NCAT];
+      std::vector<Ref> m_refs;
+      std::vector<std::uint32_t> m_nsegs;
+      std::vector<char> m_dbbuf;
+      Utils::DynBuffer<char> m_compressed;
+      ZLibUtils::Compressor m_compressor;
+      ZLibUtils::Decompressor m_decompressor;
+
+      [[noreturn]] void corrupt(const char* what) const { fileError(m_filename,what); }
+      bool selected(std::uint64_t ievt) const;
+      void startFile(const std::string&);
+      void processEvent(Event&, bool selected);
+      void parseDB(const std::vector<char>&);
+      std::size_t entryLayout(Cat, const char* p, const char* end, std::vector<Ref>&) const;
+      bool consolidateDB();
+      bool pendingEmpty() const;
+      void writePendingDB(std::vector<char>&);
+      index_type mapIndex(Cat cat, index_type idx) const
+      {
+        if (idx==EvtFile::INDEX_MAX)
+          return idx;
+        if (idx>=m_map[cat].size())
+          corrupt("Reference to unknown DB entry");
+        return m_map[cat][idx];
+      }
+      bool remap(char * addr, Cat cat) const
+      {
+        const index_type idx = peek<index_type>(addr);
+        const index_type newidx = mapIndex(cat,idx);
+        if (newidx==idx)
+          return false;
+        poke(addr,newidx);
+        return true;
+      }
+      bool remapBrief(std::vector<char>&);
+      bool remapFull(char * data, std::size_t size);
+      void ensureFullData(Event&);
+    };
+
+    bool Merger::selected(std::uint64_t ievt) const
+    {
+      if (m_opt.selection.empty())
+        return true;
+      for (auto& r : m_opt.selection)
+        if (ievt>=r.first&&ievt<=r.second)
+          return true;
+      return false;
+    }
+
+    void Merger::startFile(const std::string& filename)
+    {
+      m_filename = filename;
+      for (unsigned c = 0; c < NCAT; ++c) {
+        m_map[c].clear();
+        m_identity[c] = true;
+      }
+    }
+
+    std::size_t Merger::entryLayout(Cat cat, const char* p, const char* end, std::vector<Ref>& refs) const
+    {
+      //Returns the size of the entry at p and the positions of its references
+      //to other entries:
+      refs.clear();
+      const std::size_t avail = end - p;
+      auto need = [this,avail](std::size_t n) { if (avail<n) corrupt("Truncated DB section"); };
+      auto needVersion0 = [this,&need,p]() {
+        need(sizeof(std::int32_t));
+        if (peek<std::int32_t>(p)!=0)
+          corrupt("Unsupported version of DB entry");
+      };
+      switch (cat) {
+      case C_ISOTOPES:
+        //version, name, Z, N, A, m:
+        needVersion0();
+        need(28);
+        refs.push_back({4,C_ISONAMES});
+        return 28;
+      case C_ELEMENTS: {
+        //version, name, symbol, Z, N, A, natural abundances, n, n*(abundance, isotope):
+        needVersion0();
+        need(44);
+        refs.push_back({4,C_ELEMNAMES});
+        refs.push_back({8,C_ELEMNAMES});
+        const std::size_t n = peek<std::uint32_t>(p+40);
+        need(44+12*n);
+        for (std::size_t i = 0; i < n; ++i)
+          refs.push_back({44+12*i+8,C_ISOTOPES});
+        return 44+12*n;
+      }
+      case C_MATERIALS: {
+        //version, name, 6 doubles, state, n, n*(fraction, element):
+        needVersion0();
+        need(64);
+        refs.push_back({4,C_MATNAMES});
+        const std::size_t n = peek<std::uint32_t>(p+60);
+        need(64+12*n);
+        for (std::size_t i = 0; i < n; ++i)
+          refs.push_back({64+12*i+8,C_ELEMENTS});
+        return 64+12*n;
+      }
+      case C_TOUCHABLES: {
+        //depth, depth*(copy number, volume name, physical volume name, material):
+        need(1);
+        const std::size_t n = peek<std::uint8_t>(p);
+        need(1+16*n);
+        for (std::size_t i = 0; i < n; ++i) {
+          refs.push_back({1+16*i+4,C_VOLNAMES});
+          refs.push_back({1+16*i+8,C_VOLNAMES});
+          refs.push_back({1+16*i+12,C_MATERIALS});
+        }
+        return 1+16*n;
+      }
+      case C_METADATA: {
+        //version, n, n*(key, value):
+        needVersion0();
+        need(8);
+        const std::size_t n = peek<std::uint32_t>(p+4);
+        need(8+8*n);
+        for (std::size_t i = 0; i < n; ++i) {
+          refs.push_back({8+8*i,C_MDSTRINGS});
+          refs.push_back({8+8*i+4,C_MDSTRINGS});
+        }
+        return 8+8*n;
+      }
+      case C_PDGCODES:
+        need(sizeof(ParticleDefinition));
+        refs.push_back({offsetof(ParticleDefinition,nameIdx),C_PDGNAMES});
+        refs.push_back({offsetof(ParticleDefinition,typeIdx),C_PDGTYPES});
+        refs.push_back({offsetof(ParticleDefinition,subTypeIdx),C_PDGSUBTYPES});
+        return sizeof(ParticleDefinition);
+      default:
+        break;
+      };
+      assert(false);
+      return 0;
+    }
+
+    void Merger::parseDB(const std::vector<char>& db)
+    {
+      //Split DB section into the new strings and entries of each subsection:
+      const char * p = db.data();
+      const char * end = p + db.size();
+      auto need = [this,&p,end](std::size_t n) { if (std::size_t(end-p)<n) corrupt("Truncated DB section"); };
+      while (p!=end) {
+        need(sizeof(EvtFile::subsectid_type));
+        const auto id = peek<EvtFile::subsectid_type>(p);
+        p += sizeof(EvtFile::subsectid_type);
+        const Cat cat = Cat(std::find(cat_subsectid,cat_subsectid+NCAT,id)-cat_subsectid);
+        if (cat==NCAT)
+          corrupt("Unknown DB subsection");
+        auto& items = m_items[cat];
+        if (cat<NCAT_STRINGS) {
+          need(2*sizeof(std::uint16_t));
+          if (peek<std::uint16_t>(p)!=0)
+            corrupt("Unsupported version of DB subsection");
+          const unsigned n = peek<std::uint16_t>(p+2);
+          p += 2*sizeof(std::uint16_t);
+          for (unsigned i = 0; i < n; ++i) {
+            need(sizeof(std::uint16_t));
+            const unsigned len = peek<std::uint16_t>(p);
+            p += sizeof(std::uint16_t);
+            need(len);
+            items.emplace_back(p,len);
+            p += len;
+          }
+        } else {
+          //PDG codes have a shorter version field than other entries:
+          const std::size_t nversion = cat==C_PDGCODES ? sizeof(std::uint8_t) : sizeof(std::uint16_t);
+          need(nversion+sizeof(std::uint32_t));
+          if (cat==C_PDGCODES ? peek<std::uint8_t>(p)!=0 : peek<std::uint16_t>(p)!=0)
+            corrupt("Unsupported version of DB subsection");
+          const std::uint32_t n = peek<std::uint32_t>(p+nversion);
+          p += nversion+sizeof(std::uint32_t);
+          for (std::uint32_t i = 0; i < n; ++i) {
+            const std::size_t len = entryLayout(cat,p,end,m_refs);
+            items.emplace_back(p,len);
+            p += len;
+          }
+        }
+      }
+    }
+
+    bool Merger::pendingEmpty() const
+    {
+      for (unsigned c = 0; c < NCAT; ++c)
+        if (!m_db[c].pending.empty())
+          return false;
+      return true;
+    }
+
+    bool Merger::consolidateDB()
+    {
+      //Adds the parsed entries to the output DB and extends the mappings of
+      //indices. Returns true if the pending output DB will be exactly the DB
+      //section of the input event (all entries new, and assigned the same
+      //indices), so it can be used verbatim:
+      bool verbatim = pendingEmpty();
+      for (unsigned c = 0; c < NCAT; ++c) {
+        const Cat cat = Cat(c);
+        for (auto& item : m_items[c]) {
+          if (cat>=NCAT_STRINGS) {
+            entryLayout(cat,item.data(),item.data()+item.size(),m_refs);
+            for (auto& r : m_refs)
+              remap(&item[r.offset],r.cat);
+          }
+          const index_type inidx = static_cast<index_type>(m_map[c].size());
+          bool added;
+          const index_type outidx = m_db[c].add(std::move(item),cat==C_PDGCODES,added);
+          m_map[c].push_back(outidx);
+          if (outidx!=inidx)
+            m_identity[c] = false;
+          if (!added||outidx!=inidx)
+            verbatim = false;
+        }
+        m_items[c].clear();
+      }
+      return verbatim;
+    }
+
+    void Merger::writePendingDB(std::vector<char>& out)
+    {
+      out.clear();
+      auto put = [&out](const void* data, std::size_t n)
+      {
+        out.insert(out.end(),static_cast<const char*>(data),static_cast<const char*>(data)+n);
+      };
+      for (unsigned c = 0; c < NCAT; ++c) {
+        auto& pending = m_db[c].pending;
+        if (pending.empty())
+          continue;
+        if (c<NCAT_STRINGS) {
+          //String counts are 16 bit, so write in several chunks if needed:
+          for (std::size_t i = 0; i < pending.size(); i += UINT16_MAX-1) {
+            const std::uint16_t n = std::min<std::size_t>(pending.size()-i,UINT16_MAX-1);
+            const std::uint16_t header[3] = { cat_subsectid[c], 0, n };
+            put(header,sizeof(header));
+            for (std::size_t j = i; j < i+n; ++j) {
+              const std::uint16_t len = pending[j].size();
+              put(&len,sizeof(len));
+              put(pending[j].data(),len);
+            }
+          }
+        } else {
+          put(&cat_subsectid[c],sizeof(EvtFile::subsectid_type));
+          if (c==C_PDGCODES) {
+            const std::uint8_t version = 0;
+            put(&version,sizeof(version));
+          } else {
+            const std::uint16_t version = 0;
+            put(&version,sizeof(version));
+          }
+          const std::uint32_t n = pending.size();
+          put(&n,sizeof(n));
+          for (auto& e : pending)
+            put(e.data(),e.size());
+        }
+        pending.clear();
+      }
+    }
+
+    bool Merger::remapBrief(std::vector<char>& brief)
+    {
+      //Updates the indices of metadata, creator processes and volumes in the
+      //brief data section. Returns true if anything changed:
+      if (m_identity[C_METADATA]&&m_identity[C_PROCNAMES]&&m_identity[C_TOUCHABLES])
+        return false;
+      char * data = brief.data();
+      const std::size_t size = brief.size();
+      std::size_t pos = 0;
+      auto need = [this,&pos,size](std::size_t n) { if (size-pos<n) corrupt("Truncated brief data section"); };
+      need(F::SIZE_TRACKHEADER);
+      bool changed = remap(data+8,C_METADATA);
+      const std::uint32_t ntracks = peek<std::uint32_t>(data+12);
+      pos = F::SIZE_TRACKHEADER;
+      m_nsegs.clear();
+      for (std::uint32_t i = 0; i < ntracks; ++i) {
+        need(F::SIZE_PER_TRACK_WO_DAUGHTERLIST);
+        changed |= remap(data+pos+12,C_PROCNAMES);
+        m_nsegs.push_back(peek<std::uint32_t>(data+pos+20));
+        const std::size_t ndaughters = peek<std::uint32_t>(data+pos+24);
+        pos += F::SIZE_PER_TRACK_WO_DAUGHTERLIST;
+        need(ndaughters*F::SIZE_PER_DAUGHTERLIST_ENTRY);
+        pos += ndaughters*F::SIZE_PER_DAUGHTERLIST_ENTRY;
+      }
+      for (auto nseg : m_nsegs) {
+        for (std::uint32_t j = 0; j < nseg; ++j) {
+          need(F::SIZE_PER_SEGMENT);
+          const index_type volinfo = peek<index_type>(data+pos+16);
+          const index_type volidx = volinfo & VOLIDX_MASK;
+          const index_type newvolidx = mapIndex(C_TOUCHABLES,volidx);
+          if (newvolidx!=volidx) {
+            if (newvolidx>VOLIDX_MASK)
+              throw std::runtime_error("GriffFormat::mergeFiles: Too many volumes in output DB");
+            poke(data+pos+16,index_type((volinfo&~VOLIDX_MASK)|newvolidx));
+            changed = true;
+          }
+          pos += F::SIZE_PER_SEGMENT;
+          if (j+1==nseg||(volinfo&0x20000000)) {
+            need(F::SIZE_LAST_SEGMENT_ON_TRACK_EXTRA_SIZE);
+            pos += F::SIZE_LAST_SEGMENT_ON_TRACK_EXTRA_SIZE;
+          }
+        }
+      }
+      if (pos!=size)
+        corrupt("Unexpected size of brief data section");
+      return changed;
+    }
+
+    bool Merger::remapFull(char * data, std::size_t size)
+    {
+      //Updates the indices of the processes defining steps in the (decompressed)
+      //full data section. Returns true if anything changed:
+      const std::size_t stepsize = F::SIZE_STEPPREPOSTPART+F::SIZE_STEPOTHERPART;
+      const std::size_t procoffset = F::SIZE_STEPPREPOSTPART-sizeof(index_type);
+      bool changed = false;
+      std::size_t pos = 0;
+      while (pos<size) {
+        if (size-pos<F::SIZE_STEPHEADER)
+          corrupt("Truncated full data section");
+        const std::size_t nstored = peek<std::uint32_t>(data+pos+4);
+        const std::size_t segsize = F::SIZE_STEPHEADER+nstored*stepsize+F::SIZE_STEPPREPOSTPART;
+        if (size-pos<segsize)
+          corrupt("Truncated full data section");
+        char * point = data+pos+F::SIZE_STEPHEADER;
+        //Pre-step points of stored steps, and post-step point of the last one:
+        for (std::size_t i = 0; i < nstored; ++i, point += stepsize)
+          changed |= remap(point+procoffset,C_PROCNAMES);
+        changed |= remap(point+procoffset,C_PROCNAMES);
+        pos += segsize;
+      }
+      return changed;
+    }
+
+    void Merger::ensureFullData(Event& ev)
+    {
+      if (ev.full_available)
+        return;
+      if (F::getFormat()->compressFullData()) {
+        m_decompressor.decompress(ev.full_ondisk.data(),ev.full_ondisk.size(),ev.full);
+      } else {
+        ev.full.resize_without_init(ev.full_ondisk.size());
+        if (!ev.full_ondisk.empty())
+          std::memcpy(ev.full.data(),ev.full_ondisk.data(),ev.full_ondisk.size());
+      }
+      ev.full_available = true;
+    }
+
+    void Merger::processEvent(Event& ev, bool selected)
+    {
+      parseDB(ev.db);
+      const bool db_verbatim = consolidateDB();
+      if (!selected)
+        return;//new DB entries stay pending until the next selected event
+
+      std::uint32_t header[6];
+      std::copy(ev.header,ev.header+6,header);
+      EvtFile::CheckSumAlgo checksumalgo = ev.checksumalgo;
+      const char * db = ev.db.data();
+      bool db_changed = false;
+      if (db_verbatim) {
+        for (unsigned c = 0; c < NCAT; ++c)
+          m_db[c].pending.clear();
+      } else {
+        writePendingDB(m_dbbuf);
+        db_changed = m_dbbuf!=ev.db;
+        db = m_dbbuf.data();
+        header[3] = m_dbbuf.size();
+      }
+
+      const bool brief_changed = remapBrief(ev.brief);
+
+      bool full_changed = false;
+      const char * full = ev.full_ondisk.data();
+      if ((!m_identity[C_PROCNAMES]||ev.recompress)&&!ev.full_ondisk.empty()) {
+        ensureFullData(ev);
+        full_changed = !m_identity[C_PROCNAMES] && remapFull(ev.full.data(),ev.full.size());
+        full_changed |= ev.recompress;
+        if (full_changed&&F::getFormat()->compressFullData()) {
+          m_compressor.compress(ev.full.data(),ev.full.size(),m_compressed);
+          header[5] = m_compressed.size();
+          full = m_compressed.data();
+        } else if (full_changed) {
+          full = ev.full.data();
+        }
+      }
+
+      if (db_changed||brief_changed||full_changed) {
+        ensureFullData(ev);
+        checksumalgo = m_fw->checkSumAlgo();
+        header[0] = EvtFile::FileWriter::eventCheckSum(checksumalgo,header,db,ev.brief.data(),
+                                                       ev.full.data(),ev.full.size());
+        ++(full_changed ? m_stats.nevents_recompressed : m_stats.nevents_rehashed);
+      } else {
+        ++m_stats.nevents_raw;
+      }
+      m_fw->writeRawEvent(header,checksumalgo,db,ev.brief.data(),full);
+      ++m_stats.nevents_written;
+      m_stats.nbytes_written += 7*sizeof(std::uint32_t)+header[3]+header[4]+header[5];
+    }
+
+    MergeStats Merger::run(const std::string& output)
+    {
+      EvtFile::FileWriter fw(F::getFormat(),output.c_str());
+      if (!fw.ok())
+        throw std::runtime_error("GriffFormat::mergeFiles: Problems opening output file "+output);
+      m_fw = &fw;
+
+      //The output uses the compression dictionary of the first input (if any),
+      //so its events can be copied without recompression:
+      std::string dict;
+      {
+        EvtFile::FileReader fr(F::getFormat(),m_inputs.front().c_str());
+        if (fr.init())
+          dict = fr.compressionDictionary();
+      }
+      if (!dict.empty()) {
+        fw.setCompressionDictionary(dict);
+        m_compressor.setDictionary(dict.data(),dict.size());
+        m_decompressor.setDictionary(dict.data(),dict.size());
+      }
+
+      const std::size_t ninputs = m_inputs.size();
+      std::vector<EventQueue> queues(ninputs);
+      std::atomic<std::size_t> next_input(0);
+      unsigned nthreads = m_opt.nthreads;
+      if (!nthreads)
+        nthreads = std::max<unsigned>(1,std::thread::hardware_concurrency());
+      nthreads = std::min<std::size_t>(nthreads,ninputs);
+
+      //Input files are claimed in order, so the file currently being written
+      //out is always being read:
+      const bool verify = m_opt.verify;
+      auto work = [&]()
+      {
+        std::size_t i;
+        while ((i = next_input++) < ninputs) {
+          try {
+            readFile(m_inputs[i],queues[i],verify,dict);
+            queues[i].finish(nullptr);
+          } catch (...) {
+            queues[i].finish(std::current_exception());
+          }
+        }
+      };
+
+      struct Threads {
+        //Make sure threads are stopped and joined, also in case of exceptions:
+        std::vector<EventQueue>& queues;
+        std::atomic<std::size_t>& next_input;
+        std::vector<std::thread> threads;
+        ~Threads()
+        {
+          next_input = queues.size();
+          for (auto& q : queues)
+            q.abort();
+          for (auto& t : threads)
+            t.join();
+        }
+      } threads{queues,next_input,{}};
+      for (unsigned i = 0; i < nthreads; ++i)
+        threads.threads.emplace_back(work);
+
+      std::uint64_t ievt = 0;
+      for (std::size_t i = 0; i < ninputs; ++i) {
+        startFile(m_inputs[i]);
+        std::uint64_t nfile = 0;
+        while (EventPtr ev = queues[i].pop()) {
+          ++nfile;
+          ++m_stats.nevents_read;
+          m_stats.nbytes_read += ev->nbytes();
+          processEvent(*ev,selected(ievt++));
+          if (m_selection_end&&ievt>=m_selection_end)
+            break;
+        }
+        if (m_opt.verbose) {
+          const std::size_t slash = m_inputs[i].rfind('/');
+          printf("GriffFormat::mergeFiles: Read %llu events from %s\n",(unsigned long long)nfile,
+                 m_inputs[i].c_str()+(slash==std::string::npos?0:slash+1));
+        }
+        if (m_selection_end&&ievt>=m_selection_end)
+          break;
+      }
+
+      fw.close();
+      m_fw = nullptr;
+      m_stats.npdgconflicts = m_db[C_PDGCODES].npdgconflicts;
+      if (!m_stats.nevents_written)
+        throw std::runtime_error("GriffFormat::mergeFiles: No events written to output file "+output);
+      return m_stats;
+    }
+
+  }
+
+  MergeStats mergeFiles( const std::vector<std::string>& inputs,
+                         const std::string& output,
+                         const MergeOptions& options )
+  {
+    if (inputs.empty())
+      throw std::runtime_error("GriffFormat::mergeFiles: No input files");
+    Merger merger(inputs,options);
+    return merger.run(output);
+  }
+
+}
@@ -2,6 +2,7 @@
 
 #include "G4MCPL/G4MCPLUserFlags.hh"
 #include "G4Interfaces/FrameworkGlobals.hh"
+#include "G4Interfaces/ActionProfiler.hh"
 #include "G4Interfaces/GeoConstructBase.hh"
 #include "G4Interfaces/ParticleGenBase.hh"
 #include "G4ExprParser/G4SteppingASTBuilder.hh"
@@ -16,6 +17,11 @@
 #include <stdexcept>
 #include <string.h>
 #include <sstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cstdint>
 
 namespace G4MCPLWriter {
 
@@ -24,6 +30,130 @@ namespace G4MCPLWriter {
   class MCPLSensitiveDetector;
   typedef std::shared_ptr<G4ExprParser::G4SteppingASTBuilder> BuilderPtr;
 
+  BuilderPtr sharedExprBuilder()
+  {
+    //All MCPLWriters in the process share a single builder, so chained writers
+    //on the same volume only need to point it at the current step once, and
+    //their filter and flag expressions share common subexpressions:
+    static std::weak_ptr<G4ExprParser::G4SteppingASTBuilder> s_builder;
+    BuilderPtr b = s_builder.lock();
+    if (!b) {
+      b = std::make_shared<G4ExprParser::G4SteppingASTBuilder>();
+      s_builder = b;
+    }
+    return b;
+  }
+
+  class MCPLBlockWriter {
+  public:
+    //Packs particles into preallocated blocks of blocksize particles. Full
+    //blocks are handed to a background thread which performs the actual
+    //mcpl_add_particle calls (and eventually closes and compresses the file),
+    //while the next block is being filled from the stepping loop. The blocks
+    //form a single-producer/single-consumer ring, and the two threads only
+    //communicate through the atomic counts of blocks submitted and written, so
+    //the stepping loop never takes a lock. It only has to wait (yielding) if
+    //all blocks are still waiting to be written:
+    MCPLBlockWriter(mcpl_outfile_t f, unsigned blocksize)
+      : m_f(f),
+        m_blocksize(blocksize),
+        m_nfill(0),
+        m_nsubmitted(0),
+        m_nwritten(0),
+        m_stop(false),
+        m_gzip(false)
+    {
+      assert(blocksize>0);
+      for (auto& b : m_blocks)
+        b.reset(new mcpl_particle_t[blocksize]);
+      m_fill = m_blocks[0].get();
+      m_thread = std::thread(&MCPLBlockWriter::threadMain,this);
+    }
+
+    ~MCPLBlockWriter()
+    {
+      assert(!m_thread.joinable()&&"MCPLBlockWriter::close not called");
+    }
+
+    void add(const mcpl_particle_t& p)
+    {
+      m_fill[m_nfill++] = p;
+      if (m_nfill==m_blocksize)
+        submit();
+    }
+
+    void close(bool gzip)
+    {
+      if (m_nfill)
+        submit();
+      m_gzip = gzip;
+      m_stop.store(true,std::memory_order_release);
+      m_thread.join();
+    }
+
+  private:
+    static constexpr unsigned nblocks = 4;
+
+    void submit()
+    {
+      //Publish the block being filled, and wait for the next one in the ring
+      //to have been written out before filling it:
+      const std::uint64_t n = m_nsubmitted.load(std::memory_order_relaxed);
+      m_count[n%nblocks] = m_nfill;
+      m_nsubmitted.store(n+1,std::memory_order_release);
+      while (n+1-m_nwritten.load(std::memory_order_acquire)>=nblocks)
+        std::this_thread::yield();
+      m_fill = m_blocks[(n+1)%nblocks].get();
+      m_nfill = 0;
+    }
+
+    void threadMain()
+    {
+      std::uint64_t n = 0;//blocks written
+      unsigned nidle = 0;
+      while (true) {
+        if (m_nsubmitted.load(std::memory_order_acquire)>n) {
+          nidle = 0;
+          const mcpl_particle_t * block = m_blocks[n%nblocks].get();
+          const unsigned count = m_count[n%nblocks];
+          for (unsigned i = 0; i < count; ++i)
+            mcpl_add_particle(m_f,&block[i]);
+          m_nwritten.store(++n,std::memory_order_release);
+          continue;
+        }
+        //Nothing to write. Stop if requested, after checking once more that no
+        //block was submitted before the request:
+        if (m_stop.load(std::memory_order_acquire)) {
+          if (m_nsubmitted.load(std::memory_order_acquire)>n)
+            continue;
+          break;
+        }
+        //Keep checking for a while after writing a block, in case blocks are
+        //filled quickly, before only checking now and then:
+        if (++nidle<1000)
+          std::this_thread::yield();
+        else
+          std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+      if (m_gzip)
+        mcpl_closeandgzip_outfile(m_f);
+      else
+        mcpl_close_outfile(m_f);
+    }
+
+    mcpl_outfile_t m_f;
+    const unsigned m_blocksize;
+    std::unique_ptr<mcpl_particle_t[]> m_blocks[nblocks];
+    unsigned m_count[nblocks];//particles in each submitted block
+    mcpl_particle_t * m_fill;//block being filled (by the stepping loop)
+    unsigned m_nfill;
+    std::atomic<std::uint64_t> m_nsubmitted;
+    std::atomic<std::uint64_t> m_nwritten;
+    std::atomic<bool> m_stop;
+    bool m_gzip;//set before m_stop
+    std::thread m_thread;
+  };
+
   class MCPLOutputMerger {
   public:
     MCPLOutputMerger(MCPLSensitiveDetector* sd) : m_sd(sd) {}
@@ -69,6 +199,7 @@ namespace G4MCPLWriter {
                            double universalweight,
                            bool writeonvolexit,
                            KillStrategy killstrategy,
+                           unsigned blocksize,
                            BuilderPtr builder,
                            EP::Evaluator<bool> filter_evaluator,
                            EP::Evaluator<EP::int_type> flag_evaluator,
@@ -85,10 +216,13 @@ namespace G4MCPLWriter {
         m_opt_writeonvolexit(writeonvolexit),
         m_opt_killstrategy(killstrategy),
         m_opt_universalweight(universalweight),
+        m_opt_blocksize(blocksize),
         m_initialised(false),
         m_closed(false),
         m_om(0),
-        m_comments_and_blobs(comments_and_blobs)
+        m_blockwriter(0),
+        m_comments_and_blobs(comments_and_blobs),
+        m_prof(ActionProfiler::registerAction("MCPLWriter["+thefilename+"]::ProcessHits"))
     {
       std::memset(&m_p,0,sizeof(m_p));
     }
@@ -120,10 +254,16 @@ namespace G4MCPLWriter {
         return;
       m_closed = true;
       assert(m_f.internal);
-      if (!FrameworkGlobals::isForked())
+      const bool gzip = !FrameworkGlobals::isForked();
+      if (m_blockwriter) {
+        m_blockwriter->close(gzip);
+        delete m_blockwriter;
+        m_blockwriter = 0;
+      } else if (gzip) {
         mcpl_closeandgzip_outfile(m_f);
-      else
+      } else {
         mcpl_close_outfile(m_f);
+      }
       m_f.internal = 0;
     }
 
@@ -135,9 +275,22 @@ namespace G4MCPLWriter {
 
     virtual G4bool ProcessHits(G4Step * step,G4TouchableHistory*)
     {
-      if (m_child_sd)
-        m_child_sd->ProcessHits(step,0);
+      //We are the first writer attached to the volume. Point the (shared)
+      //expression builder at the step once for the whole chain:
+      m_expr_builder->setCurrentStep(step);
+      G4bool res = processStep(step);
+      for (MCPLSensitiveDetector * sd = m_child_sd; sd; sd = sd->m_child_sd) {
+        assert(sd->m_expr_builder==m_expr_builder);
+        if (sd->processStep(step))
+          res = true;
+      }
+      return res;
+    }
 
+  private:
+    G4bool processStep(G4Step * step)
+    {
+      ActionProfiler::Scope prof(m_prof);
       if (m_closed)//in case of early abort
         return false;
 
@@ -167,8 +320,7 @@ namespace G4MCPLWriter {
       }
 
       if (accept) {
-        //Check filter:
-        m_expr_builder->setCurrentStep(step);
+        //Check filter (builder already points to step):
         accept = m_eval_filter();
       }
 
@@ -235,7 +387,10 @@ namespace G4MCPLWriter {
         else
           m_p.userflags = G4MCPLUserFlags::getFlags(trk);
       }
-      mcpl_add_particle(m_f,&m_p);
+      if (m_blockwriter)
+        m_blockwriter->add(m_p);
+      else
+        mcpl_add_particle(m_f,&m_p);
 
       //Kill stored steps, unless asked to never kill:
       if (m_opt_killstrategy!=KS_NEVER)
@@ -244,7 +399,6 @@ namespace G4MCPLWriter {
       return true;
     }
 
-  private:
     void initmcpl() {
       assert(!m_initialised);
       m_initialised = true;
@@ -267,6 +421,7 @@ namespace G4MCPLWriter {
       if (m_opt_writepolarisation) mcpl_enable_polarisation(m_f);
       if (m_opt_writeuserflags) mcpl_enable_userflags(m_f);
       if (m_opt_universalweight) mcpl_enable_universal_weight(m_f,m_opt_universalweight);
+      if (m_opt_blocksize) m_blockwriter = new MCPLBlockWriter(m_f,m_opt_blocksize);
 
       if (FrameworkGlobals::isForked()&&FrameworkGlobals::isParent()) {
         m_om = new MCPLOutputMerger(this);
@@ -283,12 +438,15 @@ namespace G4MCPLWriter {
     bool m_opt_writeonvolexit;
     KillStrategy m_opt_killstrategy;
     double m_opt_universalweight;
+    unsigned m_opt_blocksize;
     bool m_initialised;
     bool m_closed;
     mcpl_outfile_t m_f;
     mcpl_particle_t m_p;
     MCPLOutputMerger * m_om;
+    MCPLBlockWriter * m_blockwriter;
     std::vector<std::pair<std::string,std::string>> m_comments_and_blobs;
+    ActionProfiler::Entry * m_prof;
   };
 
   void MCPLOutputMerger::merge() {
@@ -320,6 +478,7 @@ namespace G4MCPLWriter {
     bool m_opt_writeonvolexit;
     KillStrategy m_opt_killstrategy;
     double m_opt_universalweight;
+    unsigned m_opt_blocksize;
     BuilderPtr m_expr_builder;
     EP::Evaluator<bool> m_eval_filter;
     EP::Evaluator<EP::int_type> m_eval_flags;
@@ -335,6 +494,9 @@ namespace G4MCPLWriter {
     void setUserFlags(const char * expr) { m_expr_flags = expr; }
     void setKillStrategy(KillStrategy ks) {  m_opt_killstrategy = ks; }
     void setKillStrategyFromString(const char* ks) {  setKillStrategy(ks_from_string(ks)); }
+    //Number of particles per block handed to a background writer thread (0
+    //means writing directly from the stepping loop):
+    void setBlockSize(unsigned n) {  m_opt_blocksize = n; }
 
     MCPLWriter(const char* filename)
       : m_filename(filename),
@@ -344,6 +506,7 @@ namespace G4MCPLWriter {
         m_opt_writeonvolexit(false),
         m_opt_killstrategy(KS_NEVER),
         m_opt_universalweight(0.0),
+        m_opt_blocksize(0),
         m_expr_filter("true"),
         m_vols_all(false),
         m_sd(0)
@@ -373,9 +536,9 @@ namespace G4MCPLWriter {
       if (m_eval_filter.arg()|| m_expr_builder)
         throw std::runtime_error("inithook called more than once");
 
-      m_expr_builder = std::make_shared<G4ExprParser::G4SteppingASTBuilder>();
+      m_expr_builder = sharedExprBuilder();
       try {
-        m_eval_filter = m_expr_builder->createEvaluator<bool>(m_expr_filter);
+        m_eval_filter = m_expr_builder->createSharedEvaluator<bool>(m_expr_filter);
       } catch (EP::InputError& e) {
         printf("\nMCPLWriter ERROR: Invalid filter expression \"%s\"\n",m_expr_filter.c_str());
         printf("MCPLWriter ERROR: %s : %s\n\n",e.epType(),e.epWhat());
@@ -391,7 +554,7 @@ namespace G4MCPLWriter {
 
       try {
         if (!m_expr_flags.empty())
-          m_eval_flags = m_expr_builder->createEvaluator<EP::int_type>(m_expr_flags);
+          m_eval_flags = m_expr_builder->createSharedEvaluator<EP::int_type>(m_expr_flags);
       } catch (EP::InputError& e) {
         printf("\nMCPLWriter ERROR: Invalid expression for user-flas \"%s\"\n",m_expr_flags.c_str());
         printf("MCPLWriter ERROR: %s : %s\n\n",e.epType(),e.epWhat());
@@ -583,6 +746,7 @@ namespace G4MCPLWriter {
                                            m_opt_universalweight,
                                            m_opt_writeonvolexit,
                                            m_opt_killstrategy,
+                                           m_opt_blocksize,
                                            m_expr_builder,
                                            m_eval_filter,
                                            m_eval_flags,
@@ -636,6 +800,7 @@ PYTHON_MODULE( mod )
     .def("setWriteUserFlags",&MCPLWriter::setWriteUserFlags)
     .def("setUniversalWeight",&MCPLWriter::setUniversalWeight)
     .def("setKillStrategy",&MCPLWriter::setKillStrategyFromString)
+    .def("setBlockSize",&MCPLWriter::setBlockSize)
     .def("inithook",&MCPLWriter::inithook)
     ;
 
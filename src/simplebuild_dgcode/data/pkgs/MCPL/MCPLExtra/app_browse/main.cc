@@ -33,7 +33,7 @@ int usage(char**argv,const char* errmsg = 0) {
   }
   printf("Usage:\n"
          "\n"
-         "  %s [-n] MCPLFILE [PLOTEXPR] [where CONDEXPR]\n"
+         "  %s [-n] [-jN] MCPLFILE [PLOTEXPR] [where CONDEXPR]\n"
          "\n"
          "MCPLFILE is the name of an input file in MCPL format which should be examined.\n"
          "To ease working with very large files, one can optionally limit the number of\n"
@@ -53,6 +53,11 @@ int usage(char**argv,const char* errmsg = 0) {
          "If CONDEXPR is provided, only particles for which the provided expression\n"
          "evaluates to true will be considered.\n"
          "\n"
+         "For the standard histograms, specify -jN (or --threads=N) to read the file\n"
+         "just once, while filtering and filling histograms in N threads. The bin\n"
+         "ranges are then chosen from the first particles in the file, so values from\n"
+         "later particles might end up in the underflow and overflow bins.\n"
+         "\n"
          "Examples:\n"
          "1) Simply create and view standard set of histograms for file:\n"
          "   %s myfile.mcpl\n"
@@ -80,6 +85,7 @@ int main(int argc, char** argv) {
     return usage(argv);
 
   bool opt_nographics = false;
+  unsigned opt_threads = 0;
   unsigned long long opt_limit = 0;
   std::string opt_plotexpr;
   std::string opt_condexpr;
@@ -90,6 +96,18 @@ int main(int argc, char** argv) {
     args.erase(std::remove(args.begin(), args.end(), "-n"), args.end());
   }
 
+  for (auto it = args.begin(); it != args.end();) {
+    const std::string& a = *it;
+    if (a.compare(0,2,"-j")!=0&&a.compare(0,10,"--threads=")!=0) {
+      ++it;
+      continue;
+    }
+    const std::string n = a.substr(a[1]=='j'?2:10);
+    if (n.empty()||!Core::contains_only(n, "0123456789")||n.size()>4||!(opt_threads = std::stoul(n)))
+      return usage(argv,"invalid number of threads");
+    it = args.erase(it);
+  }
+
   if (args.empty())
     return usage(argv,"missing filename");
   opt_filename = args.front();
@@ -153,7 +171,10 @@ int main(int argc, char** argv) {
     auto hist = MCPLExtra::mcplHistsFromExpression(opt_filename, opt_plotexpr, opt_condexpr, opt_limit);
     hc.add(hist,"custom");
   } else {
-    MCPLExtra::mcplStdHists( hc, opt_filename, opt_condexpr, opt_limit);
+    MCPLExtra::StdHistsOptions opt;
+    opt.nthreads = opt_threads;
+    auto stats = MCPLExtra::mcplStdHists( hc, opt_filename, opt_condexpr, opt_limit, opt);
+    stats.print();
   }
 
 #define MCPLEXTRA_OUTFILE_NAME "mcpl.shist"
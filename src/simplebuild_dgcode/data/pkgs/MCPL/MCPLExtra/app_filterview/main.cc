@@ -1,9 +1,17 @@
 #include "mcpl.h"
 #include "MCPLExprParser/MCPLASTBuilder.hh"
+#include "MCPLExtra/ParticleBlockReader.hh"
 #include "ExprParser/ASTDebug.hh"
 #include "Core/File.hh"
 #include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 
 //Access hidden function from mcpl.c:
 extern "C"{
@@ -20,11 +28,13 @@ int usage(char ** argv, const char * errmsg = 0)
   pn = pn ? pn + 1 : argv[0];
 
   printf("Usage:\n\n");
-  printf("%s EXPR [MCPLFILE]\n\n",pn);
+  printf("%s [-jN] EXPR [MCPLFILE]\n\n",pn);
   printf("Applies the filter EXPR to the particles in MCPLFILE and\n");
   printf("lists the selected particles thus selected. If no MCPLFILE\n");
   printf("is provided, the compiled abstract-syntax-tree representa-\n");
   printf("tion of EXPR is shown.\n\n");
+  printf("Specify -jN (or --threads=N) to evaluate EXPR in N threads,\n");
+  printf("which is faster for complicated expressions.\n\n");
   printf("Examples:\n\n");
   printf("  %s \"is_neutron && neutron_wl <= 1.8Aa\" myfile.mcpl.gz\n",pn);
   printf("  %s \"is_neutron && inrange(neutron_wl,1.1Aa,1.8Aa)\" myfile.mcpl.gz\n",pn);
@@ -34,14 +44,110 @@ int usage(char ** argv, const char * errmsg = 0)
 }
 
 namespace MCPLFilterFunc {
+
+  //Evaluates the filter in advance in a pool of threads, for blocks of
+  //particles read via separate handles to the file. The particles are thus
+  //read twice, but the listing itself (in mcpl_dump_particles) merely has to
+  //look up the results:
+  class ParallelFilter {
+  public:
+    ParallelFilter(const std::string& filename, const std::string& expr, unsigned nthreads)
+      : m_reader(filename,0,2*nthreads+2)
+    {
+      for (unsigned i = 0; i < nthreads; ++i)
+        m_threads.emplace_back(&ParallelFilter::work,this,expr);
+    }
+
+    ~ParallelFilter()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_aborted = true;
+        m_cv.notify_all();
+      }
+      m_reader.abort();
+      for (auto& t : m_threads)
+        t.join();
+    }
+
+    //Must be called for all particles in order:
+    bool selected(std::uint64_t ipos)
+    {
+      while (ipos >= m_current.first + m_current.selected.size()) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock,[this]{ return m_error || m_done.count(m_inext); });
+        if (m_error)
+          std::rethrow_exception(m_error);
+        m_current = std::move(m_done[m_inext]);
+        m_done.erase(m_inext++);
+        m_cv.notify_all();
+      }
+      return m_current.selected[ipos - m_current.first];
+    }
+
+  private:
+    struct Result {
+      std::uint64_t first = 0;
+      std::vector<char> selected;
+    };
+
+    void work(const std::string& expr)
+    {
+      try {
+        MCPLExprParser::MCPLASTBuilder builder;
+        auto eval_filter = builder.createEvaluator<bool>(expr);
+        while (auto block = m_reader.next()) {
+          Result r;
+          r.first = block->first;
+          r.selected.reserve(block->particles.size());
+          for (const auto& p : block->particles) {
+            builder.setCurrentParticle(&p);
+            r.selected.push_back(eval_filter()?1:0);
+          }
+          const std::uint64_t index = block->index;
+          m_reader.release(block);
+          //Do not get too far ahead of the listing:
+          std::unique_lock<std::mutex> lock(m_mutex);
+          m_cv.wait(lock,[this,index]{ return m_aborted || index < m_inext + s_maxahead; });
+          if (m_aborted)
+            return;
+          m_done[index] = std::move(r);
+          m_cv.notify_all();
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = std::current_exception();
+        m_cv.notify_all();
+      }
+    }
+
+    static const std::uint64_t s_maxahead = 64;
+    MCPLExtra::ParticleBlockReader m_reader;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::map<std::uint64_t,Result> m_done;
+    std::uint64_t m_inext = 0;
+    bool m_aborted = false;
+    std::exception_ptr m_error;
+    Result m_current;
+  };
+
   static MCPLExprParser::MCPLASTBuilder builder;
   static ExprParser::Evaluator<bool> eval_filter;
+  static std::unique_ptr<ParallelFilter> parallel_filter;
   static unsigned long nselected = 0;
   static unsigned long ntested = 0;
   int filterfunc(const mcpl_particle_t * p) {
+    bool sel;
+    if (parallel_filter) {
+      sel = parallel_filter->selected(ntested);
+    } else {
+      builder.setCurrentParticle(p);
+      sel = eval_filter();
+    }
     ++ntested;
-    builder.setCurrentParticle(p);
-    if (eval_filter()) {
+    if (sel) {
       ++nselected;
       return 1;
     }
@@ -59,6 +165,19 @@ int main(int argc,char** argv) {
 
   std::string opt_expr;
   std::string opt_file;
+  unsigned opt_threads = 0;
+
+  for (auto it = args.begin(); it != args.end();) {
+    const std::string& a = *it;
+    if (a.compare(0,2,"-j")!=0&&a.compare(0,10,"--threads=")!=0) {
+      ++it;
+      continue;
+    }
+    const std::string n = a.substr(a[1]=='j'?2:10);
+    if (n.empty()||n.size()>4||n.find_first_not_of("0123456789")!=std::string::npos||!(opt_threads = std::stoul(n)))
+      return usage(argv,"invalid number of threads");
+    it = args.erase(it);
+  }
 
   if (args.size()==2) {
     opt_expr = args[0];
@@ -99,12 +218,20 @@ int main(int argc,char** argv) {
     //the process in case of errors.
     mcpl_file_t mcplfile = mcpl_open_file(opt_file.c_str());
 
+    const auto t0 = std::chrono::steady_clock::now();
+    if (opt_threads)
+      MCPLFilterFunc::parallel_filter.reset(new MCPLFilterFunc::ParallelFilter(opt_file,opt_expr,opt_threads));
     mcpl_dump_particles(mcplfile, 0, 0, MCPLFilterFunc::filterfunc);
+    MCPLFilterFunc::parallel_filter.reset();
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
     printf("Filter \"%s\" selected %lu/%lu particles (%g %%) from the file.\n",
            opt_expr.c_str(),
            MCPLFilterFunc::nselected,
            MCPLFilterFunc::ntested,
            MCPLFilterFunc::nselected*100.0/MCPLFilterFunc::ntested);
+    printf("Processed %lu particles in %.2f s (%.2f Mparticles/s).\n",
+           MCPLFilterFunc::ntested,secs,MCPLFilterFunc::ntested*1e-6/(secs>0.0?secs:1e-9));
+    mcpl_close_file(mcplfile);
   }
 
   return 0;
@@ -5,12 +5,33 @@
 
 namespace MCPLExtra {
 
+  struct StdHistsOptions {
+    //With nthreads=0, the file is read twice in the calling thread: first to
+    //find the ranges of the histograms, then to fill them. Otherwise, it is
+    //read just once by a separate thread, and particles are filtered and filled
+    //into histograms by nthreads worker threads. The ranges are then found from
+    //the first nsample particles passing the filter (values from later
+    //particles falling outside will end up in underflow and overflow bins, but
+    //are still included in the statistics of the histograms):
+    unsigned nthreads = 0;
+    unsigned long long nsample = 200000;
+  };
+
+  struct ReadStats {
+    unsigned long long nparticles_read = 0;
+    unsigned long long nparticles_used = 0;//passing the filter
+    unsigned long long nbytes_read = 0;//uncompressed particle data
+    double seconds = 0.0;
+    void print(const char * prefix = "") const;//throughput report
+  };
+
   //Create standard set of histograms, optionally limiting number of particles
   //read from the file and imposing a filter expression:
-  void mcplStdHists( SimpleHists::HistCollection& hc,
-                     const std::string& filename,
-                     const std::string& filter_expr = "",
-                     unsigned long long max_particles_load = 0 );
+  ReadStats mcplStdHists( SimpleHists::HistCollection& hc,
+                          const std::string& filename,
+                          const std::string& filter_expr = "",
+                          unsigned long long max_particles_load = 0,
+                          const StdHistsOptions& = StdHistsOptions() );
 
   //Same, but create a single histogram given by provided expression (1D hist if
   //single expression, 2D if of the form "<expr1>:<expr2>"):
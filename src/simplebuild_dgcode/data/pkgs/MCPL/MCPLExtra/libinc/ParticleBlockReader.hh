@@ -0,0 +1,81 @@
+#ifndef MCPLExtra_ParticleBlockReader_hh
+#define MCPLExtra_ParticleBlockReader_hh
+
+//Reads the particles of an MCPL file in blocks of consecutive particles, for
+//processing by a pool of threads. The file is split into ranges of particles
+//which are claimed in file order by the threads calling next(..). Each thread
+//then decodes its range via its own handle to the file, so the decoding is done
+//in parallel. Compressed files can not be positioned efficiently, so their
+//ranges are decoded one at a time via a single handle (still in the calling
+//threads). Blocks must be given back via release(..) when processed. Only a
+//fixed number of blocks exist, so next() waits when all are in use, keeping
+//memory usage bounded.
+
+#include "mcpl.h"
+#include "Core/Types.hh"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+namespace MCPLExtra {
+
+  class ParticleBlockReader {
+  public:
+
+    struct Block {
+      std::uint64_t index;//block number, counting from 0
+      std::uint64_t first;//position in file of the first particle in the block
+      std::vector<mcpl_particle_t> particles;
+    };
+
+    //Opens the file (max_particles=0 means all particles in the file):
+    ParticleBlockReader( const std::string& filename,
+                         std::uint64_t max_particles = 0,
+                         unsigned nblocks = 8,
+                         unsigned blocksize = 16384 );
+    ~ParticleBlockReader();//closes the file
+
+    //Header of the file, for use with the mcpl_hdr_xxx functions only:
+    mcpl_file_t file() const { return m_file; }
+
+    //Claim and read the next block (thread-safe), or nullptr when all
+    //particles were read. When called from several threads, the blocks are
+    //not necessarily returned in file order (see Block::index):
+    Block* next();
+
+    //Return block when done with it (thread-safe):
+    void release(Block*);
+
+    //Stop reading, after which next() returns nullptr (thread-safe):
+    void abort();
+
+    //Particles read so far and the corresponding amount of (uncompressed)
+    //particle data:
+    std::uint64_t nParticlesRead() const;
+    std::uint64_t nBytesRead() const;
+
+  private:
+    ParticleBlockReader( const ParticleBlockReader & );
+    ParticleBlockReader & operator= ( const ParticleBlockReader & );
+    std::string m_filename;
+    mcpl_file_t m_file;
+    bool m_compressed;
+    std::uint64_t m_maxparticles;
+    unsigned m_blocksize;
+    std::vector<Block> m_blocks;
+    std::vector<Block*> m_free;
+    std::vector<mcpl_file_t> m_handles;//idle handles for uncompressed files
+    std::vector<mcpl_file_t> m_allhandles;
+    mutable std::mutex m_mutex;
+    std::mutex m_readmutex;//for reading compressed files via m_file
+    std::condition_variable m_cv;
+    std::uint64_t m_nextfirst;
+    std::uint64_t m_nextindex;
+    std::uint64_t m_nread;
+    bool m_aborted;
+  };
+
+}
+
+#endif
@@ -1,8 +1,16 @@
 #include "MCPLExtra/HistCreate.hh"
+#include "MCPLExtra/ParticleBlockReader.hh"
 #include "MCPLExprParser/MCPLASTBuilder.hh"
 #include "mcpl.h"
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include "Utils/NeutronMath.hh"
 #include "Core/String.hh"
 
@@ -113,16 +121,6 @@ namespace MCPLExtra {
     }
   }
 
-  void adjust_booking(unsigned long long nfills, SimpleHists::Hist1D*h) {
-    double a(0.0),b(0.0);
-    if (!h->empty()) {
-      a = h->getMinFilled();
-      b = h->getMaxFilled();
-    }
-    adjust_limits(a,b);
-    h->resetAndRebin(suggest_nbins(nfills), a,b);
-  }
-
   ExprParser::Evaluator<bool> prepareFilter(MCPLExprParser::MCPLASTBuilder& builder,
                                             const std::string& filter_expr)
   {
@@ -136,13 +134,233 @@ namespace MCPLExtra {
     }
     return eval_filter;
   }
+
+  //Quantities in the standard histograms:
+  enum StdVar { SV_EKIN, SV_TIME, SV_POSX, SV_POSY, SV_POSZ, SV_DIRX, SV_DIRY, SV_DIRZ,
+                SV_POLX, SV_POLY, SV_POLZ, SV_USERFLAGS, SV_WEIGHT, SV_NWL, SV_N };
+
+  struct StdHists {
+    SimpleHists::Hist1D * h[SV_N];//polarisation and userflags hists only if in file
+    SimpleHists::HistCounts * h_pdgcode;
+    //Using map, could use sorted vector instead for faster access:
+    std::map<long,SimpleHists::HistCounts::Counter> pdgcounters;
+  };
+
+  void bookStdHists(SimpleHists::HistCollection& hc, StdHists& sh,
+                    bool has_polarisation, bool has_userflags)
+  {
+    auto h = sh.h;
+    std::fill(h,h+SV_N,nullptr);
+    h[SV_EKIN] = hc.book1D("ekin [MeV]", 1, 0.0, 1.0, "ekin");
+    h[SV_TIME] = hc.book1D("time [ms]", 1, 0.0, 1.0, "time");
+    h[SV_POSX] = hc.book1D("X-coordinate of position [cm]", 1, 0.0, 1.0, "posx");
+    h[SV_POSY] = hc.book1D("Y-coordinate of position [cm]", 1, 0.0, 1.0, "posy");
+    h[SV_POSZ] = hc.book1D("Z-coordinate of position [cm]", 1, 0.0, 1.0, "posz");
+    h[SV_DIRX] = hc.book1D("X-coordinate of direction", 1, 0.0, 1.0, "dirx");
+    h[SV_DIRY] = hc.book1D("Y-coordinate of direction", 1, 0.0, 1.0, "diry");
+    h[SV_DIRZ] = hc.book1D("Z-coordinate of direction", 1, 0.0, 1.0, "dirz");
+    if (has_polarisation) {
+      h[SV_POLX] = hc.book1D("X-component of polarisation vector", 1, 0.0, 1.0, "polx");
+      h[SV_POLY] = hc.book1D("Y-component of polarisation vector", 1, 0.0, 1.0, "poly");
+      h[SV_POLZ] = hc.book1D("Z-component of polarisation vector", 1, 0.0, 1.0, "polz");
+    }
+    if (has_userflags) {
+      //often not very useful to plot these, but at least it reminds the user that userflags exists.
+      h[SV_USERFLAGS] = hc.book1D("Userflags (raw integer value)", 1, 0.0, 1.0, "userflags");
+    }
+    h[SV_WEIGHT] = hc.book1D("weight", 1, 0.0, 1.0, "weight");
+    h[SV_NWL] = hc.book1D("Neutron wavelengths [Aa]", 1, 0.0, 1.0, "neutron_wl");
+    sh.h_pdgcode = hc.bookCounts("Particle Type [PDG codes]", "pdgcode");
+  }
+
+  //Final booking, given the ranges of the values filled (0 if none):
+  void bookFinalStdHists(StdHists& sh, unsigned long long nused, unsigned long long nneutrons,
+                         const double (&vmin)[SV_N], const double (&vmax)[SV_N])
+  {
+    for (unsigned i = 0; i < SV_N; ++i) {
+      if (!sh.h[i])
+        continue;
+      double a = vmin[i];
+      double b = vmax[i];
+      if (i==SV_NWL && b>20)
+        b=20.0;
+      adjust_limits(a,b);
+      sh.h[i]->resetAndRebin(suggest_nbins(i==SV_NWL?nneutrons:nused), a,b);
+    }
+  }
+
+  SimpleHists::HistCounts::Counter& pdgCounter(StdHists& sh, long pdgcode)
+  {
+    auto pdgctr = sh.pdgcounters.find(pdgcode);
+    if (pdgctr!=sh.pdgcounters.end())
+      return pdgctr->second;
+    //choose access labels which sorts correctly and contains no forbidden characters
+    std::ostringstream label;
+    label<< "pdg_"<<(pdgcode<0?"minus":"plus")<<std::setfill('0') << std::setw(10)<<(pdgcode<0?-pdgcode:pdgcode);
+    pdgctr = sh.pdgcounters.emplace(pdgcode,sh.h_pdgcode->addCounter(label.str())).first;
+    std::string pname = mini_pdg_database(pdgcode);
+    std::ostringstream displaylabel;
+    if (pname.empty()) {
+      displaylabel << pdgcode;
+    } else {
+      displaylabel << pname;
+    }
+    pdgctr->second.setDisplayLabel(displaylabel.str());
+    return pdgctr->second;
+  }
+
+  double neutronWavelength(double ekin)
+  {
+    return Utils::neutronEKinToWavelength(ekin)/Units::angstrom;
+  }
+
+  void fillStdHists(StdHists& sh, const mcpl_particle_t* p)
+  {
+    auto h = sh.h;
+    h[SV_EKIN]->fill(p->ekin,p->weight);
+    h[SV_POSX]->fill(p->position[0],p->weight);
+    h[SV_POSY]->fill(p->position[1],p->weight);
+    h[SV_POSZ]->fill(p->position[2],p->weight);
+    h[SV_DIRX]->fill(p->direction[0],p->weight);
+    h[SV_DIRY]->fill(p->direction[1],p->weight);
+    h[SV_DIRZ]->fill(p->direction[2],p->weight);
+    if (h[SV_POLX]) {
+      h[SV_POLX]->fill(p->polarisation[0],p->weight);
+      h[SV_POLY]->fill(p->polarisation[1],p->weight);
+      h[SV_POLZ]->fill(p->polarisation[2],p->weight);
+    }
+    if (h[SV_USERFLAGS])
+      h[SV_USERFLAGS]->fill(p->userflags,p->weight);
+    if (p->pdgcode==2112)
+      h[SV_NWL]->fill(neutronWavelength(p->ekin),p->weight);
+    h[SV_TIME]->fill(p->time,p->weight);
+    h[SV_WEIGHT]->fill(p->weight);
+  }
+
+  //Values of particles passing the filter, in columns suitable for
+  //Hist1D::fillMany. The SV_NWL column only has entries for neutrons, with
+  //weights in nwl_weights, and the SV_WEIGHT column has the weights for all
+  //other columns:
+  struct StdHistsColumns {
+    std::vector<double> v[SV_N];
+    std::vector<double> nwl_weights;
+    std::size_t size() const { return v[SV_WEIGHT].size(); }
+    void clear()
+    {
+      for (auto& c : v)
+        c.clear();
+      nwl_weights.clear();
+    }
+  };
+
+  void addToColumns(StdHistsColumns& c, const mcpl_particle_t* p, bool has_polarisation, bool has_userflags)
+  {
+    auto v = c.v;
+    v[SV_EKIN].push_back(p->ekin);
+    v[SV_TIME].push_back(p->time);
+    v[SV_POSX].push_back(p->position[0]);
+    v[SV_POSY].push_back(p->position[1]);
+    v[SV_POSZ].push_back(p->position[2]);
+    v[SV_DIRX].push_back(p->direction[0]);
+    v[SV_DIRY].push_back(p->direction[1]);
+    v[SV_DIRZ].push_back(p->direction[2]);
+    if (has_polarisation) {
+      v[SV_POLX].push_back(p->polarisation[0]);
+      v[SV_POLY].push_back(p->polarisation[1]);
+      v[SV_POLZ].push_back(p->polarisation[2]);
+    }
+    if (has_userflags)
+      v[SV_USERFLAGS].push_back(p->userflags);
+    v[SV_WEIGHT].push_back(p->weight);
+    if (p->pdgcode==2112) {
+      v[SV_NWL].push_back(neutronWavelength(p->ekin));
+      c.nwl_weights.push_back(p->weight);
+    }
+  }
+
+  void fillStdHists(StdHists& sh, const StdHistsColumns& c)
+  {
+    const unsigned n = c.size();
+    const double * w = c.v[SV_WEIGHT].data();
+    for (unsigned i = 0; i < SV_N; ++i) {
+      auto h = sh.h[i];
+      if (!h)
+        continue;
+      if (i==SV_WEIGHT)
+        h->fillMany(w,n);
+      else if (i==SV_NWL)
+        h->fillMany(c.v[i].data(),c.nwl_weights.data(),c.v[i].size());
+      else
+        h->fillMany(c.v[i].data(),w,n);
+    }
+  }
+
+  //Update range of values with positive weight (no weights means all weights
+  //are 1), like the min/max filled values of Hist1D. Uses independent lanes to
+  //allow vectorisation:
+  void updateRange(const double* vals, const double* weights, std::size_t n, double& vmin, double& vmax)
+  {
+    const double inf = std::numeric_limits<double>::infinity();
+    double lo[4] = { vmin, inf, inf, inf };
+    double hi[4] = { vmax, -inf, -inf, -inf };
+    std::size_t i = 0;
+    for (; i+4 <= n; i += 4) {
+      for (unsigned k = 0; k < 4; ++k) {
+        const bool use = !weights || weights[i+k]>0.0;
+        lo[k] = std::min(lo[k],use?vals[i+k]:inf);
+        hi[k] = std::max(hi[k],use?vals[i+k]:-inf);
+      }
+    }
+    for (; i < n; ++i) {
+      const bool use = !weights || weights[i]>0.0;
+      lo[0] = std::min(lo[0],use?vals[i]:inf);
+      hi[0] = std::max(hi[0],use?vals[i]:-inf);
+    }
+    vmin = std::min(std::min(lo[0],lo[1]),std::min(lo[2],lo[3]));
+    vmax = std::max(std::max(hi[0],hi[1]),std::max(hi[2],hi[3]));
+  }
+
+  double secondsSince(std::chrono::steady_clock::time_point t0)
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+  }
+
+  ReadStats mcplStdHistsSerial( SimpleHists::HistCollection& hc,
+                                const std::string& filename,
+                                const std::string& filter_expr,
+                                unsigned long long max_particles_load );
+  ReadStats mcplStdHistsThreaded( SimpleHists::HistCollection& hc,
+                                  const std::string& filename,
+                                  const std::string& filter_expr,
+                                  unsigned long long max_particles_load,
+                                  const StdHistsOptions& opt );
+}
+
+void MCPLExtra::ReadStats::print(const char * prefix) const
+{
+  const double s = seconds > 0.0 ? seconds : 1e-9;
+  printf("%sRead %llu particles (%.1f MB) in %.2f s : %.2f Mparticles/s, %.1f MB/s (%llu particles passed filter)\n",
+         prefix,nparticles_read,nbytes_read*1e-6,seconds,nparticles_read*1e-6/s,nbytes_read*1e-6/s,nparticles_used);
+}
+
+MCPLExtra::ReadStats MCPLExtra::mcplStdHists( SimpleHists::HistCollection& hc,
+                                              const std::string& filename,
+                                              const std::string& filter_expr,
+                                              unsigned long long max_particles_load,
+                                              const StdHistsOptions& opt )
+{
+  if (opt.nthreads)
+    return mcplStdHistsThreaded(hc,filename,filter_expr,max_particles_load,opt);
+  return mcplStdHistsSerial(hc,filename,filter_expr,max_particles_load);
 }
 
-void MCPLExtra::mcplStdHists( SimpleHists::HistCollection& hc,
-                              const std::string& filename,
-                              const std::string& filter_expr,
-                              unsigned long long max_particles_load )
+MCPLExtra::ReadStats MCPLExtra::mcplStdHistsSerial( SimpleHists::HistCollection& hc,
+                                                    const std::string& filename,
+                                                    const std::string& filter_expr,
+                                                    unsigned long long max_particles_load )
 {
+  const auto t0 = std::chrono::steady_clock::now();
+
   //Prepare filter:
   MCPLExprParser::MCPLASTBuilder builder;
   auto eval_filter = prepareFilter(builder,filter_expr);
@@ -153,124 +371,46 @@ void MCPLExtra::mcplStdHists( SimpleHists::HistCollection& hc,
   if (max_particles_load==0)
     max_particles_load = mcpl_hdr_nparticles(f);
   unsigned long long left = max_particles_load;
-  const bool has_userflags = mcpl_hdr_has_userflags(f);
-  const bool has_polarisation = mcpl_hdr_has_polarisation(f);
-
-  auto h_ekin = hc.book1D("ekin [MeV]", 1, 0.0, 1.0, "ekin");
-  auto h_time = hc.book1D("time [ms]", 1, 0.0, 1.0, "time");
-  auto h_posx = hc.book1D("X-coordinate of position [cm]", 1, 0.0, 1.0, "posx");
-  auto h_posy = hc.book1D("Y-coordinate of position [cm]", 1, 0.0, 1.0, "posy");
-  auto h_posz = hc.book1D("Z-coordinate of position [cm]", 1, 0.0, 1.0, "posz");
-  auto h_dirx = hc.book1D("X-coordinate of direction", 1, 0.0, 1.0, "dirx");
-  auto h_diry = hc.book1D("Y-coordinate of direction", 1, 0.0, 1.0, "diry");
-  auto h_dirz = hc.book1D("Z-coordinate of direction", 1, 0.0, 1.0, "dirz");
-  SimpleHists::Hist1D * h_polx(0);
-  SimpleHists::Hist1D * h_poly(0);
-  SimpleHists::Hist1D * h_polz(0);
-  SimpleHists::Hist1D * h_uf(0);
-  if (has_polarisation) {
-    h_polx = hc.book1D("X-component of polarisation vector", 1, 0.0, 1.0, "polx");
-    h_poly = hc.book1D("Y-component of polarisation vector", 1, 0.0, 1.0, "poly");
-    h_polz = hc.book1D("Z-component of polarisation vector", 1, 0.0, 1.0, "polz");
-  }
-  if (has_userflags) {
-    //often not very useful to plot these, but at least it reminds the user that userflags exists.
-    h_uf = hc.book1D("Userflags (raw integer value)", 1, 0.0, 1.0, "userflags");
-  }
-  auto h_weight = hc.book1D("weight", 1, 0.0, 1.0, "weight");
-  auto h_nwl = hc.book1D("Neutron wavelengths [Aa]", 1, 0.0, 1.0, "neutron_wl");
-  auto h_pdgcode = hc.bookCounts("Particle Type [PDG codes]", "pdgcode");
 
-  //Using map, could use sorted vector instead for faster access:
-  std::map<long,SimpleHists::HistCounts::Counter> pdgcounters;
+  StdHists sh;
+  bookStdHists(hc,sh,mcpl_hdr_has_polarisation(f),mcpl_hdr_has_userflags(f));
 
   //Loop through file to collect stats data for limits (despite the overhead, we
   //do it by filling the hists themselves to take advantage of the statistics
   //calculations there):
+  unsigned long long nread(0);
   unsigned long long nused(0);
   unsigned long long nneutrons(0);
   const mcpl_particle_t* p;
   while ( left && (p=mcpl_read(f)) ) {
     --left;
+    ++nread;
     if ( do_filter ) {
       builder.setCurrentParticle(p);
       if ( !eval_filter() )
         continue;
     }
     ++nused;
-    h_ekin->fill(p->ekin,p->weight);
-    h_posx->fill(p->position[0],p->weight);
-    h_posy->fill(p->position[1],p->weight);
-    h_posz->fill(p->position[2],p->weight);
-    h_dirx->fill(p->direction[0],p->weight);
-    h_diry->fill(p->direction[1],p->weight);
-    h_dirz->fill(p->direction[2],p->weight);
-    if (has_polarisation) {
-      h_polx->fill(p->polarisation[0],p->weight);
-      h_poly->fill(p->polarisation[1],p->weight);
-      h_polz->fill(p->polarisation[2],p->weight);
-    }
-    if (has_userflags)
-      h_uf->fill(p->userflags,p->weight);
-
-    int pdgcode = p->pdgcode;
-    auto pdgctr = pdgcounters.find(pdgcode);
-    if (pdgctr==pdgcounters.end()) {
-      //choose access labels which sorts correctly and contains no forbidden characters
-      std::ostringstream label;
-      label<< "pdg_"<<(pdgcode<0?"minus":"plus")<<std::setfill('0') << std::setw(10)<<(pdgcode<0?-pdgcode:pdgcode);
-      pdgcounters[ pdgcode ] = h_pdgcode->addCounter(label.str());
-      pdgctr = pdgcounters.find(pdgcode);
-      std::string pname = mini_pdg_database(pdgcode);
-      std::ostringstream displaylabel;
-      if (pname.empty()) {
-        displaylabel << pdgcode;
-      } else {
-        displaylabel << pname;
-      }
-      pdgctr->second.setDisplayLabel(displaylabel.str());
-    }
-    pdgctr->second += p->weight;
-
-    if (pdgcode==2112) {
+    fillStdHists(sh,p);
+    pdgCounter(sh,p->pdgcode) += p->weight;
+    if (p->pdgcode==2112)
       ++nneutrons;
-      h_nwl->fill(Utils::neutronEKinToWavelength(p->ekin)/Units::angstrom,p->weight);
-    }
-    h_time->fill(p->time,p->weight);
-    h_weight->fill(p->weight);
-
   }
 
   //Now, use stats to perform final booking:
-  adjust_booking(nused,h_ekin);
-  adjust_booking(nused,h_posx);
-  adjust_booking(nused,h_posy);
-  adjust_booking(nused,h_posz);
-  adjust_booking(nused,h_dirx);
-  adjust_booking(nused,h_diry);
-  adjust_booking(nused,h_dirz);
-  if (has_polarisation) {
-    adjust_booking(nused,h_polx);
-    adjust_booking(nused,h_poly);
-    adjust_booking(nused,h_polz);
+  double vmin[SV_N], vmax[SV_N];
+  for (unsigned i = 0; i < SV_N; ++i) {
+    auto h = sh.h[i];
+    vmin[i] = (!h || h->empty()) ? 0.0 : h->getMinFilled();
+    vmax[i] = (!h || h->empty()) ? 0.0 : h->getMaxFilled();
   }
-  if (has_userflags)
-    adjust_booking(nused,h_uf);
-  adjust_booking(nused,h_time);
-  adjust_booking(nused,h_weight);
-
-  double a = h_nwl->empty() ? 0.0 : h_nwl->getMinFilled();
-  double b = h_nwl->empty() ? 0.0 : h_nwl->getMaxFilled();
-  if (b>20)
-    b=20.0;
-  adjust_limits(a,b);
-  h_nwl->resetAndRebin(suggest_nbins(nneutrons), a,b);
+  bookFinalStdHists(sh,nused,nneutrons,vmin,vmax);
 
   //rewind:
   left = max_particles_load;
   mcpl_rewind(f);
 
-  //fill again (fixme: Code copied from above, a bit sloppy!):
+  //fill again:
   while ( left && (p=mcpl_read(f)) ) {
     --left;
     if ( do_filter ) {
@@ -278,27 +418,214 @@ void MCPLExtra::mcplStdHists( SimpleHists::HistCollection& hc,
       if ( !eval_filter() )
         continue;
     }
-    h_ekin->fill(p->ekin,p->weight);
-    h_posx->fill(p->position[0],p->weight);
-    h_posy->fill(p->position[1],p->weight);
-    h_posz->fill(p->position[2],p->weight);
-    h_dirx->fill(p->direction[0],p->weight);
-    h_diry->fill(p->direction[1],p->weight);
-    h_dirz->fill(p->direction[2],p->weight);
-    if (has_polarisation) {
-      h_polx->fill(p->polarisation[0],p->weight);
-      h_poly->fill(p->polarisation[1],p->weight);
-      h_polz->fill(p->polarisation[2],p->weight);
+    fillStdHists(sh,p);
+  }
+
+  sh.h_pdgcode->sortByLabels();
+
+  ReadStats stats;
+  stats.nparticles_read = nread;
+  stats.nparticles_used = nused;
+  stats.nbytes_read = nread * mcpl_hdr_particle_size(f);
+  mcpl_close_file(f);
+  stats.seconds = secondsSince(t0);
+  return stats;
+}
+
+MCPLExtra::ReadStats MCPLExtra::mcplStdHistsThreaded( SimpleHists::HistCollection& hc,
+                                                      const std::string& filename,
+                                                      const std::string& filter_expr,
+                                                      unsigned long long max_particles_load,
+                                                      const StdHistsOptions& opt )
+{
+  //Single pass over the file: The workers decode blocks of particles (see
+  //ParticleBlockReader), filter them and extract the values to fill into
+  //columns. The columns of the first blocks are kept aside until they contain
+  //at least opt.nsample particles, after which the binning is chosen from the
+  //blocks in file order (so the binning does not depend on the scheduling of
+  //the threads). From then on, each worker fills its own clones of the
+  //histograms, which are merged at the end.
+  const auto t0 = std::chrono::steady_clock::now();
+
+  //Check filter expression before starting threads:
+  {
+    MCPLExprParser::MCPLASTBuilder builder;
+    prepareFilter(builder,filter_expr);
+  }
+
+  const unsigned nthreads = opt.nthreads;
+  ParticleBlockReader reader(filename,max_particles_load,2*nthreads+2);
+  const bool has_polarisation = mcpl_hdr_has_polarisation(reader.file());
+  const bool has_userflags = mcpl_hdr_has_userflags(reader.file());
+  const unsigned long long nparticles_total = max_particles_load ? max_particles_load
+                                                                 : mcpl_hdr_nparticles(reader.file());
+
+  StdHists sh;
+  bookStdHists(hc,sh,has_polarisation,has_userflags);
+
+  struct Worker {
+    std::vector<std::unique_ptr<SimpleHists::HistBase>> owned;
+    StdHists sh = StdHists();
+    bool binned = false;
+    unsigned long long nused = 0;
+  };
+  std::vector<Worker> workers(nthreads);
+
+  //Blocks kept aside before the binning is chosen:
+  struct Sample {
+    StdHistsColumns columns;
+    unsigned long long ntested;
+  };
+  std::mutex mutex;
+  bool binned = false;
+  std::map<std::uint64_t,Sample> sample;
+
+  //Choose binning from all sampled blocks up to (but excluding) block
+  //iblock_end. Must be called with the mutex held:
+  auto chooseBinning = [&](std::uint64_t iblock_end, bool complete)
+  {
+    const double inf = std::numeric_limits<double>::infinity();
+    double vmin[SV_N], vmax[SV_N];
+    std::fill(vmin,vmin+SV_N,inf);
+    std::fill(vmax,vmax+SV_N,-inf);
+    unsigned long long nused(0), nneutrons(0), ntested(0);
+    for (auto it = sample.begin(); it!=sample.end() && it->first < iblock_end; ++it) {
+      const StdHistsColumns& c = it->second.columns;
+      const double * w = c.v[SV_WEIGHT].data();
+      for (unsigned i = 0; i < SV_N; ++i) {
+        if (i==SV_NWL)
+          updateRange(c.v[i].data(),c.nwl_weights.data(),c.v[i].size(),vmin[i],vmax[i]);
+        else
+          updateRange(c.v[i].data(),i==SV_WEIGHT?nullptr:w,c.v[i].size(),vmin[i],vmax[i]);
+      }
+      nused += c.size();
+      nneutrons += c.v[SV_NWL].size();
+      ntested += it->second.ntested;
     }
-    if (has_userflags)
-      h_uf->fill(p->userflags,p->weight);
-    if (p->pdgcode==2112)
-      h_nwl->fill(Utils::neutronEKinToWavelength(p->ekin)/Units::angstrom,p->weight);
-    h_time->fill(p->time,p->weight);
-    h_weight->fill(p->weight);
+    for (unsigned i = 0; i < SV_N; ++i) {
+      if (vmin[i]>vmax[i])
+        vmin[i] = vmax[i] = 0.0;//nothing filled
+    }
+    if (!complete && ntested) {
+      //Estimate number of fills from the fraction of the file sampled:
+      const double scale = double(nparticles_total)/ntested;
+      nused = std::max<unsigned long long>(nused,nused*scale);
+      nneutrons = std::max<unsigned long long>(nneutrons,nneutrons*scale);
+    }
+    bookFinalStdHists(sh,nused,nneutrons,vmin,vmax);
+    binned = true;
+  };
+
+  auto work = [&](Worker& w)
+  {
+    MCPLExprParser::MCPLASTBuilder builder;
+    auto eval_filter = prepareFilter(builder,filter_expr);
+    const bool do_filter = (bool)eval_filter.arg();
+    w.sh.h_pdgcode = new SimpleHists::HistCounts;
+    w.owned.emplace_back(w.sh.h_pdgcode);
+    StdHistsColumns columns;
+    std::vector<Sample> tofill;
+    while (ParticleBlockReader::Block * block = reader.next()) {
+      const std::uint64_t iblock = block->index;
+      const unsigned long long ntested = block->particles.size();
+      columns.clear();
+      for (const auto& p : block->particles) {
+        if ( do_filter ) {
+          builder.setCurrentParticle(&p);
+          if ( !eval_filter() )
+            continue;
+        }
+        addToColumns(columns,&p,has_polarisation,has_userflags);
+        pdgCounter(w.sh,p.pdgcode) += p.weight;
+      }
+      reader.release(block);
+      w.nused += columns.size();
+
+      if (!w.binned) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!binned) {
+          Sample& s = sample[iblock];
+          s.columns = std::move(columns);
+          s.ntested = ntested;
+          columns = StdHistsColumns();
+          //Enough particles in consecutive blocks from the start of the file?
+          //(stopping at the first block where there are, so the result does
+          //not depend on the order in which other blocks were processed):
+          const unsigned long long nsample = std::max<unsigned long long>(opt.nsample,1);
+          unsigned long long nsampled = 0;
+          std::uint64_t iblock_end = 0;
+          for (auto it = sample.begin(); nsampled < nsample && it!=sample.end() && it->first == iblock_end; ++it, ++iblock_end)
+            nsampled += it->second.columns.size();
+          if (nsampled < nsample)
+            continue;
+          chooseBinning(iblock_end,false);
+          for (auto& e : sample)
+            tofill.push_back(std::move(e.second));
+          sample.clear();
+        }
+        //Binning was chosen, so the histograms can be cloned:
+        for (unsigned i = 0; i < SV_N; ++i) {
+          w.sh.h[i] = nullptr;
+          if (sh.h[i]) {
+            w.sh.h[i] = static_cast<SimpleHists::Hist1D*>(sh.h[i]->clone());
+            w.owned.emplace_back(w.sh.h[i]);
+          }
+        }
+        w.binned = true;
+      }
+      for (auto& s : tofill)
+        fillStdHists(w.sh,s.columns);
+      tofill.clear();
+      fillStdHists(w.sh,columns);
+    }
+  };
+
+  {
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(nthreads);
+    for (unsigned i = 0; i < nthreads; ++i) {
+      threads.emplace_back([&work,&workers,&errors,&reader,i]()
+                           {
+                             try {
+                               work(workers[i]);
+                             } catch (...) {
+                               errors[i] = std::current_exception();
+                               reader.abort();
+                             }
+                           });
+    }
+    for (auto& t : threads)
+      t.join();
+    for (auto& e : errors)
+      if (e)
+        std::rethrow_exception(e);
+  }
+
+  //All blocks sampled (file smaller than the sample size):
+  if (!binned) {
+    chooseBinning(std::numeric_limits<std::uint64_t>::max(),true);
+    for (auto& e : sample)
+      fillStdHists(sh,e.second.columns);
+    sample.clear();
+  }
+
+  //Merge results of workers:
+  ReadStats stats;
+  for (auto& w : workers) {
+    for (unsigned i = 0; i < SV_N; ++i) {
+      if (w.binned && sh.h[i])
+        sh.h[i]->merge(w.sh.h[i]);
+    }
+    for (auto& e : w.sh.pdgcounters)
+      pdgCounter(sh,e.first) += e.second;
+    stats.nparticles_used += w.nused;
   }
+  sh.h_pdgcode->sortByLabels();
 
-  h_pdgcode->sortByLabels();
+  stats.nparticles_read = reader.nParticlesRead();
+  stats.nbytes_read = reader.nBytesRead();
+  stats.seconds = secondsSince(t0);
+  return stats;
 }
 
 SimpleHists::HistBase * MCPLExtra::mcplHistsFromExpression(const std::string& filename,
@@ -0,0 +1,155 @@
+#include "MCPLExtra/ParticleBlockReader.hh"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+namespace MCPLExtra {
+  namespace {
+    //Validate arguments before the file is opened in the member initialisers,
+    //since the destructor (closing the file) does not run if the constructor
+    //throws:
+    const std::string& checkedFilename( const std::string& filename, unsigned nblocks, unsigned blocksize )
+    {
+      if (!nblocks||!blocksize)
+        throw std::runtime_error("ParticleBlockReader: number of blocks and block size must be positive");
+      return filename;
+    }
+
+    bool isCompressed( const std::string& filename )
+    {
+      return filename.size() > 3 && filename.compare(filename.size()-3,3,".gz") == 0;
+    }
+  }
+}
+
+MCPLExtra::ParticleBlockReader::ParticleBlockReader( const std::string& filename,
+                                                     std::uint64_t max_particles,
+                                                     unsigned nblocks,
+                                                     unsigned blocksize )
+  : m_filename(checkedFilename(filename,nblocks,blocksize)),
+    m_file(mcpl_open_file(m_filename.c_str())),
+    m_compressed(isCompressed(m_filename)),
+    m_maxparticles(std::min<std::uint64_t>(max_particles ? max_particles : UINT64_MAX,mcpl_hdr_nparticles(m_file))),
+    m_blocksize(blocksize),
+    m_nextfirst(0),
+    m_nextindex(0),
+    m_nread(0),
+    m_aborted(false)
+{
+  try {
+    m_blocks.resize(nblocks);
+    for (auto& b : m_blocks) {
+      b.particles.reserve(blocksize);
+      m_free.push_back(&b);
+    }
+  } catch (...) {
+    mcpl_close_file(m_file);
+    throw;
+  }
+}
+
+MCPLExtra::ParticleBlockReader::~ParticleBlockReader()
+{
+  for (auto& f : m_allhandles)
+    mcpl_close_file(f);
+  mcpl_close_file(m_file);
+}
+
+MCPLExtra::ParticleBlockReader::Block* MCPLExtra::ParticleBlockReader::next()
+{
+  //Ranges of compressed files are read via m_file, in the order they are
+  //claimed:
+  std::unique_lock<std::mutex> readlock(m_readmutex,std::defer_lock);
+  if (m_compressed)
+    readlock.lock();
+
+  //Claim a block and the next range of particles:
+  Block * b;
+  std::uint64_t n;
+  mcpl_file_t f = m_file;
+  bool newhandle = false;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock,[this]{ return m_aborted || m_nextfirst >= m_maxparticles || !m_free.empty(); });
+    if ( m_aborted || m_nextfirst >= m_maxparticles )
+      return nullptr;
+    b = m_free.back();
+    m_free.pop_back();
+    b->index = m_nextindex++;
+    b->first = m_nextfirst;
+    n = std::min<std::uint64_t>(m_blocksize,m_maxparticles-m_nextfirst);
+    m_nextfirst += n;
+    if (!m_compressed) {
+      newhandle = m_handles.empty();
+      if (!newhandle) {
+        f = m_handles.back();
+        m_handles.pop_back();
+      }
+    }
+  }
+
+  //Decode without holding the lock:
+  bool hashandle = !newhandle;
+  try {
+    if (newhandle) {
+      f = mcpl_open_file(m_filename.c_str());
+      hashandle = true;
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_allhandles.push_back(f);
+    }
+    b->particles.clear();
+    if ( mcpl_currentposition(f) == b->first || mcpl_seek(f,b->first) ) {
+      const mcpl_particle_t* p;
+      while ( b->particles.size() < n && (p=mcpl_read(f)) )
+        b->particles.push_back(*p);
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_compressed && hashandle)
+      m_handles.push_back(f);
+    m_free.push_back(b);
+    m_cv.notify_all();
+    throw;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_compressed)
+    m_handles.push_back(f);
+  m_nread += b->particles.size();
+  if (b->particles.size() < n) {
+    //File ended early, so no further ranges can be read:
+    m_maxparticles = std::min<std::uint64_t>(m_maxparticles,b->first+b->particles.size());
+    m_cv.notify_all();
+  }
+  if (b->particles.empty()) {
+    m_free.push_back(b);
+    m_cv.notify_all();
+    return nullptr;
+  }
+  return b;
+}
+
+void MCPLExtra::ParticleBlockReader::release(Block* b)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_free.push_back(b);
+  m_cv.notify_all();
+}
+
+void MCPLExtra::ParticleBlockReader::abort()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_aborted = true;
+  m_cv.notify_all();
+}
+
+std::uint64_t MCPLExtra::ParticleBlockReader::nParticlesRead() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_nread;
+}
+
+std::uint64_t MCPLExtra::ParticleBlockReader::nBytesRead() const
+{
+  return nParticlesRead() * mcpl_hdr_particle_size(m_file);
+}
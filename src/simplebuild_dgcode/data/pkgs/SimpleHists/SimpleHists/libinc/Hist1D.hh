@@ -130,6 +130,7 @@ namespace SimpleHists {
     double * m_content;
     double * m_errors;//sum weight-squares for each bin
     void initErrors();
+    void fillManyImpl(const double* vals, const double* weights, unsigned n);
   };
 
 }
@@ -88,6 +88,7 @@ namespace SimpleHists {
   private:
     void init(unsigned nbinsx, double xmin, double xmax,
               unsigned nbinsy, double ymin, double ymax);
+    void fillManyImpl(const double* valsx, const double* valsy, const double* weights, unsigned n);
 
     //Copy/assignment is forbidden:
     Hist2D( const Hist2D & );
@@ -1,5 +1,6 @@
 #include "SimpleHists/Hist1D.hh"
 #include "hist_stats.hh"
+#include "fill_many.hh"
 #include "floatcompat.hh"
 #include <stdexcept>
 #include <cstring>//for memset
@@ -296,19 +297,53 @@ void SimpleHists::Hist1D::fill(double val, double weight)
 
 void SimpleHists::Hist1D::fillMany(const double* vals, unsigned n)
 {
-  const double *v(vals);
-  const double *vE(vals+n);
-  for(;v!=vE;++v)
-    fill(*v);
+  fillManyImpl(vals,nullptr,n);
 }
 
 void SimpleHists::Hist1D::fillMany(const double* vals, const double* weights, unsigned n)
 {
-  const double *v(vals);
-  const double *vE(vals+n);
-  const double *w(weights);
-  for(;v!=vE;++v,++w)
-    fill(*v,*w);
+  fillManyImpl(vals,weights,n);
+}
+
+void SimpleHists::Hist1D::fillManyImpl(const double* vals, const double* weights, unsigned n)
+{
+  //See fill_many.hh (weights can be null):
+  const unsigned nbins = m_data.nbins;
+  int ibins[fill_many_blocksize];
+  while (n) {
+    const unsigned nb = std::min(n,fill_many_blocksize);
+    FillManyStats stats;
+    fill_many_stats(vals,weights,nb,stats);
+    if (weights) {
+      stats.checkWeights("Hist1D");
+      if (stats.nontrivialweights && !m_errors)
+        initErrors();
+      if (stats.minweight==0)
+        stats.setMinMaxNonZero(vals,weights,nb);
+    }
+    stats.mergeInto(m_data.sumW,m_data.sumWX,m_data.rmsstate,m_data.minfilled,m_data.maxfilled);
+    fill_many_bins(vals,nb,m_data.xmin,m_data.xmax,m_invDelta,nbins,ibins);
+    double underflow(0.0), overflow(0.0);
+    for (unsigned i = 0; i < nb; ++i) {
+      const int ibin = ibins[i];
+      const double w = weights ? weights[i] : 1.0;
+      if (static_cast<unsigned>(ibin) < nbins) {
+        m_content[ibin] += w;
+        if (m_errors)
+          m_errors[ibin] += w*w;
+      } else if (ibin < 0) {
+        underflow += w;
+      } else {
+        overflow += w;
+      }
+    }
+    m_data.underflow += underflow;
+    m_data.overflow += overflow;
+    if (weights)
+      weights += nb;
+    vals += nb;
+    n -= nb;
+  }
 }
 
 void SimpleHists::Hist1D::initErrors()
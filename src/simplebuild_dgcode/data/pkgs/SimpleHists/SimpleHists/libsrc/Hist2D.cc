@@ -4,6 +4,7 @@
 #include <cstring>//for memset
 #include <cmath>//for sqrt
 #include "hist_stats.hh"
+#include "fill_many.hh"
 #include <vector>
 
 SimpleHists::Hist2D::~Hist2D()
@@ -394,23 +395,70 @@ void SimpleHists::Hist2D::fill(double valx, double valy, double weight)
   }
 }
 
+void SimpleHists::Hist2D::fillManyImpl(const double* valsx, const double* valsy, const double* weights, unsigned n)
+{
+  //See fill_many.hh (weights can be null):
+  const unsigned nbinsx = m_data.nbinsx;
+  const unsigned nbinsy = m_data.nbinsy;
+  int ibinsx[fill_many_blocksize];
+  int ibinsy[fill_many_blocksize];
+  while (n) {
+    const unsigned nb = std::min(n,fill_many_blocksize);
+    FillManyStats statsx, statsy;
+    double covstate;
+    fill_many_stats(valsx,valsy,weights,nb,statsx,statsy,covstate);
+    if (weights) {
+      statsx.checkWeights("Hist2D");
+      if (statsx.minweight==0) {
+        statsx.setMinMaxNonZero(valsx,weights,nb);
+        statsy.setMinMaxNonZero(valsy,weights,nb);
+      }
+    }
+    if (statsx.sumw) {
+      merge_covxy(m_data.covstate, m_data.sumW, m_data.sumWX, m_data.sumWY,
+                  covstate, statsx.sumw, statsx.sumwx, statsy.sumwx);
+      double fakesumw(m_data.sumW);
+      statsx.mergeInto(m_data.sumW,m_data.sumWX,m_data.rmsstateX,m_data.minfilledx,m_data.maxfilledx);
+      statsy.mergeInto(fakesumw,m_data.sumWY,m_data.rmsstateY,m_data.minfilledy,m_data.maxfilledy);
+    }
+    fill_many_bins(valsx,nb,m_data.xmin,m_data.xmax,m_invDeltaX,nbinsx,ibinsx);
+    fill_many_bins(valsy,nb,m_data.ymin,m_data.ymax,m_invDeltaY,nbinsy,ibinsy);
+    double underflowx(0.0), overflowx(0.0), underflowy(0.0), overflowy(0.0);
+    for (unsigned i = 0; i < nb; ++i) {
+      const int ibinx = ibinsx[i];
+      const int ibiny = ibinsy[i];
+      const double w = weights ? weights[i] : 1.0;
+      const bool insidex = static_cast<unsigned>(ibinx) < nbinsx;
+      const bool insidey = static_cast<unsigned>(ibiny) < nbinsy;
+      if (insidex && insidey) {
+        m_content[ibiny + nbinsy*ibinx] += w;
+        continue;
+      }
+      if (!insidex)
+        ( ibinx < 0 ? underflowx : overflowx ) += w;
+      if (!insidey)
+        ( ibiny < 0 ? underflowy : overflowy ) += w;
+    }
+    m_data.underflowx += underflowx;
+    m_data.overflowx += overflowx;
+    m_data.underflowy += underflowy;
+    m_data.overflowy += overflowy;
+    if (weights)
+      weights += nb;
+    valsx += nb;
+    valsy += nb;
+    n -= nb;
+  }
+}
+
 void SimpleHists::Hist2D::fillMany(const double* valsx, const double* valsy, unsigned n)
 {
-  const double *vx(valsx);
-  const double *vxE(valsx+n);
-  const double *vy(valsy);
-  for(;vx!=vxE;++vx,++vy)
-    fill(*vx,*vy);
+  fillManyImpl(valsx,valsy,nullptr,n);
 }
 
 void SimpleHists::Hist2D::fillMany(const double* valsx, const double* valsy, const double* weights, unsigned n)
 {
-  const double *vx(valsx);
-  const double *vxE(valsx+n);
-  const double *w(weights);
-  const double *vy(valsy);
-  for(;vx!=vxE;++vx,++vy,++w)
-    fill(*vx,*vy,*w);
+  fillManyImpl(valsx,valsy,weights,n);
 }
 
 void SimpleHists::Hist2D::scale(double a)
@@ -0,0 +1,212 @@
+// Helpers for filling histograms from arrays of values (fillMany).
+//
+// Values are processed in blocks. For each block, first the statistics are
+// calculated in a single pass, then bin indices are calculated without
+// branches (in a loop which compilers can vectorise), and finally the bin
+// contents are incremented.
+//
+// Updating the statistics value by value in fill(..) needs a division per
+// value, which dominates the cost of filling. Here the sums of each block are
+// instead accumulated relative to its first value (a "shifted data"
+// calculation, which is numerically stable as long as that value is not far
+// from the mean compared to the spread of the block), and merged into those of
+// the histogram with the same formulas as used when merging histograms (see
+// hist_stats.hh). Results might thus differ from those of repeated fill(..)
+// calls at the level of floating point rounding.
+
+//Must be included after hist_stats.hh
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace SimpleHists {
+
+  static const unsigned fill_many_blocksize = 256;
+
+  struct FillManyStats {
+    double sumw = 0.0;
+    double sumwx = 0.0;
+    double rmsstate = 0.0;
+    float minval = std::numeric_limits<float>::infinity();
+    float maxval = -std::numeric_limits<float>::infinity();
+    double minweight = 1.0;
+    bool nontrivialweights = false;//some weights differ from 0 and 1
+
+    //Throws on negative weights (must be called before using the results
+    //when filling with weights):
+    void checkWeights(const char * histname) const
+    {
+      if (minweight<0)
+        throw std::runtime_error(std::string(histname)+": Fill with negative weights gives ill-defined statistics");
+    }
+
+    //Set from sums of weights, w*(x-shift) and w*(x-shift)^2:
+    void set(double shift, double sw, double swd, double swd2)
+    {
+      sumw = sw;
+      sumwx = sw * shift + swd;
+      rmsstate = sw ? std::max(0.0,swd2 - swd*swd/sw) : 0.0;
+    }
+
+    //Set min/max from the values with non-zero weights (needed when
+    //minweight is 0, as fill_many_stats does not exclude those):
+    void setMinMaxNonZero(const double* vals, const double* weights, unsigned n)
+    {
+      double lo(std::numeric_limits<double>::infinity());
+      double hi(-lo);
+      for (unsigned i = 0; i < n; ++i) {
+        if (weights[i]) {
+          lo = std::min(lo,vals[i]);
+          hi = std::max(hi,vals[i]);
+        }
+      }
+      minval = static_cast<float>(lo);
+      maxval = static_cast<float>(hi);
+    }
+
+    void mergeInto(double& h_sumw, double& h_sumwx, double& h_rmsstate, float& h_minfilled, float& h_maxfilled) const
+    {
+      if (!sumw)
+        return;
+      merge_stats(h_sumw,h_sumwx,h_rmsstate,sumw,sumwx,rmsstate);
+      merge_maxmin(h_minfilled,h_maxfilled,minval,maxval);
+    }
+  };
+
+  //Statistics of a block of values (weights can be null, meaning all weights
+  //are 1). The sums are accumulated in two independent lanes, to shorten the
+  //chains of dependent additions. With weights, the smallest weight and the sum
+  //of |w*(w-1)| (zero only if all weights are 0 or 1) are found as well, so the
+  //weights need not be checked in a separate pass:
+  inline void fill_many_stats(const double* vals, const double* weights, unsigned n, FillManyStats& stats)
+  {
+    const double k = vals[0];
+    double sw0(0.0), sw1(0.0), s0(0.0), s1(0.0), q0(0.0), q1(0.0);
+    double lo0(std::numeric_limits<double>::infinity()), lo1(lo0);
+    double hi0(-lo0), hi1(-lo0);
+    auto add = [k](double v, double w, double& sw, double& s, double& q, double& lo, double& hi)
+    {
+      const double d = v - k;
+      const double wd = w * d;
+      sw += w;
+      s += wd;
+      q += wd * d;
+      lo = std::min(lo,v);
+      hi = std::max(hi,v);
+    };
+    unsigned i = 0;
+    if (weights) {
+#ifndef NDEBUG
+      for (unsigned j = 0; j < n; ++j)
+        assert(!(weights[j]!=weights[j])&&"SimpleHists ERROR: NAN in input weight!");
+#endif
+      double wmin0(1.0), wmin1(1.0), nt0(0.0), nt1(0.0);
+      for (; i+1 < n; i += 2) {
+        const double w0 = weights[i];
+        const double w1 = weights[i+1];
+        add(vals[i],w0,sw0,s0,q0,lo0,hi0);
+        add(vals[i+1],w1,sw1,s1,q1,lo1,hi1);
+        wmin0 = std::min(wmin0,w0);
+        wmin1 = std::min(wmin1,w1);
+        nt0 += std::fabs(w0*(w0-1.0));
+        nt1 += std::fabs(w1*(w1-1.0));
+      }
+      if (i < n) {
+        add(vals[i],weights[i],sw0,s0,q0,lo0,hi0);
+        wmin0 = std::min(wmin0,weights[i]);
+        nt0 += std::fabs(weights[i]*(weights[i]-1.0));
+      }
+      stats.minweight = std::min(wmin0,wmin1);
+      stats.nontrivialweights = ( nt0 + nt1 > 0.0 );
+    } else {
+      for (; i+1 < n; i += 2) {
+        add(vals[i],1.0,sw0,s0,q0,lo0,hi0);
+        add(vals[i+1],1.0,sw1,s1,q1,lo1,hi1);
+      }
+      if (i < n)
+        add(vals[i],1.0,sw0,s0,q0,lo0,hi0);
+    }
+    stats.set(k,sw0+sw1,s0+s1,q0+q1);
+    stats.minval = static_cast<float>(std::min(lo0,lo1));
+    stats.maxval = static_cast<float>(std::max(hi0,hi1));
+  }
+
+  //Same for two sets of values, also providing their covariance state (a
+  //single lane is enough here, as there are many independent sums). Only the
+  //smallest weight is found, since Hist2D has no bin errors:
+  inline void fill_many_stats(const double* valsx, const double* valsy, const double* weights, unsigned n,
+                              FillManyStats& statsx, FillManyStats& statsy, double& covstate)
+  {
+    const double kx = valsx[0];
+    const double ky = valsy[0];
+    double sw(0.0), sx(0.0), sx2(0.0), sy(0.0), sy2(0.0), sxy(0.0);
+    double lox(std::numeric_limits<double>::infinity()), loy(lox);
+    double hix(-lox), hiy(-lox);
+    double wmin(1.0);
+    for (unsigned i = 0; i < n; ++i) {
+      const double vx = valsx[i];
+      const double vy = valsy[i];
+      const double w = weights ? weights[i] : 1.0;
+      assert(!(w!=w)&&"SimpleHists ERROR: NAN in input weight!");
+      wmin = std::min(wmin,w);
+      const double dx = vx - kx;
+      const double dy = vy - ky;
+      const double wdx = w * dx;
+      const double wdy = w * dy;
+      sw += w;
+      sx += wdx;
+      sy += wdy;
+      sx2 += wdx * dx;
+      sy2 += wdy * dy;
+      sxy += wdx * dy;
+      lox = std::min(lox,vx);
+      hix = std::max(hix,vx);
+      loy = std::min(loy,vy);
+      hiy = std::max(hiy,vy);
+    }
+    statsx.set(kx,sw,sx,sx2);
+    statsy.set(ky,sw,sy,sy2);
+    statsx.minval = static_cast<float>(lox);
+    statsx.maxval = static_cast<float>(hix);
+    statsy.minval = static_cast<float>(loy);
+    statsy.maxval = static_cast<float>(hiy);
+    covstate = sw ? sxy - sx*sy/sw : 0.0;
+    statsx.minweight = statsy.minweight = wmin;
+  }
+
+  //Same conventions as Hist1D::valueToBin (-1 for underflow, nbins for
+  //overflow, and a value at xmax goes in the last bin), but computed with
+  //selections rather than branches. Groups of values are converted to bin
+  //indices together, which allows compilers to use vector instructions:
+  inline void fill_many_bins(const double* vals, unsigned n, double xmin, double xmax,
+                             double invdelta, unsigned nbins, int* ibin)
+  {
+#ifndef NDEBUG
+    for (unsigned i = 0; i < n; ++i)
+      assert(!(vals[i]!=vals[i])&&"SimpleHists ERROR: NAN in input!");
+#endif
+    const unsigned L = 4;
+    const double lastbin = nbins - 1;
+    const double overbin = nbins;
+    auto bin = [=](double v)
+    {
+      const double b = std::min(invdelta*(v-xmin),lastbin);
+      return v < xmin ? -1.0 : ( v > xmax ? overbin : b );
+    };
+    const double * v = vals;
+    const double * vE = vals + n;
+    const double * vGroupsE = vals + (n/L)*L;
+    for (; v!=vGroupsE; v += L, ibin += L) {
+      double b[L];
+      for (unsigned j = 0; j < L; ++j)
+        b[j] = bin(v[j]);
+      for (unsigned j = 0; j < L; ++j)
+        ibin[j] = static_cast<int>(b[j]);
+    }
+    for (; v!=vE; ++v, ++ibin)
+      *ibin = static_cast<int>(bin(*v));
+  }
+
+}
@@ -2,11 +2,21 @@
 #define SimpleHists_AutoBinHist1D_hh
 
 #include "SimpleHists/Hist1D.hh"
+#include "SimpleHistsUtils/QuantileSketch.hh"
 #include <vector>
+#include <cmath>
 
 //Class wrapping a Hist1D instance, catching fills and trying to automatically
 //rebin the Hist1D to suitable bin-ranges by temporarily storing a large number
-//of filled values in an internal array.
+//of filled values in an internal array. The bin-range is chosen from a
+//QuantileSketch of the stored values.
+//
+//Histograms filled in separate processes will in general end up with different
+//bin-ranges, and can then not be merged afterwards. To avoid that, processes
+//can agree on a bin-range by exchanging sketches before the binning is chosen:
+//Each process provides its sketch() (serialised if needed), the sketches are
+//merged in the same order everywhere, and the result is passed to setBinning(..)
+//in all processes.
 
 namespace SimpleHists {
 
@@ -19,23 +29,36 @@ namespace SimpleHists {
 
     void fill(double val);
     void fill(double val, double weight);
-    //todo: fillMany as well.
+    void fillMany(const double* vals, unsigned n);
+    void fillMany(const double* vals, const double* weights, unsigned n);
 
     HistBase * hist() { return m_h; }
     const HistBase * hist() const { return m_h; }
 
     void flush();
+
+    //Sketch of the values filled before the binning was chosen:
+    const QuantileSketch& sketch() const { return m_sketch; }
+
+    //Choose the binning immediately from the provided sketch (typically
+    //containing the merged sketches of several processes) rather than from the
+    //values filled so far:
+    void setBinning(const QuantileSketch&);
+
   private:
     Hist1D * m_h;
     size_t m_wait;
     double m_autofit_percentile;
     std::vector<std::pair<double,double> > m_db;
+    QuantileSketch m_sketch;
+    void rebin(const QuantileSketch&);
   };
 
   inline void AutoBinHist1D::fill(double val)
   {
     if (m_wait) {
       m_db.emplace_back(val,0.0);//0.0 on purpose
+      m_sketch.add(val);
       if (!--m_wait) {
         m_wait=1;
         flush();
@@ -51,6 +74,7 @@ namespace SimpleHists {
       if (weight==0)
         return;
       m_db.emplace_back(val,weight);
+      m_sketch.add(val,std::fabs(weight));
       if (!--m_wait) {
         m_wait=1;
         flush();
@@ -60,6 +84,22 @@ namespace SimpleHists {
     }
   }
 
+  inline void AutoBinHist1D::fillMany(const double* vals, unsigned n)
+  {
+    for (;n&&m_wait;--n)
+      fill(*vals++);
+    if (n)
+      m_h->fillMany(vals,n);
+  }
+
+  inline void AutoBinHist1D::fillMany(const double* vals, const double* weights, unsigned n)
+  {
+    for (;n&&m_wait;--n)
+      fill(*vals++,*weights++);
+    if (n)
+      m_h->fillMany(vals,weights,n);
+  }
+
 }
 
 #endif
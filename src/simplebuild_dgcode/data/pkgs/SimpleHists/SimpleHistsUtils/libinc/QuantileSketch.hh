@@ -0,0 +1,98 @@
+#ifndef SimpleHists_QuantileSketch_hh
+#define SimpleHists_QuantileSketch_hh
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+//Summary of a distribution of (weighted) values using a fixed amount of
+//memory, from which quantiles of the distribution can be estimated. The
+//implementation is a "merging t-digest": values are collected in weighted
+//centroids, which are kept small near the ends of the distribution (where
+//accuracy matters most) and larger in the middle. The number of centroids is
+//bounded by the compression parameter (relative errors on quantiles are
+//roughly 1/compression or better).
+//
+//Sketches of separate data sets (e.g. filled in separate processes) can be
+//merged, after transferring them as serialised data if needed. The results are
+//deterministic, depending only on the order in which values are added and
+//sketches are merged.
+
+namespace SimpleHists {
+
+  class QuantileSketch {
+  public:
+    QuantileSketch(double compression = 100.0);
+    QuantileSketch(const std::string& serialised_data);
+    ~QuantileSketch();
+
+    //Add values. Negative weights are not supported, and values with zero
+    //weight are ignored:
+    void add(double val);
+    void add(double val, double weight);
+
+    //Add contents of another sketch:
+    void merge(const QuantileSketch&);
+
+    bool empty() const { return m_totweight == 0.0; }
+    double totalWeight() const { return m_totweight; }
+    double min() const { return m_min; }//only well-defined if sketch is non-empty
+    double max() const { return m_max; }//only well-defined if sketch is non-empty
+
+    //Estimated value below which a fraction q of the total weight lies (q in
+    //[0,1], with q=0 and q=1 giving the exact min and max values):
+    double quantile(double q) const;
+
+    double compression() const { return m_compression; }
+    std::size_t nCentroids() const;
+
+    //Passed string will be overridden with serialised data:
+    void serialise(std::string&) const;
+
+  private:
+    struct Centroid {
+      double mean;
+      double weight;
+      bool operator<(const Centroid& o) const { return mean < o.mean || (mean == o.mean && weight < o.weight); }
+    };
+    double m_compression;
+    double m_totweight;
+    double m_min;
+    double m_max;
+    std::size_t m_buffercap;
+    //Kept sorted:
+    mutable std::vector<Centroid> m_centroids;
+    //Values not yet merged into the centroids:
+    mutable std::vector<Centroid> m_buffer;
+    void compress() const;
+    void addImpl(double val, double weight);
+  };
+
+  inline void QuantileSketch::add(double val)
+  {
+    addImpl(val,1.0);
+  }
+
+  inline void QuantileSketch::add(double val, double weight)
+  {
+    if (weight>0.0)
+      addImpl(val,weight);
+  }
+
+  inline void QuantileSketch::addImpl(double val, double weight)
+  {
+    if (m_totweight==0.0) {
+      m_min = m_max = val;
+    } else {
+      if (val<m_min) m_min = val;
+      if (val>m_max) m_max = val;
+    }
+    m_totweight += weight;
+    m_buffer.push_back({val,weight});
+    if (m_buffer.size()>=m_buffercap)
+      compress();
+  }
+
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "SimpleHistsUtils/AutoBinHist1D.hh"
 #include <stdexcept>
 #include <algorithm>
+#include <cassert>
 
 SimpleHists::AutoBinHist1D::AutoBinHist1D(Hist1D* h, size_t nwait)
   : m_h(h),
@@ -34,38 +35,33 @@ void SimpleHists::AutoBinHist1D::flush()
 {
   if (m_wait==0)
     return;
+  rebin(m_sketch);
+}
+
+void SimpleHists::AutoBinHist1D::setBinning(const QuantileSketch& sketch)
+{
+  if (m_wait==0)
+    throw std::runtime_error("AutoBinHist1D::setBinning called after binning was already chosen.");
+  rebin(sketch);
+}
+
+void SimpleHists::AutoBinHist1D::rebin(const QuantileSketch& sketch)
+{
+  assert(m_wait!=0);
   if (!m_h->empty())
     throw std::runtime_error("AutoBinHist1D only works if the histogram contents are not modified directly.");
   m_wait = 0;
 
   double vmin = 0.0;
   double vmax = 1.0;
-  if (!m_db.empty()&&m_autofit_percentile>0.0&&m_autofit_percentile<1.0) {
-    double ignore = (1.0-m_autofit_percentile)*0.5;
-    auto dbcpy = m_db;
-    std::sort(dbcpy.begin(),dbcpy.end());
-    double sumtot(0.0), sum(0);
-    //  for (auto& v : dbcpy) {
-    for (auto it = dbcpy.begin(); it!= dbcpy.end(); ++it) { auto& v = *it;
-      sumtot += (v.second?v.second:1.0);
-    }
-    //  for (auto& v : dbcpy) {
-    for (auto it = dbcpy.begin(); it!= dbcpy.end(); ++it) { auto& v = *it;
-      sum += (v.second?v.second:1.0);
-      if (sum<sumtot*ignore)
-        vmin = v.first;
-      if (sum>sumtot*(1-ignore)) {
-        vmax = v.first;
-        break;
-      }
-    }
-  } else {
-    if (!m_db.empty())
-      vmin = vmax = m_db.front().first;
-    //  for (auto& v : m_db) {
-    for (auto it = m_db.begin(); it!= m_db.end(); ++it) { auto& v = *it;
-      if (vmin > v.first) vmin = v.first;
-      if (vmax < v.first) vmax = v.first;
+  if (!sketch.empty()) {
+    if (m_autofit_percentile>0.0&&m_autofit_percentile<1.0) {
+      double ignore = (1.0-m_autofit_percentile)*0.5;
+      vmin = sketch.quantile(ignore);
+      vmax = sketch.quantile(1.0-ignore);
+    } else {
+      vmin = sketch.min();
+      vmax = sketch.max();
     }
   }
 
@@ -0,0 +1,172 @@
+#include "SimpleHistsUtils/QuantileSketch.hh"
+#include "Core/Types.hh"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cassert>
+
+namespace SimpleHists {
+
+  namespace {
+    static const char quantilesketch_serialversion = 0x01;
+  }
+
+  QuantileSketch::QuantileSketch(double compression)
+    : m_compression(compression),
+      m_totweight(0.0),
+      m_min(0.0),
+      m_max(0.0)
+  {
+    if (!(compression>=10.0&&compression<=1e5))
+      throw std::runtime_error("QuantileSketch: compression parameter out of range");
+    m_buffercap = static_cast<std::size_t>(5*compression);
+  }
+
+  QuantileSketch::QuantileSketch(const std::string& data)
+    : m_totweight(0.0), m_min(0.0), m_max(0.0)
+  {
+    //version, compression, min, max, number of centroids, (mean,weight) of centroids:
+    const std::size_t nheader = 1+3*sizeof(double)+sizeof(std::uint32_t);
+    if (data.size()<nheader||data[0]!=quantilesketch_serialversion)
+      throw std::runtime_error("QuantileSketch: Deserialisation failed (unknown data format)");
+    const char * p = &data[1];
+    double header[3];
+    std::memcpy(header,p,sizeof(header));
+    p += sizeof(header);
+    std::uint32_t n;
+    std::memcpy(&n,p,sizeof(n));
+    p += sizeof(n);
+    if (data.size()!=nheader+n*sizeof(Centroid))
+      throw std::runtime_error("QuantileSketch: Deserialisation failed (data size error)");
+    m_compression = header[0];
+    if (!(m_compression>=10.0&&m_compression<=1e5))
+      throw std::runtime_error("QuantileSketch: Deserialisation failed (compression parameter out of range)");
+    m_buffercap = static_cast<std::size_t>(5*m_compression);
+    m_min = header[1];
+    m_max = header[2];
+    m_centroids.resize(n);
+    static_assert(sizeof(Centroid)==2*sizeof(double));
+    if (n)
+      std::memcpy(&m_centroids[0],p,n*sizeof(Centroid));
+    for (auto& c : m_centroids) {
+      if (!(c.weight>0.0))
+        throw std::runtime_error("QuantileSketch: Deserialisation failed (invalid weights)");
+      m_totweight += c.weight;
+    }
+  }
+
+  QuantileSketch::~QuantileSketch()
+  {
+  }
+
+  std::size_t QuantileSketch::nCentroids() const
+  {
+    compress();
+    return m_centroids.size();
+  }
+
+  void QuantileSketch::compress() const
+  {
+    if (m_buffer.empty())
+      return;
+    m_buffer.insert(m_buffer.end(),m_centroids.begin(),m_centroids.end());
+    std::sort(m_buffer.begin(),m_buffer.end());
+    m_centroids.clear();
+
+    //Merge neighbouring centroids as long as the combined centroid covers less
+    //than one unit of the scale function k(q)=compression/(2pi)*asin(2q-1),
+    //which is steep near q=0 and q=1:
+    double totweight(0.0);
+    for (auto& c : m_buffer)
+      totweight += c.weight;
+    const double kfact = m_compression/(2*M_PI);
+    const double kmax = 0.25*m_compression;
+    auto qlimit = [kfact,kmax](double q)
+    {
+      const double k = std::min(kfact*std::asin(2*q-1)+1.0,kmax);
+      return 0.5*(std::sin(k/kfact)+1.0);
+    };
+    double wbefore = 0.0;
+    Centroid cur = m_buffer.front();
+    double qmax = qlimit(0.0);
+    for (auto it = std::next(m_buffer.begin()); it!=m_buffer.end(); ++it) {
+      if ((wbefore+cur.weight+it->weight)<=qmax*totweight) {
+        cur.weight += it->weight;
+        cur.mean += (it->mean-cur.mean)*it->weight/cur.weight;
+      } else {
+        m_centroids.push_back(cur);
+        wbefore += cur.weight;
+        cur = *it;
+        qmax = qlimit(std::min(1.0,wbefore/totweight));
+      }
+    }
+    m_centroids.push_back(cur);
+    m_buffer.clear();
+  }
+
+  void QuantileSketch::merge(const QuantileSketch& o)
+  {
+    if (o.empty())
+      return;
+    o.compress();
+    if (empty()) {
+      m_min = o.m_min;
+      m_max = o.m_max;
+    } else {
+      m_min = std::min(m_min,o.m_min);
+      m_max = std::max(m_max,o.m_max);
+    }
+    m_totweight += o.m_totweight;
+    m_buffer.insert(m_buffer.end(),o.m_centroids.begin(),o.m_centroids.end());
+    compress();
+  }
+
+  double QuantileSketch::quantile(double q) const
+  {
+    if (empty())
+      throw std::runtime_error("QuantileSketch: quantile requested from empty sketch");
+    if (!(q>=0.0&&q<=1.0))
+      throw std::runtime_error("QuantileSketch: quantile fraction out of range");
+    compress();
+    if (q==0.0)
+      return m_min;
+    if (q==1.0)
+      return m_max;
+    //Interpolate linearly between centroid means, placing each mean at the
+    //middle of the weight it covers, and the min and max at the ends:
+    const double target = q*m_totweight;
+    double prevpos = 0.0;
+    double prevval = m_min;
+    double wbefore = 0.0;
+    for (auto& c : m_centroids) {
+      const double pos = wbefore + 0.5*c.weight;
+      if (target<pos) {
+        const double f = (target-prevpos)/(pos-prevpos);
+        return std::min(m_max,std::max(m_min,prevval+f*(c.mean-prevval)));
+      }
+      prevpos = pos;
+      prevval = c.mean;
+      wbefore += c.weight;
+    }
+    if (!(m_totweight>prevpos))
+      return m_max;
+    const double f = (target-prevpos)/(m_totweight-prevpos);
+    return std::min(m_max,std::max(m_min,prevval+f*(m_max-prevval)));
+  }
+
+  void QuantileSketch::serialise(std::string& data) const
+  {
+    compress();
+    const std::uint32_t n = m_centroids.size();
+    const double header[3] = { m_compression, m_min, m_max };
+    data.clear();
+    data.reserve(1+sizeof(header)+sizeof(n)+n*sizeof(Centroid));
+    data.push_back(quantilesketch_serialversion);
+    data.append(reinterpret_cast<const char*>(header),sizeof(header));
+    data.append(reinterpret_cast<const char*>(&n),sizeof(n));
+    if (n)
+      data.append(reinterpret_cast<const char*>(&m_centroids[0]),n*sizeof(Centroid));
+  }
+
+}
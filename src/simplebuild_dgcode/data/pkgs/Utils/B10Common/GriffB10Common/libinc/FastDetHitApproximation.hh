@@ -0,0 +1,84 @@
+#ifndef GriffB10Common_FastDetHitApproximation_hh
+#define GriffB10Common_FastDetHitApproximation_hh
+
+#include "GriffAnaUtils/TouchableCache.hh"
+#include "GriffDataRead/GriffDataReader.hh"
+#include "Units/Units.hh"
+#include <vector>
+
+// Variant of DetHitApproximation, implementing the same algorithm and public
+// interface, but optimised for running over very large numbers of events:
+//
+//   * The counting gas volume is recognised via a GriffAnaUtils::TouchableCache,
+//     so volume names are only compared once per volume in the input file
+//     rather than once per segment.
+//   * Points are gathered in structure-of-arrays buffers, which are reused
+//     between events, and the clustering and threshold calculations are done
+//     with simple loops over these arrays which compilers can vectorise.
+//   * Outliers are removed by finding the point furthest from the current
+//     center, rather than by fully sorting all points on each iteration.
+//
+// Results agree with DetHitApproximation up to floating point rounding
+// (sums are carried out in a different order). It can not be customised by
+// overriding addPoints, so use DetHitApproximation/DetHitApproxFlex for that.
+
+class FastDetHitApproximation : public GriffDataRead::BeginEventCallBack {
+public:
+  FastDetHitApproximation(GriffDataReader*,
+                          double cluster_outlier_threshold = 1*Units::cm,
+                          double hit_edep_threshold = 150*Units::keV,
+                          const char * volname = "CountingGas");
+  virtual ~FastDetHitApproximation();
+
+  //Extract hit info for the current event (see DetHitApproximation):
+  bool eventHasHit() { ensureCalc(); return m_hit; }
+  double eventHitEDep() { ensureCalc(); return m_hitEDep; }
+  double eventHitTime() { ensureCalc(); return m_hitTime; }
+  void getEventHitPosition(double (&pos)[3]) { ensureCalc(); pos[0] = m_hitPos[0]; pos[1] = m_hitPos[1]; pos[2] = m_hitPos[2]; }
+  const double* eventHitPosition() { ensureCalc(); return m_hitPos; }
+  double eventHitPositionX() { ensureCalc(); return m_hitPos[0]; }
+  double eventHitPositionY() { ensureCalc(); return m_hitPos[1]; }
+  double eventHitPositionZ() { ensureCalc(); return m_hitPos[2]; }
+  double eventHitWeight() { ensureCalc(); return m_hitWeight; }
+  double eventTotalEDep();
+
+  const std::string& volumeName() { return m_volname; }
+
+  void test();//Runs alg on the same test points as DetHitApproximation::test()
+
+public:
+  virtual void beginEvent(const GriffDataReader*) { m_needCalc = true; m_totalEDep = -1; }
+  virtual void dereg(const GriffDataReader*) { m_dr = 0; }
+private:
+  void ensureCalc() { if (m_needCalc) calc(); }
+  void calc();
+  void calcFromPoints();
+  void clearPoints();
+  void addPoint(const double* pos, double t, double e);
+  void removePoint(std::size_t i);
+  bool inVolume(const GriffDataRead::Segment*) const;
+
+  GriffDataReader * m_dr;
+  GriffAnaUtils::TouchableCache m_volcache;
+
+  //settings:
+  double m_cluster_outlier_threshold;
+  double m_hit_edep_threshold;
+  std::string m_volname;
+  bool m_needCalc;
+
+  //Results for current event:
+  bool m_hit;
+  double m_hitTime;
+  double m_hitEDep;
+  double m_hitWeight;
+  double m_hitPos[3];
+  double m_totalEDep;
+
+  //Point buffers (structure of arrays):
+  std::vector<double> m_x, m_y, m_z, m_t, m_e;
+  std::vector<double> m_work;
+  std::vector<std::size_t> m_order;
+};
+
+#endif
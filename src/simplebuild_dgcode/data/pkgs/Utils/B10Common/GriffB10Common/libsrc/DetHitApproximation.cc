@@ -18,7 +18,8 @@ DetHitApproximation::DetHitApproximation(GriffDataReader*dr,
     m_hit(false),
     m_hitTime(0.0),
     m_hitEDep(0.0),
-    m_hitWeight(0.0)
+    m_hitWeight(0.0),
+    m_totalEDep(-1)
 {
   assert(hit_edep_threshold>0);
   m_hitPos[0] = m_hitPos[1] = m_hitPos[2] = 0.0;
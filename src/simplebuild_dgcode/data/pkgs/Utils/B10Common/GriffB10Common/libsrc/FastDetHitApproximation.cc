@@ -0,0 +1,241 @@
+#include "GriffB10Common/FastDetHitApproximation.hh"
+#include <stdexcept>
+#include <algorithm>
+
+FastDetHitApproximation::FastDetHitApproximation(GriffDataReader*dr,
+                                                 double cluster_outlier_threshold,
+                                                 double hit_edep_threshold,
+                                                 const char * volname)
+  : m_dr(dr),
+    m_cluster_outlier_threshold(cluster_outlier_threshold),
+    m_hit_edep_threshold(hit_edep_threshold),
+    m_volname(volname),
+    m_needCalc(true),
+    m_hit(false),
+    m_hitTime(0.0),
+    m_hitEDep(0.0),
+    m_hitWeight(0.0),
+    m_totalEDep(-1)
+{
+  assert(hit_edep_threshold>0);
+  m_hitPos[0] = m_hitPos[1] = m_hitPos[2] = 0.0;
+  dr->registerBeginEventCallBack(this);
+}
+
+FastDetHitApproximation::~FastDetHitApproximation()
+{
+  if (m_dr)
+    m_dr->deregisterBeginEventCallBack(this);
+}
+
+bool FastDetHitApproximation::inVolume(const GriffDataRead::Segment* seg) const
+{
+  return m_volcache.lookup(seg,[this](const GriffDataRead::Segment* s)
+                                { return s->volumeName()==m_volname; });
+}
+
+void FastDetHitApproximation::clearPoints()
+{
+  m_x.clear();
+  m_y.clear();
+  m_z.clear();
+  m_t.clear();
+  m_e.clear();
+}
+
+inline void FastDetHitApproximation::addPoint(const double* pos, double t, double e)
+{
+  m_x.push_back(pos[0]);
+  m_y.push_back(pos[1]);
+  m_z.push_back(pos[2]);
+  m_t.push_back(t);
+  m_e.push_back(e);
+}
+
+inline void FastDetHitApproximation::removePoint(std::size_t i)
+{
+  //Order is irrelevant, so move last point into the hole:
+  const std::size_t last = m_e.size()-1;
+  m_x[i] = m_x[last]; m_x.pop_back();
+  m_y[i] = m_y[last]; m_y.pop_back();
+  m_z[i] = m_z[last]; m_z.pop_back();
+  m_t[i] = m_t[last]; m_t.pop_back();
+  m_e[i] = m_e[last]; m_e.pop_back();
+}
+
+void FastDetHitApproximation::calc()
+{
+  assert(m_dr);
+  assert(m_needCalc);
+  m_needCalc=false;
+  clearPoints();
+
+  if (m_dr->eventStorageMode()==GriffFormat::Format::MODE_MINIMAL)
+    throw std::runtime_error("FastDetHitApproximation does not work with Griff files in MINIMAL mode");
+
+  //Collect points from steps of all segments in the volume with energy
+  //depositions (same selection as the SegmentIterator of DetHitApproximation):
+  double edeptot(0);
+  bool has_weight(false);
+  m_hitWeight = 0.0;
+  for (auto trk = m_dr->trackBegin(); trk!=m_dr->trackEnd(); ++trk) {
+    for (auto seg = trk->segmentBegin(); seg!=trk->segmentEnd(); ++seg) {
+      if (!(seg->eDep()>0.0) || !inVolume(seg))
+        continue;
+      edeptot += seg->eDep();
+      auto step = seg->stepBegin();
+      auto stepE = seg->stepEnd();
+      if (step==stepE)
+        continue;
+      for (;step!=stepE;++step) {
+        const double e = step->eDep()*0.5;
+        addPoint(step->preGlobalArray(),step->preTime(),e);
+        addPoint(step->postGlobalArray(),step->postTime(),e);
+      }
+      const double w = trk->weight();
+      if (has_weight && w!=m_hitWeight)
+        throw std::runtime_error("Depositions from particles with different weights not supported.");
+      has_weight = true;
+      m_hitWeight = w;
+    }
+  }
+  m_totalEDep = edeptot;
+  calcFromPoints();
+}
+
+void FastDetHitApproximation::calcFromPoints()
+{
+  m_needCalc=false;
+  m_hit=false;
+  m_hitTime = m_hitEDep = m_hitPos[0] = m_hitPos[1] = m_hitPos[2] = 0.0;
+
+  if (m_e.empty())
+    return;
+
+  //Iteratively find weighed (by edep) center and throw away the furthest point
+  //if above dist threshold:
+  const double thrsq = m_cluster_outlier_threshold*m_cluster_outlier_threshold;
+  while (true) {
+    const std::size_t n = m_e.size();
+    const double * x = m_x.data();
+    const double * y = m_y.data();
+    const double * z = m_z.data();
+    const double * e = m_e.data();
+    double sume(0.0), sumx(0.0), sumy(0.0), sumz(0.0);
+    for (std::size_t i = 0; i < n; ++i) {
+      sume += e[i];
+      sumx += x[i]*e[i];
+      sumy += y[i]*e[i];
+      sumz += z[i]*e[i];
+    }
+    m_hitEDep = sume;
+    const double cx = sumx/sume;
+    const double cy = sumy/sume;
+    const double cz = sumz/sume;
+    m_hitPos[0] = cx;
+    m_hitPos[1] = cy;
+    m_hitPos[2] = cz;
+    m_work.resize(n);
+    double * d2 = m_work.data();
+    for (std::size_t i = 0; i < n; ++i) {
+      const double dx = x[i]-cx;
+      const double dy = y[i]-cy;
+      const double dz = z[i]-cz;
+      d2[i] = dx*dx+dy*dy+dz*dz;
+    }
+    const std::size_t imax = std::max_element(d2,d2+n) - d2;
+    if (!(d2[imax]>thrsq))
+      break;
+    removePoint(imax);
+  }
+
+  //Was there a hit?
+  m_hit = (m_hitEDep>=m_hit_edep_threshold);
+
+  if (m_hit) {
+    //Find time of hit => go through points in time order and take the time of
+    //the point at which the edep threshold is exceeded:
+    const std::size_t n = m_e.size();
+    m_order.resize(n);
+    for (std::size_t i = 0; i < n; ++i)
+      m_order[i] = i;
+    const double * t = m_t.data();
+    std::sort(m_order.begin(),m_order.end(),
+              [t](std::size_t a, std::size_t b) { return t[a] < t[b]; });
+    m_hitTime = t[m_order.back()];
+    double edep_sum(0);
+    for (std::size_t i = 0; i < n; ++i) {
+      edep_sum += m_e[m_order[i]];
+      if (edep_sum>=m_hit_edep_threshold) {
+        m_hitTime = t[m_order[i]];
+        break;
+      }
+    }
+  }
+}
+
+double FastDetHitApproximation::eventTotalEDep()
+{
+  assert(m_dr);
+  if (m_totalEDep>=0)
+    return m_totalEDep;
+  m_totalEDep = 0;
+  for (auto trk = m_dr->trackBegin(); trk!=m_dr->trackEnd(); ++trk)
+    for (auto seg = trk->segmentBegin(); seg!=trk->segmentEnd(); ++seg)
+      if (seg->eDep()>0.0 && inVolume(seg))
+        m_totalEDep += seg->eDep();
+  return m_totalEDep;
+}
+
+void FastDetHitApproximation::test()
+{
+  //Same test points as in DetHitApproximation::test(), with unit thresholds:
+  const double cthr = m_cluster_outlier_threshold;
+  const double ethr = m_hit_edep_threshold;
+  m_cluster_outlier_threshold = 1.0;
+  m_hit_edep_threshold = 1.0;
+
+  const double p1[3] = { 0, 0, 0 };
+  const double p2[3] = { 0.1, 0, 0 };
+  const double p3[3] = { 0, 0.1, 0 };
+  const double p4[3] = { 0, 0, 0.1 };
+  const double p5[3] = { 0, 0, 999.0 };
+
+  for (unsigned itest = 1; itest <= 6; ++itest) {
+    printf("TEST%i ====================================\n",itest);
+    clearPoints();
+    switch (itest) {
+    case 1:
+      addPoint(p1,10.0,1.01); addPoint(p2,11.0,1.01); addPoint(p3,12.0,1.01); addPoint(p4,13.0,1.01);
+      break;
+    case 2:
+      addPoint(p1,10.0,1.01); addPoint(p2,11.0,1.01); addPoint(p3,12.0,1.01); addPoint(p4,13.0,1.01);
+      addPoint(p5,8.0,3.01);
+      break;
+    case 3:
+      addPoint(p1,10.0,0.2*1.01); addPoint(p1,14.0,0.8*1.01); addPoint(p2,11.0,1.01); addPoint(p3,12.0,1.01);
+      addPoint(p4,13.0,1.01); addPoint(p5,8.0,3.01);
+      break;
+    case 4:
+      addPoint(p1,10.0,0.8); addPoint(p5,10.0,0.8);
+      break;
+    case 5:
+      addPoint(p4,12.0,1.8);
+      break;
+    default:
+      break;
+    }
+    calcFromPoints();
+    printf("Hit: %s\n",(eventHasHit()?"yes":"no"));
+    if (eventHasHit()) {
+      printf("Edep: %g\n",eventHitEDep());
+      printf("Time: %g\n",eventHitTime());
+      printf("Center: (%g,%g,%g)\n",eventHitPositionX(),eventHitPositionY(),eventHitPositionZ());
+    }
+  }
+  printf("TESTEND ==================================\n");
+
+  m_cluster_outlier_threshold = cthr;
+  m_hit_edep_threshold = ethr;
+  m_needCalc = true;
+}
@@ -47,6 +47,7 @@ namespace ExprParser {
     virtual ExprEntityPtr optimisedVersion() { return ExprEntityPtr(); }
     const ExprEntityList& children() const { return m_children; }
   protected:
+    friend class SharedExprSet;//replaces children with shared versions
     void optimiseChildren();
     virtual ExprEntityPtr specialOptimisedVersion() const
     {
@@ -0,0 +1,54 @@
+#ifndef ExprParser_SharedExprSet_hh
+#define ExprParser_SharedExprSet_hh
+
+//Set of expression trees in which all common subexpressions are shared. When
+//several expressions are evaluated on the same input (like a filter and a
+//quantity evaluated on the same G4Step), each distinct non-constant
+//subexpression, including the variables extracting data from the input, is
+//then only evaluated once per input.
+//
+//Trees are added after being built and optimised, and the returned trees
+//(which should be used instead of the original ones) refer to the shared
+//nodes. Non-constant shared nodes remember their value until nextGeneration()
+//is called, which must therefore happen every time the input changes. Nodes
+//are only evaluated when needed, so short-circuiting of operators like "&&"
+//works as usual.
+//
+//Nodes are considered identical when they are of the same class, have the same
+//name and identical children (or in case of constants, the same value). Thus
+//the names of variable nodes must identify the variable (as is the case for
+//values provided by the createValue method of builders).
+//
+//The set must outlive any trees added to it.
+
+#include "ExprParser/ASTNode.hh"
+#include <map>
+
+namespace ExprParser {
+
+  class SharedExprSet {
+  public:
+    SharedExprSet() : m_generation(1) {}
+    ~SharedExprSet(){}
+
+    ExprEntityPtr add(ExprEntityPtr);
+
+    //Invalidate values remembered by non-constant nodes:
+    void nextGeneration() { ++m_generation; }
+
+    //Number of distinct subexpressions in the set:
+    std::size_t size() const { return m_nodes.size(); }
+
+    SharedExprSet & operator= ( const SharedExprSet & ) = delete;
+    SharedExprSet & operator= ( SharedExprSet && ) = delete;
+    SharedExprSet( const SharedExprSet& ) = delete;
+    SharedExprSet( SharedExprSet&& ) = delete;
+
+  private:
+    std::uint64_t m_generation;
+    std::map<str_type,ExprEntityPtr> m_nodes;
+  };
+
+}
+
+#endif
@@ -0,0 +1,106 @@
+#include "ExprParser/SharedExprSet.hh"
+#include <typeinfo>
+#include <cstring>
+
+namespace ExprParser {
+
+  namespace {
+
+    class SharedNodeMarker {
+    public:
+      virtual ~SharedNodeMarker(){}
+    };
+
+    template<class TValue>
+    class ExprEntity_Shared final : public ExprEntity<TValue>, public SharedNodeMarker {
+      //Evaluates its child at most once per generation of the owning set:
+    public:
+      ExprEntity_Shared(ExprEntityPtr arg, const std::uint64_t& generation)
+        : ExprEntity<TValue>(), m_generation(generation), m_valgen(0), m_val()
+      {
+        this->m_children.push_back(arg);
+      }
+      virtual ~ExprEntity_Shared(){}
+      virtual str_type name() const { return str_type("Shared_")+exprTypeChar<TValue>(); }
+      virtual bool isConstant() const { return false; }
+      virtual ExprEntityPtr optimisedVersion() { return ExprEntityPtr(); }
+      virtual TValue evaluate() const
+      {
+        if (m_valgen != m_generation) {
+          m_val = _eval<TValue>(this->child(0));
+          m_valgen = m_generation;
+        }
+        return m_val;
+      }
+    private:
+      const std::uint64_t& m_generation;
+      mutable std::uint64_t m_valgen;
+      mutable TValue m_val;
+    };
+
+    template<class TValue>
+    bool appendConstantValue(str_type& key, const ExprEntityBase* p)
+    {
+      auto c = dynamic_cast<const ExprEntityConstantValue<TValue>*>(p);
+      if (!c)
+        return false;
+      const TValue v = c->evaluate();
+      char buf[sizeof(TValue)];
+      std::memcpy(buf,&v,sizeof(TValue));//exact bit pattern (distinguishes -0.0, nan's, ...)
+      key.append(buf,sizeof(TValue));
+      return true;
+    }
+
+    template<>
+    bool appendConstantValue<str_type>(str_type& key, const ExprEntityBase* p)
+    {
+      auto c = dynamic_cast<const ExprEntityConstantValue<str_type>*>(p);
+      if (!c)
+        return false;
+      const str_type v = c->evaluate();
+      key += std::to_string(v.size());
+      key += ':';
+      key += v;
+      return true;
+    }
+  }
+
+  ExprEntityPtr SharedExprSet::add(ExprEntityPtr p)
+  {
+    if (!p || dynamic_cast<const SharedNodeMarker*>(p.get()))
+      return p;
+
+    //Share children first, so identical subtrees end up with identical child
+    //pointers below:
+    for (auto& c : p->m_children)
+      c = add(c);
+
+    str_type key(typeid(*p).name());
+    key += '\n';
+    key += p->name();
+    key += '\n';
+    for (auto& c : p->m_children) {
+      const void * addr = c.get();
+      key.append(reinterpret_cast<const char*>(&addr),sizeof(addr));
+    }
+    appendConstantValue<float_type>(key,p.get())
+      || appendConstantValue<int_type>(key,p.get())
+      || appendConstantValue<str_type>(key,p.get());
+
+    auto it = m_nodes.find(key);
+    if (it != m_nodes.end())
+      return it->second;
+
+    ExprEntityPtr shared = p;
+    if (!p->isConstant()) {
+      switch (p->returnType()) {
+      case ET_FLOAT: shared = makeobj<ExprEntity_Shared<float_type>>(p,m_generation); break;
+      case ET_INT: shared = makeobj<ExprEntity_Shared<int_type>>(p,m_generation); break;
+      case ET_STRING: shared = makeobj<ExprEntity_Shared<str_type>>(p,m_generation); break;
+      }
+    }
+    m_nodes[key] = shared;
+    return shared;
+  }
+
+}
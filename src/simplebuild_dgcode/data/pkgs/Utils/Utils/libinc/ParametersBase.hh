@@ -7,6 +7,31 @@
 
 namespace Utils {
 
+  class ParametersBase;
+
+  //Typed handle to a parameter, as returned by the addParameterXXX methods
+  //below. Reading the value through a handle involves no string comparisons or
+  //map lookups, so handles are the preferred way to access parameters in code
+  //which is called often (like the gen() method of a particle generator or the
+  //filterStep() method of a step filter). Like getParameterXXX(..), reading the
+  //value locks the owning object. Handles must not be used after the owning
+  //object is deleted. TValue is double, int, bool or std::string.
+
+  template<class TValue>
+  class ParamHandle {
+  public:
+    ParamHandle() : m_val(nullptr), m_locked(nullptr), m_pb(nullptr) {}
+    const TValue& get() const;
+    operator const TValue&() const { return get(); }
+    bool isValid() const { return m_val!=nullptr; }
+  private:
+    friend class ParametersBase;
+    ParamHandle(const TValue* v, const bool* l, ParametersBase* pb) : m_val(v), m_locked(l), m_pb(pb) {}
+    const TValue* m_val;
+    const bool* m_locked;
+    ParametersBase* m_pb;
+  };
+
   //Base class for objects which must be configurable with a declarable and
   //printable list of parameters. Each parameter must be either a bool, a
   //double, an integer or a string. In the case of ints and doubles, it is
@@ -89,17 +114,26 @@ namespace Utils {
     //Expose all paramters, except those in an exclusion list:
     void exposeParameters(ParametersBase * other, const ParameterSet& excluded_pars, const std::string& prefix = "", bool tieOnClash = false );
 
+    //Handles to existing parameters (e.g. those added by a base class or
+    //exposed from another object). Unknown names or wrong types are errors:
+    ParamHandle<double> getParameterHandleDouble(const std::string&name);
+    ParamHandle<int> getParameterHandleInt(const std::string&name);
+    ParamHandle<bool> getParameterHandleBoolean(const std::string&name);
+    ParamHandle<std::string> getParameterHandleString(const std::string&name);
+
     //Ideas for future uses of the "tie" feature:
     //  tieAllParameters(ParametersBase * other, const std::string& prefix = "");
     //  tieParameters(ParametersBase * other, const ParameterList&, const std::string& prefix = "");
   protected:
-    //To be called in the constructor of derived classes, defining which parameters are available:
-    void addParameterDouble(const std::string&name, double default_value);
-    void addParameterDouble(const std::string&name, double default_value, double valmin, double valmax);
-    void addParameterInt(const std::string&name, int default_value);
-    void addParameterInt(const std::string&name, int default_value, int valmin, int valmax);
-    void addParameterBoolean(const std::string&name, bool default_value);
-    void addParameterString(const std::string&name, const std::string& default_value);
+    //To be called in the constructor of derived classes, defining which
+    //parameters are available. The returned handles can optionally be kept for
+    //fast access to the values later:
+    ParamHandle<double> addParameterDouble(const std::string&name, double default_value);
+    ParamHandle<double> addParameterDouble(const std::string&name, double default_value, double valmin, double valmax);
+    ParamHandle<int> addParameterInt(const std::string&name, int default_value);
+    ParamHandle<int> addParameterInt(const std::string&name, int default_value, int valmin, int valmax);
+    ParamHandle<bool> addParameterBoolean(const std::string&name, bool default_value);
+    ParamHandle<std::string> addParameterString(const std::string&name, const std::string& default_value);
 
     virtual bool validateParameters() { return true; }//called when settings are locked, to ensure consistency beyond the min/max checks.
     //NB: it is still allowed to set parameters inside
@@ -131,7 +165,17 @@ namespace Utils {
   private:
     struct Imp;
     Imp * m_imp;
+    template<class TValue, class Tmap>
+    ParamHandle<TValue> createHandle(const std::string&name, Tmap&);
   };
+
+  template<class TValue>
+  inline const TValue& ParamHandle<TValue>::get() const
+  {
+    if (!*m_locked)
+      m_pb->lock();
+    return *m_val;
+  }
 }
 
 #endif
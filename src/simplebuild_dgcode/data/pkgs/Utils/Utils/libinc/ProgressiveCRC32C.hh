@@ -0,0 +1,39 @@
+#ifndef Utils_ProgressiveCRC32C_hh
+#define Utils_ProgressiveCRC32C_hh
+
+//Progressive calculation of CRC32C checksums (the Castagnoli polynomial used
+//in iSCSI, ext4, etc.), with the same interface as ProgressiveHash.
+//
+//On x86-64 CPUs with SSE4.2 (and on ARMv8 builds with the CRC extension) the
+//dedicated CPU instructions are used, which for data in the CPU caches is
+//several times faster than MurmurHash3. Elsewhere, a portable "slicing-by-8"
+//table implementation is used, which is somewhat slower than MurmurHash3. The
+//results are of course identical in all cases.
+
+#include "Core/Types.hh"
+
+class ProgressiveCRC32C {
+public:
+
+  typedef std::uint32_t hashtype;
+
+  ProgressiveCRC32C() { reset(); }
+  ~ProgressiveCRC32C(){}
+
+  void addData(const char*, unsigned len);
+
+  hashtype getHash() const { return ~m_crc; }//CRC of all data added so far
+
+  void reset() { m_crc = 0xFFFFFFFF; }//Forgets all added data.
+
+  //Whether CPU instructions are used. Hardware acceleration can be disabled
+  //for testing and benchmarking purposes (not thread-safe, so only do this
+  //while no other threads calculate checksums):
+  static bool hardwareAccelerated();
+  static void setHardwareAccelerationEnabled(bool);
+
+private:
+  std::uint32_t m_crc;
+};
+
+#endif
@@ -308,34 +308,77 @@ void Utils::ParametersBase::Imp::lock() const
   m_validating=false;
 }
 
-void Utils::ParametersBase::addParameterDouble(const std::string&name, double default_value)
+template<class TValue, class Tmap>
+Utils::ParamHandle<TValue> Utils::ParametersBase::createHandle(const std::string&name, Tmap& themap)
+{
+  //Nodes in std::map's never move, so the handle can refer directly to the
+  //value inside:
+  auto it = themap.find(name);
+  if (it==themap.end()) {
+    std::cout<<std::flush;
+    if (m_imp->m_allnames.count(name)>0)
+      printf("\nParameters ERROR: Type mismatch when attempting to get handle to parameter %s!\n",name.c_str());
+    else
+      printf("\nParameters ERROR: Attempt to get handle to unknown parameter %s!\n",name.c_str());
+    m_imp->fail();
+  }
+  return ParamHandle<TValue>(&it->second.current_val,&m_imp->m_locked,this);
+}
+
+Utils::ParamHandle<double> Utils::ParametersBase::addParameterDouble(const std::string&name, double default_value)
 {
   m_imp->mapAdd(name,m_imp->m_mapDouble,Imp::ValDouble(default_value),0);
+  return createHandle<double>(name,m_imp->m_mapDouble);
 }
 
-void Utils::ParametersBase::addParameterDouble(const std::string&name, double default_value,double valmin, double valmax)
+Utils::ParamHandle<double> Utils::ParametersBase::addParameterDouble(const std::string&name, double default_value,double valmin, double valmax)
 {
   m_imp->mapAdd(name,m_imp->m_mapDouble,Imp::ValDouble(default_value,valmin,valmax),0);
+  return createHandle<double>(name,m_imp->m_mapDouble);
 }
 
-void Utils::ParametersBase::addParameterInt(const std::string&name, int default_value)
+Utils::ParamHandle<int> Utils::ParametersBase::addParameterInt(const std::string&name, int default_value)
 {
   m_imp->mapAdd(name,m_imp->m_mapInt,Imp::ValInt(default_value),1);
+  return createHandle<int>(name,m_imp->m_mapInt);
 }
 
-void Utils::ParametersBase::addParameterInt(const std::string&name, int default_value,int valmin, int valmax)
+Utils::ParamHandle<int> Utils::ParametersBase::addParameterInt(const std::string&name, int default_value,int valmin, int valmax)
 {
   m_imp->mapAdd(name,m_imp->m_mapInt,Imp::ValInt(default_value,valmin,valmax),1);
+  return createHandle<int>(name,m_imp->m_mapInt);
 }
 
-void Utils::ParametersBase::addParameterBoolean(const std::string&name, bool default_value)
+Utils::ParamHandle<bool> Utils::ParametersBase::addParameterBoolean(const std::string&name, bool default_value)
 {
   m_imp->mapAdd(name,m_imp->m_mapBool,Imp::ValBool(default_value),2);
+  return createHandle<bool>(name,m_imp->m_mapBool);
 }
 
-void Utils::ParametersBase::addParameterString(const std::string&name, const std::string& default_value)
+Utils::ParamHandle<std::string> Utils::ParametersBase::addParameterString(const std::string&name, const std::string& default_value)
 {
   m_imp->mapAdd(name,m_imp->m_mapStr,Imp::ValStr(default_value),3);
+  return createHandle<std::string>(name,m_imp->m_mapStr);
+}
+
+Utils::ParamHandle<double> Utils::ParametersBase::getParameterHandleDouble(const std::string&name)
+{
+  return createHandle<double>(name,m_imp->m_mapDouble);
+}
+
+Utils::ParamHandle<int> Utils::ParametersBase::getParameterHandleInt(const std::string&name)
+{
+  return createHandle<int>(name,m_imp->m_mapInt);
+}
+
+Utils::ParamHandle<bool> Utils::ParametersBase::getParameterHandleBoolean(const std::string&name)
+{
+  return createHandle<bool>(name,m_imp->m_mapBool);
+}
+
+Utils::ParamHandle<std::string> Utils::ParametersBase::getParameterHandleString(const std::string&name)
+{
+  return createHandle<std::string>(name,m_imp->m_mapStr);
 }
 
 double Utils::ParametersBase::getParameterDouble(const std::string&name) const
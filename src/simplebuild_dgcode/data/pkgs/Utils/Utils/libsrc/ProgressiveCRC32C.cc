@@ -0,0 +1,154 @@
+#include "Utils/ProgressiveCRC32C.hh"
+#include <cstring>
+#include <cstddef>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#  define UTILS_CRC32C_X86
+#  include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#  define UTILS_CRC32C_ARM
+#  include <arm_acle.h>
+#endif
+
+namespace {
+
+  typedef std::uint32_t (*crc32c_fct)(std::uint32_t, const unsigned char*, std::size_t);
+
+  struct CRC32CTables {
+    std::uint32_t t[8][256];
+    CRC32CTables()
+    {
+      //Reflected Castagnoli polynomial:
+      const std::uint32_t poly = 0x82F63B78;
+      for (unsigned i = 0; i < 256; ++i) {
+        std::uint32_t c = i;
+        for (int k = 0; k < 8; ++k)
+          c = (c & 1) ? (c >> 1) ^ poly : (c >> 1);
+        t[0][i] = c;
+      }
+      for (unsigned i = 0; i < 256; ++i)
+        for (int k = 1; k < 8; ++k)
+          t[k][i] = (t[k-1][i] >> 8) ^ t[0][t[k-1][i] & 0xFF];
+    }
+  };
+
+  std::uint32_t crc32c_portable(std::uint32_t crc, const unsigned char* p, std::size_t n)
+  {
+    static const CRC32CTables tables;
+    const auto& t = tables.t;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    //Process 8 bytes at a time ("slicing-by-8"):
+    for (; n >= 8; n -= 8, p += 8) {
+      std::uint32_t one, two;
+      std::memcpy(&one,p,4);
+      std::memcpy(&two,p+4,4);
+      one ^= crc;
+      crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24]
+        ^ t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+    }
+#endif
+    for (; n; --n, ++p)
+      crc = t[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+    return crc;
+  }
+
+#if defined(UTILS_CRC32C_X86)
+  __attribute__((target("sse4.2")))
+  std::uint32_t crc32c_hw_simple(std::uint32_t crc, const unsigned char* p, std::size_t n)
+  {
+    std::uint64_t c = crc;
+    for (; n >= 8; n -= 8, p += 8) {
+      std::uint64_t w;
+      std::memcpy(&w,p,8);
+      c = _mm_crc32_u64(c,w);
+    }
+    crc = static_cast<std::uint32_t>(c);
+    for (; n; --n, ++p)
+      crc = _mm_crc32_u8(crc,*p);
+    return crc;
+  }
+
+  //The crc32 instruction has a latency of three cycles but a throughput of one
+  //per cycle, so larger blocks are processed as three interleaved streams whose
+  //CRCs are combined afterwards. Combining requires "shifting" a CRC over
+  //STREAMLEN zero bytes, which is a linear operation on the bits of the CRC and
+  //therefore done with lookup tables:
+  const std::size_t STREAMLEN = 1024;
+  struct CRC32CShiftTables {
+    std::uint32_t t[4][256];
+    CRC32CShiftTables()
+    {
+      static const unsigned char zeros[STREAMLEN] = {};
+      for (unsigned j = 0; j < 4; ++j)
+        for (unsigned i = 0; i < 256; ++i)
+          t[j][i] = crc32c_hw_simple(std::uint32_t(i) << (8*j), zeros, STREAMLEN);
+    }
+    std::uint32_t shift(std::uint32_t crc) const
+    {
+      return t[0][crc & 0xFF] ^ t[1][(crc >> 8) & 0xFF] ^ t[2][(crc >> 16) & 0xFF] ^ t[3][crc >> 24];
+    }
+  };
+
+  __attribute__((target("sse4.2")))
+  std::uint32_t crc32c_hw(std::uint32_t crc, const unsigned char* p, std::size_t n)
+  {
+    if (n >= 3*STREAMLEN) {
+      static const CRC32CShiftTables shifttables;
+      for (; n >= 3*STREAMLEN; n -= 3*STREAMLEN, p += 3*STREAMLEN) {
+        std::uint64_t c0 = crc, c1 = 0, c2 = 0;
+        for (std::size_t i = 0; i < STREAMLEN; i += 8) {
+          std::uint64_t w0, w1, w2;
+          std::memcpy(&w0,p+i,8);
+          std::memcpy(&w1,p+STREAMLEN+i,8);
+          std::memcpy(&w2,p+2*STREAMLEN+i,8);
+          c0 = _mm_crc32_u64(c0,w0);
+          c1 = _mm_crc32_u64(c1,w1);
+          c2 = _mm_crc32_u64(c2,w2);
+        }
+        crc = shifttables.shift(static_cast<std::uint32_t>(c0)) ^ static_cast<std::uint32_t>(c1);
+        crc = shifttables.shift(crc) ^ static_cast<std::uint32_t>(c2);
+      }
+    }
+    return crc32c_hw_simple(crc,p,n);
+  }
+  bool crc32c_hw_available() { return __builtin_cpu_supports("sse4.2"); }
+#elif defined(UTILS_CRC32C_ARM)
+  std::uint32_t crc32c_hw(std::uint32_t crc, const unsigned char* p, std::size_t n)
+  {
+    for (; n >= 8; n -= 8, p += 8) {
+      std::uint64_t w;
+      std::memcpy(&w,p,8);
+      crc = __crc32cd(crc,w);
+    }
+    for (; n; --n, ++p)
+      crc = __crc32cb(crc,*p);
+    return crc;
+  }
+  bool crc32c_hw_available() { return true; }
+#else
+  crc32c_fct crc32c_hw = nullptr;
+  bool crc32c_hw_available() { return false; }
+#endif
+
+  crc32c_fct& crc32c_impl()
+  {
+    static crc32c_fct f = crc32c_hw_available() ? crc32c_hw : crc32c_portable;
+    return f;
+  }
+
+}
+
+void ProgressiveCRC32C::addData(const char* data, unsigned len)
+{
+  m_crc = crc32c_impl()(m_crc, reinterpret_cast<const unsigned char*>(data), len);
+}
+
+bool ProgressiveCRC32C::hardwareAccelerated()
+{
+  return crc32c_impl() != crc32c_portable;
+}
+
+void ProgressiveCRC32C::setHardwareAccelerationEnabled(bool b)
+{
+  crc32c_impl() = ( b && crc32c_hw_available() ) ? crc32c_hw : crc32c_portable;
+}
@@ -2,12 +2,106 @@ import Core.System as Sys
 import re
 import pathlib
 import os
+import functools
 
-def rung4_extract_xs(element_or_isotope,physlist='QGSP_BIC_HP_EMZ',particle='neutron',verbose=False,
-                     parse_results_fct = None):
-    if parse_results_fct is None:
-        import XSectParse.ParseXSectFile
-        parse_results_fct = XSectParse.ParseXSectFile.parse
+def _g4version():
+    import G4Launcher
+    return G4Launcher.g4version()
+
+@functools.lru_cache()
+def material_definition(matname):
+    """Resolved definition of a material given in NamedMaterialProvider syntax,
+    for use in the keys of cached tables: The G4Material (and any NCrystal
+    scatter physics) as printed by sb_g4materials_dump, followed by the contents
+    of any NCrystal data files the material string refers to."""
+    import subprocess
+    rv = subprocess.run(['sb_g4materials_dump',matname],stdout=subprocess.PIPE,stderr=subprocess.STDOUT)
+    if rv.returncode!=0:
+        raise RuntimeError(f'Could not resolve material "{matname}":\n{rv.stdout.decode(errors="replace")}')
+    parts = [rv.stdout.decode(errors='replace')]
+    for datafile in sorted(set(re.findall(r'[^\s;:<>]+\.ncmat',matname))):
+        try:
+            import NCrystal
+            parts.append(NCrystal.createTextData(datafile).rawData)
+        except Exception:
+            p = pathlib.Path(datafile)
+            if p.is_file():
+                parts.append(p.read_text(errors='replace'))
+    return '\n'.join(parts)
+
+def _run_query(matname,physlist,particle,workdir,verbose,use_cache,cachedir):
+    """Launch a Geant4 job producing the XSectSpy file for a single
+    (material,particle) pair in workdir (and adding it to the cache when
+    use_cache is set). Returns path to the file. Does not change the current
+    working directory, so can be invoked from several threads at once."""
+    import subprocess
+    g4cmd=['sb_g4xsectdump_query',f'-p{particle}',f'-l{physlist}',f'-m{matname}','--noshow','--nofile']
+    if not use_cache:
+        g4cmd += ['--nocache']
+    env = None
+    if cachedir:
+        env = os.environ.copy()
+        env['G4XSECTSPY_CACHEDIR'] = str(cachedir)
+    if verbose:
+        print("Launching: %s"%Sys.quote_cmd(g4cmd))
+    rv = subprocess.run(g4cmd,cwd=workdir,env=env,
+                        stdout=None if verbose else subprocess.DEVNULL,
+                        stderr=None if verbose else subprocess.STDOUT)
+    if rv.returncode!=0:
+        raise RuntimeError(f'Command failed: {Sys.quote_cmd(g4cmd)}')
+    #Named by XSectSpy after the Geant4 particle and material names, which
+    #might differ from those given (e.g. when the particle is a PDG code):
+    outfiles = list(pathlib.Path(workdir).glob('xsects_discreteprocs_*.txt'))
+    if len(outfiles)!=1:
+        raise RuntimeError(f'Did not find expected output file of: {Sys.quote_cmd(g4cmd)}')
+    return outfiles[0]
+
+def extract_xs(matname,physlist='QGSP_BIC_HP_EMZ',particle='neutron',verbose=False,use_cache=True,cachedir=None):
+    """Get parsed cross sections (as XSectParse.ParseXSectFile.parse) for the given
+    material (NamedMaterialProvider syntax). Unless use_cache=False, tables
+    are taken from the XSectParse.XSectCache when available, and stored there
+    when not."""
+    import XSectParse.XSectCache as XC
+    import XSectParse.ParseXSectFile
+    if use_cache:
+        key, _ = XC.table_key(physlist,_g4version(),matname,material_definition(matname),particle)
+        res = XC.load(key,cachedir)
+        if res is not None:
+            if verbose:
+                print(f'Cross sections for {particle} in {matname} ({physlist}) taken from cache')
+            return res
+    import tempfile
+    with tempfile.TemporaryDirectory() as tmpdir:
+        if verbose:
+            print("Working in temporary directory: %s"%tmpdir)
+        outfile = _run_query(matname,physlist,particle,tmpdir,verbose,use_cache,cachedir)
+        res = XC.load(key,cachedir) if use_cache else None
+        if res is None:
+            if verbose:
+                print("Parsing output.")
+            res = XSectParse.ParseXSectFile.parse(outfile)
+        return res
+
+def build_cache(matnames,physlist='QGSP_BIC_HP_EMZ',particle='neutron',nprocs=None,verbose=False,cachedir=None):
+    """Make sure the cache contains tables for all the listed materials, running
+    up to nprocs Geant4 jobs in parallel for those which are missing (default is
+    the number of CPUs). Returns list of materials for which tables were
+    built."""
+    import XSectParse.XSectCache as XC
+    from concurrent.futures import ThreadPoolExecutor
+    g4v = _g4version()
+    missing = [m for m in dict.fromkeys(matnames)
+               if XC.load(XC.table_key(physlist,g4v,m,material_definition(m),particle)[0],cachedir) is None]
+    if not missing:
+        return []
+    def build(m):
+        print(f'Building cross sections for {particle} in {m} ({physlist})')
+        extract_xs(m,physlist=physlist,particle=particle,verbose=verbose,cachedir=cachedir)
+        return m
+    with ThreadPoolExecutor(max_workers = nprocs or os.cpu_count() or 1) as pool:
+        return list(pool.map(build,missing))
+
+def _element_matname(element_or_isotope):
     parts=[e.strip() for e in re.split(r'(\d+)', element_or_isotope) if e.strip() ]#split on digits
     if len(parts)==1:
         parts+=['0']
@@ -15,23 +109,31 @@ def rung4_extract_xs(element_or_isotope,physlist='QGSP_BIC_HP_EMZ',particle='neu
         raise RuntimeError(f'Invalid element specification: "{element_or_isotope}"'
                            +' (examples of valid ones are "H", "Fe", Fe56", "B10", ...)')
     element,A = parts[0],int(parts[1])
-    matname = f'gasmix::{element}{A or ""}'
-    g4cmd=['sb_g4xsectdump_query',f'-p{particle}',f'-l{physlist}',f'-m{matname}','--noshow']
-    g4cmd = Sys.quote_cmd(g4cmd)
-    with Sys.work_in_tmpdir():
-        print("Working in temporary directory: %s"%os.getcwd())
-        print("Launching: %s"%g4cmd)
-        Sys.system_throw(g4cmd,catch_output=not verbose)
-        print("Parsing output.")
-
-        expected_outfilename = f'xsects_discreteprocs_{particle}__{matname}__{physlist}.txt'
-        outfile = pathlib.Path(expected_outfilename)
-        if not outfile.exists():
-            raise RuntimeError(f'Did not find expected output file: {expected_outfilename}')
-        return parse_results_fct(outfile.resolve(strict=True))
+    return f'gasmix::{element}{A or ""}'
+
+def rung4_extract_xs(element_or_isotope,physlist='QGSP_BIC_HP_EMZ',particle='neutron',verbose=False,
+                     parse_results_fct = None, use_cache = True):
+    """Get cross sections for the given element or isotope. By default they are
+    returned as parsed by XSectParse.ParseXSectFile.parse, otherwise
+    parse_results_fct is called with the path to the XSectSpy file (which is a
+    copy in the cache when use_cache is set)."""
+    matname = _element_matname(element_or_isotope)
+    if parse_results_fct is None:
+        return extract_xs( matname, physlist=physlist, particle=particle,
+                           verbose=verbose, use_cache=use_cache )
+    if use_cache:
+        import XSectParse.XSectCache as XC
+        key, _ = XC.table_key(physlist,_g4version(),matname,material_definition(matname),particle)
+        if XC.load(key) is None:
+            extract_xs( matname, physlist=physlist, particle=particle, verbose=verbose )
+        res = XC.load(key)
+        if res is not None:
+            return parse_results_fct(pathlib.Path(res['cachedfile']))
+    import tempfile
+    with tempfile.TemporaryDirectory() as tmpdir:
+        outfile = _run_query(matname,physlist,particle,tmpdir,verbose,False,None)
+        return parse_results_fct(outfile)
 
 def rung4_extract_collapsed_neutronxs(element_or_isotope,**kwargs):
     import XSectParse.ParseXSectFile
-    return rung4_extract_xs( element_or_isotope,
-                             parse_results_fct = XSectParse.ParseXSectFile.extract_neutron_xs,
-                             **kwargs )
+    return XSectParse.ParseXSectFile.extract_neutron_xs( rung4_extract_xs( element_or_isotope, **kwargs ) )
@@ -4,6 +4,8 @@ import numpy as np
 import copy
 
 def parse(fh):
+    if isinstance(fh,dict):
+        return fh#already parsed (e.g. loaded via XSectParse.XSectCache)
     metadata={}
     procs={}
     if isinstance(fh,str):
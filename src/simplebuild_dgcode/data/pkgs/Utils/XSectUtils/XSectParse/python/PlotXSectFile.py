@@ -1,4 +1,4 @@
-import XSectParse.ParseXSectFile
+import XSectParse.XSectCache
 from Utils.NeutronMath import neutron_eV_to_angstrom
 import numpy as np
 import Units
@@ -93,7 +93,7 @@ def plot_file( filename,
     _plot_begin()
     showMFP=mfp
     colors_nored = ['c', 'm', 'y','k','g','b']
-    p=XSectParse.ParseXSectFile.parse(filename)
+    p=XSectParse.XSectCache.parse_cached(filename)
     md=p['metadata']
     procs=p['procs']
     physlist = md.get('PhysicsList',None)#not present in older files
@@ -157,7 +157,7 @@ def plot_file_cmp(filenames,mfp=False,save_fig=None,show=None,
         labelstyle_gen = default_labelstyle_gen
 
     colors = ['r','c', 'm', 'y','k','g','b','orange','yellow']
-    pp=[XSectParse.ParseXSectFile.parse(filename) for filename in filenames]
+    pp=[XSectParse.XSectCache.parse_cached(filename) for filename in filenames]
 
     for ifile,p in enumerate(pp):
         npa=np.asarray(p['procs'][xsectname])
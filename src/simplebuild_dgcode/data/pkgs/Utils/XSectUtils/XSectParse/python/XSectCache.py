@@ -0,0 +1,117 @@
+"""Persistent binary cache of cross-section tables.
+
+Tables are stored in a cache directory (default /tmp/<username>/dgcode_xsectcache,
+override with the G4XSECTSPY_CACHEDIR environment variable or by passing
+cachedir explicitly). Each entry consists of three files named after a hash of
+the key:
+
+  <key>.npy  : All (energy,xsect,mfp) points of all processes concatenated in
+               a single float64 array of shape (N,3), in internal units.
+  <key>.json : Metadata, key information, [begin,end) row ranges of each
+               process in the .npy file and extra information (like the name
+               of the file originally written by XSectSpy).
+  <key>.txt  : The original XSectSpy text file, for tools requiring a file.
+
+The .npy files are memory-mapped when loaded, so looking up a table costs
+milliseconds rather than a full Geant4 physics initialisation.
+"""
+
+import os
+import json
+import hashlib
+import pathlib
+import shutil
+import getpass
+import numpy as np
+
+def _default_cachedir():
+    return pathlib.Path('/tmp') / getpass.getuser() / 'dgcode_xsectcache'
+
+def cache_dir(cachedir=None):
+    """Return (and create if needed) the cache directory"""
+    cachedir = cachedir or os.environ.get('G4XSECTSPY_CACHEDIR')
+    p = pathlib.Path(os.path.expanduser(os.path.expandvars(cachedir))) if cachedir else _default_cachedir()
+    p.mkdir(parents=True,exist_ok=True)
+    return p
+
+def sampling_params():
+    """Granularity settings used by XSectSpy (see G4XSECTSPY_NSAMPLE and
+    G4XSECTSPY_LOGDELTAE). These are part of the key of any table."""
+    return dict( nsample = float(os.environ.get('G4XSECTSPY_NSAMPLE') or 0.0) or 50.0,
+                 logdeltae = float(os.environ.get('G4XSECTSPY_LOGDELTAE') or 0.0) or 0.005 )
+
+def table_key(physlist,g4version,material,matdef,particle,**sampling):
+    """Key of a table. The material is the NamedMaterialProvider string used to
+    create it, and matdef its resolved definition (see
+    G4XSectDump.query.material_definition), so tables are rebuilt when the
+    material string is the same but the material is not (for instance when the
+    NCrystal file it refers to was changed)."""
+    if not sampling:
+        sampling = sampling_params()
+    keyinfo = dict( physlist = str(physlist),
+                    g4version = int(g4version),
+                    material = str(material),
+                    matdef = hashlib.sha1(matdef.encode()).hexdigest(),
+                    particle = str(particle),
+                    nsample = float(sampling['nsample']),
+                    logdeltae = float(sampling['logdeltae']) )
+    h = hashlib.sha1(json.dumps(keyinfo,sort_keys=True).encode()).hexdigest()
+    return h, keyinfo
+
+def _paths(key,cachedir):
+    d = cache_dir(cachedir)
+    return d / f'{key}.npy', d / f'{key}.json', d / f'{key}.txt'
+
+def store(key,keyinfo,xsectfile,parsed=None,extra=None,cachedir=None):
+    """Add table from XSectSpy text file to the cache. The entry is written under
+    temporary names and then renamed, so concurrent builders and readers never
+    see partial entries."""
+    import XSectParse.ParseXSectFile
+    if parsed is None:
+        parsed = XSectParse.ParseXSectFile.parse(pathlib.Path(xsectfile))
+    f_npy, f_json, f_txt = _paths(key,cachedir)
+    procs, blocks, n = [], [], 0
+    for procname, arr in parsed['procs'].items():
+        arr = np.asarray(arr,dtype=np.float64).reshape(-1,3)
+        procs.append( (procname, n, n+len(arr)) )
+        blocks.append(arr)
+        n += len(arr)
+    allpts = np.concatenate(blocks,0) if blocks else np.zeros((0,3))
+    info = dict( key = keyinfo, metadata = parsed['metadata'], procs = procs, extra = extra or {} )
+    tmpsuffix = '.tmp%i'%os.getpid()
+    tmp_npy = f_npy.with_name(f_npy.name+tmpsuffix)
+    with tmp_npy.open('wb') as fh:
+        np.save(fh,allpts)
+    tmp_txt = f_txt.with_name(f_txt.name+tmpsuffix)
+    shutil.copyfile(xsectfile,tmp_txt)
+    tmp_json = f_json.with_name(f_json.name+tmpsuffix)
+    tmp_json.write_text(json.dumps(info))
+    tmp_npy.replace(f_npy)
+    tmp_txt.replace(f_txt)
+    tmp_json.replace(f_json)#json last: marks entry as complete
+    return f_txt
+
+def load(key,cachedir=None):
+    """Load table from cache with arrays memory-mapped, in the same format as
+    returned by XSectParse.ParseXSectFile.parse. Returns None if not present."""
+    f_npy, f_json, f_txt = _paths(key,cachedir)
+    if not f_json.exists():
+        return None
+    info = json.loads(f_json.read_text())
+    allpts = np.load(f_npy,mmap_mode='r')
+    procs = dict( (procname, allpts[b:e]) for procname,b,e in info['procs'] )
+    return { 'metadata':info['metadata'], 'procs':procs,
+             'extra':info.get('extra',{}), 'cachedfile':f_txt }
+
+def parse_cached(filename,cachedir=None):
+    """Like XSectParse.ParseXSectFile.parse(filename), but keeping a binary copy
+    of the parsed file in the cache (keyed on path, size and modification
+    time), so repeated parsing of the same files becomes a memory-map."""
+    p = pathlib.Path(filename).resolve()
+    st = p.stat()
+    key = hashlib.sha1(f'file:{p}:{st.st_size}:{st.st_mtime_ns}'.encode()).hexdigest()
+    res = load(key,cachedir)
+    if res is None:
+        store(key,dict(file=str(p)),p,cachedir=cachedir)
+        res = load(key,cachedir)
+    return res
@@ -2,22 +2,128 @@
 #define Utils_Compress_hh
 
 #include "Utils/DynBuffer.hh"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
 
 namespace ZLibUtils {
-  //Will perform zlib compression on indata and places it in output. Note that
-  //for performance reasons, output is clear()'ed internally and memory
-  //allocated with reserve(). It will thus have size()==0, and you have to
-  //inspect outdataLength to see the resulting amount of uncompressed data. This
-  //allows the caller to recycle the output buffer.
-
-  //Note from TK ~10 years later: This is not exactly a great way to do it - and
-  //perhaps even UB. Moving to custom DynBuffer.
+  //Will perform zlib compression on indata and places it in output, prefixed
+  //with the original size as a 4 byte integer. The output is resized to the
+  //amount of compressed data (also returned in outdataLength), but its memory
+  //is reused if possible, so callers can recycle the output buffer.
+  //
+  //These one-shot functions set up and tear down the zlib stream state on each
+  //call. When compressing or decompressing many (small) buffers, use the
+  //Compressor and Decompressor classes below instead.
 
   void compressToBuffer( const char* indata, unsigned indataLength,
                          Utils::DynBuffer<char>& output,
                          unsigned& outdataLength );
   void decompressToBufferNew( const char* indata, unsigned indataLength,
                               Utils::DynBuffer<char>& output );
+
+  //Stateful versions of the functions above, producing and accepting exactly
+  //the same data. The zlib stream state is kept and reset between calls, which
+  //is considerably faster for small buffers.
+  //
+  //Optionally a preset dictionary can be set, containing byte sequences which
+  //are common in the data (e.g. a typical Griff full data section). This
+  //improves the compression of small buffers, but the data can then only be
+  //decompressed with the same dictionary (verified by zlib via its adler32
+  //checksum, see dictionaryID(..)). Only the last 32kB of a dictionary are used.
+
+  class Compressor {
+  public:
+    Compressor( int level = -1 );//zlib compression level (-1 means the zlib default)
+    ~Compressor();
+
+    //Set dictionary (contents are copied, empty dictionary means none):
+    void setDictionary( const char* dict, unsigned dictLength );
+    bool hasDictionary() const;
+
+    //Compress indata into output (output.size() will be the compressed size):
+    void compress( const char* indata, unsigned indataLength,
+                   Utils::DynBuffer<char>& output );
+  private:
+    Compressor( const Compressor& ) = delete;
+    Compressor& operator=( const Compressor& ) = delete;
+    struct Imp;
+    Imp * m_imp;
+  };
+
+  class Decompressor {
+  public:
+    Decompressor();
+    ~Decompressor();
+
+    //Set dictionary (contents are copied, empty dictionary means none):
+    void setDictionary( const char* dict, unsigned dictLength );
+    bool hasDictionary() const;
+
+    //Decompress indata into output (output.size() will be the original size):
+    void decompress( const char* indata, unsigned indataLength,
+                     Utils::DynBuffer<char>& output );
+  private:
+    Decompressor( const Decompressor& ) = delete;
+    Decompressor& operator=( const Decompressor& ) = delete;
+    struct Imp;
+    Imp * m_imp;
+  };
+
+  //The adler32 checksum of a dictionary, which zlib stores in data compressed
+  //with it:
+  std::uint32_t dictionaryID( const char* dict, unsigned dictLength );
+
+  //Build a dictionary of at most dictSize bytes from sample buffers (for
+  //instance the first buffers of a larger set to be compressed). It is made of
+  //the segments of the samples containing the most byte sequences which also
+  //occur in other samples, with the most valuable segments placed at the end
+  //(where zlib can refer to them with the shortest distances). Returns an
+  //empty dictionary if the samples have nothing in common:
+  std::string trainDictionary( const std::vector<std::pair<const char*,unsigned>>& samples,
+                               unsigned dictSize = 16384 );
+
+  //Decompresses data produced by compressToBuffer on demand, so callers which
+  //only need the beginning of the data do not pay for inflating all of it. The
+  //indata and output buffers must stay untouched between calls, until reset()
+  //is called again:
+  class PartialDecompressor {
+  public:
+    PartialDecompressor();
+    ~PartialDecompressor();
+
+    //Prepare for decompression of indata into output. The output is resized to
+    //the full original size, but no data is decompressed yet:
+    void reset( const char* indata, unsigned indataLength,
+                Utils::DynBuffer<char>& output );
+
+    //Dictionary needed for data compressed with one (see Compressor). Takes
+    //effect at the next reset(..):
+    void setDictionary( const char* dict, unsigned dictLength );
+
+    unsigned originalSize() const { return m_origSize; }
+    unsigned nAvailable() const { return m_nAvail; }//bytes decompressed so far
+    bool complete() const { return m_nAvail == m_origSize; }
+
+    //Make sure at least the first n bytes are decompressed (n is capped at
+    //originalSize()). Returns nAvailable():
+    unsigned ensureAvailable( unsigned n )
+    {
+      return ( n <= m_nAvail || complete() ) ? m_nAvail : decompressMore( n );
+    }
+
+  private:
+    PartialDecompressor( const PartialDecompressor& ) = delete;
+    PartialDecompressor& operator=( const PartialDecompressor& ) = delete;
+    unsigned decompressMore( unsigned n );
+    void end();
+    struct Imp;
+    Imp * m_imp;
+    char * m_out;
+    unsigned m_origSize;
+    unsigned m_nAvail;
+  };
 }
 
 #endif
@@ -4,6 +4,34 @@
 #include <cassert>
 #include <cstdio>
 #include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <cstring>
+
+namespace ZLibUtils {
+  namespace {
+    //Inflate, providing the preset dictionary if the data was compressed with
+    //one:
+    int inflateWithDict( z_stream& strm, int flush, const std::vector<unsigned char>& dict )
+    {
+      int res = inflate(&strm, flush);
+      if (res==Z_NEED_DICT) {
+        if (dict.empty()) {
+          printf("ZLibUtils ERROR: Data was compressed with a preset dictionary,"
+                 " but no dictionary was provided for decompression.\n");
+          return res;
+        }
+        if (inflateSetDictionary(&strm, dict.data(), dict.size())!=Z_OK) {
+          printf("ZLibUtils ERROR: Data was compressed with a different preset"
+                 " dictionary than the one provided for decompression.\n");
+          return Z_DATA_ERROR;
+        }
+        res = inflate(&strm, flush);
+      }
+      return res;
+    }
+  }
+}
 
 void ZLibUtils::compressToBuffer(const char* indata,
                                  unsigned indataLength,
@@ -102,3 +130,323 @@ void ZLibUtils::decompressToBufferNew(const char* indata, unsigned indataLength,
   }
   throw std::runtime_error("ZLibUtils::decompressToBuffer failed");
 }
+
+std::uint32_t ZLibUtils::dictionaryID( const char* dict, unsigned dictLength )
+{
+  return adler32( adler32(0L, Z_NULL, 0), reinterpret_cast<const unsigned char*>(dict), dictLength );
+}
+
+std::string ZLibUtils::trainDictionary( const std::vector<std::pair<const char*,unsigned>>& samples,
+                                        unsigned dictSize )
+{
+  //A simplified version of the "cover" algorithm of the zstd dictionary
+  //builder: Count in how many samples each 8 byte sequence (d-mer) occurs, then
+  //split the samples into one epoch per segment of the dictionary, and pick in
+  //each epoch the segment with the highest total count of its d-mers. D-mers
+  //of picked segments no longer count, to avoid repeating data:
+  const unsigned d = 8;
+  const unsigned k = 128;//segment size
+  const unsigned hashbits = 20;
+  auto dmerHash = [](const char* p)
+  {
+    std::uint64_t v;
+    std::memcpy(&v,p,sizeof(v));
+    return unsigned((v*0x9E3779B97F4A7C15ull)>>(64-hashbits));
+  };
+  std::vector<std::uint32_t> count(1u<<hashbits,0), lastsample(1u<<hashbits,0);
+  std::uint64_t ntot(0);
+  for (std::size_t s = 0; s < samples.size(); ++s) {
+    const unsigned n = samples[s].second;
+    ntot += n;
+    for (unsigned i = 0; i + d <= n; ++i) {
+      const unsigned h = dmerHash(samples[s].first+i);
+      if (lastsample[h]!=s+1) {
+        lastsample[h] = s+1;
+        ++count[h];
+      }
+    }
+  }
+  //Only d-mers in at least two samples are useful:
+  for (auto& c : count)
+    c = ( c > 1 ? c - 1 : 0 );
+
+  struct Segment { std::uint64_t score; const char* data; unsigned size; };
+  std::vector<Segment> segments;
+  const unsigned nepochs = std::max<unsigned>(1,dictSize/k);
+  const std::uint64_t epochsize = std::max<std::uint64_t>(k,ntot/nepochs);
+  std::uint64_t epochbegin(0), offset(0);//positions in the concatenated samples
+  std::size_t s(0);
+  unsigned used(0);
+  while ( s < samples.size() && used < dictSize ) {
+    //Find the best segment in this epoch, not crossing sample boundaries:
+    const std::uint64_t epochend = epochbegin + epochsize;
+    Segment best = { 0, 0, 0 };
+    for (; s < samples.size() && offset < epochend; offset += samples[s++].second) {
+      const char * p = samples[s].first;
+      const unsigned n = samples[s].second;
+      if ( n < d )
+        continue;
+      const unsigned b = unsigned( epochbegin > offset ? epochbegin - offset : 0 );
+      const unsigned e = unsigned( std::min<std::uint64_t>( n - d + 1, epochend - offset ) );
+      if ( b >= e )
+        continue;
+      //Sliding sum over the d-mers starting in [i,i+k-d]:
+      const unsigned w = std::min<unsigned>( k - d + 1, n - d + 1 );
+      std::uint64_t sum(0);
+      unsigned i = std::min( b, n - d + 1 - w );
+      for (unsigned j = i; j < i + w; ++j)
+        sum += count[dmerHash(p+j)];
+      while (true) {
+        if ( sum > best.score )
+          best = { sum, p + i, std::min<unsigned>( k, n - i ) };
+        if ( i + w >= n - d + 1 || i + 1 >= e )
+          break;
+        sum += count[dmerHash(p+i+w)];
+        sum -= count[dmerHash(p+i)];
+        ++i;
+      }
+      if ( offset + n > epochend )
+        break;//sample continues in the next epoch
+    }
+    if ( best.score ) {
+      best.size = std::min( best.size, dictSize - used );
+      segments.push_back(best);
+      used += best.size;
+      for (unsigned j = 0; j + d <= best.size; ++j)
+        count[dmerHash(best.data+j)] = 0;
+    }
+    epochbegin = epochend;
+  }
+
+  std::stable_sort( segments.begin(), segments.end(),
+                    [](const Segment& a, const Segment& b) { return a.score < b.score; } );
+  std::string dict;
+  dict.reserve(used);
+  for (auto& seg : segments)
+    dict.append( seg.data, seg.size );
+  return dict;
+}
+
+struct ZLibUtils::Compressor::Imp {
+  z_stream strm;
+  std::vector<unsigned char> dict;
+};
+
+ZLibUtils::Compressor::Compressor( int level )
+  : m_imp(new Imp)
+{
+  z_stream& strm = m_imp->strm;
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  if (deflateInit(&strm, level)!=Z_OK) {
+    delete m_imp;
+    throw std::runtime_error("ZLibUtils::Compressor failed to initialise zlib");
+  }
+}
+
+ZLibUtils::Compressor::~Compressor()
+{
+  deflateEnd(&m_imp->strm);
+  delete m_imp;
+}
+
+void ZLibUtils::Compressor::setDictionary( const char* dict, unsigned dictLength )
+{
+  m_imp->dict.assign( dict, dict + dictLength );
+}
+
+bool ZLibUtils::Compressor::hasDictionary() const
+{
+  return !m_imp->dict.empty();
+}
+
+void ZLibUtils::Compressor::compress( const char* indata, unsigned indataLength,
+                                      Utils::DynBuffer<char>& output )
+{
+  assert(indataLength<UINT32_MAX);
+  if (indataLength == 0) {
+    //empty buffer, nothing to compress (but still embed the size, as in
+    //compressToBuffer):
+    output.resize_without_init( sizeof(std::uint32_t) );
+    *(reinterpret_cast<std::uint32_t*>(output.data())) = 0;
+    return;
+  }
+
+  z_stream& strm = m_imp->strm;
+  if ( deflateReset(&strm)!=Z_OK
+       || ( !m_imp->dict.empty() && deflateSetDictionary(&strm, m_imp->dict.data(), m_imp->dict.size())!=Z_OK ) )
+    throw std::runtime_error("ZLibUtils::Compressor failed to reset zlib");
+
+  const unsigned long outbuf_maxsize = deflateBound(&strm, indataLength);
+  output.resize_without_init( sizeof(std::uint32_t) + outbuf_maxsize );
+  auto out_data = reinterpret_cast<unsigned char*>(output.data());
+  *(reinterpret_cast<std::uint32_t*>(out_data)) = std::uint32_t(indataLength);
+
+  strm.next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(indata));
+  strm.avail_in = indataLength;
+  strm.next_out = out_data + sizeof(std::uint32_t);
+  strm.avail_out = outbuf_maxsize;
+  const int res = deflate(&strm, Z_FINISH);
+  if (res!=Z_STREAM_END) {
+    output.clear();
+    printf("ZLibUtils::Compressor ERROR: Problems during compression (zlib code %i).\n",res);
+    throw std::runtime_error("ZLibUtils::Compressor failed");
+  }
+  assert(strm.total_out<=outbuf_maxsize);
+  output.resize_without_init( sizeof(std::uint32_t) + strm.total_out );
+}
+
+struct ZLibUtils::Decompressor::Imp {
+  z_stream strm;
+  std::vector<unsigned char> dict;
+};
+
+ZLibUtils::Decompressor::Decompressor()
+  : m_imp(new Imp)
+{
+  z_stream& strm = m_imp->strm;
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  strm.next_in = Z_NULL;
+  strm.avail_in = 0;
+  if (inflateInit(&strm)!=Z_OK) {
+    delete m_imp;
+    throw std::runtime_error("ZLibUtils::Decompressor failed to initialise zlib");
+  }
+}
+
+ZLibUtils::Decompressor::~Decompressor()
+{
+  inflateEnd(&m_imp->strm);
+  delete m_imp;
+}
+
+void ZLibUtils::Decompressor::setDictionary( const char* dict, unsigned dictLength )
+{
+  m_imp->dict.assign( dict, dict + dictLength );
+}
+
+bool ZLibUtils::Decompressor::hasDictionary() const
+{
+  return !m_imp->dict.empty();
+}
+
+void ZLibUtils::Decompressor::decompress( const char* indata, unsigned indataLength,
+                                          Utils::DynBuffer<char>& output )
+{
+  output.clear();
+  if ( indataLength < sizeof(std::uint32_t) ) {
+    assert(indataLength == 0 );
+    return;//original buffer was empty, and stored in 0 bytes.
+  }
+  const std::uint32_t origSize = *(reinterpret_cast<const std::uint32_t*>(indata));
+  if ( origSize == 0 ) {
+    assert( indataLength == sizeof(std::uint32_t) );
+    return;//original buffer was empty, and used 4 bytes to store that zero length.
+  }
+  output.resize_without_init(origSize);
+
+  z_stream& strm = m_imp->strm;
+  if (inflateReset(&strm)!=Z_OK)
+    throw std::runtime_error("ZLibUtils::Decompressor failed to reset zlib");
+  strm.next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(indata))+sizeof(std::uint32_t);
+  strm.avail_in = indataLength - sizeof(std::uint32_t);
+  strm.next_out = reinterpret_cast<unsigned char*>(output.data());
+  strm.avail_out = origSize;
+  const int res = inflateWithDict(strm, Z_FINISH, m_imp->dict);
+  if ( res!=Z_STREAM_END || strm.avail_out!=0 ) {
+    output.clear();
+    printf("ZLibUtils::Decompressor ERROR: Problems during decompression"
+           " (zlib code %i). Data might be incomplete or corrupted.\n",res);
+    throw std::runtime_error("ZLibUtils::Decompressor failed");
+  }
+}
+
+struct ZLibUtils::PartialDecompressor::Imp {
+  z_stream strm;
+  bool active;
+  std::vector<unsigned char> dict;
+};
+
+ZLibUtils::PartialDecompressor::PartialDecompressor()
+  : m_imp(new Imp), m_out(0), m_origSize(0), m_nAvail(0)
+{
+  m_imp->active = false;
+}
+
+ZLibUtils::PartialDecompressor::~PartialDecompressor()
+{
+  end();
+  delete m_imp;
+}
+
+void ZLibUtils::PartialDecompressor::end()
+{
+  if (m_imp->active) {
+    inflateEnd(&m_imp->strm);
+    m_imp->active = false;
+  }
+}
+
+void ZLibUtils::PartialDecompressor::setDictionary( const char* dict, unsigned dictLength )
+{
+  m_imp->dict.assign( dict, dict + dictLength );
+}
+
+void ZLibUtils::PartialDecompressor::reset( const char* indata, unsigned indataLength,
+                                            Utils::DynBuffer<char>& output )
+{
+  m_out = 0;
+  m_origSize = m_nAvail = 0;
+  output.clear();
+  if ( indataLength < sizeof(std::uint32_t) ) {
+    assert(indataLength == 0 );
+    end();
+    return;//original buffer was empty, and stored in 0 bytes.
+  }
+  m_origSize = *(reinterpret_cast<const std::uint32_t*>(indata));
+  if ( m_origSize == 0 ) {
+    end();
+    return;//original buffer was empty, and used 4 bytes to store that zero length.
+  }
+  output.resize_without_init(m_origSize);
+  m_out = output.data();
+
+  z_stream& strm = m_imp->strm;
+  strm.next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(indata))+sizeof(std::uint32_t);
+  strm.avail_in = indataLength - sizeof(std::uint32_t);
+  strm.next_out = reinterpret_cast<unsigned char*>(m_out);
+  strm.avail_out = 0;
+  //Reuse the inflate state (and its window allocation) when possible:
+  const int res = m_imp->active ? inflateReset(&strm) : ( strm.zalloc = Z_NULL,
+                                                           strm.zfree = Z_NULL,
+                                                           strm.opaque = Z_NULL,
+                                                           inflateInit(&strm) );
+  if (res!=Z_OK) {
+    m_imp->active = false;
+    throw std::runtime_error("ZLibUtils::PartialDecompressor failed to initialise zlib");
+  }
+  m_imp->active = true;
+}
+
+unsigned ZLibUtils::PartialDecompressor::decompressMore( unsigned n )
+{
+  assert(m_imp->active);
+  //Inflate in chunks of at least 16kB, to keep the overhead of many small
+  //requests low:
+  const unsigned chunk = 16384;
+  n = std::min<unsigned>( m_origSize, std::max<unsigned>( n, m_nAvail + chunk ) );
+  z_stream& strm = m_imp->strm;
+  strm.next_out = reinterpret_cast<unsigned char*>(m_out + m_nAvail);
+  strm.avail_out = n - m_nAvail;
+  const int res = inflateWithDict(strm, n == m_origSize ? Z_FINISH : Z_SYNC_FLUSH, m_imp->dict);
+  m_nAvail = n - strm.avail_out;
+  if ( res == Z_STREAM_END ? m_nAvail != m_origSize : ( res != Z_OK || m_nAvail != n ) ) {
+    printf("ZLibUtils::PartialDecompressor ERROR: Problems during decompression"
+           " (zlib code %i). Data might be incomplete or corrupted.\n",res);
+    throw std::runtime_error("ZLibUtils::PartialDecompressor failed");
+  }
+  return m_nAvail;
+}
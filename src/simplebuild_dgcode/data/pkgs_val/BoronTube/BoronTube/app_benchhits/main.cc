@@ -0,0 +1,54 @@
+#include "GriffDataRead/GriffDataReader.hh"
+#include "GriffB10Common/DetHitApproximation.hh"
+#include "GriffB10Common/FastDetHitApproximation.hh"
+#include <chrono>
+#include <cmath>
+
+//Benchmark comparing throughput of DetHitApproximation and
+//FastDetHitApproximation on BoronTube Griff files (use --help for usage).
+
+namespace {
+  template<class THitApprox>
+  double runOnce(GriffDataReader& dr, THitApprox& ha, unsigned& nevts, unsigned& nhits, double& sumedep)
+  {
+    nevts = nhits = 0;
+    sumedep = 0.0;
+    dr.goToFirstEvent();
+    auto t0 = std::chrono::steady_clock::now();
+    do {
+      ++nevts;
+      if (ha.eventHasHit()) {
+        ++nhits;
+        sumedep += ha.eventHitEDep();
+      }
+    } while (dr.goToNextEvent());
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+  }
+}
+
+int main (int argc,char**argv) {
+  GriffDataReader dr(argc,argv);
+  if (!dr.goToFirstEvent()) {
+    printf("Error: No events in input\n");
+    return 1;
+  }
+
+  DetHitApproximation ref(&dr);
+  unsigned nevts, nhits_ref;
+  double edep_ref;
+  const double t_ref = runOnce(dr,ref,nevts,nhits_ref,edep_ref);
+
+  FastDetHitApproximation fast(&dr);
+  unsigned nhits_fast;
+  double edep_fast;
+  const double t_fast = runOnce(dr,fast,nevts,nhits_fast,edep_fast);
+
+  printf("Events                  : %10i\n",nevts);
+  printf("DetHitApproximation     : %10.4g s (%10.4g events/s)\n",t_ref,double(nevts)/t_ref);
+  printf("FastDetHitApproximation : %10.4g s (%10.4g events/s)\n",t_fast,double(nevts)/t_fast);
+  printf("Speedup                 : %10.4gx\n",t_ref/t_fast);
+  const bool agree = ( nhits_ref==nhits_fast
+                       && std::fabs(edep_ref-edep_fast) <= 1e-9*std::max(1.0,std::fabs(edep_ref)) );
+  printf("Results agree           : %s (%i hits)\n",(agree?"yes":"NO"),nhits_ref);
+  return agree ? 0 : 1;
+}
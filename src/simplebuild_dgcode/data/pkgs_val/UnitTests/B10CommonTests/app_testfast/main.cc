@@ -0,0 +1,53 @@
+#include "GriffB10Common/DetHitApproximation.hh"
+#include "GriffB10Common/FastDetHitApproximation.hh"
+#include "GriffDataRead/GriffDataReader.hh"
+#include "Core/FindData.hh"
+#include "Core/FPE.hh"
+#include <cmath>
+
+//Check that FastDetHitApproximation gives the same results as
+//DetHitApproximation (up to floating point rounding) on some real files.
+
+namespace {
+  bool near(double a, double b) {
+    return std::fabs(a-b) <= 1e-9*std::max(1.0,std::max(std::fabs(a),std::fabs(b)));
+  }
+}
+
+int main(int,char**) {
+  Core::catch_fpe();
+
+  unsigned nbad(0), nhits(0), nevts(0);
+  for (auto fn : { "10evts_singleneutron_on_b10_full.griff", "10evts_singleneutron_on_b10_reduced.griff" }) {
+    //Use very low threshold and the volumes with energy depositions in the test files:
+    for (auto volname : { "lv_targetbox", "lv_recordingbox" }) {
+      GriffDataReader dr(Core::findData("GriffDataRead",fn));
+      DetHitApproximation ref(&dr,1*Units::cm,1*Units::keV,volname);
+      FastDetHitApproximation fast(&dr,1*Units::cm,1*Units::keV,volname);
+      while (dr.loopEvents()) {
+        ++nevts;
+        bool ok = ref.eventHasHit()==fast.eventHasHit() && near(ref.eventTotalEDep(),fast.eventTotalEDep());
+        if (ok && ref.eventHasHit()) {
+          ++nhits;
+          ok = ( near(ref.eventHitEDep(),fast.eventHitEDep())
+                 && near(ref.eventHitTime(),fast.eventHitTime())
+                 && near(ref.eventHitWeight(),fast.eventHitWeight())
+                 && near(ref.eventHitPositionX(),fast.eventHitPositionX())
+                 && near(ref.eventHitPositionY(),fast.eventHitPositionY())
+                 && near(ref.eventHitPositionZ(),fast.eventHitPositionZ()) );
+        }
+        if (!ok) {
+          printf("ERROR: Results differ in event %i of %s (volume %s)\n",(int)dr.eventNumber(),fn,volname);
+          ++nbad;
+        }
+      }
+    }
+  }
+  printf("Compared %i events (%i with hits): %s\n",nevts,nhits,(nbad?"FAILED":"OK"));
+
+  //Same test points as DetHitApproximation::test():
+  GriffDataReader dr(Core::findData("GriffDataRead","10evts_singleneutron_on_b10_full.griff"));
+  FastDetHitApproximation(&dr).test();
+
+  return nbad ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+#include "ExprParser/ASTBuilder.hh"
+#include "ExprParser/SharedExprSet.hh"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+//Test that expressions in a SharedExprSet evaluate to the same values as
+//unshared expressions, while evaluating common subexpressions (and in
+//particular the variables) only once per generation.
+
+namespace EP = ExprParser;
+
+namespace {
+
+  //Variables "a" and "b" whose values are set from the outside, and which
+  //count how many times they are evaluated:
+  struct Input {
+    double a = 0.0;
+    double b = 0.0;
+    unsigned na = 0;
+    unsigned nb = 0;
+  };
+
+  class CountingVar final : public EP::ExprEntity<EP::float_type> {
+  public:
+    CountingVar(const Input& in, bool is_a) : m_in(in), m_is_a(is_a) {}
+    virtual EP::str_type name() const { return m_is_a ? "a" : "b"; }
+    virtual bool isConstant() const { return false; }
+    virtual EP::float_type evaluate() const
+    {
+      Input& in = const_cast<Input&>(m_in);
+      ++(m_is_a ? in.na : in.nb);
+      return m_is_a ? in.a : in.b;
+    }
+  private:
+    const Input& m_in;
+    bool m_is_a;
+  };
+
+  class Builder : public EP::ASTBuilder {
+  public:
+    Builder(const Input& in) : m_in(in) {}
+  protected:
+    virtual EP::ExprEntityPtr createValue(const EP::str_type& name) const
+    {
+      if (name=="a"||name=="b")
+        return EP::makeobj<CountingVar>(m_in,name=="a");
+      return ASTBuilder::createValue(name);
+    }
+  private:
+    const Input& m_in;
+  };
+
+  void test(bool b, const char * what)
+  {
+    if (!b) {
+      printf("ERROR: Test failed: %s\n",what);
+      exit(1);
+    }
+  }
+}
+
+int main(int,char**) {
+
+  Input in;
+  Builder builder(in);
+  EP::SharedExprSet shared;
+
+  const std::vector<const char*> exprs = { "2*a + b",
+                                           "sqrt(2*a + b) * 3",
+                                           "(2*a + b) / 2",
+                                           "a * 2 - b",
+                                           "b * b + 2*a" };
+  std::vector<EP::Evaluator<EP::float_type>> plain, sharedevals;
+  for (auto e : exprs) {
+    plain.push_back(builder.createEvaluator<EP::float_type>(e));
+    auto ev = builder.createEvaluator<EP::float_type>(e);
+    ev.setArg(shared.add(ev.arg()));
+    sharedevals.push_back(ev);
+  }
+  //Filter with short-circuiting:
+  auto filter = builder.createEvaluator<bool>("a > 10 && b > 0");
+  filter.setArg(shared.add(filter.arg()));
+  printf("Number of distinct subexpressions in set: %i\n",(int)shared.size());
+
+  for (unsigned i = 0; i < 20; ++i) {
+    in.a = 0.7*i;
+    in.b = 1.3+0.1*i*i;
+    std::vector<double> expected;
+    for (auto& ev : plain)
+      expected.push_back(ev());
+
+    shared.nextGeneration();
+    in.na = in.nb = 0;
+    for (unsigned j = 0; j < sharedevals.size(); ++j) {
+      test(sharedevals[j]()==expected[j],"shared value equals unshared value");
+      test(sharedevals[j]()==expected[j],"shared value stable within generation");
+    }
+    test(in.na==1 && in.nb==1,"variables evaluated once per generation");
+    printf("a=%-5g b=%-5g : %g %g %g %g %g\n",in.a,in.b,
+           expected[0],expected[1],expected[2],expected[3],expected[4]);
+
+    shared.nextGeneration();
+    in.na = in.nb = 0;
+    const bool f = filter();
+    test(f == (in.a > 10 && in.b > 0),"filter value");
+    test(in.na==1 && in.nb==(in.a > 10 ? 1u : 0u),"short-circuit evaluation");
+  }
+
+  //Adding a tree with only existing subexpressions adds nothing, and adding
+  //an already shared tree returns it unchanged:
+  const std::size_t n = shared.size();
+  auto ev = builder.createEvaluator<EP::float_type>("(2*a + b) / 2");
+  auto p = shared.add(ev.arg());
+  test(shared.size()==n,"no new subexpressions");
+  test(p==sharedevals[2].arg(),"identical trees are shared");
+  test(shared.add(p)==p,"adding shared tree is a no-op");
+
+  printf("All OK\n");
+  return 0;
+}
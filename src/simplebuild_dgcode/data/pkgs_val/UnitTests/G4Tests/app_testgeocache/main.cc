@@ -0,0 +1,290 @@
+#include "G4Launcher/GeoCache.hh"
+#include "G4Interfaces/GeoConstructBase.hh"
+#include "G4Tests/GeoTest.hh"
+#include "Units/Units.hh"
+#include "G4Material.hh"
+#include "G4Element.hh"
+#include "G4LogicalVolume.hh"
+#include "G4PVPlacement.hh"
+#include "G4VisAttributes.hh"
+#include "G4Box.hh"
+#include "G4Tubs.hh"
+#include "G4Cons.hh"
+#include "G4Sphere.hh"
+#include "G4Orb.hh"
+#include "G4Trd.hh"
+#include "G4UnionSolid.hh"
+#include "G4SubtractionSolid.hh"
+#include "G4IntersectionSolid.hh"
+#include "G4DisplacedSolid.hh"
+#include <filesystem>
+#include <fstream>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <dlfcn.h>
+#include <unistd.h>
+
+//Test of the geometry cache: A geometry with all supported kinds of solids,
+//placements and materials is constructed and stored, and then rebuilt from the
+//cache, after which the two volume trees are compared in detail. Finally it is
+//verified that the cache key changes when the parameters, a file named by a
+//parameter or an unrelated package library changes.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+  unsigned s_nconstruct = 0;
+
+  class CacheTestGeo final : public G4Interfaces::GeoConstructBase {
+  public:
+    CacheTestGeo() : GeoConstructBase("G4Tests/CacheTestGeo")
+    {
+      addParameterDouble("tubeLength_cm",10.0,1.0,100.0);
+      addParameterString("datafile","");
+    }
+
+    G4VPhysicalVolume* Construct() override
+    {
+      ++s_nconstruct;
+      const double tubelength = getParameterDouble("tubeLength_cm")*Units::cm;
+      auto mat_vacuum = getMaterial("Vacuum");
+      auto mat_air = getMaterial("G4_AIR");
+      auto mat_steel = getMaterial("G4_STAINLESS-STEEL;density_gcm3=8.0");
+      auto mat_b4c = getMaterial("MAT_B4C;b10_enrichment=0.95");
+
+      auto lv_world = new G4LogicalVolume(new G4Box("world",1*Units::m,1*Units::m,1*Units::m),mat_vacuum,"world");
+      auto pv_world = new G4PVPlacement(G4Transform3D(),lv_world,"world",0,false,0);
+
+      auto sld_tube = new G4Tubs("tube",1*Units::cm,5*Units::cm,0.5*tubelength,10*Units::degree,300*Units::degree);
+      auto lv_tube = new G4LogicalVolume(sld_tube,mat_air,"lv_tube");
+      auto vis_tube = new G4VisAttributes(G4Colour(0.1,0.2,0.3,0.4));
+      vis_tube->SetForceSolid(true);
+      vis_tube->SetForceAuxEdgeVisible(true);
+      vis_tube->SetForceLineSegmentsPerCircle(48);
+      lv_tube->SetVisAttributes(vis_tube);
+      G4RotationMatrix rot;
+      rot.rotateX(30*Units::degree);
+      rot.rotateY(-20*Units::degree);
+      new G4PVPlacement(G4Transform3D(rot,G4ThreeVector(10*Units::cm,-20*Units::cm,30*Units::cm)),
+                        lv_tube,"pv_tube",lv_world,false,7);
+
+      //Cone with a sphere, an orb and a trapezoid inside:
+      auto sld_cone = new G4Cons("cone",0.0,20*Units::cm,1*Units::cm,15*Units::cm,25*Units::cm,0.0,360*Units::degree);
+      auto lv_cone = new G4LogicalVolume(sld_cone,mat_steel,"lv_cone");
+      lv_cone->SetVisAttributes(G4VisAttributes::GetInvisible());
+      new G4PVPlacement(nullptr,G4ThreeVector(0,0,-50*Units::cm),lv_cone,"pv_cone",lv_world,false,0);
+      auto sld_sphere = new G4Sphere("sphere",1*Units::cm,4*Units::cm,0.0,180*Units::degree,
+                                     10*Units::degree,120*Units::degree);
+      new G4PVPlacement(nullptr,G4ThreeVector(0,0,-10*Units::cm),
+                        new G4LogicalVolume(sld_sphere,mat_b4c,"lv_sphere"),"pv_sphere",lv_cone,false,0);
+      new G4PVPlacement(nullptr,G4ThreeVector(0,0,0),
+                        new G4LogicalVolume(new G4Orb("orb",3*Units::cm),mat_b4c,"lv_orb"),"pv_orb",lv_cone,false,0);
+      new G4PVPlacement(nullptr,G4ThreeVector(0,0,12*Units::cm),
+                        new G4LogicalVolume(new G4Trd("trd",2*Units::cm,3*Units::cm,1*Units::cm,4*Units::cm,5*Units::cm),
+                                            mat_air,"lv_trd"),"pv_trd",lv_cone,false,0);
+
+      //Boolean solids (the union creates a G4DisplacedSolid), with a shared
+      //constituent:
+      auto sld_box = new G4Box("box",5*Units::cm,6*Units::cm,7*Units::cm);
+      G4RotationMatrix rot2;
+      rot2.rotateZ(45*Units::degree);
+      auto sld_union = new G4UnionSolid("union",sld_box,sld_tube,G4Transform3D(rot2,G4ThreeVector(0,0,5*Units::cm)));
+      auto sld_sub = new G4SubtractionSolid("subtraction",sld_union,new G4Orb("hole",2*Units::cm));
+      auto sld_isect = new G4IntersectionSolid("intersection",sld_sub,sld_box,nullptr,G4ThreeVector(1*Units::cm,0,0));
+      auto lv_bool = new G4LogicalVolume(sld_isect,mat_steel,"lv_bool");
+      auto vis_bool = new G4VisAttributes(G4Colour(1.0,0.0,0.5));
+      vis_bool->SetForceWireframe(true);
+      vis_bool->SetLineStyle(G4VisAttributes::dashed);
+      vis_bool->SetLineWidth(2.5);
+      vis_bool->SetDaughtersInvisible(true);
+      lv_bool->SetVisAttributes(vis_bool);
+
+      //Placed several times:
+      for (int i = 0; i < 4; ++i) {
+        G4RotationMatrix r;
+        r.rotateZ(i*25*Units::degree);
+        new G4PVPlacement(G4Transform3D(r,G4ThreeVector(-60*Units::cm+i*30*Units::cm,50*Units::cm,0)),
+                          lv_bool,"pv_bool",lv_world,false,i);
+      }
+      return pv_world;
+    }
+  };
+
+  std::string fmt(const G4ThreeVector& v)
+  {
+    std::ostringstream ss;
+    ss.precision(12);
+    ss << "(" << v.x() << ", " << v.y() << ", " << v.z() << ")";
+    return ss.str();
+  }
+
+  std::string dumpTransform(const G4RotationMatrix& rot, const G4ThreeVector& trans)
+  {
+    return "rot=[" + fmt(rot.rowX()) + ", " + fmt(rot.rowY()) + ", " + fmt(rot.rowZ()) + "] trans=" + fmt(trans);
+  }
+
+  void dumpSolid(std::ostream& os, const G4VSolid * solid, const std::string& indent)
+  {
+    const std::string type = solid->GetEntityType();
+    os << indent << "Solid " << solid->GetName() << " (" << type << ")";
+    if (type=="G4UnionSolid"||type=="G4SubtractionSolid"||type=="G4IntersectionSolid") {
+      os << "\n";
+      dumpSolid(os,solid->GetConstituentSolid(0),indent+"  ");
+      dumpSolid(os,solid->GetConstituentSolid(1),indent+"  ");
+    } else if (type=="G4DisplacedSolid") {
+      auto s = static_cast<const G4DisplacedSolid*>(solid);
+      G4Transform3D t = s->GetDirectTransform3D();
+      os << " " << dumpTransform(t.getRotation(),t.getTranslation()) << "\n";
+      dumpSolid(os,s->GetConstituentMovedSolid(),indent+"  ");
+    } else {
+      std::ostringstream ss;
+      ss.precision(12);
+      solid->StreamInfo(ss);
+      //Indent the parameter listing:
+      std::string line;
+      std::istringstream is(ss.str());
+      os << "\n";
+      while (std::getline(is,line))
+        os << indent << "  | " << line << "\n";
+    }
+  }
+
+  void dumpMaterial(std::ostream& os, const G4Material * mat, const std::string& indent)
+  {
+    os.precision(12);
+    os << indent << "Material " << mat->GetName() << " density=" << mat->GetDensity()/(Units::g/Units::cm3)
+       << "g/cm3 temp=" << mat->GetTemperature()/Units::kelvin << "K state=" << int(mat->GetState()) << "\n";
+    for (std::size_t i = 0; i < mat->GetNumberOfElements(); ++i) {
+      auto elem = mat->GetElement(i);
+      os << indent << "  Element " << elem->GetName() << " massfraction=" << mat->GetFractionVector()[i]
+         << " nisotopes=" << elem->GetNumberOfIsotopes() << "\n";
+    }
+  }
+
+  void dumpTree(std::ostream& os, const G4VPhysicalVolume * pv, const std::string& indent)
+  {
+    auto lv = pv->GetLogicalVolume();
+    os << indent << "PV " << pv->GetName() << " copyNo=" << pv->GetCopyNo() << " many=" << pv->IsMany()
+       << " " << dumpTransform(pv->GetObjectRotationValue(),pv->GetObjectTranslation()) << "\n";
+    os << indent << "  LV " << lv->GetName() << " ndaughters=" << lv->GetNoDaughters();
+    auto vis = lv->GetVisAttributes();
+    if (!vis) {
+      os << " vis=default\n";
+    } else {
+      os << " vis=" << (vis->IsVisible()?"visible":"invisible") << " colour=" << vis->GetColour()
+         << " daughtersinvisible=" << vis->IsDaughtersInvisible()
+         << " linestyle=" << int(vis->GetLineStyle()) << " linewidth=" << vis->GetLineWidth()
+         << " forcestyle=" << vis->IsForceDrawingStyle() << " style=" << int(vis->GetForcedDrawingStyle())
+         << " forceauxedge=" << vis->IsForceAuxEdgeVisible()
+         << " forcesegments=" << vis->IsForceLineSegmentsPerCircle()
+         << " segments=" << vis->GetForcedLineSegmentsPerCircle()
+         << " time=[" << vis->GetStartTime() << "," << vis->GetEndTime() << "]\n";
+    }
+    dumpMaterial(os,lv->GetMaterial(),indent+"  ");
+    dumpSolid(os,lv->GetSolid(),indent+"  ");
+    for (std::size_t i = 0; i < lv->GetNoDaughters(); ++i)
+      dumpTree(os,lv->GetDaughter(i),indent+"    ");
+  }
+
+  std::string dumpTree(const G4VPhysicalVolume * world)
+  {
+    std::ostringstream ss;
+    dumpTree(ss,world,"");
+    return ss.str();
+  }
+
+  unsigned countEntries(const std::string& dir)
+  {
+    unsigned n(0);
+    for (auto& e : fs::directory_iterator(dir))
+      if (e.path().extension()==".bin")
+        ++n;
+    return n;
+  }
+
+  int fail(const char * what)
+  {
+    printf("FAILURE: %s\n",what);
+    return 1;
+  }
+
+}
+
+int main(int,char**) {
+  const std::string dir = (fs::temp_directory_path()/("dgcode_testgeocache_"+std::to_string(getpid()))).string();
+  fs::remove_all(dir);
+
+  //Construct and store:
+  CacheTestGeo * geo1 = new CacheTestGeo;
+  G4Launcher::CachedGeoConstruction cgeo1(geo1,dir);
+  G4VPhysicalVolume * world1 = cgeo1.Construct();
+  if (s_nconstruct!=1 || countEntries(dir)!=1)
+    return fail("geometry was not constructed and stored in the cache");
+
+  //Rebuild from the cache without calling Construct():
+  CacheTestGeo * geo2 = new CacheTestGeo;
+  G4Launcher::CachedGeoConstruction cgeo2(geo2,dir);
+  G4VPhysicalVolume * world2 = cgeo2.Construct();
+  if (s_nconstruct!=1)
+    return fail("geometry was not taken from the cache");
+
+  const std::string dump1 = dumpTree(world1);
+  const std::string dump2 = dumpTree(world2);
+  printf("Volume tree:\n%s",dump1.c_str());
+  if (dump1!=dump2) {
+    printf("Volume tree rebuilt from cache:\n%s",dump2.c_str());
+    return fail("volume tree rebuilt from cache differs from the constructed one");
+  }
+  printf("Volume tree rebuilt from cache is identical\n");
+
+  //Keys must be stable, and must change with parameters and with any files
+  //the geometry might depend on:
+  const std::string key = cgeo2.cacheKey();
+  if (key.empty() || key!=cgeo2.cacheKey() || key!=cgeo1.cacheKey())
+    return fail("cache key is not reproducible");
+
+  geo2->setParameterDouble("tubeLength_cm",11.0);
+  if (cgeo2.cacheKey()==key)
+    return fail("cache key does not depend on parameters");
+  geo2->setParameterDouble("tubeLength_cm",10.0);
+
+  const std::string datafile = dir + "/somedata.txt";
+  std::ofstream(datafile) << "some data\n";
+  geo2->setParameterString("datafile",datafile);
+  const std::string key_datafile = cgeo2.cacheKey();
+  std::ofstream(datafile,std::ios::app) << "more data\n";
+  if (cgeo2.cacheKey()==key_datafile)
+    return fail("cache key does not depend on files named by parameters");
+  geo2->setParameterString("datafile","");
+  if (cgeo2.cacheKey()!=key)
+    return fail("cache key is not reproducible");
+
+  //A copy of an unrelated package library (the one with G4Tests::GeoTest):
+  G4Tests::GeoTest geotest;
+  Dl_info info;
+  if (!dladdr(*reinterpret_cast<void* const*>(&geotest),&info) || !info.dli_fname)
+    return fail("could not locate the G4Tests library");
+  const std::string libcopy = dir + "/libPKG__GeoCacheTestDummy.so";
+  fs::copy_file(info.dli_fname,libcopy);
+  if (!dlopen(libcopy.c_str(),RTLD_NOW|RTLD_LOCAL))
+    return fail("could not load library");
+  const std::string key_lib = cgeo2.cacheKey();
+  if (key_lib==key || key_lib.find(libcopy)==std::string::npos)
+    return fail("cache key does not depend on loaded package libraries");
+  fs::last_write_time(libcopy,fs::last_write_time(libcopy)+std::chrono::hours(1));
+  if (cgeo2.cacheKey()==key_lib)
+    return fail("cache key does not change when a package library is rebuilt");
+
+  //...so the geometry is constructed again:
+  G4Launcher::CachedGeoConstruction cgeo3(new CacheTestGeo,dir);
+  G4VPhysicalVolume * world3 = cgeo3.Construct();
+  if (s_nconstruct!=2 || countEntries(dir)!=2 || dumpTree(world3)!=dump1)
+    return fail("geometry was not constructed again after a change to a package library");
+  printf("Cache keys change as expected\n");
+
+  fs::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include "G4Launcher/Launcher.hh"
+#include "G4CollectFilters/StepFilterExpr.hh"
+#include "ExprParser/Exception.hh"
+#include "Units/Units.hh"
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4DynamicParticle.hh"
+#include "G4Neutron.hh"
+#include "G4Gamma.hh"
+#include "G4Alpha.hh"
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+
+//Test step filters given as expression strings to G4Launcher, by applying a
+//keep filter and a kill filter on a few steps made by hand.
+
+namespace {
+
+  void test(bool b, const char * what)
+  {
+    if (!b) {
+      printf("ERROR: Test failed: %s\n",what);
+      exit(1);
+    }
+  }
+
+  struct TestStep {
+    //Step with the given energy deposit of a track with the given particle and ids:
+    TestStep(G4ParticleDefinition* pd, int trkid, int parentid, double edep)
+      : track(new G4DynamicParticle(pd,G4ThreeVector(0,0,1),1.0*Units::MeV),0.0,G4ThreeVector())
+    {
+      track.SetTrackID(trkid);
+      track.SetParentID(parentid);
+      track.SetStep(&step);
+      step.SetTrack(&track);
+      step.SetTotalEnergyDeposit(edep);
+    }
+    G4Track track;
+    G4Step step;
+  };
+
+}
+
+int main(int,char**) {
+
+  G4Launcher::Launcher launcher;
+  launcher.setFilter("trk.is_neutron || step.edep > 1 keV");
+  launcher.setKillFilter("trk.is_secondary && trk.pdgcode == 22");
+  G4Interfaces::StepFilterBase * filter = launcher.getFilter();
+  G4Interfaces::StepFilterBase * killfilter = launcher.getKillFilter();
+  test(filter&&killfilter,"filters created");
+  test(filter->getParameterString("expression")=="trk.is_neutron || step.edep > 1 keV","filter expression");
+  filter->initFilter();//as done by the data collection
+  killfilter->initFilter();
+
+  struct Expected { const char * what; G4ParticleDefinition* pd; int trkid; int parentid; double edep; bool keep; bool kill; };
+  const Expected expected[] = {
+    { "primary neutron",              G4Neutron::Definition(), 1, 0, 0.0,              true,  false },
+    { "alpha with small edep",        G4Alpha::Definition(),   2, 1, 0.5*Units::keV,   false, false },
+    { "alpha with large edep",        G4Alpha::Definition(),   2, 1, 5.0*Units::keV,   true,  false },
+    { "secondary gamma",              G4Gamma::Definition(),   3, 1, 0.0,              false, true  },
+    { "secondary gamma with edep",    G4Gamma::Definition(),   3, 1, 2.0*Units::keV,   true,  true  },
+    { "primary gamma",                G4Gamma::Definition(),   1, 0, 0.0,              false, false }
+  };
+  for (auto& e : expected) {
+    TestStep ts(e.pd,e.trkid,e.parentid,e.edep);
+    const bool keep = filter->filterStep(&ts.step);
+    const bool kill = killfilter->filterStep(&ts.step);
+    printf("  %-26s : %s%s\n",e.what,(keep?"kept":"not kept"),(kill?", killed":""));
+    test(keep==e.keep,"keep filter");
+    test(kill==e.kill,"kill filter");
+  }
+
+  //Invalid and empty expressions are rejected:
+  for (auto expr : {"trk.nosuchvar > 0", ""}) {
+    bool failed = false;
+    try {
+      StepFilterExpr f;
+      f.setParameterString("expression",expr);
+      f.initFilter();
+    } catch (ExprParser::InputError&) {
+      failed = true;
+    }
+    test(failed,"invalid expression");
+  }
+
+  printf("All tests passed\n");
+  return 0;
+}
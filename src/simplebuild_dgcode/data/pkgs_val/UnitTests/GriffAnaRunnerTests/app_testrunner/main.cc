@@ -0,0 +1,218 @@
+#include "GriffAnaRunner/ExprHists.hh"
+#include "GriffAnaUtils/SegmentIterator.hh"
+#include "GriffAnaUtils/SegmentFilter_Volume.hh"
+#include "GriffAnaUtils/TrackFilter_PDGCode.hh"
+#include "SimpleHists/Hist1D.hh"
+#include "ExprParser/Exception.hh"
+#include "Core/FindData.hh"
+#include "Core/FPE.hh"
+#include "Units/Units.hh"
+#include <memory>
+#include <set>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+//Verify that running on several threads gives the same histograms as a plain
+//loop over the events, independently of the number of threads, and that the
+//declarative histograms of ExprHists agree with the equivalent C++ code.
+
+void test(bool b, const char * what)
+{
+  if (!b) {
+    printf("ERROR: Test failed: %s\n",what);
+    exit(1);
+  }
+}
+
+std::vector<std::string> inputFiles()
+{
+  std::vector<std::string> files;
+  files.push_back(Core::findData("GriffDataRead","10evts_singleneutron_on_b10_full.griff"));
+  files.push_back(Core::findData("GriffDataRead","10evts_singleneutron_on_b10_reduced.griff"));
+  files.push_back(Core::findData("GriffDataRead","10evts_singleneutron_on_b10_full.griff"));
+  return files;
+}
+
+//Contents of histograms must agree exactly, statistics up to rounding unless
+//exact (since they are summed in a different order on several threads):
+void compare(const SimpleHists::HistCollection& hc1, const SimpleHists::HistCollection& hc2, bool exact)
+{
+  std::set<std::string> keys1, keys2;
+  hc1.getKeys(keys1);
+  hc2.getKeys(keys2);
+  test(keys1==keys2,"same histogram keys");
+  for (auto& key : keys1) {
+    auto h1 = dynamic_cast<const SimpleHists::Hist1D*>(hc1.hist(key));
+    auto h2 = dynamic_cast<const SimpleHists::Hist1D*>(hc2.hist(key));
+    test(h1&&h2,"1D histograms");
+    test(h1->getNBins()==h2->getNBins()&&h1->getXMin()==h2->getXMin()&&h1->getXMax()==h2->getXMax(),"same binning");
+    for (unsigned i = 0; i < h1->getNBins(); ++i)
+      test(h1->getBinContent(i)==h2->getBinContent(i),"same bin contents");
+    test(h1->getUnderflow()==h2->getUnderflow(),"same underflow");
+    test(h1->getOverflow()==h2->getOverflow(),"same overflow");
+    test(h1->empty()==h2->empty(),"same emptiness");
+    if (h1->empty())
+      continue;
+    test(h1->getMinFilled()==h2->getMinFilled(),"same min");
+    test(h1->getMaxFilled()==h2->getMaxFilled(),"same max");
+    if (exact) {
+      test(h1->getMean()==h2->getMean(),"identical mean");
+      test(h1->getRMS()==h2->getRMS(),"identical rms");
+    } else {
+      test(std::fabs(h1->getMean()-h2->getMean())<=1e-9*(std::fabs(h1->getMean())+h1->getRMS()),"same mean");
+      test(std::fabs(h1->getRMS()-h2->getRMS())<=1e-9*h1->getRMS(),"same rms");
+    }
+  }
+}
+
+//Kernel with the usual GriffAnaUtils iterators:
+GriffAnaRunner::EventFunction cppKernel(GriffDataReader& dr, SimpleHists::HistCollection& hc)
+{
+  auto h_alpha = hc.book1D("alpha ekin",100,0,2,"alpha_ekin");
+  auto h_edep = hc.book1D("edep in target",100,0,3,"edep");
+  auto h_ntrk = hc.book1D("ntracks",50,0,50,"ntrks");
+  auto si_alpha = std::make_shared<GriffAnaUtils::SegmentIterator>(&dr);
+  si_alpha->addFilter(new GriffAnaUtils::TrackFilter_PDGCode(1000020040));
+  auto si_target = std::make_shared<GriffAnaUtils::SegmentIterator>(&dr);
+  si_target->addFilter(new GriffAnaUtils::SegmentFilter_Volume("lv_targetbox"));
+  return [h_alpha,h_edep,h_ntrk,si_alpha,si_target](GriffDataReader& dr)
+  {
+    h_ntrk->fill(dr.nTracks());
+    while (auto seg = si_alpha->next())
+      if (seg->iSegment()==0)
+        h_alpha->fill(seg->startEKin()/Units::MeV);
+    double edep(0);
+    bool any(false);
+    while (auto seg = si_target->next()) {
+      edep += seg->eDep()/Units::MeV;
+      any = true;
+    }
+    if (any)
+      h_edep->fill(edep);
+  };
+}
+
+std::vector<std::string> exprSpecs()
+{
+  std::vector<std::string> specs;
+  specs.push_back("alpha_ekin(100,0,2): seg.ekin_start/MeV if trk.pdgcode==1000020040 && seg.iseg==0");
+  specs.push_back("edep(100,0,3): sum seg.edep/MeV if seg.volname==\"lv_targetbox\"");
+  specs.push_back("ntrks(50,0,50): sum 1 if trk.trkid>0");
+  return specs;
+}
+
+SimpleHists::HistCollection * runThreads(unsigned nthreads, unsigned chunksize,
+                                          const GriffAnaRunner::Kernel& kernel, bool summaryonly = false,
+                                          unsigned nskip = 0, unsigned nmax = 0)
+{
+  GriffAnaRunner::Runner runner(inputFiles());
+  runner.allowSetupChange();
+  runner.setNThreads(nthreads);
+  runner.setChunkSize(chunksize);
+  runner.setSummaryOnly(summaryonly);
+  runner.setEventRange(nskip,nmax);
+  auto hc = new SimpleHists::HistCollection;
+  auto stats = runner.run(*hc,kernel);
+  test(stats.nthreads==nthreads,"number of threads");
+  test(stats.nevents==(nmax?nmax:30-nskip),"number of events");
+  return hc;
+}
+
+void testBadSpec(const char * spec)
+{
+  bool failed = false;
+  try {
+    GriffAnaRunner::ExprHists::parseSpec(spec);
+  } catch (ExprParser::InputError& e) {
+    printf("  bad spec \"%s\" : %s\n",spec,e.epWhat());
+    failed = true;
+  }
+  test(failed,spec);
+}
+
+int main(int,char**) {
+  Core::catch_fpe();
+  GriffDataReader::setOpenMsg(false);
+
+  //Reference from a plain event loop:
+  SimpleHists::HistCollection ref;
+  {
+    GriffDataReader dr(inputFiles());
+    dr.allowSetupChange();
+    auto fct = cppKernel(dr,ref);
+    while (dr.loopEvents())
+      fct(dr);
+  }
+  for (auto key : {"alpha_ekin","edep","ntrks"})
+    test(ref.hist(key)->getIntegral()>0,"non-empty reference histograms");
+
+  std::unique_ptr<SimpleHists::HistCollection> hc1(runThreads(1,100,cppKernel));
+  compare(ref,*hc1,true);
+  for (unsigned nthreads = 2; nthreads <= 4; ++nthreads) {
+    for (unsigned chunksize : {1,3,7}) {
+      std::unique_ptr<SimpleHists::HistCollection> hc(runThreads(nthreads,chunksize,cppKernel));
+      compare(ref,*hc,false);
+      std::unique_ptr<SimpleHists::HistCollection> hc_again(runThreads(nthreads,chunksize,cppKernel));
+      compare(*hc,*hc_again,true);
+    }
+  }
+
+  //Event ranges crossing file boundaries, compared with skipping the events in
+  //a plain loop:
+  SimpleHists::HistCollection ref_range;
+  {
+    GriffDataReader dr(inputFiles());
+    dr.allowSetupChange();
+    auto fct = cppKernel(dr,ref_range);
+    test(dr.skipEvents(7),"skipEvents");
+    for (unsigned i = 0; i < 15; ++i) {
+      fct(dr);
+      test(dr.goToNextEvent(),"goToNextEvent");
+    }
+  }
+  test(ref_range.hist("ntrks")->getIntegral()==15,"events in range");
+  for (unsigned nthreads = 1; nthreads <= 3; ++nthreads) {
+    for (unsigned chunksize : {1,4,100}) {
+      std::unique_ptr<SimpleHists::HistCollection> hc(runThreads(nthreads,chunksize,cppKernel,false,7,15));
+      compare(ref_range,*hc,nthreads==1||chunksize==100);
+    }
+  }
+
+  //Declarative histograms:
+  GriffAnaRunner::ExprHists eh(exprSpecs());
+  test(eh.summaryOnly(),"no step data needed");
+  test(eh.specs().at(0).level==GriffAnaRunner::ExprHists::Spec::SEGMENT,"segment level");
+  test(eh.specs().at(2).level==GriffAnaRunner::ExprHists::Spec::TRACK,"track level");
+  for (unsigned nthreads = 1; nthreads <= 3; ++nthreads) {
+    std::unique_ptr<SimpleHists::HistCollection> hc(runThreads(nthreads,2,eh.kernel(),eh.summaryOnly()));
+    compare(ref,*hc,nthreads==1);
+  }
+
+  //Steps (the sum of step energy depositions equals that of the segments, up to
+  //rounding, so only compare the number of entries):
+  GriffAnaRunner::ExprHists eh_steps({"edep(100,0,3): sum step.edep/MeV if seg.volname==\"lv_targetbox\""});
+  test(!eh_steps.summaryOnly(),"step data needed");
+  std::unique_ptr<SimpleHists::HistCollection> hc_steps(runThreads(2,2,eh_steps.kernel(),eh_steps.summaryOnly()));
+  test(hc_steps->hist("edep")->getIntegral()==ref.hist("edep")->getIntegral(),"step edep entries");
+
+  printf("Bad specifications:\n");
+  testBadSpec("edep: seg.edep");
+  testBadSpec("edep(100,0): seg.edep");
+  testBadSpec("edep(0,0,1): seg.edep");
+  testBadSpec("edep(10,1,0): seg.edep");
+  testBadSpec("edep(10,0,seg.edep): seg.edep");
+  testBadSpec("edep(10,0,1):");
+  testBadSpec("edep(10,0,1): seg.edep if");
+  testBadSpec("edep(10,0,1): 17");
+  testBadSpec("edep(10,0,1): seg.nosuchvar");
+  try {
+    GriffAnaRunner::ExprHists eh_dupl({"a(10,0,1): seg.edep","a(10,0,1): trk.ekin"});
+    test(false,"duplicate keys");
+  } catch (ExprParser::InputError& e) {
+    printf("  duplicate keys : %s\n",e.epWhat());
+  }
+
+  printf("All tests passed\n");
+  return 0;
+}
@@ -0,0 +1,58 @@
+#include "GriffDataRead/GriffDataReader.hh"
+#include "GriffDataRead/DumpObj.hh"
+#include <vector>
+#include <string>
+#include <cstdio>
+
+//Dumps the content of all events in the given Griff files: setups, tracks,
+//segments (with volume and material names), steps and materials. Nothing
+//depending on the file layout (event indices, database indices or checksums)
+//is printed, so the output can be used to check that tools rewriting Griff
+//files (extracting or merging events, ...) preserve the event content.
+
+int main(int argc, char** argv) {
+  if (argc<2) {
+    printf("Usage: %s FILE1.griff [FILE2.griff ...]\n",argv[0]);
+    return 1;
+  }
+  std::vector<std::string> files(argv+1,argv+argc);
+  GriffDataReader dr(files);
+  dr.allowSetupChange();
+  while (dr.loopEvents()) {
+    if (dr.setupChanged()) {
+      printf("==== Setup:\n");
+      dr.setup()->dump("  ");
+    }
+    printf("==== Event run=%u evt=%u mode=%s ntracks=%u nprimary=%u\n",dr.runNumber(),dr.eventNumber(),
+           dr.eventStorageModeStr(),dr.nTracks(),dr.nPrimaryTracks());
+    const bool hassteps = dr.eventStorageMode()!=GriffFormat::Format::MODE_MINIMAL;
+    std::vector<const GriffDataRead::Material*> mats;
+    for (auto trk = dr.trackBegin(); trk != dr.trackEnd(); ++trk) {
+      dump(trk,true);
+      printf("\n");
+      for (auto seg = trk->segmentBegin(); seg != trk->segmentEnd(); ++seg) {
+        printf("  ");
+        dump(seg);
+        printf("\n");
+        for (unsigned i = 0; i < seg->volumeDepthStored(); ++i) {
+          auto mat = seg->material(i);
+          bool seen(false);
+          for (auto m : mats)
+            seen = seen || m == mat;
+          if (!seen)
+            mats.push_back(mat);
+        }
+        for (unsigned i = 0; hassteps && i < seg->nStepsStored(); ++i) {
+          printf("    ");
+          dump(seg->getStep(i));
+          printf("\n");
+        }
+      }
+    }
+    for (auto mat : mats) {
+      dump(mat);
+      printf("\n");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,71 @@
+#include "GriffAnaUtils/SegmentFilter_Volume.hh"
+#include "GriffAnaUtils/TrackFilter_PDGCode.hh"
+#include "GriffDataRead/GriffDataReader.hh"
+#include "Utils/RefCountBase.hh"
+#include "Core/FindData.hh"
+#include "Core/FPE.hh"
+#include <vector>
+
+//Verify that the cached filter decisions in SegmentFilter_Volume and
+//TrackFilter_PDGCode are identical to explicit comparisons, also when the
+//touchable database changes as a new file is opened.
+
+int main(int,char**) {
+
+  Core::catch_fpe();
+
+  std::vector<std::string> files;
+  files.push_back(Core::findData("GriffDataRead","10evts_singleneutron_on_b10_full.griff"));
+  files.push_back(Core::findData("GriffDataRead","10evts_singleneutron_on_b10_reduced.griff"));
+  files.push_back(Core::findData("GriffDataRead","10evts_singleneutron_on_b10_full.griff"));
+  GriffDataReader dr(files,2);
+  dr.allowSetupChange();
+
+  //Filters are normally owned by iterators, here we own them ourselves:
+  auto vf = new GriffAnaUtils::SegmentFilter_Volume("lv_targetbox");
+  auto vf_phys = (new GriffAnaUtils::SegmentFilter_Volume("pv_targetbox"))->setPhysical();
+  auto vf_mother = new GriffAnaUtils::SegmentFilter_Volume("lv_targetbox","world");
+  auto vf_badmother = new GriffAnaUtils::SegmentFilter_Volume("lv_targetbox","lv_targetbox");
+  auto tf = new GriffAnaUtils::TrackFilter_PDGCode(22,-11,1000020040);
+  auto tf_unsigned = (new GriffAnaUtils::TrackFilter_PDGCode(11,-1000030070))->setUnsigned();
+  for (Utils::RefCountBase* f : std::vector<Utils::RefCountBase*>{vf,vf_phys,vf_mother,vf_badmother,tf,tf_unsigned})
+    f->ref();
+
+  unsigned nseg(0), nsegpass(0), ntrk(0), ntrkpass(0), nerr(0);
+  while (dr.loopEvents()) {
+    for (auto trk = dr.trackBegin();trk!=dr.trackEnd();++trk) {
+      ++ntrk;
+      const int32_t c = trk->pdgCode();
+      const bool exp_tf = (c==22||c==-11||c==1000020040);
+      const bool exp_tf_unsigned = (c==11||c==-11||c==1000030070||c==-1000030070);
+      if (tf->filter(trk)!=exp_tf||tf_unsigned->filter(trk)!=exp_tf_unsigned) {
+        printf("ERROR: Wrong PDG filter decision for track with pdgcode %i\n",(int)c);
+        ++nerr;
+      }
+      if (exp_tf)
+        ++ntrkpass;
+      for (auto seg = trk->segmentBegin();seg!=trk->segmentEnd();++seg) {
+        ++nseg;
+        const bool intarget = seg->volumeName()=="lv_targetbox";
+        const bool exp_mother = intarget && seg->volumeDepthStored()>1 && seg->volumeName(1)=="world";
+        if ( vf->filter(seg)!=intarget
+             || vf_phys->filter(seg)!=(seg->physicalVolumeName()=="pv_targetbox")
+             || vf_mother->filter(seg)!=exp_mother
+             || vf_badmother->filter(seg) ) {
+          printf("ERROR: Wrong volume filter decision for segment in volume %s\n",seg->volumeNameCStr());
+          ++nerr;
+        }
+        if (intarget)
+          ++nsegpass;
+      }
+    }
+  }
+
+  printf("Checked filters on %i tracks (%i passing) and %i segments (%i passing): %s\n",
+         ntrk,ntrkpass,nseg,nsegpass,(nerr?"FAILED":"OK"));
+
+  for (Utils::RefCountBase* f : std::vector<Utils::RefCountBase*>{vf,vf_phys,vf_mother,vf_badmother,tf,tf_unsigned})
+    f->unref();
+
+  return nerr ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+#include "EvtFile/FileWriter.hh"
+#include "EvtFile/FileReader.hh"
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+//Test event checksums with the different algorithms, in files with both the
+//current and the old (version 2) layout of event headers.
+
+namespace {
+  class DummyFormat : public EvtFile::IFormat {
+  public:
+    DummyFormat() {}
+    std::uint32_t magicWord() const { return 0x12345679; }
+    const char* fileExtension() const { return ".dmy"; }
+    const char* eventBriefDataName() const { return "brf"; }
+    const char* eventFullDataName() const { return "dtld"; }
+    bool compressFullData() const { return true; }
+  };
+
+  static const DummyFormat dummyFormat;
+
+  void test(bool b, const char * what)
+  {
+    if (!b) {
+      printf("ERROR: Test failed: %s\n",what);
+      exit(1);
+    }
+  }
+
+  const char * algoName(EvtFile::CheckSumAlgo a)
+  {
+    return a == EvtFile::CheckSumAlgo::CRC32C ? "CRC32C" : "MurmurHash3";
+  }
+
+  void writeFile()
+  {
+    EvtFile::FileWriter fw(&dummyFormat,"testcs");
+    test(fw.ok(),"open output file");
+    test(fw.checkSumAlgo()==EvtFile::CheckSumAlgo::CRC32C,"default algorithm");
+    for (std::int32_t i = 0; i < 6; ++i) {
+      fw.setCheckSumAlgo(i%2 ? EvtFile::CheckSumAlgo::MurmurHash3 : EvtFile::CheckSumAlgo::CRC32C);
+      if (i%3==0)
+        fw.writeDataDBSection(i);
+      fw.writeDataBriefSection((std::int64_t)i);
+      //Large enough to be decompressed in several chunks during verification:
+      for (std::int32_t j = 0; j < (i%3) * 100000; ++j)
+        fw.writeDataFullSection(j%1000+i);
+      fw.flushEventToDisk(1,i);
+    }
+    test(fw.ok(),"writing");
+  }
+
+  //Rewrite file with version 2 event headers (the checksums are unchanged as
+  //long as all events use MurmurHash3):
+  void convertToVersion2(const char * infile, const char * outfile)
+  {
+    std::ifstream is(infile, std::ios::binary);
+    std::stringstream ss;
+    ss << is.rdbuf();
+    const std::string data = ss.str();
+    std::ofstream os(outfile, std::ios::binary);
+    std::uint32_t fileheader[2];
+    std::memcpy(fileheader,&data[0],8);
+    fileheader[1] = 2;
+    os.write((const char*)fileheader,8);
+    std::size_t pos = 8;
+    while (pos<data.size()) {
+      std::uint32_t h[7];
+      std::memcpy(h,&data[pos],sizeof(h));
+      test(h[6]==(std::uint32_t)EvtFile::CheckSumAlgo::MurmurHash3,"conversion requires MurmurHash3");
+      os.write((const char*)h,6*sizeof(std::uint32_t));
+      os.write(&data[pos+sizeof(h)],h[3]+h[4]+h[5]);
+      pos += sizeof(h)+h[3]+h[4]+h[5];
+    }
+  }
+
+  //Verify in various states of data loading:
+  unsigned verifyAll(const char * filename, int mode)
+  {
+    EvtFile::FileReader fr(&dummyFormat,filename);
+    test(fr.init(),"open input file");
+    unsigned nevts = 0;
+    for (;fr.eventActive();fr.goToNextEvent()) {
+      ++nevts;
+      if (mode==1)
+        fr.getBriefData();
+      if (mode==2)
+        fr.getFullDataPrefix(100);
+      if (mode==3)
+        fr.getFullData();
+      if (mode==4)
+        fr.getFullDataOnDisk();
+      if (mode==0)
+        printf("  Event %u: %u bytes of full data, checksum %08x (%s, header %u bytes)\n",
+               fr.eventNumber(),fr.nBytesFullData(),fr.eventCheckSum(),
+               algoName(fr.eventCheckSumAlgo()),fr.eventHeaderBytes());
+      test(fr.verifyEventDataIntegrity(),"verification");
+      //Data is still as expected afterwards:
+      test(*reinterpret_cast<const std::int64_t*>(fr.getBriefData())==fr.eventNumber(),"brief data");
+      const unsigned nfull = fr.nBytesFullData();
+      if (nfull) {
+        const std::int32_t * full = reinterpret_cast<const std::int32_t*>(fr.getFullData());
+        test(full[nfull/4-1]==int((nfull/4-1)%1000+fr.eventNumber()),"full data");
+      }
+      test(fr.verifyEventDataIntegrity(),"repeated verification");
+    }
+    test(fr.ok(),"reading");
+    return nevts;
+  }
+
+  void corrupt(const char * filename, std::size_t pos)
+  {
+    std::fstream f(filename, std::ios::in | std::ios::out | std::ios::binary);
+    f.seekg(pos);
+    char c;
+    f.read(&c,1);
+    c ^= 0x10;
+    f.seekp(pos);
+    f.write(&c,1);
+  }
+
+  unsigned nFailures(const char * filename)
+  {
+    EvtFile::FileReader fr(&dummyFormat,filename);
+    test(fr.init(),"open input file");
+    unsigned n = 0;
+    for (;fr.eventActive();fr.goToNextEvent())
+      n += (fr.verifyEventDataIntegrity() ? 0 : 1);
+    return n;
+  }
+}
+
+int main(int,char**)
+{
+  writeFile();
+  printf("File with mixed algorithms:\n");
+  for (int mode = 0; mode < 5; ++mode)
+    test(verifyAll("testcs.dmy",mode)==6,"number of events");
+
+  //Make a file with only MurmurHash3 events by copying them:
+  {
+    EvtFile::FileReader fr(&dummyFormat,"testcs.dmy");
+    test(fr.init(),"open input file");
+    EvtFile::FileWriter fw(&dummyFormat,"testcs_murmur.dmy");
+    std::vector<char> db;
+    for (;fr.eventActive();fr.goToNextEvent()) {
+      if (fr.eventCheckSumAlgo()!=EvtFile::CheckSumAlgo::MurmurHash3)
+        continue;
+      const std::uint32_t header[6] = { fr.eventCheckSum(), fr.runNumber(), fr.eventNumber(),
+                                        fr.nBytesSharedDataInEvent(), fr.nBytesBriefData(),
+                                        fr.nBytesFullDataOnDisk() };
+      fr.getSharedDataInEvent(db);
+      fw.writeRawEvent(header,fr.eventCheckSumAlgo(),db.data(),fr.getBriefData(),fr.getFullDataOnDisk());
+    }
+  }
+  convertToVersion2("testcs_murmur.dmy","testcs_v2.dmy");
+  printf("Version 2 file:\n");
+  for (int mode = 0; mode < 5; ++mode)
+    test(verifyAll("testcs_v2.dmy",mode)==3,"number of events in version 2 file");
+
+  //Corrupt a byte in the shared data section of the first event (CRC32C) and
+  //in the brief data of the second (MurmurHash3). Corrupted compressed data
+  //would instead make decompression fail with an exception:
+  test(nFailures("testcs.dmy")==0,"no failures");
+  const std::size_t evt0 = 8;
+  corrupt("testcs.dmy",evt0+7*4+1);
+  test(nFailures("testcs.dmy")==1,"detect corrupted shared data");
+  const std::size_t evt1 = evt0+7*4+4+8;
+  corrupt("testcs.dmy",evt1+7*4+1);
+  test(nFailures("testcs.dmy")==2,"detect corrupted brief data");
+
+  printf("All OK\n");
+  return 0;
+}
@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <random>
 #include <tuple>
+#include <stdexcept>
 
 void test(bool b)
 {
@@ -50,6 +51,98 @@ int test_seek(const char* datafile) {
   return 0;
 }
 
+void compare_steps(const GriffDataRead::Track* trk, const GriffDataRead::Track* trk_ref)
+{
+  test(trk->nSegments()==trk_ref->nSegments());
+  for (unsigned iseg = 0; iseg < trk->nSegments(); ++iseg) {
+    auto seg = trk->segmentBegin()+iseg;
+    auto seg_ref = trk_ref->segmentBegin()+iseg;
+    test(seg->nStepsStored()==seg_ref->nStepsStored());
+    test(seg->nStepsOriginal()==seg_ref->nStepsOriginal());
+    for (unsigned istep = 0; istep < seg->nStepsStored(); ++istep) {
+      auto step = seg->getStep(istep);
+      auto step_ref = seg_ref->getStep(istep);
+      test(step->eDep()==step_ref->eDep());
+      test(step->stepLength()==step_ref->stepLength());
+      test(step->preTime()==step_ref->preTime());
+      test(step->postEKin()==step_ref->postEKin());
+      test(step->postGlobalX()==step_ref->postGlobalX());
+      test(step->preMomentumZ()==step_ref->preMomentumZ());
+      test(step->stepStatusStr()==step_ref->stepStatusStr());
+    }
+  }
+}
+
+int test_lazysteps(const char* datafile) {
+
+  //Steps are only decompressed as far as needed. Test this by looking at steps
+  //of primary tracks first, and then at the remaining tracks in reverse order,
+  //comparing with a reader for which all step data is loaded up front:
+  GriffDataReader dr(datafile);
+  GriffDataReader dr_ref(datafile);
+  while (dr.loopEvents()) {
+    test(dr_ref.loopEvents());
+    test(dr.nTracks()==dr_ref.nTracks());
+    if (dr.eventStorageMode()==GriffFormat::Format::MODE_MINIMAL)
+      continue;
+    dr_ref.getRawFileReader()->getFullData();
+    const unsigned nprim = dr.nPrimaryTracks();
+    for (unsigned i = 0; i < nprim; ++i)
+      compare_steps(dr.getTrack(i),dr_ref.getTrack(i));
+    for (unsigned i = dr.nTracks(); i-- > nprim;)
+      compare_steps(dr.getTrack(i),dr_ref.getTrack(i));
+    test(dr.verifyEventDataIntegrity());
+  }
+  test(!dr_ref.loopEvents());
+  return 0;
+}
+
+int test_summaryonly(const char* datafile) {
+
+  //In summary-only mode, the brief data must be unchanged while any attempt to
+  //access step data must fail. Loop twice through the file, to also test the
+  //rewinding to the first event:
+  GriffDataReader dr(datafile,2);
+  GriffDataReader dr_ref(datafile,2);
+  dr.setSummaryOnly();
+  test(dr.summaryOnly());
+  while (dr.loopEvents()) {
+    test(dr_ref.loopEvents());
+    test(dr.eventCheckSum()==dr_ref.eventCheckSum());
+    test(dr.nTracks()==dr_ref.nTracks());
+    for (unsigned i = 0; i < dr.nTracks(); ++i) {
+      auto trk = dr.getTrack(i);
+      auto trk_ref = dr_ref.getTrack(i);
+      test(trk->trackID()==trk_ref->trackID());
+      test(trk->pdgName()==trk_ref->pdgName());
+      test(trk->startEKin()==trk_ref->startEKin());
+      test(trk->nSegments()==trk_ref->nSegments());
+      for (unsigned iseg = 0; iseg < trk->nSegments(); ++iseg) {
+        auto seg = trk->segmentBegin()+iseg;
+        auto seg_ref = trk_ref->segmentBegin()+iseg;
+        test(seg->eDep()==seg_ref->eDep());
+        test(seg->startTime()==seg_ref->startTime());
+        test(seg->volumeName()==seg_ref->volumeName());
+      }
+    }
+    bool threw = false;
+    try {
+      dr.getTrack(0)->segmentBegin()->nStepsStored();
+    } catch (std::runtime_error&) {
+      threw = true;
+    }
+    test(threw==(dr.eventStorageMode()!=GriffFormat::Format::MODE_MINIMAL));
+  }
+  test(!dr_ref.loopEvents());
+
+  //Step data is available again once the mode is switched off:
+  dr.setSummaryOnly(false);
+  test(dr.goToFirstEvent());
+  test(dr.verifyEventDataIntegrity());
+  if (dr.eventStorageMode()!=GriffFormat::Format::MODE_MINIMAL)
+    test(dr.getTrack(0)->segmentBegin()->nStepsStored()>0);
+  return 0;
+}
 
 void print_track_tree(const GriffDataRead::Track* trk, const std::string& prefix)
 {
@@ -247,5 +340,12 @@ int main(int,char**)
     return 1;
   }
 
-  return test_seek(datafile.c_str());
+  if (test_seek(datafile.c_str()))
+    return 1;
+  for (auto mode : { "full", "reduced", "minimal" }) {
+    std::string f = Core::findData("GriffDataRead",std::string("10evts_singleneutron_on_b10_")+mode+".griff");
+    if (test_summaryonly(f.c_str()))
+      return 1;
+  }
+  return test_lazysteps(datafile.c_str());
 }
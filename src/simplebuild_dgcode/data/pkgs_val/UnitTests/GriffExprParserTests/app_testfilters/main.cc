@@ -0,0 +1,182 @@
+#include "GriffExprParser/TrackFilter_Expr.hh"
+#include "GriffExprParser/SegmentFilter_Expr.hh"
+#include "GriffExprParser/StepFilter_Expr.hh"
+#include "GriffAnaUtils/SegmentIterator.hh"
+#include "GriffAnaUtils/StepIterator.hh"
+#include "GriffDataRead/GriffDataReader.hh"
+#include "Core/FindData.hh"
+#include "Core/FPE.hh"
+#include "Units/Units.hh"
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+
+//Verify that the expression based filters agree with explicit C++ code, also
+//for the name comparisons which are folded into cached lookups, and also when
+//the touchable database changes as a new file is opened.
+
+void test(bool b, const char * what)
+{
+  if (!b) {
+    printf("ERROR: Test failed: %s\n",what);
+    exit(1);
+  }
+}
+
+GriffDataReader * createReader()
+{
+  std::vector<std::string> files;
+  files.push_back(Core::findData("GriffDataRead","10evts_singleneutron_on_b10_full.griff"));
+  files.push_back(Core::findData("GriffDataRead","10evts_singleneutron_on_b10_reduced.griff"));
+  files.push_back(Core::findData("GriffDataRead","10evts_singleneutron_on_b10_full.griff"));
+  GriffDataReader * dr = new GriffDataReader(files);
+  dr->allowSetupChange();
+  return dr;
+}
+
+void testTrackFilter(const char * expr, std::function<bool(const GriffDataRead::Track*)> ref)
+{
+  auto f = new GriffExprParser::TrackFilter_Expr(expr);
+  f->ref();
+  GriffDataReader * dr = createReader();
+  unsigned n(0), npass(0);
+  while (dr->loopEvents()) {
+    for (auto trk = dr->trackBegin(); trk!=dr->trackEnd(); ++trk) {
+      const bool pass = f->filter(trk);
+      test(pass==ref(trk),expr);
+      ++n;
+      npass += pass;
+    }
+  }
+  printf("  %-75s : %u/%u tracks\n",expr,npass,n);
+  f->unref();
+  delete dr;
+}
+
+void testSegmentFilter(const char * expr, std::function<bool(const GriffDataRead::Segment*)> ref)
+{
+  //Check via a SegmentIterator, which also takes care of the negation:
+  for (int negate = 0; negate < 2; ++negate) {
+    GriffDataReader * dr = createReader();
+    GriffAnaUtils::SegmentIterator si(dr);
+    si.addFilter(new GriffExprParser::SegmentFilter_Expr(expr))->setNegated(negate);
+    unsigned n(0), npass(0);
+    while (dr->loopEvents()) {
+      const GriffDataRead::Segment * seg_it = si.next();
+      for (auto trk = dr->trackBegin(); trk!=dr->trackEnd(); ++trk) {
+        for (auto seg = trk->segmentBegin(); seg!=trk->segmentEnd(); ++seg) {
+          ++n;
+          if (ref(seg)==(negate!=0)) {
+            test(seg!=seg_it,expr);
+            continue;
+          }
+          test(seg==seg_it,expr);
+          ++npass;
+          seg_it = si.next();
+        }
+      }
+      test(seg_it==0,expr);
+    }
+    if (!negate)
+      printf("  %-75s : %u/%u segments\n",expr,npass,n);
+    delete dr;
+  }
+}
+
+void testStepFilter(const char * expr, std::function<bool(const GriffDataRead::Step*)> ref)
+{
+  GriffDataReader dr(Core::findData("GriffDataRead","10evts_singleneutron_on_b10_full.griff"));
+  GriffAnaUtils::StepIterator si(&dr);
+  si.addFilter(new GriffExprParser::StepFilter_Expr(expr));
+  unsigned n(0), npass(0);
+  while (dr.loopEvents()) {
+    const GriffDataRead::Step * step_it = si.next();
+    for (auto trk = dr.trackBegin(); trk!=dr.trackEnd(); ++trk) {
+      for (auto seg = trk->segmentBegin(); seg!=trk->segmentEnd(); ++seg) {
+        for (auto step = seg->stepBegin(); step!=seg->stepEnd(); ++step) {
+          ++n;
+          if (!ref(step))
+            continue;
+          test(step==step_it,expr);
+          ++npass;
+          step_it = si.next();
+        }
+      }
+    }
+    test(step_it==0,expr);
+  }
+  printf("  %-75s : %u/%u steps\n",expr,npass,n);
+}
+
+void testFolding(const char * expr, const char * expected_name)
+{
+  auto f = new GriffExprParser::SegmentFilter_Expr(expr);
+  f->ref();
+  printf("  %-45s -> %s\n",expr,f->tree()->name().c_str());
+  test(f->tree()->name()==expected_name,expr);
+  f->unref();
+}
+
+int main(int,char**)
+{
+  Core::catch_fpe();
+  GriffDataReader::setOpenMsg(false);
+
+  printf("Name comparisons with constant strings are folded:\n");
+  testFolding("seg.volname==\"lv_targetbox\"","seg.volname==\"lv_targetbox\"");
+  testFolding("\"lv_\"+\"targetbox\"!=seg.volname","seg.volname!=\"lv_targetbox\"");
+  testFolding("trk.name==\"alpha\"","trk.name==\"alpha\"");
+  testFolding("seg.volname==seg.volname_1","CmpEqual_svs");
+
+  printf("Testing track filters:\n");
+  testTrackFilter("trk.name==\"alpha\" || trk.name==\"gamma\"",
+                  [](const GriffDataRead::Track* t) { return t->pdgName()=="alpha" || t->pdgName()=="gamma"; });
+  testTrackFilter("trk.type!=\"nucleus\" && trk.ekin > 1keV",
+                  [](const GriffDataRead::Track* t) { return t->pdgType()!="nucleus" && t->startEKin() > 1*Units::keV; });
+
+  printf("Testing segment filters:\n");
+  testSegmentFilter("seg.volname==\"lv_targetbox\"",
+                    [](const GriffDataRead::Segment* s) { return s->volumeName()=="lv_targetbox"; });
+  testSegmentFilter("seg.physvolname!=\"pv_recordingbox_after\" && trk.name==\"e-\"",
+                    [](const GriffDataRead::Segment* s) { return s->physicalVolumeName()!="pv_recordingbox_after"
+                        && s->getTrack()->pdgName()=="e-"; });
+  testSegmentFilter("seg.volname_1==\"world\" && seg.mat_name!=\"G4_Galactic\" && seg.edep>0",
+                    [](const GriffDataRead::Segment* s) { return s->volumeDepthStored()>1 && s->volumeName(1)=="world"
+                        && s->material()->getName()!="G4_Galactic" && s->eDep()>0; });
+
+  printf("Testing step filters:\n");
+  testStepFilter("step.edep > 10keV && step.pre.ekin > step.post.ekin",
+                 [](const GriffDataRead::Step* s) { return s->eDep() > 10*Units::keV && s->preEKin() > s->postEKin(); });
+  testStepFilter("step.status==fGeomBoundary && trk.name==\"neutron\"",
+                 [](const GriffDataRead::Step* s) { return s->stepStatus()==GriffDataRead::Step::STATUS_GeomBoundary
+                     && s->getTrack()->pdgName()=="neutron"; });
+  testStepFilter("seg.volname==\"lv_targetbox\" && step.post.process_defined_step==\"NeutronInelastic\"",
+                 [](const GriffDataRead::Step* s) { return s->getSegment()->volumeName()=="lv_targetbox"
+                     && s->postProcessDefinedStep()=="NeutronInelastic"; });
+
+  //Invalid expressions:
+  for (auto expr : { "seg.edep > 0", "step.edep > 0", "step.pre > 0", "step.pre.nonexisting > 0" }) {
+    bool threw = false;
+    try {
+      auto f = new GriffExprParser::TrackFilter_Expr(expr);
+      f->ref();
+      f->unref();
+    } catch (ExprParser::InputError& e) {
+      threw = true;
+      printf("Invalid track filter expression \"%s\" gives %s : %s\n",expr,e.epType(),e.epWhat());
+    }
+    test(threw,expr);
+  }
+  bool threw = false;
+  try {
+    auto f = new GriffExprParser::SegmentFilter_Expr("step.edep > 0");
+    f->ref();
+    f->unref();
+  } catch (ExprParser::InputError& e) {
+    threw = true;
+    printf("Invalid segment filter expression \"step.edep > 0\" gives %s : %s\n",e.epType(),e.epWhat());
+  }
+  test(threw,"step.edep > 0");
+
+  return 0;
+}
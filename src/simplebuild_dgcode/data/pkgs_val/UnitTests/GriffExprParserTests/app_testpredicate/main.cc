@@ -0,0 +1,100 @@
+#include "GriffExprParser/EventPredicate.hh"
+#include "GriffDataRead/GriffDataReader.hh"
+#include "Core/FindData.hh"
+#include "Core/FPE.hh"
+#include "Units/Units.hh"
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+
+void test(bool b, const char * what)
+{
+  if (!b) {
+    printf("ERROR: Test failed: %s\n",what);
+    exit(1);
+  }
+}
+
+bool anySegment(const GriffDataReader& dr, std::function<bool(const GriffDataRead::Segment*)> f)
+{
+  for (auto trk = dr.trackBegin(); trk!=dr.trackEnd(); ++trk)
+    for (auto seg = trk->segmentBegin(); seg!=trk->segmentEnd(); ++seg)
+      if (f(seg))
+        return true;
+  return false;
+}
+
+bool anyTrack(const GriffDataReader& dr, std::function<bool(const GriffDataRead::Track*)> f)
+{
+  for (auto trk = dr.trackBegin(); trk!=dr.trackEnd(); ++trk)
+    if (f(trk))
+      return true;
+  return false;
+}
+
+void testPredicate(const std::string& datafile, const char * expr, std::function<bool(const GriffDataReader&)> ref)
+{
+  //The predicate must agree with the equivalent C++ code, both in normal and in
+  //summary-only mode:
+  GriffExprParser::EventPredicate pred(expr);
+  unsigned nsel(0), nevts(0);
+  for (int summaryonly = 0; summaryonly < 2; ++summaryonly) {
+    GriffDataReader dr(datafile);
+    dr.setSummaryOnly(summaryonly);
+    nsel = nevts = 0;
+    while (dr.loopEvents()) {
+      const bool sel = pred(dr);
+      test(sel==ref(dr),expr);
+      nsel += sel;
+      ++nevts;
+    }
+  }
+  printf("  %-60s : %s-level, selects %u/%u events\n",expr,pred.segmentLevel()?"segment":"track",nsel,nevts);
+}
+
+int main(int,char**)
+{
+  Core::catch_fpe();
+  GriffDataReader::setOpenMsg(false);
+
+  for (auto mode : { "full", "reduced", "minimal" }) {
+    std::string datafile = Core::findData("GriffDataRead",std::string("10evts_singleneutron_on_b10_")+mode+".griff");
+    printf("Testing predicates on file with %s storage mode:\n",mode);
+    testPredicate(datafile,"seg.volname==\"lv_targetbox\" && seg.edep > 1MeV",
+                  [](const GriffDataReader& dr) { return anySegment(dr,[](const GriffDataRead::Segment* s)
+                    { return s->volumeName()=="lv_targetbox" && s->eDep() > 1*Units::MeV; }); });
+    testPredicate(datafile,"trk.is_primary && seg.is_in_world && seg.iseg > 0 && seg.volname_1 == \"\"",
+                  [](const GriffDataReader& dr) { return anySegment(dr,[](const GriffDataRead::Segment* s)
+                    { return s->getTrack()->isPrimary() && s->isInWorldVolume() && s->iSegment() > 0; }); });
+    testPredicate(datafile,"trk.name==\"e-\" && seg.edep > 1keV",
+                  [](const GriffDataReader& dr) { return anySegment(dr,[](const GriffDataRead::Segment* s)
+                    { return s->getTrack()->pdgName()=="e-" && s->eDep() > 1*Units::keV; }); });
+    testPredicate(datafile,"trk.is_secondary && trk.name==\"alpha\" && seg.ekin_start-seg.ekin_end > 1.4MeV",
+                  [](const GriffDataReader& dr) { return anySegment(dr,[](const GriffDataRead::Segment* s)
+                    { return s->getTrack()->isSecondary() && s->getTrack()->pdgName()=="alpha"
+                        && s->startEKin()-s->endEKin() > 1.4*Units::MeV; }); });
+    testPredicate(datafile,"seg.physvolname==\"pv_recordingbox_after\" && seg.time_start > 685.9microsecond",
+                  [](const GriffDataReader& dr) { return anySegment(dr,[](const GriffDataRead::Segment* s)
+                    { return s->physicalVolumeName()=="pv_recordingbox_after" && s->startTime() > 685.9*Units::microsecond; }); });
+    testPredicate(datafile,"trk.ndaughters >= 5",
+                  [](const GriffDataReader& dr) { return anyTrack(dr,[](const GriffDataRead::Track* t)
+                    { return t->nDaughters() >= 5; }); });
+    testPredicate(datafile,"trk.is_ion && trk.creatorprocess == \"NeutronInelastic\"",
+                  [](const GriffDataReader& dr) { return anyTrack(dr,[](const GriffDataRead::Track* t)
+                    { return std::abs(t->pdgCode())/100000000==10 && t->creatorProcess()=="NeutronInelastic"; }); });
+  }
+
+  //Invalid expressions:
+  for (auto expr : { "seg.nonexisting > 0", "seg > 0", "trk.name > 1", "step.edep > 0" }) {
+    bool threw = false;
+    try {
+      GriffExprParser::EventPredicate pred(expr);
+    } catch (ExprParser::InputError& e) {
+      threw = true;
+      printf("Invalid expression \"%s\" gives %s : %s\n",expr,e.epType(),e.epWhat());
+    }
+    test(threw,expr);
+  }
+
+  return 0;
+}
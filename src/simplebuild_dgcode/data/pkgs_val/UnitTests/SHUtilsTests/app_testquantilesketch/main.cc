@@ -0,0 +1,182 @@
+#include "SimpleHistsUtils/QuantileSketch.hh"
+#include "SimpleHistsUtils/AutoBinHist1D.hh"
+#include "SimpleHists/Hist1D.hh"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+namespace {
+
+  void test(bool b, const char * what)
+  {
+    if (!b) {
+      printf("ERROR: Test failed: %s\n",what);
+      exit(1);
+    }
+  }
+
+  //Simple deterministic pseudo-random numbers (xorshift64*):
+  struct Rand {
+    std::uint64_t s;
+    Rand(std::uint64_t seed) : s(seed) {}
+    double operator()()
+    {
+      s ^= s >> 12; s ^= s << 25; s ^= s >> 27;
+      return ((s * 2685821657736338717ULL) >> 11) * (1.0/9007199254740992.0);
+    }
+  };
+
+  std::vector<double> expValues(std::uint64_t seed, unsigned n)
+  {
+    Rand rand(seed);
+    std::vector<double> v(n);
+    for (auto& x : v)
+      x = -std::log(1.0-rand());
+    return v;
+  }
+
+  double exactQuantile(std::vector<double> v, double q)
+  {
+    std::sort(v.begin(),v.end());
+    return v[std::min<std::size_t>(v.size()-1,q*v.size())];
+  }
+
+  //Check that the fraction of values below an estimated quantile is close to q
+  //(the sketch is most accurate near the ends, hence a relative tolerance):
+  void testQuantile(const std::vector<double>& v, double q, double estimate)
+  {
+    std::size_t nbelow(0);
+    for (auto x : v)
+      nbelow += (x < estimate ? 1 : 0);
+    const double qactual = double(nbelow)/v.size();
+    test(std::fabs(qactual-q)<0.25*std::min(q,1.0-q)+1e-4,"quantile accuracy");
+  }
+
+}
+
+int main(int,char**) {
+
+  {
+    printf("---- Small data sets are summarised exactly:\n");
+    SimpleHists::QuantileSketch s;
+    for (int i = 10; i >= 0; --i)
+      s.add(0.1*i);
+    printf("  n=%i, w=%g, min=%g, max=%g, q(0.5)=%g\n",(int)s.nCentroids(),s.totalWeight(),s.min(),s.max(),s.quantile(0.5));
+    test(s.nCentroids()==11&&s.totalWeight()==11,"all values kept");
+    test(s.min()==0.0&&s.max()==1.0&&s.quantile(0.0)==0.0&&s.quantile(1.0)==1.0,"exact min/max");
+    test(std::fabs(s.quantile(0.5)-0.5)<1e-12,"exact median");
+    s.add(7.0,0.0);
+    test(s.totalWeight()==11&&s.max()==1.0,"zero weights ignored");
+  }
+
+  {
+    printf("---- Accuracy and memory usage for large data sets:\n");
+    auto v = expValues(12345,1000000);
+    SimpleHists::QuantileSketch s;
+    for (auto x : v)
+      s.add(x);
+    printf("  n=%i centroids\n",(int)s.nCentroids());
+    test(s.nCentroids()<=100,"bounded number of centroids");
+    for (double q : {0.001,0.005,0.1,0.5,0.9,0.995,0.999}) {
+      const double exact = exactQuantile(v,q);
+      const double approx = s.quantile(q);
+      printf("  q=%-5g exact=%.5f sketch=%.5f\n",q,exact,approx);
+      testQuantile(v,q,approx);
+    }
+  }
+
+  {
+    printf("---- Merging and serialisation:\n");
+    auto v1 = expValues(1,200000);
+    auto v2 = expValues(2,300000);
+    for (auto& x : v2)
+      x += 2.0;
+    SimpleHists::QuantileSketch s1, s2, sall;
+    for (auto x : v1) { s1.add(x,0.5); sall.add(x,0.5); }
+    for (auto x : v2) { s2.add(x,0.5); sall.add(x,0.5); }
+    SimpleHists::QuantileSketch smerged(s1);
+    smerged.merge(s2);
+    test(smerged.totalWeight()==sall.totalWeight(),"merged weight");
+    test(smerged.min()==sall.min()&&smerged.max()==sall.max(),"merged min/max");
+    std::vector<double> vall(v1);
+    vall.insert(vall.end(),v2.begin(),v2.end());
+    for (double q : {0.01,0.3,0.5,0.7,0.99}) {
+      const double exact = exactQuantile(vall,q);
+      printf("  q=%-5g exact=%.4f merged=%.4f direct=%.4f\n",q,exact,smerged.quantile(q),sall.quantile(q));
+      testQuantile(vall,q,smerged.quantile(q));
+    }
+
+    std::string data, data2;
+    smerged.serialise(data);
+    SimpleHists::QuantileSketch sread(data);
+    sread.serialise(data2);
+    test(data==data2,"serialisation round trip");
+    test(sread.quantile(0.3)==smerged.quantile(0.3),"deserialised quantile");
+
+    //Same merge order gives identical results:
+    SimpleHists::QuantileSketch smerged2(s1);
+    smerged2.merge(s2);
+    smerged2.serialise(data2);
+    test(data==data2,"deterministic merging");
+  }
+
+  {
+    printf("---- AutoBinHist1D filled in two \"processes\":\n");
+    auto v1 = expValues(3,20000);
+    auto v2 = expValues(4,20000);
+    for (auto& x : v2)
+      x *= 1.5;
+    SimpleHists::Hist1D h1(50,0.0,1.0), h2(50,0.0,1.0), h3(50,0.0,1.0), h4(50,0.0,1.0);
+    SimpleHists::AutoBinHist1D a1(&h1,1000), a2(&h2,1000), a3(&h3,1000), a4(&h4,1000);
+    for (auto a : {&a1,&a2,&a3,&a4})
+      a->autoFit(0.99);
+    a1.fillMany(v1.data(),500);
+    a2.fillMany(v2.data(),500);
+    for (unsigned i = 0; i < 500; ++i)
+      a3.fill(v1[i]);
+    //Exchange sketches (serialised) and agree on binning:
+    std::string d1, d2;
+    a1.sketch().serialise(d1);
+    a2.sketch().serialise(d2);
+    SimpleHists::QuantileSketch combined(d1);
+    combined.merge(SimpleHists::QuantileSketch(d2));
+    a1.setBinning(combined);
+    a2.setBinning(combined);
+    printf("  Agreed range: [%g, %g]\n",h1.getXMin(),h1.getXMax());
+    test(h1.mergeCompatible(&h2),"histograms with agreed binning can be merged");
+    a1.fillMany(v1.data()+500,v1.size()-500);
+    a2.fillMany(v2.data()+500,v2.size()-500);
+    h1.merge(&h2);
+    test(h1.getIntegral()==40000,"merged contents");
+
+    //Without agreement, binning comes from the first values:
+    a3.fillMany(v1.data()+500,v1.size()-500);
+    a4.fillMany(v2.data(),v2.size());
+    printf("  Independent ranges: [%g, %g] and [%g, %g]\n",h3.getXMin(),h3.getXMax(),h4.getXMin(),h4.getXMax());
+    test(!h3.mergeCompatible(&h4),"independent binnings differ");
+    test(h3.getIntegral()==20000&&h3.getNBins()==50,"auto-binned contents");
+
+    //fillMany gives same results as fill:
+    SimpleHists::Hist1D h5(50,0.0,1.0), h6(50,0.0,1.0);
+    SimpleHists::AutoBinHist1D a5(&h5,1000), a6(&h6,1000);
+    std::vector<double> w(v1.size());
+    for (std::size_t i = 0; i < w.size(); ++i)
+      w[i] = (i%7==3 ? 0.0 : 0.5+(i%3));
+    for (std::size_t i = 0; i < v1.size(); ++i)
+      a5.fill(v1[i],w[i]);
+    a6.fillMany(v1.data(),w.data(),1700);
+    a6.fillMany(v1.data()+1700,w.data()+1700,v1.size()-1700);
+    printf("  Weighted: range [%g, %g], integral %g\n",h5.getXMin(),h5.getXMax(),h5.getIntegral());
+    test(h5.getXMin()==h6.getXMin()&&h5.getXMax()==h6.getXMax(),"fillMany binning");
+    test(std::fabs(h5.getIntegral()-h6.getIntegral())<1e-9*h5.getIntegral(),"fillMany contents");
+    for (unsigned i = 0; i < h5.getNBins(); ++i)
+      test(std::fabs(h5.getBinContent(i)-h6.getBinContent(i))<1e-9*h5.getIntegral(),"fillMany bin contents");
+  }
+
+  printf("All OK\n");
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include "SimpleHists/Hist1D.hh"
+#include "SimpleHists/Hist2D.hh"
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+//Compare the speed of filling histograms from arrays with fillMany (as done
+//when filling from numpy arrays) with the speed of calling fill for each
+//value. Any change to fillMany must be at least as fast as the per-value
+//loop, with the default compilation flags. Usage: app_benchfill [nvalues]
+//(default 1e7).
+
+namespace sh = SimpleHists;
+
+namespace {
+
+  std::uint64_t s_seed = 123;
+  double rnd()
+  {
+    s_seed = s_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (s_seed >> 11) * (1.0/9007199254740992.0);
+  }
+
+  //Sum of uniform numbers, roughly gaussian in [-10,10] with tails outside:
+  double rndval(double scale)
+  {
+    return scale*(rnd()+rnd()+rnd()+rnd()-2.0);
+  }
+
+  //Best time of each function (alternating, to be fair to both):
+  template<class TFct1, class TFct2>
+  void bench(TFct1 fct1, TFct2 fct2, double& t1, double& t2)
+  {
+    auto timeit = [](auto& fct)
+    {
+      auto t0 = std::chrono::steady_clock::now();
+      fct();
+      return std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+    };
+    for (unsigned r = 0; r < 5; ++r) {
+      const double a = timeit(fct1);
+      const double b = timeit(fct2);
+      t1 = ( r==0 || a < t1 ) ? a : t1;
+      t2 = ( r==0 || b < t2 ) ? b : t2;
+    }
+  }
+
+  void report(const char * what, unsigned n, double t_loop, double t_many)
+  {
+    printf("  %-18s : fill() loop %7.1f Mfill/s, fillMany %7.1f Mfill/s (ratio %.2f)\n",
+           what,n/t_loop*1e-6,n/t_many*1e-6,t_loop/t_many);
+  }
+
+}
+
+int main(int argc, char** argv)
+{
+  const unsigned n = argc > 1 ? unsigned(std::atof(argv[1])) : 10000000;
+  std::vector<double> x(n), y(n), w(n);
+  for (unsigned i = 0; i < n; ++i) {
+    x[i] = rndval(6.0);
+    y[i] = rndval(5.0);
+    w[i] = 0.5 + rnd();
+  }
+
+  printf("Filling %u values (best of 5):\n",n);
+  {
+    sh::Hist1D ha(100,-10.0,10.0), hb(100,-10.0,10.0);
+    double t_loop, t_many;
+    bench([&]{ for (unsigned i = 0; i < n; ++i) ha.fill(x[i]); },
+          [&]{ hb.fillMany(x.data(),n); },t_loop,t_many);
+    report("Hist1D",n,t_loop,t_many);
+  }
+  {
+    sh::Hist1D ha(100,-10.0,10.0), hb(100,-10.0,10.0);
+    double t_loop, t_many;
+    bench([&]{ for (unsigned i = 0; i < n; ++i) ha.fill(x[i],w[i]); },
+          [&]{ hb.fillMany(x.data(),w.data(),n); },t_loop,t_many);
+    report("Hist1D weighted",n,t_loop,t_many);
+  }
+  {
+    sh::Hist2D ha(100,-10.0,10.0,100,-10.0,10.0), hb(100,-10.0,10.0,100,-10.0,10.0);
+    double t_loop, t_many;
+    bench([&]{ for (unsigned i = 0; i < n; ++i) ha.fill(x[i],y[i]); },
+          [&]{ hb.fillMany(x.data(),y.data(),n); },t_loop,t_many);
+    report("Hist2D",n,t_loop,t_many);
+  }
+  {
+    sh::Hist2D ha(100,-10.0,10.0,100,-10.0,10.0), hb(100,-10.0,10.0,100,-10.0,10.0);
+    double t_loop, t_many;
+    bench([&]{ for (unsigned i = 0; i < n; ++i) ha.fill(x[i],y[i],w[i]); },
+          [&]{ hb.fillMany(x.data(),y.data(),w.data(),n); },t_loop,t_many);
+    report("Hist2D weighted",n,t_loop,t_many);
+  }
+  return 0;
+}
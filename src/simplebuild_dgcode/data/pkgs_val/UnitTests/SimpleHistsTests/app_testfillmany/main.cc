@@ -0,0 +1,200 @@
+#include "SimpleHists/Hist1D.hh"
+#include "SimpleHists/Hist2D.hh"
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+//Verify that filling from arrays with fillMany gives the same results as
+//calling fill for each value (up to floating point rounding in statistics).
+
+namespace sh = SimpleHists;
+
+namespace {
+  class SimpleRandGen {
+    // very simple multiply-with-carry rand gen (http://en.wikipedia.org/wiki/Random_number_generation)
+  public:
+    SimpleRandGen()
+      : m_w(117),/* must not be zero, nor 0x464fffff */
+        m_z(11713)/* must not be zero, nor 0x9068ffff */
+    {
+    }
+    ~SimpleRandGen(){}
+
+    double shoot()
+    {
+      m_w = 18000 * (m_w & 65535) + (m_w >> 16);
+      m_z = 36969 * (m_z & 65535) + (m_z >> 16);
+      return double((m_z << 16) + m_w)/double(UINT32_MAX);  /* 32-bit result */
+    }
+  private:
+    std::uint32_t m_w;
+    std::uint32_t m_z;
+  };
+
+  void test(bool b, const char * what)
+  {
+    if (!b) {
+      printf("ERROR: Test failed: %s\n",what);
+      exit(1);
+    }
+  }
+
+  bool near(double a, double b)
+  {
+    return std::fabs(a-b) <= 1e-10*std::max(1.0,std::max(std::fabs(a),std::fabs(b)));
+  }
+
+  //Values in and around [xmin,xmax] = [-1,3], including the edges:
+  std::vector<double> genValues(SimpleRandGen& rg, unsigned n)
+  {
+    std::vector<double> v;
+    v.reserve(n+6);
+    v.push_back(-1.0);
+    v.push_back(3.0);
+    v.push_back(std::nextafter(3.0,0.0));
+    v.push_back(std::nextafter(-1.0,-2.0));
+    v.push_back(std::nextafter(3.0,4.0));
+    v.push_back(1.0e6);
+    for (unsigned i = 0; i < n; ++i)
+      v.push_back(-2.0+6.0*rg.shoot());
+    return v;
+  }
+
+  void compare(const sh::Hist1D& h, const sh::Hist1D& href, const char * what)
+  {
+    printf("  %-40s : integral=%g underflow=%g overflow=%g\n",what,h.getIntegral(),h.getUnderflow(),h.getOverflow());
+    for (unsigned i = 0; i < h.getNBins(); ++i) {
+      test(near(h.getBinContent(i),href.getBinContent(i)),"bin content");
+      test(near(h.getBinError(i),href.getBinError(i)),"bin error");
+    }
+    test(near(h.getUnderflow(),href.getUnderflow()),"underflow");
+    test(near(h.getOverflow(),href.getOverflow()),"overflow");
+    test(near(h.getIntegral(),href.getIntegral()),"integral");
+    test(h.empty()==href.empty(),"empty");
+    if (href.empty())
+      return;
+    test(h.getMinFilled()==href.getMinFilled(),"minfilled");
+    test(h.getMaxFilled()==href.getMaxFilled(),"maxfilled");
+    test(near(h.getMean(),href.getMean()),"mean");
+    test(near(h.getRMS(),href.getRMS()),"rms");
+  }
+
+  void compare(const sh::Hist2D& h, const sh::Hist2D& href, const char * what)
+  {
+    printf("  %-40s : integral=%g\n",what,h.getIntegral());
+    for (unsigned ix = 0; ix < h.getNBinsX(); ++ix)
+      for (unsigned iy = 0; iy < h.getNBinsY(); ++iy)
+        test(near(h.getBinContent(ix,iy),href.getBinContent(ix,iy)),"bin content");
+    test(near(h.getUnderflowX(),href.getUnderflowX()),"underflowx");
+    test(near(h.getOverflowX(),href.getOverflowX()),"overflowx");
+    test(near(h.getUnderflowY(),href.getUnderflowY()),"underflowy");
+    test(near(h.getOverflowY(),href.getOverflowY()),"overflowy");
+    test(near(h.getIntegral(),href.getIntegral()),"integral");
+    test(h.getMinFilledX()==href.getMinFilledX(),"minfilledx");
+    test(h.getMaxFilledY()==href.getMaxFilledY(),"maxfilledy");
+    test(near(h.getMeanX(),href.getMeanX()),"meanx");
+    test(near(h.getMeanY(),href.getMeanY()),"meany");
+    test(near(h.getRMSX(),href.getRMSX()),"rmsx");
+    test(near(h.getRMSY(),href.getRMSY()),"rmsy");
+    test(near(h.getCovariance(),href.getCovariance()),"covariance");
+  }
+}
+
+int main(int,char**) {
+
+  SimpleRandGen rg;
+  //More than one block, and a partial last block:
+  const unsigned n = 2500;
+  std::vector<double> x = genValues(rg,n);
+  std::vector<double> y = genValues(rg,n);
+  std::vector<double> w, w01;
+  for (unsigned i = 0; i < x.size(); ++i) {
+    w.push_back(i%10==0 ? 0.0 : 0.1+2.0*rg.shoot());
+    w01.push_back(i%3==0 ? 0.0 : 1.0);
+  }
+
+  printf("Comparing fillMany with repeated fill calls:\n");
+  {
+    sh::Hist1D h(40,-1.0,3.0), href(40,-1.0,3.0);
+    h.fillMany(x.data(),x.size());
+    for (auto v : x)
+      href.fill(v);
+    compare(h,href,"Hist1D");
+    //Once more on top, after errors are enabled:
+    h.fill(0.5,3.3);
+    href.fill(0.5,3.3);
+    h.fillMany(x.data(),x.size());
+    for (auto v : x)
+      href.fill(v);
+    compare(h,href,"Hist1D (with errors)");
+  }
+  {
+    sh::Hist1D h(40,-1.0,3.0), href(40,-1.0,3.0);
+    h.fillMany(x.data(),w.data(),x.size());
+    for (unsigned i = 0; i < x.size(); ++i)
+      href.fill(x[i],w[i]);
+    compare(h,href,"Hist1D weighted");
+  }
+  {
+    sh::Hist1D h(40,-1.0,3.0), href(40,-1.0,3.0);
+    h.fillMany(x.data(),w01.data(),x.size());
+    for (unsigned i = 0; i < x.size(); ++i)
+      href.fill(x[i],w01[i]);
+    compare(h,href,"Hist1D weighted (0 or 1)");
+  }
+  {
+    sh::Hist1D h(40,-1.0,3.0), href(40,-1.0,3.0);
+    std::vector<double> w0(x.size(),0.0);
+    h.fillMany(x.data(),w0.data(),x.size());
+    compare(h,href,"Hist1D weighted (all 0)");
+  }
+  {
+    sh::Hist1D h(40,-1.0,3.0);
+    std::vector<double> wneg(w);
+    wneg.back() = -1.0;
+    bool caught(false);
+    try {
+      h.fillMany(x.data(),wneg.data(),x.size());
+    } catch (std::runtime_error&) {
+      caught = true;
+    }
+    test(caught,"negative weights");
+    printf("  %-40s : rejected\n","Hist1D negative weight");
+  }
+  {
+    sh::Hist2D h(20,-1.0,3.0,30,-1.0,3.0), href(20,-1.0,3.0,30,-1.0,3.0);
+    h.fillMany(x.data(),y.data(),x.size());
+    for (unsigned i = 0; i < x.size(); ++i)
+      href.fill(x[i],y[i]);
+    compare(h,href,"Hist2D");
+  }
+  {
+    sh::Hist2D h(20,-1.0,3.0,30,-1.0,3.0), href(20,-1.0,3.0,30,-1.0,3.0);
+    h.fill(0.1,0.2);
+    href.fill(0.1,0.2);
+    h.fillMany(x.data(),y.data(),w.data(),x.size());
+    for (unsigned i = 0; i < x.size(); ++i)
+      href.fill(x[i],y[i],w[i]);
+    compare(h,href,"Hist2D weighted");
+  }
+
+  //Large offsets, as in app_statvalidate:
+  {
+    const double width = std::exp(1);
+    const double offset = width*1e6;
+    std::vector<double> v;
+    for (unsigned i = 0; i < 100000; ++i)
+      v.push_back((1+i%5)*width+offset);
+    sh::Hist1D h(100,0,offset+6*width), href(100,0,offset+6*width);
+    h.fillMany(v.data(),v.size());
+    for (auto e : v)
+      href.fill(e);
+    compare(h,href,"Hist1D large offset");
+  }
+
+  printf("All OK\n");
+  return 0;
+}
@@ -0,0 +1,54 @@
+#include "Utils/ProgressiveHash.hh"
+#include "Utils/ProgressiveCRC32C.hh"
+#include <vector>
+#include <chrono>
+#include <cstdio>
+
+//Compare speed of the checksum algorithms available for Griff events
+//(MurmurHash3, used in files before format version 3, and CRC32C with and
+//without CPU instructions), for various sizes of the data blocks added. The
+//data is kept small enough to stay in the CPU caches, since reading it from
+//main memory would otherwise limit the speed of the fastest algorithm.
+
+namespace {
+  template<class THash>
+  void bench(const char * name, const std::vector<char>& data, unsigned blocksize)
+  {
+    const unsigned nblocks = data.size()/blocksize;
+    const unsigned nrepeat = 2000;
+    std::uint32_t dummy(0);
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < nrepeat; ++r) {
+      //Separate checksum for each block, like for events of that size:
+      for (unsigned i = 0; i < nblocks; ++i) {
+        THash h;
+        h.addData(&data[i*blocksize],blocksize);
+        dummy += h.getHash();
+      }
+    }
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+    const double nbytes = double(nrepeat)*nblocks*blocksize;
+    printf("  %-20s blocksize %8u B : %8.2f GB/s   [%08x]\n",name,blocksize,nbytes*1e-9/secs,dummy);
+  }
+}
+
+int main(int,char**)
+{
+  std::vector<char> data(1000000);
+  std::uint32_t s = 1;
+  for (auto& c : data) {
+    s = s * 1103515245 + 12345;
+    c = char(s >> 16);
+  }
+  const bool hw = ProgressiveCRC32C::hardwareAccelerated();
+  printf("Hardware accelerated CRC32C available: %s\n",hw?"yes":"no");
+  for (unsigned blocksize : {100u, 1000u, 10000u, 1000000u}) {
+    bench<ProgressiveHash>("MurmurHash3",data,blocksize);
+    ProgressiveCRC32C::setHardwareAccelerationEnabled(false);
+    bench<ProgressiveCRC32C>("CRC32C (portable)",data,blocksize);
+    ProgressiveCRC32C::setHardwareAccelerationEnabled(true);
+    if (hw)
+      bench<ProgressiveCRC32C>("CRC32C (hardware)",data,blocksize);
+  }
+  return 0;
+}
@@ -0,0 +1,80 @@
+#include "Utils/ProgressiveCRC32C.hh"
+#include <vector>
+#include <string>
+#include <cstdio>
+
+namespace {
+  std::uint32_t crc(const char * data, unsigned n)
+  {
+    ProgressiveCRC32C c;
+    c.addData(data,n);
+    return c.getHash();
+  }
+}
+
+int main(int,char**)
+{
+  printf("Hardware acceleration available: %s\n",ProgressiveCRC32C::hardwareAccelerated()?"yes":"no");
+
+  //Standard check value and test vectors from RFC 3720 (iSCSI):
+  const std::string digits("123456789");
+  std::vector<char> zeros(32,0), ones(32,char(0xFF)), incr(32);
+  for (unsigned i = 0; i < 32; ++i)
+    incr[i] = char(i);
+  const bool hw = ProgressiveCRC32C::hardwareAccelerated();
+  for (int usehw = (hw ? 1 : 0); usehw >= 0; --usehw) {
+    ProgressiveCRC32C::setHardwareAccelerationEnabled(usehw);
+    if (crc(digits.data(),digits.size())!=0xE3069283
+        || crc(zeros.data(),32)!=0x8A9136AA
+        || crc(ones.data(),32)!=0x62A8AB43
+        || crc(incr.data(),32)!=0x46DD794E
+        || crc(nullptr,0)!=0) {
+      printf("error: wrong CRC32C values!\n");
+      return 1;
+    }
+  }
+  ProgressiveCRC32C::setHardwareAccelerationEnabled(true);
+  if (ProgressiveCRC32C::hardwareAccelerated()!=hw) {
+    printf("error: could not reenable hardware acceleration!\n");
+    return 1;
+  }
+
+  //Results must not depend on how the data is split up, its alignment in
+  //memory, or the implementation used:
+  std::vector<char> data(2000);
+  std::uint32_t s = 12345;
+  for (auto& c : data) {
+    s = s * 1103515245 + 12345;
+    c = char(s >> 16);
+  }
+  for (unsigned offset = 0; offset < 16; ++offset) {
+    const unsigned n = data.size()-offset;
+    ProgressiveCRC32C::setHardwareAccelerationEnabled(false);
+    const std::uint32_t expected = crc(&data[offset],n);
+    ProgressiveCRC32C::setHardwareAccelerationEnabled(true);
+    if (crc(&data[offset],n)!=expected) {
+      printf("error: different results with hardware acceleration!\n");
+      return 1;
+    }
+    for (unsigned n1 = 0; n1 < 40; n1 += 3) {
+      for (unsigned n2 = 0; n2 < 100; n2 += 7) {
+        ProgressiveCRC32C c;
+        c.addData(&data[offset],n1);
+        c.addData(&data[offset+n1],n2);
+        c.addData(&data[offset+n1+n2],n-n1-n2);
+        if (c.getHash()!=expected) {
+          printf("error: different CRC when calculating in multiple steps!\n");
+          return 1;
+        }
+        c.reset();
+        c.addData(&data[offset],n);
+        if (c.getHash()!=expected) {
+          printf("error: different CRC after a reset()!\n");
+          return 1;
+        }
+      }
+    }
+  }
+  printf("All tests succeeded!\n");
+  return 0;
+}
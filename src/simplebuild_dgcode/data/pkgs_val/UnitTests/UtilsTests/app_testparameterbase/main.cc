@@ -1,17 +1,18 @@
 #include "Utils/ParametersBase.hh"
 #include "Utils/DummyParamHolder.hh"
+#include <cassert>
 
 class MyClassWithParameters : public Utils::ParametersBase
 {
 public:
   MyClassWithParameters()
   {
-    addParameterDouble("some_dbl_par",17.0);
+    m_dbl = addParameterDouble("some_dbl_par",17.0);
     addParameterDouble("some_dbl_par_0to1",0.5e-10,0.0,1.0);
-    addParameterInt("some_int_par",-5);
+    m_int = addParameterInt("some_int_par",-5);
     addParameterInt("some_int_par_-100to100",10,-100,100);
-    addParameterBoolean("some_bool_par", true);
-    addParameterString("some_string_par","some string");
+    m_bool = addParameterBoolean("some_bool_par", true);
+    m_str = addParameterString("some_string_par","some string");
     addParameterString("some_string_with_allowed_values","YES");
   }
 protected:
@@ -32,6 +33,12 @@ protected:
     }
     return true;
   }
+public:
+  //Fast access via handles:
+  Utils::ParamHandle<double> m_dbl;
+  Utils::ParamHandle<int> m_int;
+  Utils::ParamHandle<bool> m_bool;
+  Utils::ParamHandle<std::string> m_str;
 };
 
 int main(int,char**)
@@ -60,5 +67,20 @@ int main(int,char**)
   delete[] serialised;
   dummy.dump("  ");
 
+  printf("---- test handles ----\n");
+  MyClassWithParameters p3;
+  auto h = p3.getParameterHandleDouble("some_dbl_par_0to1");
+  p3.setParameterDouble("some_dbl_par",2.5);
+  p3.setParameterString("some_string_par","handled");
+  assert(!p3.isLocked());
+  printf("  some_dbl_par = %g\n",p3.m_dbl.get());
+  assert(p3.isLocked());//reading through handle locks
+  printf("  some_dbl_par_0to1 = %g\n",h.get());
+  printf("  some_int_par = %i\n",p3.m_int.get());
+  printf("  some_bool_par = %s\n",p3.m_bool ? "yes" : "no");
+  printf("  some_string_par = \"%s\"\n",p3.m_str.get().c_str());
+  assert(p3.m_dbl.get()==p3.getParameterDouble("some_dbl_par"));
+  assert(&p3.m_str.get()==&p3.getParameterString("some_string_par"));
+
   return 0;
 }
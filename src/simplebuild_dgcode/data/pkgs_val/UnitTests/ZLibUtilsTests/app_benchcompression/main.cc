@@ -0,0 +1,100 @@
+#include "ZLibUtils/Compress.hh"
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+//Compare the speed of the one-shot compression functions with the stateful
+//Compressor/Decompressor (also with a preset dictionary), for buffers of
+//various sizes. The data mimics the full data sections of Griff events: records
+//of small integer indices followed by floating point numbers which vary
+//slowly from record to record.
+
+namespace {
+
+  std::uint32_t s_seed = 1;
+  unsigned rnd(unsigned n)
+  {
+    s_seed = s_seed * 1103515245 + 12345;
+    return (s_seed >> 16) % n;
+  }
+
+  void genEvent(std::vector<char>& out, unsigned nbytes)
+  {
+    const unsigned recsize = 48;
+    out.clear();
+    float vals[10] = { 1.0f, 0.5f, -2.0f, 10.0f, 0.025f, 1e-3f, 3.0f, 4.0f, 0.0f, 1.0f };
+    while (out.size() < nbytes) {
+      std::int32_t idx[2] = { std::int32_t(rnd(5)), std::int32_t(rnd(3)) };
+      for (auto& v : vals)
+        v *= 1.0f + 0.01f*(rnd(100)-50.0f)/50.0f;
+      char rec[recsize];
+      std::memcpy(rec,idx,sizeof(idx));
+      std::memcpy(rec+sizeof(idx),vals,sizeof(vals));
+      out.insert(out.end(),rec,rec+recsize);
+    }
+    out.resize(nbytes);
+  }
+
+  enum Mode { ONESHOT, STATEFUL, DICTIONARY };
+
+  void bench(Mode mode, const std::vector<std::vector<char>>& events, const std::vector<char>& dict)
+  {
+    ZLibUtils::Compressor comp;
+    ZLibUtils::Decompressor decomp;
+    if (mode==DICTIONARY) {
+      comp.setDictionary(dict.data(),dict.size());
+      decomp.setDictionary(dict.data(),dict.size());
+    }
+    std::vector<Utils::DynBuffer<char>> zipped(events.size());
+    Utils::DynBuffer<char> out;
+    double nbytes(0), nbytes_zipped(0);
+    const unsigned nrepeat = 5;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < nrepeat; ++r) {
+      for (std::size_t i = 0; i < events.size(); ++i) {
+        if (mode==ONESHOT) {
+          unsigned n;
+          ZLibUtils::compressToBuffer(events[i].data(),events[i].size(),zipped[i],n);
+        } else {
+          comp.compress(events[i].data(),events[i].size(),zipped[i]);
+        }
+        nbytes += events[i].size();
+        nbytes_zipped += zipped[i].size();
+      }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < nrepeat; ++r) {
+      for (auto& z : zipped) {
+        if (mode==ONESHOT)
+          ZLibUtils::decompressToBufferNew(z.data(),z.size(),out);
+        else
+          decomp.decompress(z.data(),z.size(),out);
+      }
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    const double secs_comp = std::chrono::duration<double>(t1-t0).count();
+    const double secs_decomp = std::chrono::duration<double>(t2-t1).count();
+    const char * names[3] = { "one-shot", "stateful", "stateful+dict" };
+    printf("  %-14s size %6u B : compress %8.1f MB/s  decompress %8.1f MB/s  ratio %5.1f %%\n",
+           names[mode],(unsigned)events.front().size(),nbytes*1e-6/secs_comp,nbytes*1e-6/secs_decomp,
+           100.0*nbytes_zipped/nbytes);
+  }
+
+}
+
+int main(int,char**)
+{
+  std::vector<char> dict;
+  genEvent(dict,4096);
+  for (unsigned eventsize : {200u, 1000u, 5000u, 50000u}) {
+    std::vector<std::vector<char>> events(2000000/eventsize);
+    for (auto& e : events)
+      genEvent(e,eventsize);
+    for (Mode mode : {ONESHOT, STATEFUL, DICTIONARY})
+      bench(mode,events,dict);
+  }
+  return 0;
+}
@@ -2,6 +2,10 @@
 #include <string>
 #include <iostream>
 #include "Core/Types.hh"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 // Note: H.C.Andersen is no longer copyright!! :-)
 
@@ -35,6 +39,137 @@ static const std::string data_orig = "Det sydede og bruste, mens Ilden flammede
 ""
 "H.C. Andersen.";
 
+static bool sameData(const Utils::DynBuffer<char>& a, const Utils::DynBuffer<char>& b)
+{
+  return a.size()==b.size() && ( a.empty() || std::memcmp(a.data(),b.data(),a.size())==0 );
+}
+
+static bool decompressFails(ZLibUtils::Decompressor& d, const Utils::DynBuffer<char>& data)
+{
+  Utils::DynBuffer<char> out;
+  try {
+    d.decompress(data.data(),data.size(),out);
+  } catch (std::runtime_error&) {
+    return true;
+  }
+  return false;
+}
+
+//Test the stateful Compressor/Decompressor (and the PartialDecompressor) on
+//many buffers of varying sizes, with and without a dictionary:
+static int testStateful()
+{
+  ZLibUtils::Compressor comp;
+  ZLibUtils::Decompressor decomp;
+  ZLibUtils::PartialDecompressor pdecomp;
+  Utils::DynBuffer<char> z, z_oneshot, out, out_partial;
+  const char * orig = data_orig.c_str();
+  const unsigned norig = data_orig.size();
+  for (unsigned i = 0; i < 200; ++i) {
+    const unsigned offset = (i*7919)%norig;
+    const unsigned n = std::min<unsigned>(norig-offset,(i*i*13)%3000);
+    comp.compress(orig+offset,n,z);
+    unsigned nz;
+    ZLibUtils::compressToBuffer(orig+offset,n,z_oneshot,nz);
+    if (!sameData(z,z_oneshot)) {
+      printf("ERROR: Compressor output differs from compressToBuffer output\n");
+      return 1;
+    }
+    decomp.decompress(z.data(),z.size(),out);
+    if (out.size()!=n || (n && std::memcmp(out.data(),orig+offset,n)!=0)) {
+      printf("ERROR: Decompressor output differs from original data\n");
+      return 1;
+    }
+  }
+
+  //With a dictionary (the first part of the text, compressing later parts):
+  const unsigned ndict = 2000;
+  comp.setDictionary(orig,ndict);
+  decomp.setDictionary(orig,ndict);
+  pdecomp.setDictionary(orig,ndict);
+  unsigned nz_nodict(0), nz_dict(0);
+  for (unsigned i = 0; i < 50; ++i) {
+    const unsigned offset = ndict + (i*7919)%(norig-ndict);
+    const unsigned n = std::min<unsigned>(norig-offset,100+(i*37)%400);
+    unsigned nz;
+    ZLibUtils::compressToBuffer(orig+offset,n,z_oneshot,nz);
+    nz_nodict += nz;
+    comp.compress(orig+offset,n,z);
+    nz_dict += z.size();
+    decomp.decompress(z.data(),z.size(),out);
+    pdecomp.reset(z.data(),z.size(),out_partial);
+    pdecomp.ensureAvailable(n/2);
+    pdecomp.ensureAvailable(n);
+    if (!sameData(out,out_partial) || out.size()!=n || std::memcmp(out.data(),orig+offset,n)!=0) {
+      printf("ERROR: Decompressed output differs from original data when using dictionary\n");
+      return 1;
+    }
+  }
+  if (!(nz_dict<nz_nodict)) {
+    printf("ERROR: Dictionary did not improve compression\n");
+    return 1;
+  }
+
+  //Data compressed with a dictionary can not be decompressed without it or with
+  //another one, and data compressed without can still be decompressed:
+  comp.compress(orig+ndict,500,z);
+  ZLibUtils::Decompressor decomp_nodict, decomp_otherdict;
+  decomp_otherdict.setDictionary(orig+1,ndict);
+  if (!decompressFails(decomp_nodict,z)||!decompressFails(decomp_otherdict,z)||decompressFails(decomp,z)) {
+    printf("ERROR: Unexpected result when decompressing with wrong dictionary\n");
+    return 1;
+  }
+  decomp_nodict.decompress(z_oneshot.data(),z_oneshot.size(),out);
+  decomp.decompress(z_oneshot.data(),z_oneshot.size(),out);
+  if (ZLibUtils::dictionaryID(orig,ndict)==ZLibUtils::dictionaryID(orig+1,ndict)) {
+    printf("ERROR: Unexpected dictionary IDs\n");
+    return 1;
+  }
+  return 0;
+}
+
+//Test dictionaries from trainDictionary, using pieces of the text as samples:
+static int testTrainDictionary()
+{
+  const char * orig = data_orig.c_str();
+  const unsigned norig = data_orig.size();
+  std::vector<std::pair<const char*,unsigned>> samples;
+  for (unsigned i = 0; i < 40; ++i)
+    samples.emplace_back(orig+(i*7919)%(norig-400),200+(i*37)%200);
+  const std::string dict = ZLibUtils::trainDictionary(samples,1024);
+  if (dict.empty()||dict.size()>1024||dict!=ZLibUtils::trainDictionary(samples,1024)) {
+    printf("ERROR: Unexpected dictionary from trainDictionary\n");
+    return 1;
+  }
+  if (!ZLibUtils::trainDictionary(samples,0).empty()
+      ||!ZLibUtils::trainDictionary(std::vector<std::pair<const char*,unsigned>>(),1024).empty()) {
+    printf("ERROR: Expected empty dictionary from trainDictionary\n");
+    return 1;
+  }
+  ZLibUtils::Compressor comp, comp_dict;
+  ZLibUtils::Decompressor decomp_dict;
+  comp_dict.setDictionary(dict.data(),dict.size());
+  decomp_dict.setDictionary(dict.data(),dict.size());
+  Utils::DynBuffer<char> z, out;
+  unsigned nz_nodict(0), nz_dict(0);
+  for (auto& smpl : samples) {
+    comp.compress(smpl.first,smpl.second,z);
+    nz_nodict += z.size();
+    comp_dict.compress(smpl.first,smpl.second,z);
+    nz_dict += z.size();
+    decomp_dict.decompress(z.data(),z.size(),out);
+    if (out.size()!=smpl.second||std::memcmp(out.data(),smpl.first,smpl.second)!=0) {
+      printf("ERROR: Decompressed output differs from original data when using trained dictionary\n");
+      return 1;
+    }
+  }
+  if (!(nz_dict<nz_nodict)) {
+    printf("ERROR: Trained dictionary did not improve compression\n");
+    return 1;
+  }
+  return 0;
+}
+
 int main(int,char**) {
   Utils::DynBuffer<char> data_zipped;
   unsigned zippeddataLength;
@@ -68,4 +203,8 @@ int main(int,char**) {
     printf("ERROR: uncompressing null buffer yields unexpected result\n");
     return 1;
   }
+
+  if (testStateful())
+    return 1;
+  return testTrainDictionary();
 }